@@ -25,6 +25,7 @@ TEST_CASE("Test mode and help")
     REQUIRE(parser.getHelp() == "Mode options for Axial Analysis:\n"\
                                 "  -xl <x>,<y> Calculate all lines map from this seed point (can be used more than once)\n"
                                 "  -xf Calculate fewest lines map from all lines map\n"\
+                                "  -xfs <seed> Seed for the order of equally ranked lines in the fewest lines map (default 0: line order)\n"\
                                 "  -xa <radius/list of radii> run axial anlysis with specified radii\n"\
                                 " All modes expect to find the required input in the in graph\n"\
                                 " Any combination of flags above can be specified, they will always be run in the order -aa -af -au -ax\n"\
@@ -33,6 +34,7 @@ TEST_CASE("Test mode and help")
                                 "   -xal Include local measures\n"\
                                 "   -xar Include RA, RRA and total depth\n"\
                                 "   -xaw <map attribute name> perform weighted analysis using this attribute\n"\
+                                "   -at <threads> number of threads for all lines and fewest lines map construction and axial analysis\n"\
                                 "\n");
 
 }
@@ -51,6 +53,36 @@ TEST_CASE("Test Parsing Exceptions","")
         ArgumentHolder ah{"prog", "-xl"};
         REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), "-xl requires an argument" );
     }
+
+    SECTION("Thread count missing")
+    {
+        ArgumentHolder ah{"prog", "-xa", "n", "-at"};
+        REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), "-at requires an argument" );
+    }
+
+    SECTION("Thread count not a number")
+    {
+        ArgumentHolder ah{"prog", "-xa", "n", "-at", "foo"};
+        REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), Catch::Contains("Thread count must be a positive integer or 0 for all cores, got foo"));
+    }
+
+    SECTION("Seed missing")
+    {
+        ArgumentHolder ah{"prog", "-xf", "-xfs"};
+        REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), "-xfs requires an argument" );
+    }
+
+    SECTION("Seed not a number")
+    {
+        ArgumentHolder ah{"prog", "-xf", "-xfs", "foo"};
+        REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), Catch::Contains("Seed must be a non-negative integer of at most 4294967295, got foo"));
+    }
+
+    SECTION("Seed too large")
+    {
+        ArgumentHolder ah{"prog", "-xf", "-xfs", "4294967296"};
+        REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), Catch::Contains("got 4294967296"));
+    }
 }
 
 TEST_CASE("Test mode parsing", "")
@@ -76,6 +108,15 @@ TEST_CASE("Test mode parsing", "")
         REQUIRE(parser.runFewestLines());
         REQUIRE_FALSE(parser.runUnlink());
         REQUIRE_FALSE(parser.runAnalysis());
+        REQUIRE(parser.getFewestLineSeed() == 0);
+    }
+    SECTION("Fewest lines + seed")
+    {
+        ArgumentHolder ah{"prog", "-xf", "-xfs", "4294967295", "-at", "3"};
+        parser.parse(ah.argc(), ah.argv());
+        REQUIRE(parser.runFewestLines());
+        REQUIRE(parser.getFewestLineSeed() == 4294967295u);
+        REQUIRE(parser.getThreadCount() == 3);
     }
     SECTION("Analysis")
     {
@@ -88,6 +129,7 @@ TEST_CASE("Test mode parsing", "")
         REQUIRE_FALSE(parser.calculateRRA());
         REQUIRE_FALSE(parser.useChoice());
         REQUIRE_FALSE(parser.useLocal());
+        REQUIRE(parser.getThreadCount() == 1);
     }
     SECTION("Analysis -rra")
     {
@@ -113,6 +155,14 @@ TEST_CASE("Test mode parsing", "")
         REQUIRE(parser.useChoice());
         REQUIRE_FALSE(parser.useLocal());
     }
+    SECTION("Analysis + threads")
+    {
+        ArgumentHolder ah{"prog", "-xa", "n", "-xac", "-at", "4"};
+        parser.parse(ah.argc(), ah.argv());
+        REQUIRE(parser.runAnalysis());
+        REQUIRE(parser.useChoice());
+        REQUIRE(parser.getThreadCount() == 4);
+    }
     SECTION("Analysis + local")
     {
         ArgumentHolder ah{"prog", "-xa", "n", "-xal"};
@@ -31,7 +31,12 @@ TEST_CASE("Isovistparser string constants")
                                 "    the latter two are optional.\n"\
                                 "  Those two arguments cannot be mixed\n"\
                                 "  Angles for partial isovists are in degrees, counted anti-clockwise with 0°\n"\
-                                "  pointing to the right.\n\n" );
+                                "  pointing to the right.\n"\
+                                "  -it <threads> number of threads to make the isovists on (default 1, 0 for all cores)\n"\
+                                "  -ibs <splitter> how the BSP tree picks its partition lines, one of midpoint (default)\n"\
+                                "    or cost (balanced, and built on the -it threads)\n"\
+                                "  -ibd <depth> depth of the BSP tree below which the cost splitter builds subtrees\n"\
+                                "    as separate tasks (default 8)\n\n" );
 }
 
 TEST_CASE("Parse isovist on the command line")
@@ -46,7 +51,35 @@ TEST_CASE("Parse isovist on the command line")
 
     REQUIRE(parser.getIsovists()[1].getLocation().y == Approx(5.0));
     REQUIRE(parser.getIsovists()[1].getViewAngle() == Approx(3.141592));
+    REQUIRE(parser.getThreadCount() == 1);
+}
+
+TEST_CASE("Parse isovist thread count")
+{
+    ArgumentHolder ah{"prog", "-ii", "1,2", "-it", "3"};
+    IsovistParser parser;
+    parser.parse(ah.argc(), ah.argv());
+    REQUIRE(parser.getThreadCount() == 3);
+}
 
+TEST_CASE("Parse isovist BSP tree options")
+{
+    {
+        ArgumentHolder ah{"prog", "-ii", "1,2"};
+        IsovistParser parser;
+        parser.parse(ah.argc(), ah.argv());
+        REQUIRE(parser.getBSPOptions().splitter == BSPTree::Splitter::MIDPOINT);
+        REQUIRE(parser.getBSPOptions().taskDepth == 8);
+        REQUIRE(parser.getBSPOptions().threads == 1);
+    }
+    {
+        ArgumentHolder ah{"prog", "-ii", "1,2", "-it", "4", "-ibs", "cost", "-ibd", "3"};
+        IsovistParser parser;
+        parser.parse(ah.argc(), ah.argv());
+        REQUIRE(parser.getBSPOptions().splitter == BSPTree::Splitter::COST);
+        REQUIRE(parser.getBSPOptions().taskDepth == 3);
+        REQUIRE(parser.getBSPOptions().threads == 4);
+    }
 }
 
 
@@ -133,6 +166,24 @@ TEST_CASE("Command line failures")
         REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), Catch::Contains("-ii cannot be used together with -if"));
     }
 
+    SECTION( "Missing arguments for -it")
+    {
+        ArgumentHolder ah{"prog", "-ii", "1,1", "-it"};
+        REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), Catch::Contains("-it requires an argument"));
+    }
+
+    SECTION( "Unknown BSP splitter")
+    {
+        ArgumentHolder ah{"prog", "-ii", "1,1", "-ibs", "random"};
+        REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), Catch::Contains("BSP splitter must be midpoint or cost, got random"));
+    }
+
+    SECTION( "Zero BSP task depth")
+    {
+        ArgumentHolder ah{"prog", "-ii", "1,1", "-ibd", "0"};
+        REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), Catch::Contains("BSP task depth must be a positive integer, got 0"));
+    }
+
     SECTION("Nothing to do")
     {
         ArgumentHolder ah{"prog"};
@@ -60,6 +60,21 @@ TEST_CASE("MapConvertParserFail", "Error cases")
         REQUIRE_THROWS_WITH(parser.parse(int(ah.argc()), ah.argv()), Catch::Contains("-crsl must be a number >0, got -1"));
     }
 
+    SECTION("Missing argument to cth")
+    {
+        MapConvertParser parser;
+        ArgumentHolder ah{"prog", "-co", "axial", "-con", "new_axial", "-cth"};
+        REQUIRE_THROWS_WITH(parser.parse(int(ah.argc()), ah.argv()), Catch::Contains("-cth requires an argument"));
+    }
+
+    SECTION("Non-numeric input to -cth")
+    {
+        MapConvertParser parser;
+        ArgumentHolder ah{"prog", "-co", "axial", "-con", "new_axial", "-cth", "foo"};
+        REQUIRE_THROWS_WITH(parser.parse(int(ah.argc()), ah.argv()),
+                            Catch::Contains("Thread count must be a positive integer or 0 for all cores, got foo"));
+    }
+
     SECTION("rubbish input to -co")
     {
         MapConvertParser parser;
@@ -99,5 +114,14 @@ TEST_CASE("MapConvertParserSuccess", "Read successfully")
         parser.parse(int(ah.argc()), ah.argv());
         REQUIRE(parser.outputMapName() == "new_axial");
         REQUIRE(parser.outputMapType() == ShapeMap::AXIALMAP);
+        REQUIRE(parser.threadCount() == 1);
+    }
+
+    SECTION("Segment on several threads")
+    {
+        ArgumentHolder ah{"prog", "-co", "segment", "-con", "new_segment", "-cth", "4"};
+        parser.parse(int(ah.argc()), ah.argv());
+        REQUIRE(parser.outputMapType() == ShapeMap::SEGMENTMAP);
+        REQUIRE(parser.threadCount() == 4);
     }
 }
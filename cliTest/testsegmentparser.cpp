@@ -35,7 +35,8 @@ TEST_CASE("Test segment mode and help")
                                 "       angular\n"\
                                 "  -sic to include choice (only for Tulip)\n"\
                                 "  -stb <tulip bins> (4 to 1024, 1024 approximates full angular)\n"\
-                                "  -swa <map attribute name> perform weighted analysis using this attribute (only for Tulip)\n");
+                                "  -swa <map attribute name> perform weighted analysis using this attribute (only for Tulip)\n"\
+                                "  -sth <threads> number of threads (only for Tulip)\n");
 
 }
 
@@ -131,6 +132,18 @@ TEST_CASE("Test Segment Parsing Exceptions","")
         ArgumentHolder ah{"prog", "-st", "tulip", "-sr", "n", "-srt", "steps", "-stb", "1025"};
         REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), "-stb must be a number between 4 and 1024, got 1025" );
     }
+
+    SECTION("Argument missing -sth")
+    {
+        ArgumentHolder ah{"prog", "-st", "tulip", "-sr", "n", "-srt", "steps", "-stb", "1024", "-sth"};
+        REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), "-sth requires an argument" );
+    }
+
+    SECTION("Invalid thread count")
+    {
+        ArgumentHolder ah{"prog", "-st", "tulip", "-sr", "n", "-srt", "steps", "-stb", "1024", "-sth", "foo"};
+        REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), Catch::Contains("Thread count must be a positive integer or 0 for all cores, got foo"));
+    }
 }
 
 TEST_CASE("Test segment mode parsing", "")
@@ -179,6 +192,14 @@ TEST_CASE("Test segment mode parsing", "")
         REQUIRE(parser.getRadiusType() == SegmentParser::RadiusType::SEGMENT_STEPS);
         REQUIRE(parser.getRadii().size() == 1);
         REQUIRE(int(parser.getRadii()[0]) == -1);
+        REQUIRE(parser.getThreadCount() == 1);
+    }
+    SECTION("Analysis Tulip on several threads")
+    {
+        ArgumentHolder ah{"prog", "-st", "tulip", "-sr", "n", "-srt", "angular", "-stb", "1024", "-sth", "4"};
+        parser.parse(ah.argc(), ah.argv());
+        REQUIRE(parser.getAnalysisType() == SegmentParser::AnalysisType::ANGULAR_TULIP);
+        REQUIRE(parser.getThreadCount() == 4);
     }
 
 }
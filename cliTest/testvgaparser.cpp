@@ -62,6 +62,42 @@ TEST_CASE("VGA args invalid", "")
         VgaParser p;
         REQUIRE_THROWS_WITH(p.parse(ah.argc(), ah.argv()), Catch::Contains("Metric vga requires a radius, use -vr <radius>"));
     }
+
+    {
+        ArgumentHolder ah{"prog", "-f", "infile", "-o", "outfile", "-m", "VGA", "-vm", "visibility", "-vg", "-vr", "n", "-vt"};
+        VgaParser p;
+        REQUIRE_THROWS_WITH(p.parse(ah.argc(), ah.argv()), Catch::Contains("-vt requires an argument"));
+    }
+
+    {
+        ArgumentHolder ah{"prog", "-f", "infile", "-o", "outfile", "-m", "VGA", "-vm", "visibility", "-vg", "-vr", "n", "-vt", "foo"};
+        VgaParser p;
+        REQUIRE_THROWS_WITH(p.parse(ah.argc(), ah.argv()), Catch::Contains("Thread count must be a positive integer or 0 for all cores, got foo"));
+    }
+
+    {
+        ArgumentHolder ah{"prog", "-f", "infile", "-o", "outfile", "-m", "VGA", "-vm", "angular", "-vq"};
+        VgaParser p;
+        REQUIRE_THROWS_WITH(p.parse(ah.argc(), ah.argv()), Catch::Contains("-vq requires an argument"));
+    }
+
+    {
+        ArgumentHolder ah{"prog", "-f", "infile", "-o", "outfile", "-m", "VGA", "-vm", "angular", "-vq", "heap"};
+        VgaParser p;
+        REQUIRE_THROWS_WITH(p.parse(ah.argc(), ah.argv()), Catch::Contains("Invalid VGA search queue: heap"));
+    }
+
+    {
+        ArgumentHolder ah{"prog", "-f", "infile", "-o", "outfile", "-m", "VGA", "-vm", "isovist", "-vbs", "sah"};
+        VgaParser p;
+        REQUIRE_THROWS_WITH(p.parse(ah.argc(), ah.argv()), Catch::Contains("BSP splitter must be midpoint or cost, got sah"));
+    }
+
+    {
+        ArgumentHolder ah{"prog", "-f", "infile", "-o", "outfile", "-m", "VGA", "-vm", "isovist", "-vbd", "x"};
+        VgaParser p;
+        REQUIRE_THROWS_WITH(p.parse(ah.argc(), ah.argv()), Catch::Contains("BSP task depth must be a positive integer, got x"));
+    }
 }
 
 TEST_CASE("VGA args valid", "valid")
@@ -98,6 +134,34 @@ TEST_CASE("VGA args valid", "valid")
         REQUIRE(cmdP.globalMeasures());
         REQUIRE(cmdP.localMeasures());
         REQUIRE(cmdP.getRadius() == "4");
+        REQUIRE(cmdP.getThreadCount() == 1);
+        REQUIRE_FALSE(cmdP.multiSourceTraversal());
+    }
+
+    {
+        ArgumentHolder ah{"prog", "-f", "infile", "-o", "outfile", "-m", "VGA", "-vm", "visibility", "-vg", "-vr", "3", "-vb"};
+        VgaParser cmdP;
+        cmdP.parse(ah.argc(), ah.argv());
+        REQUIRE(cmdP.globalMeasures());
+        REQUIRE(cmdP.multiSourceTraversal());
+    }
+
+    {
+        ArgumentHolder ah{"prog", "-f", "infile", "-o", "outfile", "-m", "VGA", "-vm", "visibility", "-vg", "-vr", "n", "-vt", "8"};
+        VgaParser cmdP;
+        cmdP.parse(ah.argc(), ah.argv());
+        REQUIRE(cmdP.getVgaMode() == VgaParser::VgaMode::VISBILITY);
+        REQUIRE(cmdP.globalMeasures());
+        REQUIRE(cmdP.getThreadCount() == 8);
+        REQUIRE_FALSE(cmdP.useSetQueue());
+    }
+
+    {
+        ArgumentHolder ah{"prog", "-f", "infile", "-o", "outfile", "-m", "VGA", "-vm", "metric", "-vr", "n", "-vq", "set"};
+        VgaParser cmdP;
+        cmdP.parse(ah.argc(), ah.argv());
+        REQUIRE(cmdP.getVgaMode() == VgaParser::VgaMode::METRIC);
+        REQUIRE(cmdP.useSetQueue());
     }
 
     {
@@ -107,5 +171,14 @@ TEST_CASE("VGA args valid", "valid")
         REQUIRE(cmdP.getVgaMode() == VgaParser::VgaMode::THRU_VISION);
     }
 
+    {
+        ArgumentHolder ah{"prog", "-f", "infile", "-o", "outfile", "-m", "VGA", "-vm", "isovist", "-vt", "2", "-vbs", "cost", "-vbd", "5"};
+        VgaParser cmdP;
+        cmdP.parse(ah.argc(), ah.argv());
+        REQUIRE(cmdP.getBSPOptions().splitter == BSPTree::Splitter::COST);
+        REQUIRE(cmdP.getBSPOptions().taskDepth == 5);
+        REQUIRE(cmdP.getBSPOptions().threads == 2);
+    }
+
 
 }
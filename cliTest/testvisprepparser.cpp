@@ -41,6 +41,18 @@ TEST_CASE("VisPrepParserFail", "Error cases")
         ArgumentHolder ah{"prog", "-pf", "-pg", "1.2"};
         REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), Catch::Contains("-pf requires an argument"));
     }
+    SECTION("Missing argument to pt")
+    {
+        VisPrepParser parser;
+        ArgumentHolder ah{"prog", "-pm", "-pt"};
+        REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), Catch::Contains("-pt requires an argument"));
+    }
+    SECTION("Non-numeric input to -pt")
+    {
+        VisPrepParser parser;
+        ArgumentHolder ah{"prog", "-pm", "-pt", "all"};
+        REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), Catch::Contains("Thread count must be a positive integer"));
+    }
 
     SECTION("Non-numeric input to -pg")
     {
@@ -152,6 +164,27 @@ TEST_CASE("VisPrepParserFail", "Error cases")
         ArgumentHolder ah{"prog", "-pg", "1", "-pu"};
         REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), Catch::Contains("-pu can not be used with any other option apart from -pl"));
     }
+
+    SECTION("Make and update")
+    {
+        VisPrepParser parser;
+        ArgumentHolder ah{"prog", "-pp", "1.2,1.3", "-pm", "-pd"};
+        REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), Catch::Contains("-pd cannot be used together with -pm"));
+    }
+
+    SECTION("Update without points")
+    {
+        VisPrepParser parser;
+        ArgumentHolder ah{"prog", "-pd"};
+        REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), Catch::Contains("-pd needs points to fill (-pp or -pf) and cannot be used with -pg or -pb"));
+    }
+
+    SECTION("Grid and update")
+    {
+        VisPrepParser parser;
+        ArgumentHolder ah{"prog", "-pg", "1", "-pp", "1.2,1.3", "-pd"};
+        REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), Catch::Contains("-pd needs points to fill (-pp or -pf) and cannot be used with -pg or -pb"));
+    }
 }
 
 TEST_CASE("VisprepParserMakeSuccess", "Read successfully - Make")
@@ -181,6 +214,19 @@ TEST_CASE("VisprepParserMakeSuccess", "Read successfully - Make")
         REQUIRE(parser.getMaxVisibility() == Approx(2.1));
     }
 
+    SECTION("Read thread count from commandline")
+    {
+        std::stringstream p1;
+        p1 << x1 << "," << y1 << std::flush;
+        std::stringstream p2;
+        p2 << x2 << "," << y2 << std::flush;
+
+        ArgumentHolder ah{"prog", "-pg", gstring.str(), "-pp", p1.str(), "-pp", p2.str(), "-pm", "-pt", "4"};
+        parser.parse(ah.argc(), ah.argv());
+        REQUIRE(parser.getMakeGraph());
+        REQUIRE(parser.getThreadCount() == 4);
+    }
+
     SECTION("Read from file")
     {
         SelfCleaningFile scf("testpoints.csv");
@@ -207,6 +253,23 @@ TEST_CASE("VisprepParserMakeSuccess", "Read successfully - Make")
     REQUIRE(points[1].y == Approx(y2));
 }
 
+TEST_CASE("VisprepParserUpdateSuccess", "Read successfully - Update")
+{
+    VisPrepParser parser;
+    ArgumentHolder ah{"prog", "-pp", "1.1,1.2", "-pd", "-pr", "2.1", "-pt", "2"};
+    parser.parse(ah.argc(), ah.argv());
+    REQUIRE(parser.getUpdateGraph());
+    REQUIRE_FALSE(parser.getMakeGraph());
+    REQUIRE_FALSE(parser.getUnmakeGraph());
+    REQUIRE(parser.getGrid() < 0);
+    REQUIRE(parser.getMaxVisibility() == Approx(2.1));
+    REQUIRE(parser.getThreadCount() == 2);
+    auto points = parser.getFillPoints();
+    REQUIRE(points.size() == 1);
+    REQUIRE(points[0].x == Approx(1.1));
+    REQUIRE(points[0].y == Approx(1.2));
+}
+
 TEST_CASE("VisprepParserUnmakeSuccess", "Read successfully - Unmake")
 {
     VisPrepParser parser;
@@ -26,6 +26,7 @@ CAxialAnalysisOptionsDlg::CAxialAnalysisOptionsDlg(MetaGraph *graph, QWidget *pa
     m_weighted = false;
     m_rra = false;
     m_local = false;
+    m_threads = 1;
 
     m_meta_graph = graph;
 
@@ -35,6 +36,7 @@ CAxialAnalysisOptionsDlg::CAxialAnalysisOptionsDlg(MetaGraph *graph, QWidget *pa
             m_choice = mainWin->m_options.choice;
             m_local = mainWin->m_options.local;
             m_rra = mainWin->m_options.fulloutput;
+            m_threads = mainWin->m_options.thread_count;
 
             m_radius = QString(tr("n"));
 
@@ -71,6 +73,7 @@ CAxialAnalysisOptionsDlg::CAxialAnalysisOptionsDlg(MetaGraph *graph, QWidget *pa
 
     c_attribute_chooser->setCurrentIndex(m_attribute);
     c_radius->setText(m_radius);
+    c_threads->setValue(m_threads);
 }
 
 void CAxialAnalysisOptionsDlg::OnUpdateRadius() {
@@ -159,6 +162,7 @@ void CAxialAnalysisOptionsDlg::OnOK() {
             mainWin->m_options.choice = m_choice;
             mainWin->m_options.local = m_local;
             mainWin->m_options.fulloutput = m_rra;
+            mainWin->m_options.thread_count = m_threads;
 
             // attributes:
             if (!m_weighted) {
@@ -197,6 +201,8 @@ void CAxialAnalysisOptionsDlg::UpdateData(bool value) {
             m_local = true;
         else
             m_local = false;
+
+        m_threads = c_threads->value();
     } else {
         c_radius->setText(m_radius);
         if (m_choice)
@@ -219,6 +225,8 @@ void CAxialAnalysisOptionsDlg::UpdateData(bool value) {
             c_local->setCheckState(Qt::Checked);
         else
             c_local->setCheckState(Qt::Unchecked);
+
+        c_threads->setValue(m_threads);
     }
 }
 
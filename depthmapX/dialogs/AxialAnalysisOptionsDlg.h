@@ -30,6 +30,7 @@ public:
 	bool	m_weighted;
 	bool	m_rra;
 	bool	m_local;
+	int		m_threads;
 	MetaGraph *m_meta_graph;
 	void showEvent(QShowEvent * event);
 
@@ -23,7 +23,7 @@
 
 using namespace depthmapX;
 
-AxialParser::AxialParser() :  m_runFewestLines(false), m_runAnalysis(false), m_choice(false), m_local(false), m_rra(false)
+AxialParser::AxialParser() :  m_runFewestLines(false), m_runAnalysis(false), m_choice(false), m_local(false), m_rra(false), m_threadCount(1), m_fewestLineSeed(0)
 {
 
 }
@@ -39,6 +39,7 @@ std::string AxialParser::getHelp() const
     return  "Mode options for Axial Analysis:\n"\
             "  -xl <x>,<y> Calculate all lines map from this seed point (can be used more than once)\n"
             "  -xf Calculate fewest lines map from all lines map\n"\
+            "  -xfs <seed> Seed for the order of equally ranked lines in the fewest lines map (default 0: line order)\n"\
             "  -xa <radius/list of radii> run axial anlysis with specified radii\n"\
             " All modes expect to find the required input in the in graph\n"\
             " Any combination of flags above can be specified, they will always be run in the order -aa -af -au -ax\n"\
@@ -47,6 +48,7 @@ std::string AxialParser::getHelp() const
             "   -xal Include local measures\n"\
             "   -xar Include RA, RRA and total depth\n"\
             "   -xaw <map attribute name> perform weighted analysis using this attribute\n"\
+            "   -at <threads> number of threads for all lines and fewest lines map construction and axial analysis\n"\
             "\n";
 }
 
@@ -63,6 +65,11 @@ void AxialParser::parse(int argc, char **argv)
         {
             m_runFewestLines = true;
         }
+        else if (std::strcmp(argv[i], "-xfs") == 0)
+        {
+            ENFORCE_ARGUMENT("-xfs", i)
+            m_fewestLineSeed = parseSeed(argv[i]);
+        }
         else if (std::strcmp(argv[i], "-xa") == 0)
         {
             ENFORCE_ARGUMENT("-xa", i)
@@ -90,6 +97,11 @@ void AxialParser::parse(int argc, char **argv)
             ENFORCE_ARGUMENT("-xaw", i)
             m_attribute = argv[i];
         }
+        else if (std::strcmp(argv[i], "-at") == 0)
+        {
+            ENFORCE_ARGUMENT("-at", i)
+            m_threadCount = parseThreadCount(argv[i]);
+        }
     }
 
     if (!runAllLines() && !runFewestLines() && !runUnlink() && !runAnalysis())
@@ -62,6 +62,8 @@ public:
 
     const std::vector<double>& getRadii() const { return m_radii;}
     const std::string getAttribute() const { return m_attribute;}
+    int getThreadCount() const { return m_threadCount; }
+    unsigned int getFewestLineSeed() const { return m_fewestLineSeed; }
 
 private:
     std::vector<Point2f> m_allAxesRoots;
@@ -72,4 +74,6 @@ private:
     bool m_local;
     bool m_rra;
     std::string m_attribute;
+    int m_threadCount;
+    unsigned int m_fewestLineSeed;
 };
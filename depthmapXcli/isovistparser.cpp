@@ -15,6 +15,7 @@
 #include "isovistparser.h"
 #include "parsingutils.h"
 #include "exceptions.h"
+#include "parsingutils.h"
 #include "salalib/entityparsing.h"
 #include <sstream>
 #include "runmethods.h"
@@ -22,7 +23,8 @@
 
 using namespace depthmapX;
 
-IsovistParser::IsovistParser()
+IsovistParser::IsovistParser() : m_threadCount(1), m_bspSplitter(BSPTree::BuildOptions().splitter),
+    m_bspTaskDepth(BSPTree::BuildOptions().taskDepth)
 {
 
 }
@@ -43,7 +45,12 @@ std::string IsovistParser::getHelp() const
            "    the latter two are optional.\n"\
            "  Those two arguments cannot be mixed\n"\
            "  Angles for partial isovists are in degrees, counted anti-clockwise with 0°\n"\
-           "  pointing to the right.\n\n";
+           "  pointing to the right.\n"\
+           "  -it <threads> number of threads to make the isovists on (default 1, 0 for all cores)\n"\
+           "  -ibs <splitter> how the BSP tree picks its partition lines, one of midpoint (default)\n"\
+           "    or cost (balanced, and built on the -it threads)\n"\
+           "  -ibd <depth> depth of the BSP tree below which the cost splitter builds subtrees\n"\
+           "    as separate tasks (default 8)\n\n";
 }
 
 void IsovistParser::parse(int argc, char **argv)
@@ -74,6 +81,21 @@ void IsovistParser::parse(int argc, char **argv)
             ENFORCE_ARGUMENT("-if",i);
             isovistFile = argv[i];
         }
+        else if (std::strcmp(argv[i], "-it") == 0)
+        {
+            ENFORCE_ARGUMENT("-it", i)
+            m_threadCount = parseThreadCount(argv[i]);
+        }
+        else if (std::strcmp(argv[i], "-ibs") == 0)
+        {
+            ENFORCE_ARGUMENT("-ibs", i)
+            m_bspSplitter = parseBSPSplitter(argv[i]);
+        }
+        else if (std::strcmp(argv[i], "-ibd") == 0)
+        {
+            ENFORCE_ARGUMENT("-ibd", i)
+            m_bspTaskDepth = parseBSPTaskDepth(argv[i]);
+        }
     }
 
     if (!isovistFile.empty())
@@ -94,7 +116,16 @@ void IsovistParser::parse(int argc, char **argv)
 
 }
 
+BSPTree::BuildOptions IsovistParser::getBSPOptions() const
+{
+    BSPTree::BuildOptions options;
+    options.splitter = m_bspSplitter;
+    options.threads = m_threadCount;
+    options.taskDepth = m_bspTaskDepth;
+    return options;
+}
+
 void IsovistParser::run(const CommandLineParser &clp, IPerformanceSink &perfWriter) const
 {
-    dm_runmethods::runIsovists(clp, m_isovists, perfWriter);
+    dm_runmethods::runIsovists(clp, m_isovists, m_threadCount, getBSPOptions(), perfWriter);
 }
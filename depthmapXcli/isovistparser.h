@@ -17,6 +17,7 @@
 
 #include "imodeparser.h"
 #include "salalib/isovistdef.h"
+#include "genlib/bsptree.h"
 #include <vector>
 
 class IsovistParser : public IModeParser
@@ -32,6 +33,12 @@ public:
     void run(const CommandLineParser &clp, IPerformanceSink &perfWriter) const;
 
     const std::vector<IsovistDefinition> &getIsovists() const{ return m_isovists;}
+    int getThreadCount() const { return m_threadCount; }
+    // the thread count is taken from -it
+    BSPTree::BuildOptions getBSPOptions() const;
 private:
     std::vector<IsovistDefinition> m_isovists;
+    int m_threadCount;
+    BSPTree::Splitter m_bspSplitter;
+    int m_bspTaskDepth;
 };
@@ -84,6 +84,11 @@ void MapConvertParser::parse(int argc, char **argv)
                 throw CommandLineException(std::string("-crsl must be a number >0, got ") + argv[i]);
             }
         }
+        else if (std::strcmp(argv[i], "-cth") == 0)
+        {
+            ENFORCE_ARGUMENT("-cth", i)
+            m_threadCount = parseThreadCount(argv[i]);
+        }
     }
 
     if (m_outMapType == ShapeMap::EMPTYMAP)
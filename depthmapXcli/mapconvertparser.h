@@ -26,7 +26,8 @@ public:
         m_outMapName(""),
         m_removeInputMap(false),
         m_copyAttributes(false),
-        m_removeStubLengthPRC(0)
+        m_removeStubLengthPRC(0),
+        m_threadCount(1)
     {}
 
     // IModeParser interface
@@ -49,7 +50,9 @@ public:
                 "  -con Output map name\n"\
                 "  -cir Remove input map\n"\
                 "  -coc Copy attributes to output map (Only between DATA, AXIAL and SEGMENT)\n"\
-                "  -crsl <%> Percent of line length of axial stubs to remove (Only for AXIAL -> SEGMENT)\n\n";
+                "  -crsl <%> Percent of line length of axial stubs to remove (Only for AXIAL -> SEGMENT)\n"\
+                "  -cth <threads> number of threads to make the connections on (Only for conversions to AXIAL\n"\
+                "       and AXIAL -> SEGMENT, default 1, 0 for all cores)\n\n";
     }
     void parse(int argc, char **argv);
     void run(const CommandLineParser &clp, IPerformanceSink &perfWriter) const;
@@ -59,6 +62,7 @@ public:
     bool removeInputMap() const { return m_removeInputMap; }
     bool copyAttributes() const { return m_copyAttributes; }
     double removeStubLength() const { return m_removeStubLengthPRC; }
+    int threadCount() const { return m_threadCount; }
 
 private:
     int m_outMapType;
@@ -66,4 +70,5 @@ private:
     bool m_removeInputMap;
     bool m_copyAttributes;
     double m_removeStubLengthPRC;
+    int m_threadCount;
 };
@@ -18,6 +18,8 @@
 #include <iostream>
 #include <algorithm>
 #include <cstring>
+#include <cstdlib>
+#include <climits>
 #include "exceptions.h"
 
 std::vector<double> depthmapX::parseRadiusList(const std::string &radiusList)
@@ -65,3 +67,44 @@ std::vector<double> depthmapX::parseRadiusList(const std::string &radiusList)
     }
     return result;
 }
+
+int depthmapX::parseThreadCount(const std::string &threadCount)
+{
+    if (threadCount.empty() || !has_only_digits(threadCount))
+    {
+        throw CommandLineException(std::string("Thread count must be a positive integer or 0 for all cores, got ") + threadCount);
+    }
+    return std::atoi(threadCount.c_str());
+}
+
+unsigned int depthmapX::parseSeed(const std::string &seed)
+{
+    if (seed.empty() || !has_only_digits(seed) || seed.size() > 10 || std::stoull(seed) > UINT_MAX)
+    {
+        throw CommandLineException(std::string("Seed must be a non-negative integer of at most ") +
+                                   std::to_string(UINT_MAX) + ", got " + seed);
+    }
+    return static_cast<unsigned int>(std::stoull(seed));
+}
+
+BSPTree::Splitter depthmapX::parseBSPSplitter(const std::string &splitter)
+{
+    if (splitter == "midpoint")
+    {
+        return BSPTree::Splitter::MIDPOINT;
+    }
+    if (splitter == "cost")
+    {
+        return BSPTree::Splitter::COST;
+    }
+    throw CommandLineException(std::string("BSP splitter must be midpoint or cost, got ") + splitter);
+}
+
+int depthmapX::parseBSPTaskDepth(const std::string &depth)
+{
+    if (depth.empty() || !has_only_digits(depth) || std::atoi(depth.c_str()) < 1)
+    {
+        throw CommandLineException(std::string("BSP task depth must be a positive integer, got ") + depth);
+    }
+    return std::atoi(depth.c_str());
+}
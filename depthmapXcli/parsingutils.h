@@ -23,6 +23,8 @@
         throw CommandLineException(flag  " requires an argument");\
     }\
 
+#include "genlib/bsptree.h"
+
 #include <vector>
 #include <string>
 
@@ -42,4 +44,16 @@ namespace depthmapX{
 
     std::vector<double> parseRadiusList(const std::string &radiusList);
 
+    // number of worker threads, 0 meaning "use all cores"
+    int parseThreadCount(const std::string &threadCount);
+
+    // seed for a reproducible run, a non-negative integer that fits an unsigned int
+    unsigned int parseSeed(const std::string &seed);
+
+    // BSP tree splitter: midpoint or cost
+    BSPTree::Splitter parseBSPSplitter(const std::string &splitter);
+
+    // depth of the BSP tree below which subtrees are built as separate tasks, at least 1
+    int parseBSPTaskDepth(const std::string &depth);
+
 }
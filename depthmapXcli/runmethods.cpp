@@ -241,6 +241,7 @@ namespace dm_runmethods
                 {
                     options->radius = converter.ConvertForVisibility(vgaP.getRadius());
                 }
+                options->multi_source_bfs = vgaP.multiSourceTraversal();
                 break;
             case VgaParser::VgaMode::METRIC:
                 options->output_type = Options::OUTPUT_METRIC;
@@ -258,6 +259,15 @@ namespace dm_runmethods
             default:
                 throw depthmapX::SetupCheckException("Unsupported VGA mode");
         }
+        options->thread_count = vgaP.getThreadCount();
+        options->traversal_queue = vgaP.useSetQueue() ? Options::QUEUE_SET : Options::QUEUE_BUCKET;
+        if (options->output_type == Options::OUTPUT_ISOVIST)
+        {
+            // made separately so that the time to build it is reported on its own
+            std::cout << " ok\nBuilding BSP tree..." << std::flush;
+            mgraph->setBSPOptions(vgaP.getBSPOptions());
+            DO_TIMED("Build BSP tree", mgraph->makeBSPtree(getCommunicator(cmdP).get()))
+        }
         std::cout << " ok\nAnalysing graph..." << std::flush;
 
         DO_TIMED("Run VGA", mgraph->analyseGraph(getCommunicator(cmdP).get(), *options, cmdP.simpleMode() ))
@@ -282,8 +292,10 @@ namespace dm_runmethods
             double maxVisibility,
             bool boundaryGraph,
             bool makeGraph,
+            bool updateGraph,
             bool unmakeGraph,
             bool removeLinksWhenUnmaking,
+            int threadCount,
             IPerformanceSink &perfWriter)
     {
         auto mGraph = loadGraph(clp.getFileName().c_str(),perfWriter);
@@ -324,6 +336,11 @@ namespace dm_runmethods
             }
             DO_TIMED("Unmaking graph", mGraph->getDisplayedPointMap().unmake(removeLinksWhenUnmaking))
         } else {
+            if(updateGraph && !mGraph->getDisplayedPointMap().isProcessed()) {
+                std::stringstream message;
+                message << "Current map has not had its graph made so there's nothing to update" << std::flush;
+                throw depthmapX::RuntimeException(message.str());
+            }
             if(fillPoints.size() > 0) {
                 std::cout << "ok\nFilling grid... " << std::flush;
                 DO_TIMED("Filling grid",
@@ -331,7 +348,11 @@ namespace dm_runmethods
             }
             if(makeGraph) {
                 std::cout << "ok\nMaking graph... " << std::flush;
-                DO_TIMED("Making graph", mGraph->makeGraph(getCommunicator(clp).get(), boundaryGraph ? 1 : 0, maxVisibility))
+                DO_TIMED("Making graph", mGraph->makeGraph(getCommunicator(clp).get(), boundaryGraph ? 1 : 0, maxVisibility, threadCount))
+            }
+            if(updateGraph) {
+                std::cout << "ok\nUpdating graph... " << std::flush;
+                DO_TIMED("Updating graph", mGraph->updateGraph(getCommunicator(clp).get(), std::vector<Line>(), maxVisibility, threadCount))
             }
         }
 
@@ -353,7 +374,7 @@ namespace dm_runmethods
            }
            std::cout << "Making all line map... " << std::flush;
            DO_TIMED("Making all axes map", for_each (ap.getAllAxesRoots().begin(),ap.getAllAxesRoots().end(),
-                                                     [&mGraph, &clp](const Point2f &point)->void{mGraph->makeAllLineMap(getCommunicator(clp).get(), point);} ))
+                                                     [&mGraph, &clp, &ap](const Point2f &point)->void{mGraph->makeAllLineMap(getCommunicator(clp).get(), point, ap.getThreadCount());} ))
            std::cout << "ok" << std::endl;
         }
 
@@ -368,7 +389,7 @@ namespace dm_runmethods
                 throw depthmapX::RuntimeException("All line map must be constructed before fewest lines can be constructed. Use -aa to do this");
             }
             std::cout << "Constructing fewest line map... " << std::flush;
-            DO_TIMED("Fewest line map", mGraph->makeFewestLineMap(getCommunicator(clp).get(), 1))
+            DO_TIMED("Fewest line map", mGraph->makeFewestLineMap(getCommunicator(clp).get(), 1, ap.getFewestLineSeed(), ap.getThreadCount()))
             std::cout << "ok" << std::endl;
         }
 
@@ -381,6 +402,7 @@ namespace dm_runmethods
             options.choice = ap.useChoice();
             options.local = ap.useLocal();
             options.fulloutput = ap.calculateRRA();
+            options.thread_count = ap.getThreadCount();
             options.weighted_measure_col = -1;
 
             if(!ap.getAttribute().empty()) {
@@ -418,6 +440,7 @@ namespace dm_runmethods
         options.radius_set.insert(radii.begin(), radii.end());
         options.choice = sp.includeChoice();
         options.tulip_bins = sp.getTulipBins();
+        options.thread_count = sp.getThreadCount();
         options.weighted_measure_col = -1;
 
         if(!sp.getAttribute().empty()) {
@@ -632,15 +655,16 @@ namespace dm_runmethods
         }
     }
 
-    void runIsovists(const CommandLineParser &clp, const std::vector<IsovistDefinition> &isovists, IPerformanceSink &perfWriter)
+    void runIsovists(const CommandLineParser &clp, const std::vector<IsovistDefinition> &isovists, int threadCount,
+                     const BSPTree::BuildOptions &bspOptions, IPerformanceSink &perfWriter)
     {
         auto mGraph = loadGraph(clp.getFileName().c_str(),perfWriter);
 
-        std::cout << "Making " << isovists.size() << " isovists... "  << std::flush;
-        DO_TIMED("Make isovists", std::for_each(isovists.begin(), isovists.end(),
-            [&mGraph, &clp](const IsovistDefinition &isovist)->void{
-                mGraph->makeIsovist(getCommunicator(clp).get(), isovist.getLocation(), isovist.getLeftAngle(), isovist.getRightAngle(), clp.simpleMode());
-            }))
+        std::cout << "Building BSP tree... " << std::flush;
+        mGraph->setBSPOptions(bspOptions);
+        DO_TIMED("Build BSP tree", mGraph->makeBSPtree(getCommunicator(clp).get()))
+        std::cout << " ok\nMaking " << isovists.size() << " isovists... "  << std::flush;
+        DO_TIMED("Make isovists", mGraph->makeIsovists(getCommunicator(clp).get(), isovists, clp.simpleMode(), threadCount))
         std::cout << " ok\nWriting out result..." << std::flush;
         DO_TIMED("Writing graph", mGraph->write(clp.getOuputFile().c_str(),METAGRAPH_VERSION, false))
         std::cout << " ok" << std::endl;
@@ -830,13 +854,13 @@ namespace dm_runmethods
             switch(currentMapType) {
             case ShapeMap::DRAWINGMAP: {
                 DO_TIMED("Converting from drawing to axial",
-                         mGraph->convertDrawingToAxial(getCommunicator(clp).get(), mcp.outputMapName()));
+                         mGraph->convertDrawingToAxial(getCommunicator(clp).get(), mcp.outputMapName(), mcp.threadCount()));
                 break;
             }
             case ShapeMap::DATAMAP: {
                 DO_TIMED("Converting from data to axial",
                          mGraph->convertDataToAxial(getCommunicator(clp).get(), mcp.outputMapName(),
-                                                    !mcp.removeInputMap(), mcp.copyAttributes()));
+                                                    !mcp.removeInputMap(), mcp.copyAttributes(), mcp.threadCount()));
                 break;
             }
             default: {
@@ -855,7 +879,8 @@ namespace dm_runmethods
             case ShapeMap::AXIALMAP: {
                 DO_TIMED("Converting from axial to segment",
                          mGraph->convertAxialToSegment(getCommunicator(clp).get(), mcp.outputMapName(), !mcp.removeInputMap(),
-                                                       mcp.copyAttributes(), mcp.removeStubLength() / 100.0));
+                                                       mcp.copyAttributes(), mcp.removeStubLength() / 100.0,
+                                                       mcp.threadCount()));
                 break;
             }
             case ShapeMap::DATAMAP: {
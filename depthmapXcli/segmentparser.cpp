@@ -24,7 +24,7 @@
 using namespace depthmapX;
 
 SegmentParser::SegmentParser() :  m_analysisType(AnalysisType::NONE), m_radiusType(RadiusType::NONE), m_includeChoice(false),
-    m_tulipBins(0)
+    m_tulipBins(0), m_threadCount(1)
 {
 
 }
@@ -49,7 +49,8 @@ std::string SegmentParser::getHelp() const
             "       angular\n"\
             "  -sic to include choice (only for Tulip)\n"\
             "  -stb <tulip bins> (4 to 1024, 1024 approximates full angular)\n"\
-            "  -swa <map attribute name> perform weighted analysis using this attribute (only for Tulip)\n";
+            "  -swa <map attribute name> perform weighted analysis using this attribute (only for Tulip)\n"\
+            "  -sth <threads> number of threads (only for Tulip)\n";
 }
 
 void SegmentParser::parse(int argc, char **argv)
@@ -136,6 +137,11 @@ void SegmentParser::parse(int argc, char **argv)
             ENFORCE_ARGUMENT("-swa", i)
             m_attribute = argv[i];
         }
+        else if (std::strcmp(argv[i], "-sth") == 0)
+        {
+            ENFORCE_ARGUMENT("-sth", i)
+            m_threadCount = parseThreadCount(argv[i]);
+        }
     }
 
     if (getAnalysisType() == AnalysisType::NONE)
@@ -57,6 +57,8 @@ public:
 
     const std::string getAttribute() const { return m_attribute;}
 
+    int getThreadCount() const { return m_threadCount; }
+
 private:
     AnalysisType m_analysisType;
     RadiusType m_radiusType;
@@ -64,4 +66,5 @@ private:
     int m_tulipBins;
     std::vector<double> m_radii;
     std::string m_attribute;
+    int m_threadCount;
 };
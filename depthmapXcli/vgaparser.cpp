@@ -23,7 +23,8 @@
 using namespace depthmapX;
 
 
-VgaParser::VgaParser() : m_vgaMode(VgaMode::NONE), m_localMeasures(false), m_globalMeasures(false)
+VgaParser::VgaParser() : m_vgaMode(VgaMode::NONE), m_localMeasures(false), m_globalMeasures(false), m_threadCount(1), m_setQueue(false), m_multiSource(false),
+    m_bspSplitter(BSPTree::BuildOptions().splitter), m_bspTaskDepth(BSPTree::BuildOptions().taskDepth)
 {}
 
 void VgaParser::parse(int argc, char *argv[])
@@ -76,6 +77,41 @@ void VgaParser::parse(int argc, char *argv[])
             ENFORCE_ARGUMENT("-vr", i)
             m_radius = argv[i];
         }
+        else if (std::strcmp(argv[i], "-vt") == 0)
+        {
+            ENFORCE_ARGUMENT("-vt", i)
+            m_threadCount = parseThreadCount(argv[i]);
+        }
+        else if (std::strcmp(argv[i], "-vb") == 0)
+        {
+            m_multiSource = true;
+        }
+        else if (std::strcmp(argv[i], "-vq") == 0)
+        {
+            ENFORCE_ARGUMENT("-vq", i)
+            if ( std::strcmp(argv[i], "set") == 0 )
+            {
+                m_setQueue = true;
+            }
+            else if ( std::strcmp(argv[i], "bucket") == 0 )
+            {
+                m_setQueue = false;
+            }
+            else
+            {
+                throw CommandLineException(std::string("Invalid VGA search queue: ") + argv[i]);
+            }
+        }
+        else if (std::strcmp(argv[i], "-vbs") == 0)
+        {
+            ENFORCE_ARGUMENT("-vbs", i)
+            m_bspSplitter = parseBSPSplitter(argv[i]);
+        }
+        else if (std::strcmp(argv[i], "-vbd") == 0)
+        {
+            ENFORCE_ARGUMENT("-vbd", i)
+            m_bspTaskDepth = parseBSPTaskDepth(argv[i]);
+        }
         ++i;
     }
 
@@ -105,6 +141,15 @@ void VgaParser::parse(int argc, char *argv[])
     }
 }
 
+BSPTree::BuildOptions VgaParser::getBSPOptions() const
+{
+    BSPTree::BuildOptions options;
+    options.splitter = m_bspSplitter;
+    options.threads = m_threadCount;
+    options.taskDepth = m_bspTaskDepth;
+    return options;
+}
+
 void VgaParser::run(const CommandLineParser &clp, IPerformanceSink &perfWriter) const
 {
     RadiusConverter radiusConverter;
@@ -18,6 +18,7 @@
 #include <string>
 #include "imodeparser.h"
 #include "commandlineparser.h"
+#include "genlib/bsptree.h"
 
 class VgaParser : public IModeParser
 {
@@ -33,7 +34,16 @@ public:
                   "-vm <vga mode> one of isovist, visiblity, metric, angular, thruvision\n"\
                   "-vg turn on global measures for visibility, requires radius between 1 and 99 or n\n"\
                   "-vl turn on local measures for visibility\n"\
-                  "-vr set visibility radius\n";
+                  "-vr set visibility radius\n"\
+                  "-vb use the bit-parallel multi-source traversal for global visibility measures\n"\
+                  "-vt <threads> number of threads for isovist, global visibility, metric and angular analysis\n"\
+                  "    (default 1, 0 for all cores)\n"\
+                  "-vq <queue> search queue for metric and angular analysis, one of bucket (default)\n"\
+                  "    or set (the original, slower implementation, for checking results)\n"\
+                  "-vbs <splitter> how the BSP tree for isovist analysis picks its partition lines, one of\n"\
+                  "    midpoint (default) or cost (balanced, and built on the -vt threads)\n"\
+                  "-vbd <depth> depth of the BSP tree below which the cost splitter builds subtrees\n"\
+                  "    as separate tasks (default 8)\n";
     }
 
 public:
@@ -55,11 +65,21 @@ public:
     bool localMeasures() const { return m_localMeasures; }
     bool globalMeasures() const { return m_globalMeasures; }
     const std::string & getRadius() const { return m_radius; }
+    int getThreadCount() const { return m_threadCount; }
+    bool useSetQueue() const { return m_setQueue; }
+    bool multiSourceTraversal() const { return m_multiSource; }
+    // the thread count is taken from -vt
+    BSPTree::BuildOptions getBSPOptions() const;
 private:
     // vga options
     VgaMode m_vgaMode;
     bool m_localMeasures;
     bool m_globalMeasures;
     std::string m_radius;
+    int m_threadCount;
+    bool m_setQueue;
+    bool m_multiSource;
+    BSPTree::Splitter m_bspSplitter;
+    int m_bspTaskDepth;
 };
 
@@ -37,6 +37,7 @@ void VisPrepParser::parse(int argc, char ** argv)
     // Create Grid + Fill Grid + Make graph
     // Fill Grid
     // Fill Grid + Make graph
+    // Fill Grid + Update graph
     // Make Graph
     // Unmake Graph
 
@@ -109,23 +110,48 @@ void VisPrepParser::parse(int argc, char ** argv)
             {
                 throw CommandLineException("-pm cannot be used together with -pu");
             }
+            if (getUpdateGraph())
+            {
+                throw CommandLineException("-pm cannot be used together with -pd");
+            }
             m_makeGraph = true;
         }
+        else if ( std::strcmp("-pd", argv[i]) == 0 )
+        {
+            if (getMakeGraph())
+            {
+                throw CommandLineException("-pd cannot be used together with -pm");
+            }
+            if (getUnmakeGraph())
+            {
+                throw CommandLineException("-pd cannot be used together with -pu");
+            }
+            m_updateGraph = true;
+        }
         else if ( std::strcmp("-pu", argv[i]) == 0 )
         {
             if (getMakeGraph())
             {
                 throw CommandLineException("-pu cannot be used together with -pm");
             }
+            if (getUpdateGraph())
+            {
+                throw CommandLineException("-pu cannot be used together with -pd");
+            }
             m_unmakeGraph = true;
         }
         else if ( std::strcmp("-pl", argv[i]) == 0 )
         {
             m_removeLinksWhenUnmaking = true;
         }
+        else if ( std::strcmp("-pt", argv[i]) == 0 )
+        {
+            ENFORCE_ARGUMENT("-pt", i)
+            m_threadCount = parseThreadCount(argv[i]);
+        }
     }
 
-    if(!getMakeGraph() && !getUnmakeGraph() && m_grid <= 0 && pointFile.empty() && points.empty())
+    if(!getMakeGraph() && !getUpdateGraph() && !getUnmakeGraph() && m_grid <= 0 && pointFile.empty() && points.empty())
     {
         throw CommandLineException("Nothing to do");
     }
@@ -162,6 +188,10 @@ void VisPrepParser::parse(int argc, char ** argv)
 
     }
 
+    if(getUpdateGraph() && (m_grid > 0 || m_boundaryGraph || m_fillPoints.empty())) {
+        throw CommandLineException("-pd needs points to fill (-pp or -pf) and cannot be used with -pg or -pb");
+    }
+
     if(getUnmakeGraph() && (m_grid > 0 || !m_fillPoints.empty())) {
         throw CommandLineException("-pu can not be used with any other option apart from -pl");
     }
@@ -173,5 +203,5 @@ void VisPrepParser::parse(int argc, char ** argv)
 
 void VisPrepParser::run(const CommandLineParser &clp, IPerformanceSink &perfWriter) const
 {
-    dm_runmethods::runVisualPrep(clp, m_grid, m_fillPoints, m_maxVisibility, m_boundaryGraph, m_makeGraph, m_unmakeGraph, m_removeLinksWhenUnmaking, perfWriter);
+    dm_runmethods::runVisualPrep(clp, m_grid, m_fillPoints, m_maxVisibility, m_boundaryGraph, m_makeGraph, m_updateGraph, m_unmakeGraph, m_removeLinksWhenUnmaking, m_threadCount, perfWriter);
 }
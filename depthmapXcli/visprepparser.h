@@ -22,7 +22,7 @@
 class VisPrepParser : public IModeParser
 {
 public:
-    VisPrepParser() : m_grid(-1.0), m_maxVisibility(-1.0), m_boundaryGraph(false), m_makeGraph(false), m_unmakeGraph(false), m_removeLinksWhenUnmaking(false)
+    VisPrepParser() : m_grid(-1.0), m_maxVisibility(-1.0), m_boundaryGraph(false), m_makeGraph(false), m_updateGraph(false), m_unmakeGraph(false), m_removeLinksWhenUnmaking(false), m_threadCount(1)
     {}
 
     virtual std::string getModeName() const
@@ -40,8 +40,11 @@ public:
                "  -pr <max visibility> restrict visibility (-1 is unrestricted, default)\n" \
                "  -pb Make boundary graph\n" \
                "  -pm Make graph\n" \
+               "  -pd Update a graph already made with the points filled by -pp or -pf\n" \
+               "      (use the -pr it was made with)\n" \
                "  -pu Unmake graph\n" \
-               "  -pl Remove links when unmaking\n";
+               "  -pl Remove links when unmaking\n" \
+               "  -pt <threads> number of threads for making or updating the graph (default 1, 0 for all cores)\n";
     }
 
     virtual void parse(int argc, char** argv);
@@ -53,8 +56,10 @@ public:
     bool getBoundaryGraph() const { return m_boundaryGraph; }
     double getMaxVisibility() const { return m_maxVisibility; }
     bool getMakeGraph() const { return m_makeGraph; }
+    bool getUpdateGraph() const { return m_updateGraph; }
     bool getUnmakeGraph() const { return m_unmakeGraph; }
     bool getRemoveLinksWhenUnmaking() const { return m_removeLinksWhenUnmaking; }
+    int getThreadCount() const { return m_threadCount; }
 
 private:
     double m_grid;
@@ -62,8 +67,10 @@ private:
     double m_maxVisibility;
     bool m_boundaryGraph;
     bool m_makeGraph;
+    bool m_updateGraph;
     bool m_unmakeGraph;
     bool m_removeLinksWhenUnmaking;
+    int m_threadCount;
 };
 
 
@@ -17,65 +17,131 @@
 
 #include "bsptree.h"
 
+#include "genlib/parallelutils.h"
+
+#include <atomic>
 #include <stack>
 
 // Binary Space Partition
 
-/* Takes a set of lines and creates a binary-space-partition tree by starting from a
- * root node, setting its left and right nodes and recursively doing the same process
- * over those. Through this process the set of lines is split in two (one set for each
- * left and right nodes) and those are split and passed again further down the recursion.
- * While the original implementation was actually recursive it was hitting the recursion
- * limit when the input was a large number of lines that fell on the same side (i.e. an
- * arc divided in 500 pieces). It has been refactored here to an iterative solution, where
- * the current node (left or right) is pushed to a stack along with the relevant set of lines.
- */
+namespace {
+    typedef std::pair<std::vector<TaggedLine>, std::vector<TaggedLine>> TagLineVecPair;
 
-void BSPTree::make(Communicator *communicator, time_t atime, const std::vector<TaggedLine> &lines, BSPNode *root) {
+    // a node whose line has not been chosen yet, with the lines it partitions
+    struct Subtree {
+        std::vector<TaggedLine> lines;
+        int parent;
+        int side;
+    };
 
-    typedef std::pair<std::vector<TaggedLine>, std::vector<TaggedLine>> TagLineVecPair;
+    // a node that has been added, with the lines left for its children
+    struct Branch {
+        int node;
+        TagLineVecPair lines;
+        int depth;
+    };
 
-    std::stack<BSPNode *> nodeStack;
-    std::stack<TagLineVecPair> lineStack;
+    /* Takes a set of lines and creates a binary-space-partition tree by starting from a
+     * root node, setting its left and right nodes and recursively doing the same process
+     * over those. Through this process the set of lines is split in two (one set for each
+     * left and right nodes) and those are split and passed again further down the recursion.
+     * While the original implementation was actually recursive it was hitting the recursion
+     * limit when the input was a large number of lines that fell on the same side (i.e. an
+     * arc divided in 500 pieces). It has been refactored here to an iterative solution, where
+     * the current node (left or right) is pushed to a stack along with the relevant set of lines.
+     * The nodes are added to the tree as their lines are chosen, the root with parentLine
+     * as the line of its parent. When tasks is given, the children at taskDepth are left
+     * unmade and added to it instead.
+     */
 
-    nodeStack.push(root);
-    lineStack.push(makeLines(communicator, atime, lines, root));
+    void makeSubtree(Communicator *communicator, time_t atime, std::atomic<int> &progress,
+                     const std::vector<TaggedLine> &lines, const Line *parentLine, FlatBSPTree &tree,
+                     BSPTree::Splitter splitter, int taskDepth, std::vector<Subtree> *tasks) {
 
-    int progress = 0;
-    while (!nodeStack.empty()) {
-        progress++; // might need to increase by 2 because it was one for each left/right in the previous iteration
+        std::stack<Branch> branchStack;
 
-        if (communicator) {
-            if (communicator->IsCancelled()) {
-                throw Communicator::CancelledException();
+        TaggedLine chosen;
+        TagLineVecPair rootLines = BSPTree::makeLines(communicator, atime, lines, parentLine, chosen, splitter);
+        int root = tree.addNode(chosen, FlatBSPTree::NO_CHILD, FlatBSPTree::BSPLEFT);
+        branchStack.push(Branch{root, std::move(rootLines), 0});
+
+        while (!branchStack.empty()) {
+            progress++; // might need to increase by 2 because it was one for each left/right in the previous iteration
+
+            if (communicator) {
+                if (communicator->IsCancelled()) {
+                    throw Communicator::CancelledException();
+                }
+                if (qtimer(atime, 500)) {
+                    communicator->CommPostMessage(Communicator::CURRENT_RECORD, progress);
+                }
             }
-            if (qtimer(atime, 500)) {
-                communicator->CommPostMessage(Communicator::CURRENT_RECORD, progress);
+            Branch branch = std::move(branchStack.top());
+            branchStack.pop();
+            int depth = branch.depth + 1;
+
+            for (int side : {FlatBSPTree::BSPLEFT, FlatBSPTree::BSPRIGHT}) {
+                std::vector<TaggedLine> &sideLines =
+                    side == FlatBSPTree::BSPLEFT ? branch.lines.first : branch.lines.second;
+                if (sideLines.empty()) {
+                    continue;
+                }
+                if (tasks && depth >= taskDepth) {
+                    tasks->push_back(Subtree{std::move(sideLines), branch.node, side});
+                } else {
+                    TagLineVecPair childLines = BSPTree::makeLines(communicator, atime, sideLines,
+                                                                   &tree.getLine(branch.node), chosen, splitter);
+                    int child = tree.addNode(chosen, branch.node, side);
+                    branchStack.push(Branch{child, std::move(childLines), depth});
+                }
             }
         }
-        BSPNode *currNode = nodeStack.top();
-        nodeStack.pop();
-        TagLineVecPair currLines = lineStack.top();
-        lineStack.pop();
-
-        if (!currLines.first.empty()) {
-            currNode->m_left = std::unique_ptr<BSPNode>(new BSPNode(currNode));
-            nodeStack.push(currNode->m_left.get());
-            lineStack.push(makeLines(communicator, atime, currLines.first, currNode->m_left.get()));
-        }
-        if (!currLines.second.empty()) {
-            currNode->m_right = std::unique_ptr<BSPNode>(new BSPNode(currNode));
-            nodeStack.push(currNode->m_right.get());
-            lineStack.push(makeLines(communicator, atime, currLines.second, currNode->m_right.get()));
-        }
     }
+} // namespace
+
+/* With more than one thread the top of the tree is made first, down to the task depth, and
+ * then the subtrees below it are shared out between the threads, each made as a tree of its
+ * own and then added to the top. Only the first thread posts progress and checks for
+ * cancellation.
+ */
+
+FlatBSPTree BSPTree::make(Communicator *communicator, time_t atime, const std::vector<TaggedLine> &lines,
+                          const BuildOptions &options) {
+    FlatBSPTree tree;
+    if (lines.empty()) {
+        return tree;
+    }
+    std::atomic<int> progress(0);
+    size_t threads = 1;
+    if (options.splitter != Splitter::MIDPOINT) {
+        threads = depthmapX::getThreadCount(options.threads, lines.size());
+    }
+    if (threads <= 1) {
+        makeSubtree(communicator, atime, progress, lines, nullptr, tree, options.splitter, 0, nullptr);
+        return tree;
+    }
+
+    std::vector<Subtree> tasks;
+    makeSubtree(communicator, atime, progress, lines, nullptr, tree, options.splitter, std::max(options.taskDepth, 1),
+                &tasks);
+    std::vector<FlatBSPTree> subtrees(tasks.size());
+    depthmapX::parallelFor(nullptr, depthmapX::getThreadCount(int(threads), tasks.size()), tasks.size(),
+                           [&](size_t index, size_t threadIndex) {
+                               makeSubtree(threadIndex == 0 ? communicator : nullptr, atime, progress,
+                                           tasks[index].lines, &tree.getLine(tasks[index].parent), subtrees[index],
+                                           options.splitter, 0, nullptr);
+                           });
+    for (size_t index = 0; index < tasks.size(); index++) {
+        tree.addSubtree(subtrees[index], tasks[index].parent, tasks[index].side);
+    }
+    return tree;
 }
 
 /* Finds the midpoint from all the lines given and returns the index of the line
  * closest to it.
  */
 
-int BSPTree::pickMidpointLine(const std::vector<TaggedLine> &lines, BSPNode *par) {
+int BSPTree::pickMidpointLine(const std::vector<TaggedLine> &lines, const Line *parentLine) {
     int chosen = -1;
     Point2f midpoint;
     for (size_t i = 0; i < lines.size(); i++) {
@@ -83,7 +149,7 @@ int BSPTree::pickMidpointLine(const std::vector<TaggedLine> &lines, BSPNode *par
     }
     midpoint /= 2.0 * lines.size();
     bool ver = true;
-    if (par && par->getLine().height() > par->getLine().width()) {
+    if (parentLine && parentLine->height() > parentLine->width()) {
         ver = false;
     }
     double chosendist = -1.0;
@@ -113,32 +179,94 @@ int BSPTree::pickMidpointLine(const std::vector<TaggedLine> &lines, BSPNode *par
     return chosen;
 }
 
-/* Breaks a set of lines in two (left-right). First chooses a line closest to the midpoint
- * of the set ("chosen") and then classifies lines left or right depending on whether they
+namespace {
+    // Which sides of the chosen line (with unit direction v0) the ends of testline are on:
+    // a for the start and b for the end, positive to the left and negative to the right
+    inline void sides(const Line &chosenLine, const Point2f &v0, const Line &testline, double &a, double &b) {
+        Point2f v1 = testline.start() - chosenLine.start();
+        v1.normalise();
+        Point2f v2 = testline.end() - chosenLine.start();
+        v2.normalise();
+        // should use approxeq here:
+        a = testline.start() == chosenLine.start() ? 0 : det(v0, v1);
+        b = testline.end() == chosenLine.start() ? 0 : det(v0, v2);
+    }
+} // namespace
+
+/* Scores up to SPLITTER_CANDIDATES lines, spread evenly through the set, and returns the index
+ * of the one with the lowest cost: the difference between the number of lines that would go
+ * to its left and to its right, plus SPLIT_COST for every line it would cut in two. For large
+ * sets the lines are counted over an even sample of COST_SAMPLE lines. Unlike the midpoint
+ * pick this does not depend on the parent or on chance, so the same lines always give the
+ * same tree, and the subtrees can be built in any order.
+ */
+
+int BSPTree::pickCostLine(const std::vector<TaggedLine> &lines) {
+    const size_t SPLITTER_CANDIDATES = 16;
+    const size_t COST_SAMPLE = 256;
+    const size_t SPLIT_COST = 8;
+
+    size_t candidates = std::min(lines.size(), SPLITTER_CANDIDATES);
+    size_t samples = std::min(lines.size(), COST_SAMPLE);
+    int chosen = -1;
+    size_t chosenCost = 0;
+    for (size_t c = 0; c < candidates; c++) {
+        size_t candidate = c * lines.size() / candidates;
+        const Line &candidateLine = lines[candidate].line;
+        Point2f v0 = candidateLine.end() - candidateLine.start();
+        v0.normalise();
+        size_t left = 0, right = 0, split = 0;
+        for (size_t t = 0; t < samples; t++) {
+            size_t i = t * lines.size() / samples;
+            if (i == candidate) {
+                continue;
+            }
+            double a, b;
+            sides(candidateLine, v0, lines[i].line, a, b);
+            // the same tests as makeLines
+            if (a >= 0 && b >= 0) {
+                left++;
+            } else if (a <= 0 && b <= 0) {
+                right++;
+            } else {
+                split++;
+            }
+        }
+        size_t cost = (left > right ? left - right : right - left) + SPLIT_COST * split;
+        if (chosen == -1 || cost < chosenCost) {
+            chosen = static_cast<int>(candidate);
+            chosenCost = cost;
+        }
+    }
+    return chosen;
+}
+
+/* Breaks a set of lines in two (left-right). First chooses a line with the splitter (by
+ * default the one closest to the midpoint of the set, "chosen") and then classifies lines left or right depending on whether they
  * lie clockwise or anti-clockwise of the chosen one (with chosen start as centre, angles
  * from the chosen end up to 180 are clockwise, down to -180 anti-clockwise). Lines that cross
  * from one side of the chosen to the other are split in two and each part goes to the relevant set.
  */
 
 std::pair<std::vector<TaggedLine>, std::vector<TaggedLine>>
-BSPTree::makeLines(Communicator *, time_t, const std::vector<TaggedLine> &lines, BSPNode *base) {
+BSPTree::makeLines(Communicator *, time_t, const std::vector<TaggedLine> &lines, const Line *parentLine,
+                   TaggedLine &chosenLine, Splitter splitter) {
     std::vector<TaggedLine> leftlines;
     std::vector<TaggedLine> rightlines;
 
     // for optimization of the tree (this reduced a six-minute gen time to a 38 second gen time)
     int chosen = -1;
-    if (lines.size() > 3) {
-        chosen = BSPTree::pickMidpointLine(lines, base->m_parent);
+    if (splitter == Splitter::COST) {
+        chosen = BSPTree::pickCostLine(lines);
+    } else if (lines.size() > 3) {
+        chosen = BSPTree::pickMidpointLine(lines, parentLine);
     } else {
         chosen = pafrand() % lines.size();
     }
 
-    Line chosenLine = lines[chosen].line;
-    int chosenTag = lines[chosen].tag;
-    base->setLine(chosenLine);
-    base->setTag(chosenTag);
+    chosenLine = lines[chosen];
 
-    Point2f v0 = chosenLine.end() - chosenLine.start();
+    Point2f v0 = chosenLine.line.end() - chosenLine.line.start();
     v0.normalise();
 
     for (size_t i = 0; i < lines.size(); i++) {
@@ -147,13 +275,8 @@ BSPTree::makeLines(Communicator *, time_t, const std::vector<TaggedLine> &lines,
         }
         const Line &testline = lines[i].line;
         int tag = lines[i].tag;
-        Point2f v1 = testline.start() - chosenLine.start();
-        v1.normalise();
-        Point2f v2 = testline.end() - chosenLine.start();
-        v2.normalise();
-        // should use approxeq here:
-        double a = testline.start() == chosenLine.start() ? 0 : det(v0, v1);
-        double b = testline.end() == chosenLine.start() ? 0 : det(v0, v2);
+        double a, b;
+        sides(chosenLine.line, v0, testline, a, b);
         // note sure what to do if a == 0 and b == 0 (i.e., it's parallel... this test at least ensures on the line is
         // one or the other side)
         if (a >= 0 && b >= 0) {
@@ -161,7 +284,7 @@ BSPTree::makeLines(Communicator *, time_t, const std::vector<TaggedLine> &lines,
         } else if (a <= 0 && b <= 0) {
             rightlines.push_back(TaggedLine(testline, tag));
         } else {
-            Point2f p = intersection_point(chosenLine, testline);
+            Point2f p = intersection_point(chosenLine.line, testline);
             Line x = Line(testline.start(), p);
             Line y = Line(p, testline.end());
             if (a >= 0) {
@@ -180,3 +303,47 @@ BSPTree::makeLines(Communicator *, time_t, const std::vector<TaggedLine> &lines,
 
     return std::make_pair(leftlines, rightlines);
 }
+
+void FlatBSPTree::setChild(int parent, int side, int child) {
+    if (side == BSPLEFT) {
+        m_nodes[size_t(parent)].left = child;
+    } else {
+        m_nodes[size_t(parent)].right = child;
+    }
+}
+
+int FlatBSPTree::addNode(const TaggedLine &line, int parent, int side) {
+    int index = static_cast<int>(m_nodes.size());
+    Point2f dir = line.line.end() - line.line.start();
+    dir.normalise();
+    m_nodes.push_back(Node{line.line.start(), dir, NO_CHILD, NO_CHILD});
+    m_lines.push_back(line.line);
+    m_tags.push_back(line.tag);
+    if (parent != NO_CHILD) {
+        setChild(parent, side, index);
+    }
+    return index;
+}
+
+/* The nodes of the subtree keep their order, after the nodes already in the tree, so
+ * their children move along by the same offset.
+ */
+
+void FlatBSPTree::addSubtree(const FlatBSPTree &subtree, int parent, int side) {
+    if (subtree.empty()) {
+        return;
+    }
+    int offset = static_cast<int>(m_nodes.size());
+    for (Node node : subtree.m_nodes) {
+        if (node.left != NO_CHILD) {
+            node.left += offset;
+        }
+        if (node.right != NO_CHILD) {
+            node.right += offset;
+        }
+        m_nodes.push_back(node);
+    }
+    m_lines.insert(m_lines.end(), subtree.m_lines.begin(), subtree.m_lines.end());
+    m_tags.insert(m_tags.end(), subtree.m_tags.begin(), subtree.m_tags.end());
+    setChild(parent, side, offset + subtree.root());
+}
@@ -19,47 +19,91 @@
 
 #include "genlib/p2dpoly.h"
 
-#include <memory>
+#include <vector>
 
 // Binary Space Partition
 
-struct BSPNode {
-
-  private:
-    Line m_line;
-    int m_tag;
+// The tree laid out for the isovist and closest line queries: all the nodes in one array,
+// with the children found by index. BSPTree::make adds the nodes as it chooses their lines.
+// The direction of each partition line is normalised once here rather than at every visit
 
+class FlatBSPTree {
   public:
     enum { BSPLEFT, BSPRIGHT };
-    std::unique_ptr<BSPNode> m_left;
-    std::unique_ptr<BSPNode> m_right;
-    BSPNode *m_parent;
+    static constexpr int NO_CHILD = -1;
 
-    BSPNode(BSPNode *parent = NULL) : m_left(nullptr), m_right(nullptr) {
-        m_parent = parent;
-        m_tag = -1;
-    }
-    bool isLeaf() { return m_left == nullptr && m_right == nullptr; }
-    int classify(const Point2f &p) {
-        Point2f v0 = m_line.end() - m_line.start();
-        v0.normalise();
-        Point2f v1 = p - m_line.start();
-        v1.normalise();
-        if (det(v0, v1) >= 0) {
-            return BSPLEFT;
-        } else {
+    FlatBSPTree() {}
+
+    bool empty() const { return m_nodes.empty(); }
+    size_t size() const { return m_nodes.size(); }
+    // the root is always the first node
+    int root() const { return 0; }
+    int left(int node) const { return m_nodes[size_t(node)].left; }
+    int right(int node) const { return m_nodes[size_t(node)].right; }
+    const Line &getLine(int node) const { return m_lines[size_t(node)]; }
+    int getTag(int node) const { return m_tags[size_t(node)]; }
+
+    // the side of the line of the node p is on, BSPLEFT or BSPRIGHT
+    int classify(int node, const Point2f &p) const {
+        const Node &n = m_nodes[size_t(node)];
+        Point2f v1 = p - n.start;
+        if (v1.x == 0.0 && v1.y == 0.0) {
+            // the start of the line itself has always been put on the right
             return BSPRIGHT;
         }
+        return det(n.dir, v1) >= 0 ? BSPLEFT : BSPRIGHT;
     }
-    const Line &getLine() const { return m_line; }
-    void setLine(const Line &line) { m_line = line; }
-    int getTag() const { return m_tag; }
-    void setTag(const int tag) { m_tag = tag; }
+
+    // adds a node on the side (BSPLEFT or BSPRIGHT) of parent, or the root if parent is
+    // NO_CHILD, and returns its index
+    int addNode(const TaggedLine &line, int parent, int side);
+    // adds all the nodes of another tree, with its root on the side of parent
+    void addSubtree(const FlatBSPTree &subtree, int parent, int side);
+
+  private:
+    // what the traversal reads at every visit, the lines and tags are only read when drawn
+    struct Node {
+        Point2f start;
+        Point2f dir;
+        int left;
+        int right;
+    };
+    std::vector<Node> m_nodes;
+    std::vector<Line> m_lines;
+    std::vector<int> m_tags;
+
+    void setChild(int parent, int side, int child);
 };
 
 namespace BSPTree {
-    void make(Communicator *communicator, time_t atime, const std::vector<TaggedLine> &lines, BSPNode *root);
-    int pickMidpointLine(const std::vector<TaggedLine> &lines, BSPNode *par);
+    // how the partition line of each node is chosen
+    enum class Splitter {
+        // the line closest to the middle of the set, alternating between vertical and
+        // horizontal lines (at random for three lines or fewer)
+        MIDPOINT,
+        // the sampled line with the lowest cost, see pickCostLine
+        COST
+    };
+    struct BuildOptions {
+        Splitter splitter = Splitter::MIDPOINT;
+        // number of threads to build the subtrees on, 0 for all cores. The midpoint splitter
+        // picks some lines at random, so trees made with it are always built on one thread
+        int threads = 1;
+        // the subtrees below this depth are each built by one thread
+        int taskDepth = 8;
+        bool operator==(const BuildOptions &other) const {
+            return splitter == other.splitter && threads == other.threads && taskDepth == other.taskDepth;
+        }
+        bool operator!=(const BuildOptions &other) const { return !(*this == other); }
+    };
+
+    FlatBSPTree make(Communicator *communicator, time_t atime, const std::vector<TaggedLine> &lines,
+                     const BuildOptions &options = BuildOptions());
+    // parentLine is the line of the parent node, null for the root
+    int pickMidpointLine(const std::vector<TaggedLine> &lines, const Line *parentLine);
+    int pickCostLine(const std::vector<TaggedLine> &lines);
+    // chooses the line of a node into chosenLine and gives the lines left for each side of it
     std::pair<std::vector<TaggedLine>, std::vector<TaggedLine>>
-    makeLines(Communicator *communicator, time_t atime, const std::vector<TaggedLine> &lines, BSPNode *base);
+    makeLines(Communicator *communicator, time_t atime, const std::vector<TaggedLine> &lines, const Line *parentLine,
+              TaggedLine &chosenLine, Splitter splitter = Splitter::MIDPOINT);
 } // namespace BSPTree
@@ -0,0 +1,151 @@
+// genlib - a component of the depthmapX - spatial network analysis platform
+// Copyright (C) 2026, Tasos Varoudis
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "genlib/comm.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace depthmapX {
+
+    // Works out how many workers to use for a job: a request of 0 or less means
+    // "as many as the hardware offers", and there is never any point in having
+    // more workers than items of work
+    inline size_t getThreadCount(int requested, size_t workItems) {
+        size_t threads = requested > 0 ? size_t(requested) : size_t(std::thread::hardware_concurrency());
+        threads = std::min(threads, workItems);
+        return std::max(threads, size_t(1));
+    }
+
+    // Runs worker(threadIndex) on threadCount threads and waits for all of them to finish.
+    // The worker with index 0 runs on the calling thread, so it is the only one allowed to
+    // talk to a Communicator. The first exception thrown by any worker is rethrown here.
+    template <typename Worker> void runOnThreads(size_t threadCount, Worker worker) {
+        if (threadCount <= 1) {
+            worker(size_t(0));
+            return;
+        }
+        std::exception_ptr error;
+        std::mutex errorMutex;
+        auto guarded = [&](size_t threadIndex) {
+            try {
+                worker(threadIndex);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        };
+        std::vector<std::thread> threads;
+        threads.reserve(threadCount - 1);
+        for (size_t t = 1; t < threadCount; t++) {
+            threads.emplace_back(guarded, t);
+        }
+        guarded(0);
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    // Calls body(index, threadIndex) once for every index in [0, count), handing indices out
+    // to the workers one at a time so that uneven work evens out. The body must only write to
+    // state owned by its index or by its threadIndex. Progress is posted and cancellation
+    // checked from the calling thread; a cancellation stops all workers and is rethrown as
+    // Communicator::CancelledException.
+    template <typename Body>
+    void parallelFor(Communicator *comm, size_t threadCount, size_t count, Body body) {
+        std::atomic<size_t> next(0);
+        std::atomic<size_t> done(0);
+        std::atomic<bool> stop(false);
+        time_t atime = 0;
+        if (comm) {
+            qtimer(atime, 0);
+        }
+        runOnThreads(threadCount, [&](size_t threadIndex) {
+            try {
+                size_t index;
+                while (!stop && (index = next++) < count) {
+                    body(index, threadIndex);
+                    done++;
+                    if (threadIndex == 0 && comm && qtimer(atime, 500)) {
+                        if (comm->IsCancelled()) {
+                            throw Communicator::CancelledException();
+                        }
+                        comm->CommPostMessage(Communicator::CURRENT_RECORD, int(done));
+                    }
+                }
+            } catch (...) {
+                stop = true;
+                throw;
+            }
+        });
+    }
+
+    // A block size for parallelForInBlocks that depends only on the amount of work: the work is
+    // cut into at most 128 blocks, enough for it to spread well over the threads while keeping
+    // the merges, which run one at a time, to a fixed number however big the job
+    inline size_t getBlockSize(size_t workItems) {
+        return std::max((workItems + 127) / 128, size_t(1));
+    }
+
+    // Like parallelFor, but the indices are handed out in blocks of blockSize consecutive ones.
+    // Once a worker has called body(index, threadIndex) for every index of a block it calls
+    // merge(threadIndex), one worker at a time and in block order, so that sums the workers
+    // build up for their blocks can be folded into shared totals in the same order however many
+    // threads run. Progress is posted in blocks.
+    template <typename Body, typename Merge>
+    void parallelForInBlocks(Communicator *comm, size_t threadCount, size_t count, size_t blockSize, Body body,
+                             Merge merge) {
+        size_t blocks = (count + blockSize - 1) / blockSize;
+        std::mutex mergeMutex;
+        std::condition_variable mergeTurn;
+        size_t merged = 0;
+        bool failed = false;
+        parallelFor(comm, threadCount, blocks, [&](size_t block, size_t threadIndex) {
+            try {
+                size_t end = std::min((block + 1) * blockSize, count);
+                for (size_t index = block * blockSize; index < end; index++) {
+                    body(index, threadIndex);
+                }
+                std::unique_lock<std::mutex> lock(mergeMutex);
+                mergeTurn.wait(lock, [&]() { return merged == block || failed; });
+                if (failed) {
+                    return;
+                }
+                merge(threadIndex);
+                merged++;
+                mergeTurn.notify_all();
+            } catch (...) {
+                // the blocks after this one will never get their turn
+                std::lock_guard<std::mutex> lock(mergeMutex);
+                failed = true;
+                mergeTurn.notify_all();
+                throw;
+            }
+        });
+    }
+} // namespace depthmapX
@@ -25,8 +25,6 @@ TEST_CASE("BSPTree::pickMidpointLine")
     lines.push_back(TaggedLine(Line(Point2f(2, 2), Point2f(3, 2)), 0));
     lines.push_back(TaggedLine(Line(Point2f(3, 2), Point2f(4, 2)), 0));
 
-    BSPNode node;
-
     REQUIRE(BSPTree::pickMidpointLine(lines, 0) == 1);
 
     SECTION("Additional lines") {
@@ -73,10 +71,11 @@ TEST_CASE("BSPTree::makeLines")
     lines.push_back(TaggedLine(Line(Point2f(3, 2), Point2f(4, 2)), 0));
     lines.push_back(TaggedLine(Line(Point2f(4, 2), Point2f(5, 2)), 0));
 
-    std::unique_ptr<BSPNode> node(new BSPNode());
+    TaggedLine chosen;
 
-    TagLineVecPair result = BSPTree::makeLines(0, 0, lines, node.get());
+    TagLineVecPair result = BSPTree::makeLines(0, 0, lines, nullptr, chosen);
 
+    compareLines(chosen.line, lines[1].line, EPSILON);
     REQUIRE(result.first.size() == 3);
     REQUIRE(result.second.size() == 0);
 
@@ -89,7 +88,7 @@ TEST_CASE("BSPTree::makeLines")
     {
         lines.push_back(TaggedLine(Line(Point2f(5, 1), Point2f(6, 1)), 0));
 
-        result = BSPTree::makeLines(0, 0, lines, node.get());
+        result = BSPTree::makeLines(0, 0, lines, nullptr, chosen);
 
         REQUIRE(result.first.size() == 3);
         REQUIRE(result.second.size() == 1);
@@ -103,7 +102,7 @@ TEST_CASE("BSPTree::makeLines")
 
         lines.push_back(TaggedLine(Line(Point2f(6, 2), Point2f(7, 2)), 0));
 
-        result = BSPTree::makeLines(0, 0, lines, node.get());
+        result = BSPTree::makeLines(0, 0, lines, nullptr, chosen);
 
         REQUIRE(result.first.size() == 4);
         REQUIRE(result.second.size() == 1);
@@ -128,7 +127,7 @@ TEST_CASE("BSPTree::makeLines")
         // line with two points at different sides of chosen
         lines.push_back(TaggedLine(Line(Point2f(3, -2), Point2f(6, -2)), 0));
 
-        result = BSPTree::makeLines(0, 0, lines, node.get());
+        result = BSPTree::makeLines(0, 0, lines, nullptr, chosen);
 
         // adds one on each side
         REQUIRE(result.first.size() == 5);
@@ -159,29 +158,21 @@ TEST_CASE("BSPTree::make (all horizontal lines)", "all-left tree")
     lines.push_back(TaggedLine(Line(Point2f(3, 2), Point2f(4, 2)), 0));
     lines.push_back(TaggedLine(Line(Point2f(4, 2), Point2f(5, 2)), 0));
 
-    std::unique_ptr<BSPNode> node(new BSPNode());
-
-    BSPTree::make(0, 0, lines, node.get());
-
-    compareLines(node->getLine(), lines[1].line, EPSILON);
-
-    REQUIRE(node->m_left != nullptr);
-    REQUIRE(node->m_right == nullptr);
-
-    compareLines(node->m_left->getLine(), lines[2].line, EPSILON);
+    FlatBSPTree tree = BSPTree::make(0, 0, lines);
 
-    REQUIRE(node->m_left->m_left != nullptr);
-    REQUIRE(node->m_left->m_right == nullptr);
+    REQUIRE(tree.size() == 4);
+    int node = tree.root();
+    compareLines(tree.getLine(node), lines[1].line, EPSILON);
 
-    compareLines(node->m_left->m_left->getLine(), lines[3].line, EPSILON);
-
-    REQUIRE(node->m_left->m_left->m_left != nullptr);
-    REQUIRE(node->m_left->m_left->m_right == nullptr);
-
-    compareLines(node->m_left->m_left->m_left->getLine(), lines[0].line, EPSILON);
+    for (int line : {2, 3, 0}) {
+        REQUIRE(tree.left(node) != FlatBSPTree::NO_CHILD);
+        REQUIRE(tree.right(node) == FlatBSPTree::NO_CHILD);
+        node = tree.left(node);
+        compareLines(tree.getLine(node), lines[line].line, EPSILON);
+    }
 
-    REQUIRE(node->m_left->m_left->m_left->m_left == nullptr);
-    REQUIRE(node->m_left->m_left->m_left->m_right == nullptr);
+    REQUIRE(tree.left(node) == FlatBSPTree::NO_CHILD);
+    REQUIRE(tree.right(node) == FlatBSPTree::NO_CHILD);
 }
 
 TEST_CASE("BSPTree::make (all vertical lines)", "split tree")
@@ -194,26 +185,161 @@ TEST_CASE("BSPTree::make (all vertical lines)", "split tree")
     lines.push_back(TaggedLine(Line(Point2f(3.5, 1), Point2f(3.5, 3)), 0));
     lines.push_back(TaggedLine(Line(Point2f(4.5, 1), Point2f(4.5, 3)), 0));
 
-    std::unique_ptr<BSPNode> node(new BSPNode());
+    FlatBSPTree tree = BSPTree::make(0, 0, lines);
+
+    REQUIRE(tree.size() == 4);
+    int root = tree.root();
+    compareLines(tree.getLine(root), lines[1].line, EPSILON);
 
-    BSPTree::make(0, 0, lines, node.get());
+    int left = tree.left(root);
+    int right = tree.right(root);
+    REQUIRE(left != FlatBSPTree::NO_CHILD);
+    REQUIRE(right != FlatBSPTree::NO_CHILD);
 
-    compareLines(node->getLine(), lines[1].line, EPSILON);
+    compareLines(tree.getLine(left), lines[0].line, EPSILON);
+    compareLines(tree.getLine(right), lines[3].line, EPSILON);
 
-    REQUIRE(node->m_left != nullptr);
-    REQUIRE(node->m_right != nullptr);
+    REQUIRE(tree.left(left) == FlatBSPTree::NO_CHILD);
+    REQUIRE(tree.right(left) == FlatBSPTree::NO_CHILD);
 
-    compareLines(node->m_left->getLine(), lines[0].line, EPSILON);
-    compareLines(node->m_right->getLine(), lines[3].line, EPSILON);
+    int rightLeft = tree.left(right);
+    REQUIRE(rightLeft != FlatBSPTree::NO_CHILD);
+    REQUIRE(tree.right(right) == FlatBSPTree::NO_CHILD);
 
-    REQUIRE(node->m_left->m_left == nullptr);
-    REQUIRE(node->m_left->m_right == nullptr);
+    compareLines(tree.getLine(rightLeft), lines[2].line, EPSILON);
 
-    REQUIRE(node->m_right->m_left != nullptr);
-    REQUIRE(node->m_right->m_right == nullptr);
+    REQUIRE(tree.left(rightLeft) == FlatBSPTree::NO_CHILD);
+    REQUIRE(tree.right(rightLeft) == FlatBSPTree::NO_CHILD);
+}
+
+// the side the pointer tree gave before it was flattened, normalising both vectors at every visit
+static int classifyWithNormalisedVectors(const Line &line, const Point2f &p) {
+    Point2f v0 = line.end() - line.start();
+    v0.normalise();
+    Point2f v1 = p - line.start();
+    v1.normalise();
+    return det(v0, v1) >= 0 ? FlatBSPTree::BSPLEFT : FlatBSPTree::BSPRIGHT;
+}
 
-    compareLines(node->m_right->m_left->getLine(), lines[2].line, EPSILON);
+TEST_CASE("FlatBSPTree built node by node", "children found by index")
+{
+    const float EPSILON = 0.001f;
 
-    REQUIRE(node->m_right->m_left->m_left == nullptr);
-    REQUIRE(node->m_right->m_left->m_right == nullptr);
+    std::vector<TaggedLine> lines;
+    lines.push_back(TaggedLine(Line(Point2f(1.5, 1), Point2f(1.5, 3)), 0));
+    lines.push_back(TaggedLine(Line(Point2f(2.5, 1), Point2f(2.5, 3)), 1));
+    lines.push_back(TaggedLine(Line(Point2f(3.5, 1), Point2f(3.5, 3)), 2));
+    lines.push_back(TaggedLine(Line(Point2f(4.5, 1), Point2f(4.5, 3)), 3));
+
+    FlatBSPTree tree;
+    REQUIRE(tree.empty());
+    int root = tree.addNode(lines[1], FlatBSPTree::NO_CHILD, FlatBSPTree::BSPLEFT);
+    int right = tree.addNode(lines[3], root, FlatBSPTree::BSPRIGHT);
+    int left = tree.addNode(lines[0], root, FlatBSPTree::BSPLEFT);
+
+    REQUIRE(tree.size() == 3);
+    REQUIRE(root == tree.root());
+    compareLines(tree.getLine(root), lines[1].line, EPSILON);
+    REQUIRE(tree.getTag(root) == 1);
+    REQUIRE(tree.left(root) == left);
+    REQUIRE(tree.right(root) == right);
+
+    compareLines(tree.getLine(left), lines[0].line, EPSILON);
+    REQUIRE(tree.getTag(left) == 0);
+    REQUIRE(tree.left(left) == FlatBSPTree::NO_CHILD);
+    REQUIRE(tree.right(left) == FlatBSPTree::NO_CHILD);
+
+    SECTION("A subtree added to a node")
+    {
+        FlatBSPTree subtree;
+        int subroot = subtree.addNode(lines[2], FlatBSPTree::NO_CHILD, FlatBSPTree::BSPLEFT);
+        subtree.addNode(TaggedLine(Line(Point2f(3, 1), Point2f(3, 3)), 4), subroot, FlatBSPTree::BSPRIGHT);
+        tree.addSubtree(subtree, right, FlatBSPTree::BSPLEFT);
+
+        REQUIRE(tree.size() == 5);
+        int rightLeft = tree.left(right);
+        REQUIRE(rightLeft == 3);
+        REQUIRE(tree.right(right) == FlatBSPTree::NO_CHILD);
+        compareLines(tree.getLine(rightLeft), lines[2].line, EPSILON);
+        REQUIRE(tree.getTag(rightLeft) == 2);
+        REQUIRE(tree.left(rightLeft) == FlatBSPTree::NO_CHILD);
+        REQUIRE(tree.right(rightLeft) == 4);
+        REQUIRE(tree.getTag(4) == 4);
+        REQUIRE(tree.left(4) == FlatBSPTree::NO_CHILD);
+        REQUIRE(tree.right(4) == FlatBSPTree::NO_CHILD);
+    }
+
+    SECTION("Points are put on the same side as with the directions normalised at every visit")
+    {
+        std::vector<Point2f> points = {Point2f(0, 0),     Point2f(2, 2),   Point2f(5, 5),
+                                       Point2f(2.5, 0.5), Point2f(2.5, 1), Point2f(1e-12, 1e-12)};
+        for (const Point2f &p : points) {
+            REQUIRE(tree.classify(root, p) == classifyWithNormalisedVectors(lines[1].line, p));
+            REQUIRE(tree.classify(right, p) == classifyWithNormalisedVectors(lines[3].line, p));
+        }
+    }
+}
+
+TEST_CASE("BSPTree::pickCostLine", "balanced splitter")
+{
+    // four vertical lines: either of the middle two leaves one line on one side and two on the
+    // other, the outer ones leave all three on one side
+    std::vector<TaggedLine> lines;
+    lines.push_back(TaggedLine(Line(Point2f(1.5, 1), Point2f(1.5, 3)), 0));
+    lines.push_back(TaggedLine(Line(Point2f(4.5, 1), Point2f(4.5, 3)), 1));
+    lines.push_back(TaggedLine(Line(Point2f(2.5, 1), Point2f(2.5, 3)), 2));
+    lines.push_back(TaggedLine(Line(Point2f(3.5, 1), Point2f(3.5, 3)), 3));
+    REQUIRE(BSPTree::pickCostLine(lines) == 2);
+
+    SECTION("Cutting lines costs more than an unbalanced split")
+    {
+        // a long horizontal line through the two middle lines makes them cut it
+        lines.push_back(TaggedLine(Line(Point2f(2, 2), Point2f(4, 2)), 4));
+        int chosen = BSPTree::pickCostLine(lines);
+        REQUIRE((chosen == 0 || chosen == 1 || chosen == 4));
+    }
+}
+
+TEST_CASE("BSPTree::make with the cost splitter", "same tree on any number of threads")
+{
+    // a grid of rooms with doors, so that lines are cut and the tree is several levels deep
+    std::vector<TaggedLine> lines;
+    for (int i = 0; i <= 6; i++) {
+        for (int j = 0; j < 6; j++) {
+            lines.push_back(TaggedLine(Line(Point2f(i, j), Point2f(i, j + 0.4)), int(lines.size())));
+            lines.push_back(TaggedLine(Line(Point2f(j, i), Point2f(j + 0.3, i)), int(lines.size())));
+        }
+    }
+    lines.push_back(TaggedLine(Line(Point2f(0.5, 0.5), Point2f(5.5, 5.2)), int(lines.size())));
+
+    BSPTree::BuildOptions options;
+    options.splitter = BSPTree::Splitter::COST;
+    FlatBSPTree serial = BSPTree::make(0, 0, lines, options);
+
+    options.threads = 3;
+    options.taskDepth = 2;
+    FlatBSPTree parallel = BSPTree::make(0, 0, lines, options);
+
+    // the subtrees made on other threads are laid out after the top of the tree, so the
+    // trees are walked together rather than compared node by node
+    REQUIRE(parallel.size() == serial.size());
+    REQUIRE(parallel.size() > lines.size());
+    std::vector<std::pair<int, int>> nodes = {{serial.root(), parallel.root()}};
+    while (!nodes.empty()) {
+        int expected = nodes.back().first;
+        int actual = nodes.back().second;
+        nodes.pop_back();
+        REQUIRE(parallel.getTag(actual) == serial.getTag(expected));
+        REQUIRE(parallel.getLine(actual).start() == serial.getLine(expected).start());
+        REQUIRE(parallel.getLine(actual).end() == serial.getLine(expected).end());
+        REQUIRE((parallel.left(actual) == FlatBSPTree::NO_CHILD) == (serial.left(expected) == FlatBSPTree::NO_CHILD));
+        REQUIRE((parallel.right(actual) == FlatBSPTree::NO_CHILD) ==
+                (serial.right(expected) == FlatBSPTree::NO_CHILD));
+        if (serial.left(expected) != FlatBSPTree::NO_CHILD) {
+            nodes.push_back({serial.left(expected), parallel.left(actual)});
+        }
+        if (serial.right(expected) != FlatBSPTree::NO_CHILD) {
+            nodes.push_back({serial.right(expected), parallel.right(actual)});
+        }
+    }
 }
@@ -0,0 +1,96 @@
+// Copyright (C) 2026 Tasos Varoudis
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "catch.hpp"
+#include <genlib/parallelutils.h>
+#include <stdexcept>
+#include <vector>
+
+TEST_CASE("Thread count is clamped to the work available", "")
+{
+    REQUIRE(depthmapX::getThreadCount(4, 100) == 4);
+    REQUIRE(depthmapX::getThreadCount(4, 2) == 2);
+    REQUIRE(depthmapX::getThreadCount(4, 0) == 1);
+    REQUIRE(depthmapX::getThreadCount(0, 100) >= 1);
+}
+
+TEST_CASE("Parallel for visits every index exactly once", "")
+{
+    for (size_t threads : {1, 2, 5}) {
+        std::vector<int> visits(1000, 0);
+        std::vector<size_t> perThread(threads, 0);
+        depthmapX::parallelFor(nullptr, threads, visits.size(), [&](size_t idx, size_t threadIndex) {
+            visits[idx]++;
+            perThread[threadIndex]++;
+        });
+        for (int v : visits) {
+            REQUIRE(v == 1);
+        }
+        size_t total = 0;
+        for (size_t c : perThread) {
+            total += c;
+        }
+        REQUIRE(total == visits.size());
+    }
+}
+
+TEST_CASE("Exceptions thrown by workers reach the caller", "")
+{
+    REQUIRE_THROWS_AS(depthmapX::parallelFor(nullptr, 3, 100,
+                                             [](size_t idx, size_t) {
+                                                 if (idx == 42) {
+                                                     throw std::runtime_error("worker failed");
+                                                 }
+                                             }),
+                      std::runtime_error);
+}
+
+TEST_CASE("Blocks are merged in order whatever the thread count", "")
+{
+    REQUIRE(depthmapX::getBlockSize(10) == 1);
+    REQUIRE(depthmapX::getBlockSize(2560) == 20);
+    REQUIRE(depthmapX::getBlockSize(1000000) == 7813);
+
+    for (size_t threads : {1, 2, 5}) {
+        std::vector<std::vector<size_t>> blockIndices(threads);
+        std::vector<size_t> mergedFirstIndices;
+        bool contiguous = true;
+        depthmapX::parallelForInBlocks(nullptr, threads, 103, 10,
+                                       [&](size_t idx, size_t threadIndex) {
+                                           blockIndices[threadIndex].push_back(idx);
+                                       },
+                                       [&](size_t threadIndex) {
+                                           std::vector<size_t> &indices = blockIndices[threadIndex];
+                                           mergedFirstIndices.push_back(indices.front());
+                                           contiguous &= indices.back() - indices.front() + 1 == indices.size();
+                                           indices.clear();
+                                       });
+        std::vector<size_t> expected;
+        for (size_t first = 0; first < 103; first += 10) {
+            expected.push_back(first);
+        }
+        REQUIRE(mergedFirstIndices == expected);
+        REQUIRE(contiguous);
+    }
+
+    REQUIRE_THROWS_AS(depthmapX::parallelForInBlocks(nullptr, 3, 100, 5,
+                                                     [](size_t idx, size_t) {
+                                                         if (idx == 42) {
+                                                             throw std::runtime_error("worker failed");
+                                                         }
+                                                     },
+                                                     [](size_t) {}),
+                      std::runtime_error);
+}
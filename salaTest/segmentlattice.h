@@ -0,0 +1,44 @@
+// Copyright (C) 2026 Tasos Varoudis
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "salalib/mapconverter.h"
+#include "salalib/mgraph.h"
+
+#include <memory>
+#include <vector>
+
+// The lines of an uneven lattice, eight across and eight down
+inline std::vector<Line> getSegmentLatticeLines() {
+    std::vector<Line> lines;
+    for (int i = 0; i < 8; i++) {
+        lines.push_back(Line(Point2f(0.25 * (i % 3), i), Point2f(7.5 - 0.5 * (i % 4), i + 0.1 * (i % 3))));
+        lines.push_back(Line(Point2f(i + 0.5, -0.5 + (i % 3)), Point2f(i + 0.5 + 0.2 * (i % 2), 7.5)));
+    }
+    return lines;
+}
+
+// A segment map of the lattice, broken into segments where the lines cross
+inline std::unique_ptr<ShapeGraph> makeSegmentLattice() {
+    std::unique_ptr<MetaGraph> metaGraph(new MetaGraph("Test MetaGraph"));
+    metaGraph->m_drawingFiles.emplace_back("Test SpacePixelGroup");
+    metaGraph->m_drawingFiles.back().m_spacePixels.emplace_back("Test ShapeMap");
+    for (const Line &line : getSegmentLatticeLines()) {
+        metaGraph->m_drawingFiles.back().m_spacePixels.back().makeLineShape(line);
+    }
+    auto axialMap = MapConverter::convertDrawingToAxial(nullptr, "Test axial", metaGraph->m_drawingFiles);
+    return MapConverter::convertAxialToSegment(nullptr, *axialMap, "Test segment");
+}
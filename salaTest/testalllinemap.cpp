@@ -0,0 +1,115 @@
+// Copyright (C) 2026 Tasos Varoudis
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "catch.hpp"
+#include "salalib/alllinemap.h"
+
+// a room with two blocks in it, so that there are corners on separate polygons to see each other
+static std::vector<SpacePixelFile> makeRoomWithBlocks() {
+    std::vector<SpacePixelFile> drawingFiles;
+    drawingFiles.push_back(SpacePixelFile("Drawing file"));
+    drawingFiles.back().m_spacePixels.push_back(ShapeMap("Drawing layer", ShapeMap::DRAWINGMAP));
+    ShapeMap &drawing = drawingFiles.back().m_spacePixels.back();
+    auto addBox = [&drawing](double x0, double y0, double x1, double y1) {
+        drawing.makeLineShape(Line(Point2f(x0, y0), Point2f(x1, y0)));
+        drawing.makeLineShape(Line(Point2f(x1, y0), Point2f(x1, y1)));
+        drawing.makeLineShape(Line(Point2f(x1, y1), Point2f(x0, y1)));
+        drawing.makeLineShape(Line(Point2f(x0, y1), Point2f(x0, y0)));
+    };
+    addBox(0, 0, 12, 10);
+    addBox(2, 2, 4, 5);
+    addBox(7, 4, 9, 8);
+    drawingFiles.back().m_region = drawing.getRegion();
+    return drawingFiles;
+}
+
+static std::vector<Line> getLines(const ShapeGraph &map) {
+    std::vector<Line> lines;
+    for (size_t i = 0; i < map.getShapeCount(); i++) {
+        lines.push_back(map.getShapeRefFromIndex(i)->second.getLine());
+    }
+    return lines;
+}
+
+static bool sameLines(const std::vector<Line> &a, const std::vector<Line> &b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].start() != b[i].start() || a[i].end() != b[i].end()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+TEST_CASE("All-line map made on several threads", "") {
+    std::vector<SpacePixelFile> drawingFiles = makeRoomWithBlocks();
+
+    AllLineMap serial(nullptr, drawingFiles, Point2f(1, 1));
+    AllLineMap parallel(nullptr, drawingFiles, Point2f(1, 1), "All-Line Map", 3);
+
+    REQUIRE(serial.getShapeCount() > 0);
+    REQUIRE(parallel.getShapeCount() == serial.getShapeCount());
+    for (size_t i = 0; i < serial.getShapeCount(); i++) {
+        const SalaShape &expected = serial.getShapeRefFromIndex(i)->second;
+        const SalaShape &actual = parallel.getShapeRefFromIndex(i)->second;
+        REQUIRE(actual.getLine().start() == expected.getLine().start());
+        REQUIRE(actual.getLine().end() == expected.getLine().end());
+    }
+
+    REQUIRE(parallel.getConnections().size() == serial.getConnections().size());
+    for (size_t i = 0; i < serial.getConnections().size(); i++) {
+        REQUIRE(parallel.getConnections()[i].m_connections == serial.getConnections()[i].m_connections);
+    }
+
+    REQUIRE(parallel.m_radial_lines.size() == serial.m_radial_lines.size());
+    for (size_t i = 0; i < serial.m_radial_lines.size(); i++) {
+        REQUIRE(parallel.m_radial_lines[i] == serial.m_radial_lines[i]);
+    }
+    REQUIRE(parallel.m_poly_connections.size() == serial.m_poly_connections.size());
+
+    // no two lines left are the same line
+    for (size_t i = 0; i < serial.getShapeCount(); i++) {
+        for (size_t j = i + 1; j < serial.getShapeCount(); j++) {
+            const Line &a = serial.getShapeRefFromIndex(i)->second.getLine();
+            const Line &b = serial.getShapeRefFromIndex(j)->second.getLine();
+            REQUIRE_FALSE((a.start() == b.start() && a.end() == b.end()));
+        }
+    }
+}
+
+TEST_CASE("Fewest-line maps do not depend on the number of threads", "") {
+    std::vector<SpacePixelFile> drawingFiles = makeRoomWithBlocks();
+    AllLineMap allLineMap(nullptr, drawingFiles, Point2f(1, 1));
+
+    for (unsigned int seed : {0u, 7u}) {
+        std::unique_ptr<ShapeGraph> serialSubsets, serialMinimal;
+        std::tie(serialSubsets, serialMinimal) = allLineMap.extractFewestLineMaps(nullptr, seed);
+        REQUIRE(serialMinimal->getShapeCount() > 0);
+        REQUIRE(serialMinimal->getShapeCount() <= serialSubsets->getShapeCount());
+        REQUIRE(serialSubsets->getShapeCount() <= allLineMap.getShapeCount());
+
+        std::unique_ptr<ShapeGraph> parallelSubsets, parallelMinimal;
+        std::tie(parallelSubsets, parallelMinimal) = allLineMap.extractFewestLineMaps(nullptr, seed, 3);
+        REQUIRE(sameLines(getLines(*parallelSubsets), getLines(*serialSubsets)));
+        REQUIRE(sameLines(getLines(*parallelMinimal), getLines(*serialMinimal)));
+
+        // and the same seed gives the same maps again
+        std::unique_ptr<ShapeGraph> againSubsets, againMinimal;
+        std::tie(againSubsets, againMinimal) = allLineMap.extractFewestLineMaps(nullptr, seed);
+        REQUIRE(sameLines(getLines(*againMinimal), getLines(*serialMinimal)));
+    }
+}
@@ -392,6 +392,154 @@ TEST_CASE("attibute table iterations")
     REQUIRE(table.getRow(AttributeKey(1)).getValue(1) == Approx(3.2));
 }
 
+TEST_CASE("Rows added and removed out of key order")
+{
+    AttributeTable table;
+    table.getOrInsertColumn("col1");
+
+    auto& row5 = table.addRow(AttributeKey(5));
+    row5.setValue(0, 5.0f);
+    auto& row1 = table.addRow(AttributeKey(1));
+    row1.setValue(0, 1.0f);
+    auto& row3 = table.addRow(AttributeKey(3));
+    row3.setValue(0, 3.0f);
+    REQUIRE_THROWS(table.addRow(AttributeKey(3)));
+
+    // a column added after the rows starts out empty for all of them
+    size_t col2 = table.getOrInsertColumn("col2");
+    REQUIRE(row1.getValue(col2) == -1.0f);
+    row3.setValue(col2, 30.0f);
+
+    std::vector<int> keys;
+    for (auto& item : table)
+    {
+        keys.push_back(item.getKey().value);
+        REQUIRE(item.getRow().getValue(0) == Approx(float(item.getKey().value)));
+    }
+    REQUIRE(keys == std::vector<int>{1, 3, 5});
+    REQUIRE(&table.back() == &row5);
+
+    // references to the other rows follow their rows as rows come and go
+    table.removeRow(AttributeKey(1));
+    REQUIRE(table.getNumRows() == 2);
+    REQUIRE(table.getRowPtr(AttributeKey(1)) == nullptr);
+    REQUIRE(row3.getValue(0) == Approx(3.0f));
+    REQUIRE(row3.getValue(col2) == Approx(30.0f));
+    REQUIRE(row5.getValue(0) == Approx(5.0f));
+
+    auto& row4 = table.addRow(AttributeKey(4));
+    REQUIRE(row4.getValue(0) == -1.0f);
+    REQUIRE(row5.getValue(0) == Approx(5.0f));
+    REQUIRE(&table.getRow(AttributeKey(5)) == &row5);
+    REQUIRE(table.find(AttributeKey(4))->getKey().value == 4);
+    REQUIRE(table.find(AttributeKey(2)) == table.end());
+
+    table.removeColumn(0);
+    REQUIRE(row3.getValue(0) == Approx(30.0f));
+    REQUIRE_THROWS_AS(row3.getValue(1), std::out_of_range);
+
+    // the rows belong to the table they are moved to
+    AttributeTable moved(std::move(table));
+    moved.getRow(AttributeKey(3)).setValue("col2", 31.0f);
+    REQUIRE(moved.getRow(AttributeKey(3)).getValue(0) == Approx(31.0f));
+}
+
+TEST_CASE("Column stats follow the values of the column")
+{
+    AttributeTable table;
+    size_t col = table.getOrInsertColumn("col1");
+    for (int i = 0; i < 4; i++)
+    {
+        table.addRow(AttributeKey(i));
+    }
+    REQUIRE(table.getColumn(col).getStats().max == -1.0);
+    REQUIRE(table.getColumn(col).getStats().total == -1.0);
+
+    table.getRow(AttributeKey(0)).setValue(col, 5.0f);
+    table.getRow(AttributeKey(1)).setValue(col, 2.0f);
+    table.getRow(AttributeKey(2)).setValue(col, -1.0f);
+    REQUIRE(table.getColumn(col).getStats().min == Approx(2.0));
+    REQUIRE(table.getColumn(col).getStats().max == Approx(5.0));
+    REQUIRE(table.getColumn(col).getStats().total == Approx(7.0));
+
+    // overwriting the largest value brings the maximum down again
+    table.getRow(AttributeKey(0)).setValue(col, 3.0f);
+    REQUIRE(table.getColumn(col).getStats().max == Approx(3.0));
+    REQUIRE(table.getColumn(col).getStats().total == Approx(5.0));
+
+    table.removeRow(AttributeKey(1));
+    REQUIRE(table.getColumn(col).getStats().min == Approx(3.0));
+
+    SECTION("Whole columns written in bulk")
+    {
+        REQUIRE(table.getRowPosition(AttributeKey(3)) == 2);
+        REQUIRE_THROWS_AS(table.getRowPosition(AttributeKey(1)), std::out_of_range);
+        REQUIRE_THROWS_AS(table.setColumnValues(col, std::vector<float>(2, 1.0f)), std::invalid_argument);
+
+        table.setColumnValues(col, std::vector<float>{1.0f, -1.0f, 4.0f});
+        REQUIRE(table.getRow(AttributeKey(3)).getValue(col) == Approx(4.0f));
+        REQUIRE(table.getColumnValues(col)[0] == Approx(1.0f));
+        REQUIRE(table.getColumn(col).getStats().min == Approx(1.0));
+        REQUIRE(table.getColumn(col).getStats().max == Approx(4.0));
+        REQUIRE(table.getColumn(col).getStats().total == Approx(5.0));
+    }
+
+    SECTION("Cells without a value are left out")
+    {
+        // any negative value is no value, not just -1
+        table.getRow(AttributeKey(3)).setValue(col, -0.5f);
+        table.getRow(AttributeKey(2)).setValue(col, -7.0f);
+        REQUIRE(table.getColumn(col).getStats().min == Approx(3.0));
+        REQUIRE(table.getColumn(col).getStats().max == Approx(3.0));
+        REQUIRE(table.getColumn(col).getStats().total == Approx(3.0));
+
+        table.getRow(AttributeKey(3)).setValue(col, 0.0f);
+        REQUIRE(table.getColumn(col).getStats().min == 0.0);
+        REQUIRE(table.getColumn(col).getStats().total == Approx(3.0));
+
+        table.getRow(AttributeKey(0)).setValue(col, -2.0f);
+        table.getRow(AttributeKey(3)).setValue(col, -1.0f);
+        REQUIRE(table.getColumn(col).getStats().min == -1.0);
+        REQUIRE(table.getColumn(col).getStats().max == -1.0);
+        REQUIRE(table.getColumn(col).getStats().total == -1.0);
+    }
+
+    SECTION("A big table")
+    {
+        AttributeTable big;
+        size_t bigCol = big.getOrInsertColumn("col1");
+        std::vector<float> values;
+        for (int i = 0; i < 200000; i++)
+        {
+            big.addRow(AttributeKey(i));
+            values.push_back(float(i % 1000));
+        }
+        values[150000] = -1.0f;
+        big.setColumnValues(bigCol, values);
+        REQUIRE(big.getColumn(bigCol).getStats().min == 0.0);
+        REQUIRE(big.getColumn(bigCol).getStats().max == Approx(999.0));
+        REQUIRE(big.getColumn(bigCol).getStats().total == Approx(200.0 * 999.0 * 1000.0 / 2.0));
+
+        // and with the cells without a value spread through it
+        double total = 0.0;
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            if (i % 3 == 0 || values[i] == 0.0f || values[i] == 999.0f)
+            {
+                values[i] = -float(i % 5 + 1);
+            }
+            else
+            {
+                total += values[i];
+            }
+        }
+        big.setColumnValues(bigCol, values);
+        REQUIRE(big.getColumn(bigCol).getStats().min == 1.0);
+        REQUIRE(big.getColumn(bigCol).getStats().max == Approx(998.0));
+        REQUIRE(big.getColumn(bigCol).getStats().total == Approx(total));
+    }
+}
+
 #include <salalib/attributetablehelpers.h>
 
 TEST_CASE("Attribute Table - serialisation")
@@ -467,3 +615,59 @@ TEST_CASE("Attribute Table - serialisation")
 
 }
 
+
+TEST_CASE("Several rows removed together")
+{
+    AttributeTable table;
+    table.getOrInsertColumn("col1");
+    size_t col2 = table.getOrInsertColumn("col2");
+    for (int i = 0; i < 10; i++)
+    {
+        auto& row = table.addRow(AttributeKey(i));
+        row.setValue(0, float((i * 7) % 10));
+        if (i % 2 == 0)
+        {
+            row.setValue(col2, float(i));
+        }
+    }
+    auto& row8 = table.addRow(AttributeKey(8 + 10));
+    row8.setValue(0, 1.5f);
+    REQUIRE(table.getColumnOrder(0).size() == 11);
+    REQUIRE(table.getColumn(col2).getStats().max == Approx(8.0));
+
+    // the stats of a column only stay as they were when none of its removed rows had a value
+    size_t version = table.getColumnVersion(0);
+    table.removeRows({AttributeKey(7), AttributeKey(1), AttributeKey(3)});
+    REQUIRE_THROWS(table.removeRows({AttributeKey(2), AttributeKey(3)}));
+    REQUIRE(table.getNumRows() == 8);
+    REQUIRE(table.getColumnVersion(0) != version);
+    REQUIRE(table.getColumn(col2).getStats().max == Approx(8.0));
+
+    std::vector<int> keys;
+    for (size_t position = 0; position < table.getNumRows(); position++)
+    {
+        keys.push_back(table.getRowKey(position).value);
+        REQUIRE(table.getRowPosition(table.getRowKey(position)) == position);
+    }
+    REQUIRE(keys == std::vector<int>{0, 2, 4, 5, 6, 8, 9, 18});
+    REQUIRE(table.getColumnValues(0) == std::vector<float>{0, 4, 8, 5, 2, 6, 3, 1.5f});
+    REQUIRE(&table.getRow(AttributeKey(18)) == &row8);
+
+    // the order kept up to date matches the one sorted from scratch
+    std::vector<size_t> order = table.getColumnOrder(0);
+    REQUIRE(order == std::vector<size_t>{0, 7, 4, 6, 1, 3, 5, 2});
+    table.getRow(AttributeKey(0)).setValue(0, 0.0f);
+    REQUIRE(table.getColumnOrder(0) == order);
+    REQUIRE(table.getColumn(0).getStats().max == Approx(8.0));
+
+    table.removeRows({AttributeKey(4), AttributeKey(18)});
+    REQUIRE(table.getColumnOrder(0) == std::vector<size_t>{0, 3, 5, 1, 2, 4});
+    REQUIRE(table.getColumn(0).getStats().max == Approx(6.0));
+    REQUIRE(table.getColumn(col2).getStats().max == Approx(8.0));
+    REQUIRE(table.getColumn(col2).getStats().min == Approx(0.0));
+
+    // the freed rows are used again
+    auto& row1 = table.addRow(AttributeKey(1));
+    REQUIRE(row1.getValue(0) == -1.0f);
+    REQUIRE(table.getColumnValues(0) == std::vector<float>{0, -1, 4, 5, 2, 6, 3});
+}
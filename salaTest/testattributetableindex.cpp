@@ -16,6 +16,8 @@
 #include "catch.hpp"
 #include <salalib/attributetableindex.h>
 
+#include <numeric>
+
 TEST_CASE("Check index creation")
 {
     AttributeTable table;
@@ -43,3 +45,65 @@ TEST_CASE("Check index creation")
     REQUIRE(table.getRow(AttributeKey(2)).getValue(1) == Approx(1.5));
 }
 
+
+TEST_CASE("Column order kept with the table")
+{
+    AttributeTable table;
+    size_t col = table.getOrInsertColumn("col1");
+    for (int key = 0; key < 6; key++)
+    {
+        table.addRow(AttributeKey(key * 10));
+    }
+    std::vector<float> values = {3.0f, 1.0f, 3.0f, -1.0f, 2.0f, 1.0f};
+    table.setColumnValues(col, values);
+
+    // same values in row order
+    REQUIRE(table.getColumnOrder(col) == std::vector<size_t>{3, 1, 5, 4, 0, 2});
+    REQUIRE(table.findValueRange(col, 1.0f, 2.5f) == std::make_pair(size_t(1), size_t(4)));
+    REQUIRE(table.findValueRange(col, 5.0f, 6.0f) == std::make_pair(size_t(6), size_t(6)));
+
+    // reading leaves the version alone, writing moves it on
+    size_t version = table.getColumnVersion(col);
+    REQUIRE(table.getColumnVersion(col) == version);
+    table.getRow(AttributeKey(40)).setValue(col, 0.5f);
+    REQUIRE(table.getColumnVersion(col) != version);
+    REQUIRE(table.getColumnOrder(col) == std::vector<size_t>{3, 4, 1, 5, 0, 2});
+
+    // rows coming and going keep the order as a fresh sort would have it
+    table.addRow(AttributeKey(25));
+    REQUIRE(table.getColumnOrder(col) == std::vector<size_t>{3, 4, 5, 1, 6, 0, 2});
+    table.removeRow(AttributeKey(10));
+    REQUIRE(table.getColumnOrder(col) == std::vector<size_t>{2, 3, 4, 5, 0, 1});
+    // a row added at the end is sorted in the next time the order is asked for
+    version = table.getColumnVersion(col);
+    table.addRow(AttributeKey(60));
+    REQUIRE(table.getColumnVersion(col) != version);
+    REQUIRE(table.getColumnOrder(col) == std::vector<size_t>{2, 3, 6, 4, 5, 0, 1});
+    REQUIRE(table.getColumn(col).getStats().max == Approx(3.0));
+
+    auto index = makeAttributeIndex(table, int(col));
+    REQUIRE(index.front().key.value == 25);
+    REQUIRE(index.back().key.value == 20);
+    auto range = getIndexItemsInValueRange(index, table, 1.0f, 3.0f);
+    REQUIRE(std::distance(range.first, range.second) == 3);
+    REQUIRE(range.first->key.value == 50);
+}
+
+TEST_CASE("Big column order made in sorted runs")
+{
+    AttributeTable table;
+    size_t col = table.getOrInsertColumn("col1");
+    std::vector<float> values;
+    for (int key = 0; key < 300000; key++)
+    {
+        table.addRow(AttributeKey(key));
+        values.push_back(float((size_t(key) * 7919) % 1000));
+    }
+    table.setColumnValues(col, values);
+
+    std::vector<size_t> expected(values.size());
+    std::iota(expected.begin(), expected.end(), size_t(0));
+    std::stable_sort(expected.begin(), expected.end(),
+                     [&values](size_t a, size_t b) { return values[a] < values[b]; });
+    REQUIRE(table.getColumnOrder(col, 4) == expected);
+}
@@ -83,3 +83,27 @@ TEST_CASE("Test attribute table handle")
 
 
 }
+
+TEST_CASE("Attribute view index made again only when the column changes")
+{
+    AttributeTable table;
+    table.insertOrResetColumn("foo");
+    table.addRow(AttributeKey(0)).setValue(0, 1.0f);
+    table.addRow(AttributeKey(7)).setValue(0, 0.7f);
+
+    AttributeTableView view(table);
+    view.setDisplayColIndex(0);
+    const ConstAttributeIndexItem *first = view.getConstTableIndex().data();
+    view.setDisplayColIndex(0);
+    REQUIRE(view.getConstTableIndex().data() == first);
+
+    table.getRow(AttributeKey(0)).setValue(0, 0.5f);
+    view.setDisplayColIndex(0);
+    REQUIRE(view.getConstTableIndex().front().key.value == 0);
+    REQUIRE(view.getConstTableIndex().front().value == Approx(0.5));
+
+    table.addRow(AttributeKey(3)).setValue(0, 0.6f);
+    view.setDisplayColIndex(0);
+    REQUIRE(view.getConstTableIndex().size() == 3);
+    REQUIRE(view.getConstTableIndex()[1].key.value == 3);
+}
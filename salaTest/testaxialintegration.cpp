@@ -0,0 +1,116 @@
+// Copyright (C) 2026 Tasos Varoudis
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "catch.hpp"
+#include "salalib/axialmodules/axialintegration.h"
+#include "salalib/mapconverter.h"
+#include "salalib/mgraph.h"
+
+TEST_CASE("Axial choice splits pairs between equal shortest paths")
+{
+    // two horizontal lines joined by two vertical ones, and a stub off each horizontal:
+    //
+    //     E
+    //  ___|_______   A
+    //     |   |
+    //     C   D
+    //  ___|___|_|_   B
+    //           F
+    //
+    // every path from E to B or F can go through either C or D, so each of those gets half
+    // of every such pair whichever way it is taken
+    std::vector<Line> lines = {
+        Line(Point2f(0, 2), Point2f(3, 2)),       // A
+        Line(Point2f(0, 0), Point2f(3, 0)),       // B
+        Line(Point2f(1, -0.5), Point2f(1, 2.5)),  // C
+        Line(Point2f(2, -0.5), Point2f(2, 2.5)),  // D
+        Line(Point2f(0.5, 1.5), Point2f(0.5, 3)), // E
+        Line(Point2f(2.5, -1), Point2f(2.5, 0.5)) // F
+    };
+
+    std::unique_ptr<MetaGraph> metaGraph(new MetaGraph("Test MetaGraph"));
+    metaGraph->m_drawingFiles.emplace_back("Test SpacePixelGroup");
+    metaGraph->m_drawingFiles.back().m_spacePixels.emplace_back("Test ShapeMap");
+    for (const Line &line : lines) {
+        metaGraph->m_drawingFiles.back().m_spacePixels.back().makeLineShape(line);
+    }
+    auto shapeGraph = MapConverter::convertDrawingToAxial(nullptr, "Test axial", metaGraph->m_drawingFiles);
+    REQUIRE(shapeGraph->getShapeCount() == lines.size());
+
+    std::set<double> radii = {-1.0, 2.0};
+    AxialIntegration(radii, -1, true, false, false).run(nullptr, *shapeGraph, false);
+
+    const AttributeTable &attributes = shapeGraph->getAttributeTable();
+    int choiceCol = attributes.getColumnIndex("Choice");
+    int normChoiceCol = attributes.getColumnIndex("Choice [Norm]");
+    int choiceR2Col = attributes.getColumnIndex("Choice R2");
+
+    // by the lines' midpoints: A and B are passed through by all eight ordered pairs from the
+    // stub beyond them, and by half of the two between C and D, while C and D each get half
+    // of the eight pairs across the middle. At radius 2 only the pairs two steps apart count:
+    // A is between E and C or D and shares C and D with B, C shares A and B with D
+    std::map<std::pair<double, double>, std::vector<float>> expected = {
+        {{1.5, 2}, {9, 0.9f, 5}}, {{1.5, 0}, {9, 0.9f, 5}},    {{1, 1}, {4, 0.4f, 1}},
+        {{2, 1}, {4, 0.4f, 1}},   {{0.5, 2.25}, {0, 0, 0}}, {{2.5, -0.25}, {0, 0, 0}}};
+    size_t index = 0;
+    for (auto &shape : shapeGraph->getAllShapes()) {
+        Point2f midpoint = shape.second.getLine().midpoint();
+        const std::vector<float> &values = expected.at(std::make_pair(midpoint.x, midpoint.y));
+        const AttributeRow &row = shapeGraph->getAttributeRowFromShapeIndex(index++);
+        REQUIRE(row.getValue(choiceCol) == Approx(values[0]));
+        REQUIRE(row.getValue(normChoiceCol) == Approx(values[1]));
+        REQUIRE(row.getValue(choiceR2Col) == Approx(values[2]));
+    }
+}
+
+TEST_CASE("Axial analysis gives the same results on any number of threads")
+{
+    // an uneven lattice, so that many pairs are joined by several shortest paths
+    std::vector<Line> lines;
+    for (int i = 0; i < 12; i++) {
+        lines.push_back(Line(Point2f(0.25 * (i % 3), i), Point2f(11 - 0.5 * (i % 4), i)));
+        lines.push_back(Line(Point2f(i + 0.5, -0.5 + (i % 5)), Point2f(i + 0.5, 11.5 - (i % 2) * 3)));
+    }
+
+    auto makeGraph = [&lines]() {
+        std::unique_ptr<MetaGraph> metaGraph(new MetaGraph("Test MetaGraph"));
+        metaGraph->m_drawingFiles.emplace_back("Test SpacePixelGroup");
+        metaGraph->m_drawingFiles.back().m_spacePixels.emplace_back("Test ShapeMap");
+        for (const Line &line : lines) {
+            metaGraph->m_drawingFiles.back().m_spacePixels.back().makeLineShape(line);
+        }
+        return MapConverter::convertDrawingToAxial(nullptr, "Test axial", metaGraph->m_drawingFiles);
+    };
+    auto single = makeGraph();
+    auto multi = makeGraph();
+
+    std::set<double> radii = {-1.0, 2.0, 3.0};
+    int weightCol = single->getAttributeTable().getColumnIndex("Line Length");
+    REQUIRE(weightCol != -1);
+    AxialIntegration(radii, weightCol, true, true, true, 1).run(nullptr, *single, false);
+    AxialIntegration(radii, weightCol, true, true, true, 3).run(nullptr, *multi, false);
+
+    const AttributeTable &singleAttributes = single->getAttributeTable();
+    const AttributeTable &multiAttributes = multi->getAttributeTable();
+    REQUIRE(singleAttributes.getNumColumns() == multiAttributes.getNumColumns());
+    REQUIRE(singleAttributes.hasColumn("Choice [Line Length Wgt] R3"));
+    for (size_t index = 0; index < lines.size(); index++) {
+        const AttributeRow &singleRow = single->getAttributeRowFromShapeIndex(index);
+        const AttributeRow &multiRow = multi->getAttributeRowFromShapeIndex(index);
+        for (size_t col = 0; col < singleAttributes.getNumColumns(); col++) {
+            REQUIRE(singleRow.getValue(col) == multiRow.getValue(col));
+        }
+    }
+}
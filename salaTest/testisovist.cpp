@@ -14,8 +14,13 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "catch.hpp"
+#include "salalib/isovist.h"
 #include "salalib/mgraph.h"
 
+#include <chrono>
+#include <iostream>
+#include <memory>
+
 TEST_CASE("Simple Isovist") {
 
     const float EPSILON = 0.001;
@@ -100,3 +105,193 @@ TEST_CASE("Simple Isovist") {
     REQUIRE(isovist.m_points[11].x == Approx(3.0).epsilon(EPSILON));
     REQUIRE(isovist.m_points[11].y == Approx(2.5).epsilon(EPSILON));
 }
+
+TEST_CASE("Batch of isovists made on several threads") {
+
+    std::vector<Line> planLines = {
+        Line(Point2f(1, 1), Point2f(1, 3)), //
+        Line(Point2f(1, 3), Point2f(3, 3)), //
+        Line(Point2f(3, 3), Point2f(3, 2)), //
+        Line(Point2f(3, 2), Point2f(2, 2)), //
+        Line(Point2f(2, 2), Point2f(2, 1)), //
+        Line(Point2f(2, 1), Point2f(1, 1))  //
+    };
+    std::vector<IsovistDefinition> isovists = {
+        IsovistDefinition(2.5, 2.5), IsovistDefinition(1.5, 1.5), IsovistDefinition(1.2, 2.8, M_PI, M_PI * 0.5),
+        IsovistDefinition(2.9, 2.1, 0.25 * M_PI, M_PI)};
+
+    auto makeMetaGraph = [&planLines]() {
+        std::unique_ptr<MetaGraph> metaGraph(new MetaGraph("Test MetaGraph"));
+        metaGraph->m_drawingFiles.emplace_back("Test SpacePixelGroup");
+        metaGraph->m_drawingFiles.back().m_spacePixels.emplace_back("Test ShapeMap");
+        for (Line &line : planLines) {
+            metaGraph->m_drawingFiles.back().m_spacePixels.back().makeLineShape(line);
+        }
+        return metaGraph;
+    };
+
+    std::unique_ptr<MetaGraph> oneByOne = makeMetaGraph();
+    for (const IsovistDefinition &isovist : isovists) {
+        oneByOne->makeIsovist(nullptr, isovist.getLocation(), isovist.getLeftAngle(), isovist.getRightAngle(), false);
+    }
+    std::unique_ptr<MetaGraph> batch = makeMetaGraph();
+    REQUIRE(batch->makeIsovists(nullptr, isovists, false, 3) == 2);
+
+    const ShapeMap &expected = oneByOne->getDataMaps().front();
+    const ShapeMap &actual = batch->getDataMaps().front();
+    REQUIRE(actual.getAllShapes().size() == isovists.size());
+    auto expectedShape = expected.getAllShapes().begin();
+    for (auto &actualShape : actual.getAllShapes()) {
+        REQUIRE(actualShape.first == expectedShape->first);
+        REQUIRE(actualShape.second.m_points.size() == expectedShape->second.m_points.size());
+        for (size_t i = 0; i < actualShape.second.m_points.size(); i++) {
+            REQUIRE(actualShape.second.m_points[i].x == expectedShape->second.m_points[i].x);
+            REQUIRE(actualShape.second.m_points[i].y == expectedShape->second.m_points[i].y);
+        }
+        const AttributeRow &expectedRow = expected.getAttributeTable().getRow(AttributeKey(expectedShape->first));
+        const AttributeRow &actualRow = actual.getAttributeTable().getRow(AttributeKey(actualShape.first));
+        for (size_t col = 0; col < expected.getAttributeTable().getNumColumns(); col++) {
+            REQUIRE(actualRow.getValue(col) == expectedRow.getValue(col));
+        }
+        ++expectedShape;
+    }
+}
+
+// The pointer based tree that isovists were made with before the tree was flattened, copied
+// from a flat tree to check and time the flat tree against
+struct PointerTreeNode {
+    Line line;
+    int tag;
+    std::unique_ptr<PointerTreeNode> left;
+    std::unique_ptr<PointerTreeNode> right;
+
+    PointerTreeNode(const FlatBSPTree &tree, int node) : line(tree.getLine(node)), tag(tree.getTag(node)) {
+        if (tree.left(node) != FlatBSPTree::NO_CHILD)
+            left.reset(new PointerTreeNode(tree, tree.left(node)));
+        if (tree.right(node) != FlatBSPTree::NO_CHILD)
+            right.reset(new PointerTreeNode(tree, tree.right(node)));
+    }
+    int classify(const Point2f &p) const {
+        Point2f v0 = line.end() - line.start();
+        v0.normalise();
+        Point2f v1 = p - line.start();
+        v1.normalise();
+        return det(v0, v1) >= 0 ? FlatBSPTree::BSPLEFT : FlatBSPTree::BSPRIGHT;
+    }
+};
+
+// Makes the visible segments of an isovist with the pointer based tree, the way Isovist did
+// before the tree was flattened
+class PointerTreeIsovist : public Isovist {
+  public:
+    const std::set<IsoSeg> &blocks() const { return m_blocks; }
+    void start(const Point2f &p) {
+        m_centre = p;
+        m_blocks.clear();
+        m_gaps.clear();
+        m_gaps.insert(IsoSeg(0.0, 2.0 * M_PI));
+    }
+    void makeFrom(const PointerTreeNode *here) {
+        if (m_gaps.size()) {
+            if (here->classify(m_centre) == FlatBSPTree::BSPLEFT) {
+                if (here->left)
+                    makeFrom(here->left.get());
+                drawnode(here->line, here->tag);
+                if (here->right)
+                    makeFrom(here->right.get());
+            } else {
+                if (here->right)
+                    makeFrom(here->right.get());
+                drawnode(here->line, here->tag);
+                if (here->left)
+                    makeFrom(here->left.get());
+            }
+        }
+    }
+};
+
+// rooms of one unit with a door in each wall, with the isovists taken from points off the lines
+static std::vector<TaggedLine> makeRoomLines(int rooms) {
+    std::vector<TaggedLine> lines;
+    for (int i = 0; i <= rooms; i++) {
+        for (int j = 0; j < rooms; j++) {
+            lines.push_back(TaggedLine(Line(Point2f(i, j), Point2f(i, j + 0.4)), int(lines.size())));
+            lines.push_back(TaggedLine(Line(Point2f(i, j + 0.7), Point2f(i, j + 1)), int(lines.size())));
+            lines.push_back(TaggedLine(Line(Point2f(j, i), Point2f(j + 0.3, i)), int(lines.size())));
+            lines.push_back(TaggedLine(Line(Point2f(j + 0.6, i), Point2f(j + 1, i)), int(lines.size())));
+        }
+    }
+    return lines;
+}
+
+static std::vector<Point2f> makeRoomOrigins(int rooms, int perSide) {
+    std::vector<Point2f> origins;
+    for (int i = 0; i < rooms * perSide; i++) {
+        for (int j = 0; j < rooms * perSide; j++) {
+            origins.push_back(Point2f((i + 0.37) / perSide, (j + 0.61) / perSide));
+        }
+    }
+    return origins;
+}
+
+TEST_CASE("Isovists from the flat BSP tree match the pointer tree") {
+    const int rooms = 4;
+    FlatBSPTree tree = BSPTree::make(nullptr, 0, makeRoomLines(rooms));
+    PointerTreeNode root(tree, tree.root());
+
+    PointerTreeIsovist expected;
+    PointerTreeIsovist actual;
+    for (const Point2f &p : makeRoomOrigins(rooms, 3)) {
+        expected.start(p);
+        expected.makeFrom(&root);
+        actual.start(p);
+        actual.make(tree);
+        REQUIRE(actual.blocks().size() == expected.blocks().size());
+        auto expectedBlock = expected.blocks().begin();
+        for (const IsoSeg &block : actual.blocks()) {
+            REQUIRE(block.tag == expectedBlock->tag);
+            REQUIRE(block.startpoint.x == expectedBlock->startpoint.x);
+            REQUIRE(block.startpoint.y == expectedBlock->startpoint.y);
+            REQUIRE(block.endpoint.x == expectedBlock->endpoint.x);
+            REQUIRE(block.endpoint.y == expectedBlock->endpoint.y);
+            ++expectedBlock;
+        }
+    }
+}
+
+// not run by default, run with: salaTest "[benchmark]"
+TEST_CASE("Isovists per second from the pointer and flat BSP trees", "[.][benchmark]") {
+    const int rooms = 30;
+    FlatBSPTree tree = BSPTree::make(nullptr, 0, makeRoomLines(rooms));
+    PointerTreeNode root(tree, tree.root());
+    std::vector<Point2f> origins = makeRoomOrigins(rooms, 4);
+
+    PointerTreeIsovist isovist;
+    auto rate = [&origins](std::chrono::steady_clock::time_point start) {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return double(origins.size()) / elapsed.count();
+    };
+
+    size_t pointerBlocks = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const Point2f &p : origins) {
+        isovist.start(p);
+        isovist.makeFrom(&root);
+        pointerBlocks += isovist.blocks().size();
+    }
+    double pointerRate = rate(start);
+
+    size_t flatBlocks = 0;
+    start = std::chrono::steady_clock::now();
+    for (const Point2f &p : origins) {
+        isovist.start(p);
+        isovist.make(tree);
+        flatBlocks += isovist.blocks().size();
+    }
+    double flatRate = rate(start);
+
+    REQUIRE(flatBlocks == pointerBlocks);
+    std::cout << origins.size() << " isovists of " << tree.size() << " BSP nodes, per second:" << std::endl
+              << "  pointer tree: " << pointerRate << std::endl
+              << "  flat tree:    " << flatRate << std::endl;
+}
@@ -213,3 +213,43 @@ TEST_CASE("Test data to segment conversion", "") {
         }
     }
 }
+
+TEST_CASE("Test axial to segment conversion on several threads", "") {
+    std::vector<SpacePixelFile> drawingFiles;
+    drawingFiles.push_back(SpacePixelFile("Drawing file"));
+    drawingFiles.back().m_spacePixels.push_back(ShapeMap("Drawing layer", ShapeMap::DRAWINGMAP));
+    ShapeMap &drawingLayer = drawingFiles.back().m_spacePixels.back();
+
+    // a hash (#) shape with a diagonal through it
+    drawingLayer.makeLineShape(Line(Point2f(0.0, 1.0), Point2f(3.0, 1.0)));
+    drawingLayer.makeLineShape(Line(Point2f(0.0, 2.0), Point2f(3.0, 2.0)));
+    drawingLayer.makeLineShape(Line(Point2f(1.0, 0.0), Point2f(1.0, 3.0)));
+    drawingLayer.makeLineShape(Line(Point2f(2.0, 0.0), Point2f(2.0, 3.0)));
+    drawingLayer.makeLineShape(Line(Point2f(0.0, 0.0), Point2f(3.0, 3.0)));
+    drawingFiles.back().m_region = drawingLayer.getRegion();
+
+    std::unique_ptr<ShapeGraph> axialMap = MapConverter::convertDrawingToAxial(nullptr, "Axial map", drawingFiles);
+    std::unique_ptr<ShapeGraph> single =
+        MapConverter::convertAxialToSegment(nullptr, *axialMap, "Segment map", true, false, 0.0, 1);
+    std::unique_ptr<ShapeGraph> several =
+        MapConverter::convertAxialToSegment(nullptr, *axialMap, "Segment map", true, false, 0.0, 3);
+
+    // the diagonal runs through two of the crossings, so every line is broken in three
+    REQUIRE(single->getAllShapes().size() == 4 * 3 + 3);
+    REQUIRE(several->getAllShapes().size() == single->getAllShapes().size());
+    auto singleIter = single->getAllShapes().begin();
+    for (auto &shape : several->getAllShapes()) {
+        REQUIRE(shape.first == singleIter->first);
+        REQUIRE(shape.second.getLine().start() == singleIter->second.getLine().start());
+        REQUIRE(shape.second.getLine().end() == singleIter->second.getLine().end());
+        ++singleIter;
+    }
+    const std::vector<Connector> &singleConnectors = single->getConnections();
+    const std::vector<Connector> &severalConnectors = several->getConnections();
+    REQUIRE(severalConnectors.size() == singleConnectors.size());
+    for (size_t i = 0; i < singleConnectors.size(); i++) {
+        REQUIRE(severalConnectors[i].m_segment_axialref == singleConnectors[i].m_segment_axialref);
+        REQUIRE(severalConnectors[i].m_back_segconns == singleConnectors[i].m_back_segconns);
+        REQUIRE(severalConnectors[i].m_forward_segconns == singleConnectors[i].m_forward_segconns);
+    }
+}
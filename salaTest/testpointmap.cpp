@@ -17,6 +17,7 @@
 #include "catch.hpp"
 #include "salalib/mgraph.h"
 
+#include <random>
 #include <sstream>
 
 
@@ -550,3 +551,179 @@ TEST_CASE("Direct pointmap linking - fully filled grid (no geometry)", "")
         REQUIRE(pixelPairs3.size() == 0);
     }
 }
+
+// A 4 by 3 room with a wall part of the way across, so that the bins have both blocked and open runs
+static std::unique_ptr<MetaGraph> makePartitionedRoom()
+{
+    std::unique_ptr<MetaGraph> metaGraph(new MetaGraph("Test MetaGraph"));
+    metaGraph->m_drawingFiles.emplace_back("Test SpacePixelGroup");
+    metaGraph->m_drawingFiles.back().m_spacePixels.emplace_back("Test ShapeMap");
+    ShapeMap &drawing = metaGraph->m_drawingFiles.back().m_spacePixels.back();
+    drawing.makeLineShape(Line(Point2f(0,0), Point2f(0,3)));
+    drawing.makeLineShape(Line(Point2f(0,3), Point2f(4,3)));
+    drawing.makeLineShape(Line(Point2f(4,3), Point2f(4,0)));
+    drawing.makeLineShape(Line(Point2f(4,0), Point2f(0,0)));
+    drawing.makeLineShape(Line(Point2f(1.6,0), Point2f(2.4,1.9)));
+    metaGraph->m_drawingFiles.back().m_region = drawing.getRegion();
+    metaGraph->setRegion(metaGraph->m_drawingFiles.back().m_region.bottom_left,
+                         metaGraph->m_drawingFiles.back().m_region.top_right);
+    return metaGraph;
+}
+
+// The whole room filled on a quarter unit grid
+static std::unique_ptr<PointMap> fillPartitionedRoom(MetaGraph &metaGraph, const std::string &name)
+{
+    int fill_type = 0; // = QDepthmapView::FULLFILL
+    std::unique_ptr<PointMap> pointMap(new PointMap(metaGraph.getRegion(), metaGraph.m_drawingFiles, name));
+    pointMap->setGrid(0.25, Point2f(0,0));
+    pointMap->makePoints(Point2f(0.6, 0.6), fill_type);
+    return pointMap;
+}
+
+// The same nodes, seeing the same pixels in the same order with the same far bin distances, and
+// the same point statistics
+static void requireSameGraph(PointMap &a, PointMap &b)
+{
+    std::stringstream aConnections, bConnections;
+    a.outputConnections(aConnections);
+    b.outputConnections(bConnections);
+    REQUIRE(aConnections.str() == bConnections.str());
+
+    const AttributeTable &aTable = a.getAttributeTable();
+    const AttributeTable &bTable = b.getAttributeTable();
+    REQUIRE(aTable.getNumRows() == bTable.getNumRows());
+    REQUIRE(aTable.getNumRows() == size_t(a.getFilledPointCount()));
+    for (auto iter = aTable.begin(); iter != aTable.end(); ++iter) {
+        PixelRef pix = iter->getKey().value;
+        REQUIRE(b.getPoint(pix).hasNode());
+        std::stringstream aNode, bNode;
+        a.getPoint(pix).getNode().write(aNode);
+        b.getPoint(pix).getNode().write(bNode);
+        REQUIRE(aNode.str() == bNode.str());
+    }
+    for (const char *column : {"Connectivity", "Point First Moment", "Point Second Moment"}) {
+        size_t aCol = aTable.getColumnIndex(column);
+        size_t bCol = bTable.getColumnIndex(column);
+        for (auto iter = aTable.begin(); iter != aTable.end(); ++iter) {
+            REQUIRE(iter->getRow().getValue(aCol) == bTable.getRow(iter->getKey()).getValue(bCol));
+        }
+    }
+}
+
+TEST_CASE("PointMap graph made on several threads", "")
+{
+    std::unique_ptr<MetaGraph> metaGraph = makePartitionedRoom();
+    std::unique_ptr<PointMap> serial = fillPartitionedRoom(*metaGraph, "Serial PointMap");
+    std::unique_ptr<PointMap> parallel = fillPartitionedRoom(*metaGraph, "Parallel PointMap");
+    REQUIRE(serial->sparkGraph2(nullptr, false, -1, 1));
+    REQUIRE(parallel->sparkGraph2(nullptr, false, -1, 4));
+    requireSameGraph(*serial, *parallel);
+}
+
+TEST_CASE("PointMap graph updated after drawing edits", "")
+{
+    std::unique_ptr<MetaGraph> metaGraph = makePartitionedRoom();
+    ShapeMap &drawing = metaGraph->m_drawingFiles.back().m_spacePixels.back();
+    int partitionRef = drawing.getAllShapes().rbegin()->first;
+    Line partition = drawing.getAllShapes().rbegin()->second.getLine();
+    std::unique_ptr<PointMap> updated = fillPartitionedRoom(*metaGraph, "Updated PointMap");
+    std::unique_ptr<PointMap> remade = fillPartitionedRoom(*metaGraph, "Remade PointMap");
+    REQUIRE(updated->sparkGraph2(nullptr, false, -1));
+
+    // the points to fill or empty are only changed in the remade map once its graph is gone
+    auto remake = [&](const std::vector<std::pair<Point2f, bool>> &fills, double maxdist) {
+        remade->unmake(false);
+        for (auto &fill : fills) {
+            remade->fillPoint(fill.first, fill.second);
+        }
+        REQUIRE(remade->sparkGraph2(nullptr, false, maxdist));
+    };
+
+    SECTION("Adding a line")
+    {
+        Line wall(Point2f(0.9,2.1), Point2f(3.1,2.6));
+        drawing.makeLineShape(wall);
+        REQUIRE(updated->updateGraph(nullptr, {wall}, -1));
+        remake({}, -1);
+        requireSameGraph(*updated, *remade);
+    }
+
+    SECTION("Removing a line")
+    {
+        drawing.removeShape(partitionRef);
+        REQUIRE(updated->updateGraph(nullptr, {partition}, -1, 4));
+        remake({}, -1);
+        requireSameGraph(*updated, *remade);
+    }
+
+    SECTION("Emptying and filling points")
+    {
+        std::vector<std::pair<Point2f, bool>> fills = {{Point2f(1.1, 1.4), false}, {Point2f(3.6, 0.4), false}};
+        for (auto &fill : fills) {
+            updated->fillPoint(fill.first, fill.second);
+        }
+        REQUIRE(updated->updateGraph(nullptr, {}, -1));
+        remake(fills, -1);
+        requireSameGraph(*updated, *remade);
+
+        fills.push_back({Point2f(1.1, 1.4), true});
+        updated->fillPoint(fills.back().first, fills.back().second);
+        REQUIRE(updated->updateGraph(nullptr, {}, -1));
+        remake(fills, -1);
+        requireSameGraph(*updated, *remade);
+    }
+
+    // each round adds or takes away a few walls and fills or empties a few points, then checks the
+    // updated graph against one made from scratch
+    auto requireRandomEditsUpdate = [&](double maxdist) {
+        std::mt19937 random(2026);
+        std::uniform_real_distribution<double> x(0.05, 3.95), y(0.05, 2.95);
+        // the points are kept off the walls of the room, as the sieve never gets past a point
+        // with two walls crossing at it
+        std::uniform_real_distribution<double> fillX(0.2, 3.8), fillY(0.2, 2.8);
+        std::vector<std::pair<int, Line>> walls;
+        std::vector<std::pair<Point2f, bool>> fills;
+        for (int round = 0; round < 10; round++) {
+            std::vector<Line> changed;
+            for (int edit = 0; edit < 3; edit++) {
+                switch (random() % 3) {
+                case 0: {
+                    Line wall(Point2f(x(random), y(random)), Point2f(x(random), y(random)));
+                    walls.push_back({drawing.makeLineShape(wall), wall});
+                    changed.push_back(wall);
+                    break;
+                }
+                case 1:
+                    if (!walls.empty()) {
+                        size_t which = random() % walls.size();
+                        drawing.removeShape(walls[which].first);
+                        changed.push_back(walls[which].second);
+                        walls.erase(walls.begin() + which);
+                    }
+                    break;
+                case 2: {
+                    Point2f p(fillX(random), fillY(random));
+                    fills.push_back({p, !updated->getPoint(updated->pixelate(p)).filled()});
+                    updated->fillPoint(p, fills.back().second);
+                    break;
+                }
+                }
+            }
+            REQUIRE(updated->updateGraph(nullptr, changed, maxdist, 2));
+            remake(fills, maxdist);
+            requireSameGraph(*updated, *remade);
+        }
+    };
+
+    SECTION("Random edits")
+    {
+        requireRandomEditsUpdate(-1);
+    }
+
+    SECTION("Random edits with limited visibility")
+    {
+        updated->unmake(false);
+        REQUIRE(updated->sparkGraph2(nullptr, false, 1.5));
+        requireRandomEditsUpdate(1.5);
+    }
+}
@@ -0,0 +1,59 @@
+// Copyright (C) 2026 Tasos Varoudis
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "catch.hpp"
+#include "genlib/parallelutils.h"
+#include "salalib/resultwriter.h"
+
+TEST_CASE("Results written from several threads go into the table on commit", "")
+{
+    AttributeTable table;
+    table.getOrInsertColumn("Kept");
+    ColumnHandle depth(table.getOrInsertColumn("Depth"));
+    for (int key = 99; key >= 0; key--) {
+        table.addRow(AttributeKey(key * 10));
+    }
+    table.getRow(AttributeKey(0)).setValue(depth.index, 7.0f);
+    table.getRow(AttributeKey(0)).setValue("Kept", 3.0f);
+    REQUIRE(table.getColumnHandle("Depth").index == depth.index);
+    REQUIRE_THROWS_AS(table.getColumnHandle("Missing"), std::out_of_range);
+
+    ResultWriter results(table);
+    REQUIRE(results.addColumn("Depth").index == depth.index);
+    ColumnHandle count = results.addColumn(ColumnHandle(table.getOrInsertColumn("Count")));
+    REQUIRE(results.getValue(results.getRowPosition(AttributeKey(0)), depth) == 7.0f);
+
+    // every other row is written, each by whichever thread gets it
+    depthmapX::parallelFor(nullptr, 3, 50, [&](size_t i, size_t) {
+        int key = int(i) * 20 + 10;
+        size_t position = results.getRowPosition(AttributeKey(key));
+        results.setValue(position, depth, float(key));
+        results.setValue(position, count, 1.0f);
+    });
+
+    // nothing reaches the table before the commit
+    REQUIRE(table.getRow(AttributeKey(10)).getValue(depth.index) == -1.0f);
+    results.commit();
+
+    REQUIRE(table.getRow(AttributeKey(0)).getValue(depth.index) == 7.0f);
+    REQUIRE(table.getRow(AttributeKey(0)).getValue("Kept") == 3.0f);
+    REQUIRE(table.getRow(AttributeKey(20)).getValue(depth.index) == -1.0f);
+    for (int key = 10; key < 1000; key += 20) {
+        REQUIRE(table.getRow(AttributeKey(key)).getValue(depth.index) == float(key));
+        REQUIRE(table.getRow(AttributeKey(key)).getValue(count.index) == 1.0f);
+    }
+    REQUIRE(table.getColumn(depth.index).getStats().max == Approx(990.0));
+    REQUIRE(table.getColumn(count.index).getStats().total == Approx(50.0));
+}
@@ -379,6 +379,157 @@ TEST_CASE("Shapemap scripts with unexpected results") {
     }
 }
 
+static std::unique_ptr<ShapeGraph> makeScriptTestAxialMap() {
+    std::vector<SpacePixelFile> drawingFiles;
+    drawingFiles.push_back(SpacePixelFile("Test SpacePixelGroup"));
+    drawingFiles.back().m_spacePixels.push_back(ShapeMap("Test ShapeMap"));
+    ShapeMap &drawing = drawingFiles.back().m_spacePixels.back();
+    drawing.makeLineShape(Line(Point2f(0, 0), Point2f(3, 0)));
+    drawing.makeLineShape(Line(Point2f(1, 1), Point2f(1, -1)));
+    drawing.makeLineShape(Line(Point2f(2, 1), Point2f(2, -2)));
+    drawing.makeLineShape(Line(Point2f(2, 1), Point2f(4, 1)));
+    drawing.makeLineShape(Line(Point2f(5, 3), Point2f(3, 1)));
+    return MapConverter::convertDrawingToAxial(0, "Test axial", drawingFiles);
+}
+
+TEST_CASE("Compiled scripts") {
+
+    auto shapeGraph = makeScriptTestAxialMap();
+    AttributeTable &attributes = shapeGraph->getAttributeTable();
+    int valueCol = shapeGraph->addAttribute("Some value");
+    float v = 0.5f;
+    for (auto rowIter = attributes.begin(); rowIter != attributes.end(); rowIter++) {
+        rowIter->getRow().setValue(valueCol, v);
+        v *= 3;
+    }
+    int newCol = shapeGraph->addAttribute("NewCol");
+    SalaGrf graph;
+    graph.map.shape = shapeGraph.get();
+    SalaObj context = SalaObj(SalaObj::S_SHAPEMAPOBJ, graph);
+
+    std::stringstream script;
+    std::vector<double> expectedColVals;
+
+    SECTION("float arithmetic on values") {
+        // 1 / 4 is an integer division
+        script << "value(\"Some value\") * 2 + 1 / 4\n";
+        expectedColVals = {1.0, 3.0, 9.0, 27.0, 81.0};
+    }
+
+    SECTION("constants folded into float arithmetic") {
+        script << "(2 ^ 3 - 0.5) * value(\"Some value\") / (1 + 2)\n";
+        expectedColVals = {1.25, 3.75, 11.25, 33.75, 101.25};
+    }
+
+    SECTION("variables assigned after they are used") {
+        // list items are evaluated from the last to the first
+        script << "x = value(\"Ref Number\")\n"
+               << "[(x = 100), x][1]\n";
+        expectedColVals = {0.0, 1.0, 2.0, 3.0, 4.0};
+    }
+
+    SECTION("and in conditions") {
+        script << "x = value(\"Ref Number\")\n"
+               << "if x > 0 and x < 3 and value(\"Some value\") > 1:\n"
+               << "    return 1\n"
+               << "0\n";
+        expectedColVals = {0.0, 1.0, 1.0, 0.0, 0.0};
+    }
+
+    SECTION("and that is not evaluated last, which is left to the interpreter") {
+        script << "x = value(\"Ref Number\")\n"
+               << "len([x, x > 0 and x < 3])\n";
+        expectedColVals = {2.0, 2.0, 2.0, 2.0, 2.0};
+    }
+
+    SECTION("values of other rows") {
+        script << "x = 0\n"
+               << "for line in connections():\n"
+               << "    x = x + line.value(\"Ref Number\") * line.value(\"Some value\")\n"
+               << "x\n";
+        expectedColVals = {1 * 1.5 + 2 * 4.5, 0.0, 0 + 3 * 13.5, 2 * 4.5 + 4 * 40.5, 3 * 13.5};
+    }
+
+    SalaProgram program(context);
+    REQUIRE(program.parse(script));
+    REQUIRE(program.runupdate(newCol));
+
+    auto iter = expectedColVals.begin();
+    for (auto rowIter = attributes.begin(); rowIter != attributes.end(); rowIter++) {
+        REQUIRE(rowIter->getRow().getValue(newCol) == Approx(*iter).epsilon(0.001));
+        iter++;
+    }
+}
+
+TEST_CASE("Compiled scripts report errors as the interpreter does") {
+
+    auto shapeGraph = makeScriptTestAxialMap();
+    int newCol = shapeGraph->addAttribute("NewCol");
+    SalaGrf graph;
+    graph.map.shape = shapeGraph.get();
+    SalaObj context = SalaObj(SalaObj::S_SHAPEMAPOBJ, graph);
+
+    std::stringstream script;
+    std::string expectedMessage;
+
+    SECTION("unknown column in nested functions") {
+        script << "x = 1\n"
+               << "sqrt(value(\"Nope\") * 2)\n";
+        expectedMessage = "In 'sqrt' function: In '*' operator: In graph object 'value' function: "
+                          "Nope is an unknown column on line 2";
+    }
+
+    SECTION("types that do not add") {
+        script << "x = (1 + \"a\") * 2\n";
+        expectedMessage = "In '=' operator: In '*' operator: In '+' operator: Cannot add a string to an integer on line 1";
+    }
+
+    SECTION("exponent converted before the base is evaluated") {
+        script << "value(\"Nope\") ^ \"b\"\n";
+        expectedMessage = "In '^' operator: Cannot convert a string to a floating point number on line 1";
+    }
+
+    SECTION("assignment to a constant") {
+        script << "x = [1, 2]\n"
+               << "if x[0] == 1:\n"
+               << "    3 = x[1]\n";
+        expectedMessage = "In '=' operator: Cannot assign to constant, function or none on line 3";
+    }
+
+    SECTION("result that is not a number") {
+        script << "x = [1, 2]\n"
+               << "x\n";
+        expectedMessage = "Cannot convert a list to a floating point number";
+    }
+
+    SalaProgram program(context);
+    REQUIRE(program.parse(script));
+    REQUIRE_FALSE(program.runupdate(newCol));
+    REQUIRE(program.getLastErrorMessage() == expectedMessage);
+}
+
+TEST_CASE("Select by script") {
+
+    auto shapeGraph = makeScriptTestAxialMap();
+    SalaGrf graph;
+    graph.map.shape = shapeGraph.get();
+    SalaObj context = SalaObj(SalaObj::S_SHAPEMAPOBJ, graph);
+
+    std::stringstream script;
+    script << "value(\"Ref Number\") > 2 or value(\"Ref Number\") == 0\n";
+
+    SalaProgram program(context);
+    REQUIRE(program.parse(script));
+
+    std::vector<int> selected;
+    REQUIRE(program.runselect(selected));
+    REQUIRE(selected == std::vector<int>{0, 3, 4});
+
+    selected.clear();
+    REQUIRE(program.runselect(selected, std::set<int>{1, 2, 4}));
+    REQUIRE(selected == std::vector<int>{4});
+}
+
 TEST_CASE("Performance tests") {
     //# For a graph with 100000 segments for cpu timing:
     //x=value("Angular Connectivity")*value("Angular Step Depth")+value("Axial Line Ref")+value("Connectivity")/value("Segment Length")^value("T1024 Choice R1000 metric")
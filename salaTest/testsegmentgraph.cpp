@@ -0,0 +1,84 @@
+// Copyright (C) 2026 Tasos Varoudis
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "catch.hpp"
+#include "salalib/mapconverter.h"
+#include "salalib/mgraph.h"
+#include "salalib/segmentgraph.h"
+
+namespace {
+    void requireSnapshotMatches(const ShapeGraph &map) {
+        const SegmentGraph &graph = map.getSegmentGraph();
+        const std::vector<Connector> &connectors = map.getConnections();
+        REQUIRE(graph.segmentCount() == connectors.size());
+        for (size_t segment = 0; segment < connectors.size(); segment++) {
+            std::vector<std::pair<SegmentRef, float>> expected(connectors[segment].m_back_segconns.begin(),
+                                                               connectors[segment].m_back_segconns.end());
+            std::vector<std::pair<SegmentRef, float>> actual;
+            for (size_t edge = graph.backBegin(int(segment)); edge < graph.backEnd(int(segment)); edge++) {
+                actual.push_back(std::make_pair(graph.segmentRef(edge), graph.weight(edge)));
+            }
+            REQUIRE(graph.backEnd(int(segment)) == graph.forwardBegin(int(segment)));
+            for (size_t edge = graph.forwardBegin(int(segment)); edge < graph.forwardEnd(int(segment)); edge++) {
+                actual.push_back(std::make_pair(graph.segmentRef(edge), graph.weight(edge)));
+            }
+            expected.insert(expected.end(), connectors[segment].m_forward_segconns.begin(),
+                            connectors[segment].m_forward_segconns.end());
+            REQUIRE(actual.size() == expected.size());
+            for (size_t i = 0; i < actual.size(); i++) {
+                REQUIRE(actual[i].first.ref == expected[i].first.ref);
+                REQUIRE(actual[i].first.dir == expected[i].first.dir);
+                REQUIRE(actual[i].second == expected[i].second);
+            }
+        }
+    }
+}
+
+TEST_CASE("Segment graph snapshot of a segment map")
+{
+    // an uneven lattice, broken into segments where the lines cross
+    std::vector<Line> lines;
+    for (int i = 0; i < 5; i++) {
+        lines.push_back(Line(Point2f(0.25 * (i % 3), i), Point2f(4.5 - 0.5 * (i % 4), i + 0.1 * (i % 3))));
+        lines.push_back(Line(Point2f(i + 0.5, -0.5 + (i % 3)), Point2f(i + 0.5 + 0.2 * (i % 2), 4.5)));
+    }
+    std::unique_ptr<MetaGraph> metaGraph(new MetaGraph("Test MetaGraph"));
+    metaGraph->m_drawingFiles.emplace_back("Test SpacePixelGroup");
+    metaGraph->m_drawingFiles.back().m_spacePixels.emplace_back("Test ShapeMap");
+    for (const Line &line : lines) {
+        metaGraph->m_drawingFiles.back().m_spacePixels.back().makeLineShape(line);
+    }
+    auto axialMap = MapConverter::convertDrawingToAxial(nullptr, "Test axial", metaGraph->m_drawingFiles);
+    auto segmentMap = MapConverter::convertAxialToSegment(nullptr, *axialMap, "Test segment");
+    REQUIRE(segmentMap->getShapeCount() > lines.size());
+
+    requireSnapshotMatches(*segmentMap);
+
+    SECTION("The snapshot follows new links")
+    {
+        // a segment that the first is not yet linked to
+        const auto &forward = segmentMap->getConnections()[0].m_forward_segconns;
+        int target = int(segmentMap->getShapeCount()) - 1;
+        while (forward.find(SegmentRef(-1, target)) != forward.end()) {
+            target--;
+        }
+        REQUIRE(target > 0);
+        size_t before = segmentMap->getSegmentGraph().forwardEnd(0) - segmentMap->getSegmentGraph().forwardBegin(0);
+        segmentMap->linkShapes(0, 1, target, -1, 0.5f);
+        requireSnapshotMatches(*segmentMap);
+        REQUIRE(segmentMap->getSegmentGraph().forwardEnd(0) - segmentMap->getSegmentGraph().forwardBegin(0) ==
+                before + 1);
+    }
+}
@@ -0,0 +1,74 @@
+// Copyright (C) 2026 Tasos Varoudis
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "catch.hpp"
+#include "salalib/segmmodules/segmmetric.h"
+#include "salalib/segmmodules/segmtopological.h"
+#include "segmentlattice.h"
+
+TEST_CASE("Metric and topological analysis of several radii match one run per radius")
+{
+    std::set<double> radii = {-1.0, 2.0, 4.0};
+    auto multi = makeSegmentLattice();
+    std::string prefix;
+    SECTION("Metric")
+    {
+        prefix = "Metric ";
+        SegmentMetric(radii, false).run(nullptr, *multi, false);
+    }
+    SECTION("Topological")
+    {
+        prefix = "Topological ";
+        SegmentTopological(radii, false).run(nullptr, *multi, false);
+    }
+    const AttributeTable &multiAttributes = multi->getAttributeTable();
+    size_t segmentCount = multi->getShapeCount();
+
+    for (double radius : radii) {
+        auto single = makeSegmentLattice();
+        std::string suffix;
+        if (prefix == "Metric ") {
+            SegmentMetric(radius, false).run(nullptr, *single, false);
+        } else {
+            SegmentTopological(radius, false).run(nullptr, *single, false);
+        }
+        if (radius != -1.0) {
+            suffix = dXstring::formatString(radius, " R%.f metric");
+        }
+        const AttributeTable &singleAttributes = single->getAttributeTable();
+        for (std::string name : {"Choice", "Choice [SLW]", "Mean Depth", "Mean Depth [SLW]", "Total Depth",
+                                 "Total Nodes", "Total Length"}) {
+            int singleCol = singleAttributes.getColumnIndex(prefix + name + suffix);
+            int multiCol = multiAttributes.getColumnIndex(prefix + name + suffix);
+            REQUIRE(singleCol != -1);
+            REQUIRE(multiCol != -1);
+            for (size_t index = 0; index < segmentCount; index++) {
+                float singleValue = single->getAttributeRowFromShapeIndex(index).getValue(singleCol);
+                float multiValue = multi->getAttributeRowFromShapeIndex(index).getValue(multiCol);
+                // mean depths of segments that reach nothing else are NaN in both
+                if (singleValue == singleValue) {
+                    REQUIRE(singleValue == multiValue);
+                } else {
+                    REQUIRE(multiValue != multiValue);
+                }
+            }
+        }
+        if (radius == -1.0) {
+            // the lattice is connected, so every segment reaches all the others at radius n
+            int countCol = singleAttributes.getColumnIndex(prefix + "Total Nodes");
+            REQUIRE(single->getAttributeRowFromShapeIndex(0).getValue(countCol) == Approx(segmentCount));
+        }
+    }
+}
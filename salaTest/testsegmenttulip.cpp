@@ -0,0 +1,50 @@
+// Copyright (C) 2026 Tasos Varoudis
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "catch.hpp"
+#include "salalib/segmmodules/segmtulip.h"
+#include "segmentlattice.h"
+
+TEST_CASE("Segment tulip analysis gives the same results on any number of threads")
+{
+    auto single = makeSegmentLattice();
+    auto multi = makeSegmentLattice();
+    size_t segmentCount = single->getShapeCount();
+    REQUIRE(segmentCount > getSegmentLatticeLines().size());
+
+    std::set<double> radii = {-1.0, 0.5};
+    int weightCol = single->getAttributeTable().getColumnIndex("Segment Length");
+    REQUIRE(weightCol != -1);
+    SegmentTulip(radii, false, 1024, weightCol, Options::RADIUS_ANGULAR, true, false, -1, -1, 1)
+        .run(nullptr, *single, false);
+    SegmentTulip(radii, false, 1024, weightCol, Options::RADIUS_ANGULAR, true, false, -1, -1, 3)
+        .run(nullptr, *multi, false);
+
+    const AttributeTable &singleAttributes = single->getAttributeTable();
+    const AttributeTable &multiAttributes = multi->getAttributeTable();
+    REQUIRE(singleAttributes.getNumColumns() == multiAttributes.getNumColumns());
+    REQUIRE(singleAttributes.hasColumn("T1024 Node Count"));
+    size_t countCol = singleAttributes.getColumnIndex("T1024 Node Count");
+    REQUIRE(singleAttributes.hasColumn("T1024 Choice [Segment Length Wgt]"));
+    for (size_t index = 0; index < segmentCount; index++) {
+        const AttributeRow &singleRow = single->getAttributeRowFromShapeIndex(index);
+        const AttributeRow &multiRow = multi->getAttributeRowFromShapeIndex(index);
+        // the lattice is connected, so every segment reaches all the others at radius n
+        REQUIRE(singleRow.getValue(countCol) == Approx(segmentCount));
+        for (size_t col = 0; col < singleAttributes.getNumColumns(); col++) {
+            REQUIRE(singleRow.getValue(col) == multiRow.getValue(col));
+        }
+    }
+}
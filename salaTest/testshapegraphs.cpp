@@ -161,3 +161,48 @@ TEST_CASE("Testing ShapeMap::getAllLinkLines and ShapeMap::getAllUnlinkPoints()"
     REQUIRE(unlinkPoints[0].x == Approx(intersection.x).epsilon(EPSILON));
     REQUIRE(unlinkPoints[0].y == Approx(intersection.y).epsilon(EPSILON));
 }
+
+TEST_CASE("Testing ShapeGraph::makeConnections on several threads")
+{
+    std::unique_ptr<MetaGraph> metaGraph(new MetaGraph("Test MetaGraph"));
+
+    metaGraph->m_drawingFiles.emplace_back("Test SpacePixelGroup");
+    metaGraph->m_drawingFiles.back().m_spacePixels.emplace_back("Test ShapeMap");
+
+    // a lattice: every horizontal line crosses every vertical one
+    const int side = 8;
+    for (int i = 0; i < side; i++) {
+        metaGraph->m_drawingFiles.back().m_spacePixels.back().makeLineShape(
+            Line(Point2f(-0.5, i), Point2f(side - 0.5, i)));
+        metaGraph->m_drawingFiles.back().m_spacePixels.back().makeLineShape(
+            Line(Point2f(i, -0.5), Point2f(i, side - 0.5)));
+    }
+
+    auto shapegraph = MapConverter::convertDrawingToAxial(0, "Test axial", metaGraph->m_drawingFiles);
+    REQUIRE(shapegraph->getConnections().size() == 2 * side);
+
+    std::vector<std::vector<int>> single;
+    for (auto &connector : shapegraph->getConnections()) {
+        single.push_back(connector.m_connections);
+    }
+
+    shapegraph->makeConnections(KeyVertices(), 3);
+    const std::vector<Connector> &connectors = shapegraph->getConnections();
+    REQUIRE(connectors.size() == single.size());
+
+    std::vector<bool> horizontal;
+    for (auto &shape : shapegraph->getAllShapes()) {
+        const Line &line = shape.second.getLine();
+        horizontal.push_back(line.height() < line.width());
+    }
+    for (size_t i = 0; i < connectors.size(); i++) {
+        REQUIRE(connectors[i].m_connections == single[i]);
+        std::vector<int> expected;
+        for (size_t j = 0; j < connectors.size(); j++) {
+            if (horizontal[j] != horizontal[i]) {
+                expected.push_back(int(j));
+            }
+        }
+        REQUIRE(connectors[i].m_connections == expected);
+    }
+}
@@ -0,0 +1,62 @@
+// Copyright (C) 2026 Tasos Varoudis
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "catch.hpp"
+#include "salalib/shapemap.h"
+
+static void requireIndexMatchesMap(const ShapeMap &shapeMap) {
+    const std::map<int, SalaShape> &shapes = shapeMap.getAllShapes();
+    size_t index = 0;
+    for (auto iter = shapes.begin(); iter != shapes.end(); ++iter, ++index) {
+        REQUIRE(shapeMap.getShapeRefFromIndex(index) == iter);
+        REQUIRE(shapeMap.getShapeIndexFromKey(iter->first) == int(index));
+    }
+}
+
+TEST_CASE("Shape index follows the shapes of a ShapeMap", "") {
+    ShapeMap shapeMap("Test ShapeMap");
+    for (int i = 0; i < 5; i++) {
+        shapeMap.makeLineShape(Line(Point2f(0.0, i), Point2f(1.0, i)));
+        requireIndexMatchesMap(shapeMap);
+    }
+    REQUIRE(shapeMap.getShapeIndexFromKey(100) == -1);
+
+    SECTION("Removing a shape from the middle") {
+        int key = shapeMap.getShapeRefFromIndex(2)->first;
+        shapeMap.removeShape(key, false);
+        REQUIRE(shapeMap.getShapeIndexFromKey(key) == -1);
+        requireIndexMatchesMap(shapeMap);
+
+        // and appending after that
+        shapeMap.makeLineShape(Line(Point2f(0.0, 10.0), Point2f(1.0, 10.0)));
+        requireIndexMatchesMap(shapeMap);
+    }
+
+    SECTION("Adding a shape before the existing ones") {
+        shapeMap.makeLineShapeWithRef(Line(Point2f(0.0, -1.0), Point2f(1.0, -1.0)), -5);
+        REQUIRE(shapeMap.getShapeIndexFromKey(-5) == 0);
+        requireIndexMatchesMap(shapeMap);
+    }
+
+    SECTION("Replacing the shapes with as many others") {
+        shapeMap.clearShapes();
+        for (int i = 0; i < 5; i++) {
+            shapeMap.makeLineShapeWithRef(Line(Point2f(2.0, i), Point2f(3.0, i)), 10 + i);
+        }
+        REQUIRE(shapeMap.getShapeIndexFromKey(0) == -1);
+        REQUIRE(shapeMap.getShapeIndexFromKey(10) == 0);
+        requireIndexMatchesMap(shapeMap);
+    }
+}
@@ -189,6 +189,24 @@ TEST_CASE("Testing deleting shapes from axial maps") {
             }
         }
     }
+
+    SECTION("Delete the selected shapes from an axial map") {
+        axialMap->setEditable(true);
+        axialMap->setCurSel(std::vector<int>{1, 2});
+        REQUIRE(axialMap->removeSelected());
+        REQUIRE(axialMap->getAllShapes().size() == 2);
+        REQUIRE(axialMap->getConnections().size() == 2);
+        REQUIRE(axialTable.getNumRows() == 2);
+        REQUIRE(axialTable.getRowPtr(AttributeKey(1)) == nullptr);
+        REQUIRE(axialTable.getRowPtr(AttributeKey(2)) == nullptr);
+
+        // 0 and 3 each lose one of their two connections
+        for (int shapeRef : {0, 3}) {
+            REQUIRE(axialTable.getRow(AttributeKey(shapeRef)).getValue(axialConnectivityColIdx) == 1);
+        }
+        REQUIRE(axialMap->getConnections()[0].m_connections == std::vector<int>{1});
+        REQUIRE(axialMap->getConnections()[1].m_connections == std::vector<int>{0});
+    }
 }
 
 TEST_CASE("Testing deleting shapes from segment maps") {
@@ -0,0 +1,79 @@
+// Copyright (C) 2026 Tasos Varoudis
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "catch.hpp"
+#include "salalib/traversalqueue.h"
+
+#include <random>
+
+TEST_CASE("Bucket traversal queue pops in set order", "")
+{
+    SetTraversalQueue<MetricTriple> setQueue;
+    BucketTraversalQueue<MetricTriple> bucketQueue(1.0f);
+
+    // a Dijkstra-like run: every push is at least as far as the last pop, duplicates
+    // (same distance and pixel) turn up now and then, and some steps are shorter than
+    // a bucket so that entries land in the bucket currently being popped
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> pixelDist(0, 7);
+    std::uniform_int_distribution<int> stepDist(0, 6);
+    float last = 0.0f;
+    for (int round = 0; round < 3; round++) {
+        setQueue.clear();
+        bucketQueue.clear();
+        setQueue.push(MetricTriple(0.0f, PixelRef(0, 0), PixelRef(1, 1)));
+        bucketQueue.push(MetricTriple(0.0f, PixelRef(0, 0), PixelRef(1, 1)));
+        last = 0.0f;
+        for (int i = 0; i < 500 && !setQueue.empty(); i++) {
+            REQUIRE_FALSE(bucketQueue.empty());
+            MetricTriple fromSet = setQueue.pop();
+            MetricTriple fromBuckets = bucketQueue.pop();
+            REQUIRE(fromSet.dist == fromBuckets.dist);
+            REQUIRE(fromSet.pixel == fromBuckets.pixel);
+            REQUIRE(fromSet.lastpixel == fromBuckets.lastpixel);
+            REQUIRE(fromSet.dist >= last);
+            last = fromSet.dist;
+            for (int j = 0; j < 3; j++) {
+                MetricTriple next(last + stepDist(gen) * 0.5f, PixelRef(pixelDist(gen), pixelDist(gen)),
+                                  PixelRef(j, i % 8));
+                setQueue.push(next);
+                bucketQueue.push(next);
+            }
+        }
+        while (!setQueue.empty()) {
+            REQUIRE_FALSE(bucketQueue.empty());
+            MetricTriple fromSet = setQueue.pop();
+            MetricTriple fromBuckets = bucketQueue.pop();
+            REQUIRE(fromSet.dist == fromBuckets.dist);
+            REQUIRE(fromSet.pixel == fromBuckets.pixel);
+            REQUIRE(fromSet.lastpixel == fromBuckets.lastpixel);
+        }
+        REQUIRE(bucketQueue.empty());
+    }
+}
+
+TEST_CASE("Bucket traversal queue keys below the current bucket", "")
+{
+    BucketTraversalQueue<AngularTriple> queue(0.5f);
+    queue.push(AngularTriple(2.2f, PixelRef(1, 1)));
+    queue.push(AngularTriple(2.1f, PixelRef(2, 1)));
+    REQUIRE(queue.pop().angle == 2.1f);
+
+    // lower than anything popped so far: still the next one out
+    queue.push(AngularTriple(0.3f, PixelRef(3, 1)));
+    REQUIRE(queue.pop().angle == 0.3f);
+    REQUIRE(queue.pop().angle == 2.2f);
+    REQUIRE(queue.empty());
+}
@@ -0,0 +1,43 @@
+// Copyright (C) 2026 Tasos Varoudis
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "catch.hpp"
+#include "salalib/traversalworkspace.h"
+
+TEST_CASE("Traversal workspace defaults and reset", "")
+{
+    TraversalWorkspace workspace(12, 0.0f, -1.0f);
+    int a = 7;
+    int b = 11;
+
+    REQUIRE(workspace.misc(a) == 0);
+    REQUIRE(workspace.dist(a) == 0.0f);
+    REQUIRE(workspace.cumangle(a) == -1.0f);
+
+    workspace.misc(a) = ~0;
+    workspace.dist(a) = 3.5f;
+    workspace.cumangle(b) = 2.0f;
+
+    REQUIRE(workspace.misc(a) == ~0);
+    REQUIRE(workspace.dist(a) == 3.5f);
+    REQUIRE(workspace.cumangle(b) == 2.0f);
+    REQUIRE(workspace.misc(b) == 0);
+
+    // a new traversal sees the defaults again without anything being cleared explicitly
+    workspace.reset();
+    REQUIRE(workspace.misc(a) == 0);
+    REQUIRE(workspace.dist(a) == 0.0f);
+    REQUIRE(workspace.cumangle(b) == -1.0f);
+}
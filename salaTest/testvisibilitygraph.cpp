@@ -0,0 +1,102 @@
+// Copyright (C) 2026 Tasos Varoudis
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "catch.hpp"
+#include "salalib/mgraph.h"
+#include "salalib/pointdata.h"
+#include "salalib/visibilitygraph.h"
+
+TEST_CASE("Visibility graph snapshot of a half filled grid", "")
+{
+    double spacing = 0.5;
+    Point2f offset(0, 0);
+    int fill_type = 0; // = QDepthmapView::FULLFILL
+
+    // a diagonal wall through the grid, so that the graph has blocked cells and
+    // diagonal runs with gaps in them
+    Point2f lineStart(0, 0);
+    Point2f lineEnd(2, 4);
+
+    std::unique_ptr<MetaGraph> metaGraph(new MetaGraph("Test MetaGraph"));
+    metaGraph->m_drawingFiles.emplace_back("Test SpacePixelGroup");
+    metaGraph->m_drawingFiles.back().m_spacePixels.emplace_back("Test ShapeMap");
+    metaGraph->m_drawingFiles.back().m_spacePixels.back().makeLineShape(Line(lineStart, lineEnd));
+    metaGraph->m_drawingFiles.back().m_region = metaGraph->m_drawingFiles.back().m_spacePixels.back().getRegion();
+    metaGraph->setRegion(metaGraph->m_drawingFiles.back().m_region.bottom_left,
+                         metaGraph->m_drawingFiles.back().m_region.top_right);
+
+    PointMap pointMap(metaGraph->getRegion(), metaGraph->m_drawingFiles, "Test PointMap");
+    pointMap.setGrid(spacing, offset);
+    Point2f gridBottomLeft = pointMap.getRegion().bottom_left;
+    Point2f gridTopRight = pointMap.getRegion().top_right;
+    pointMap.makePoints(Point2f(gridBottomLeft.x + spacing, gridTopRight.y - spacing), fill_type);
+    pointMap.sparkGraph2(nullptr, false, -1);
+
+    const VisibilityGraph &graph = pointMap.getVisibilityGraph();
+    REQUIRE(graph.nodeCount() == size_t(pointMap.getFilledPointCount()));
+
+    // nodes are numbered column by column, and hold what their Node holds, in the same order
+    int expectedNode = 0;
+    for (size_t i = 0; i < pointMap.getCols(); i++) {
+        for (size_t j = 0; j < pointMap.getRows(); j++) {
+            PixelRef curs(static_cast<short>(i), static_cast<short>(j));
+            Point &point = pointMap.getPoint(curs);
+            if (!point.filled()) {
+                REQUIRE(graph.nodeAt(curs) == VisibilityGraph::NO_NODE);
+                continue;
+            }
+            int node = graph.nodeAt(curs);
+            REQUIRE(node == expectedNode++);
+            REQUIRE(graph.pixel(node) == curs);
+            REQUIRE(graph.onBoundary(node) == (point.blocked() || pointMap.blockedAdjacent(curs)));
+            REQUIRE(graph.mergePartner(node) == VisibilityGraph::NO_NODE);
+
+            std::vector<PixelRef> expected;
+            std::vector<int> expectedBins;
+            for (int b = 0; b < 32; b++) {
+                const Bin &bin = point.getNode().bin(b);
+                for (bin.first(); !bin.is_tail(); bin.next()) {
+                    if (pointMap.getPoint(bin.cursor()).filled()) {
+                        expected.push_back(bin.cursor());
+                        expectedBins.push_back(b);
+                    }
+                }
+            }
+            std::vector<PixelRef> actual;
+            std::vector<int> actualBins;
+            for (size_t edge = graph.edgesBegin(node); edge < graph.edgesEnd(node); edge++) {
+                actual.push_back(graph.pixel(graph.neighbour(edge)));
+                actualBins.push_back(graph.bin(edge));
+            }
+            REQUIRE(actual == expected);
+            REQUIRE(actualBins == expectedBins);
+        }
+    }
+
+    SECTION("The snapshot follows merged pixels")
+    {
+        PixelRef a = graph.pixel(0);
+        PixelRef b = graph.pixel(int(graph.nodeCount()) - 1);
+        pointMap.mergePixels(a, b);
+
+        const VisibilityGraph &merged = pointMap.getVisibilityGraph();
+        REQUIRE(merged.mergePartner(merged.nodeAt(a)) == merged.nodeAt(b));
+        REQUIRE(merged.mergePartner(merged.nodeAt(b)) == merged.nodeAt(a));
+
+        pointMap.unmergePixel(a);
+        const VisibilityGraph &unmerged = pointMap.getVisibilityGraph();
+        REQUIRE(unmerged.mergePartner(unmerged.nodeAt(a)) == VisibilityGraph::NO_NODE);
+    }
+}
@@ -2,13 +2,16 @@
 #include "salalib/axialminimiser.h"
 #include "salalib/tolerances.h"
 #include "genlib/exceptions.h"
+#include "genlib/parallelutils.h"
 #include <time.h>
 #include <iomanip>
+#include <unordered_map>
 
 AllLineMap::AllLineMap(Communicator *comm,
                        std::vector<SpacePixelFile> &drawingLayers,
                        const Point2f& seed,
-                       const std::string& name):
+                       const std::string& name,
+                       int threads):
     ShapeGraph(name, ShapeMap::ALLLINEMAP)
 {
    if (comm) {
@@ -74,51 +77,67 @@ AllLineMap::AllLineMap(Communicator *comm,
    }
 
 
-   time_t atime = 0;
-   int count = 0;
    if (comm) {
-      qtimer( atime, 0 );
       comm->CommPostMessage( Communicator::CURRENT_STEP, 2 );
       comm->CommPostMessage( Communicator::NUM_RECORDS, m_polygons.m_vertex_possibles.size() );
    }
 
    std::set<AxialVertex> openvertices;
    openvertices.insert(vertex);
-   while (!openvertices.empty()) {
-      m_polygons.makeAxialLines(openvertices, axiallines, preaxialdata, m_poly_connections, m_radial_lines);
-      count++;
-      //
-      if (comm) {
-         if (qtimer( atime, 500 )) {
-            if (comm->IsCancelled()) {
-               throw Communicator::CancelledException();
-            }
-            comm->CommPostMessage( Communicator::CURRENT_RECORD, count );
-         }
-      }
-
-   }
+   m_polygons.makeAxialLines(comm, openvertices, axiallines, preaxialdata, m_poly_connections, m_radial_lines, threads);
 
    if (comm) {
       comm->CommPostMessage( Communicator::CURRENT_STEP, 3 );
       comm->CommPostMessage( Communicator::CURRENT_RECORD, 0 );
    }
 
-   // cut out duplicates:
-   int removed = 0;  // for testing purposes
-   for (size_t j = 0; j < axiallines.size(); j++) {
-      for (size_t k = axiallines.size() - 1; k > j; k--) {
-         double maxdim = __max(region.width(),region.height());
-         if (approxeq(axiallines[j].start(), axiallines[k].start(), maxdim * TOLERANCE_B) && approxeq(axiallines[j].end(), axiallines[k].end(), maxdim * TOLERANCE_B)) {
-            for (int preaxiali: preaxialdata[k]) {
-                preaxialdata[j].insert(preaxiali);
+   // cut out duplicates: each line is merged into the first line kept before it that it matches. The kept lines
+   // are hashed on a grid by their start points, with cells no smaller than the tolerance, so that only the
+   // lines in the cells around a line need to be compared with it
+   double maxdim = __max(region.width(),region.height());
+   double tolerance = maxdim * TOLERANCE_B;
+   double cellsize = tolerance > 0.0 ? tolerance : 1.0;
+   auto cellOf = [&](const Point2f& p) {
+      return std::make_pair(int64_t(floor((p.x - region.bottom_left.x) / cellsize)),
+                            int64_t(floor((p.y - region.bottom_left.y) / cellsize)));
+   };
+   struct CellHash {
+      size_t operator()(const std::pair<int64_t,int64_t>& cell) const {
+         return std::hash<int64_t>()(cell.first) ^ (std::hash<int64_t>()(cell.second) * 31);
+      }
+   };
+   std::unordered_map<std::pair<int64_t,int64_t>, std::vector<size_t>, CellHash> keptcells;
+   size_t kept = 0;
+   for (size_t k = 0; k < axiallines.size(); k++) {
+      auto cell = cellOf(axiallines[k].start());
+      size_t match = kept;
+      for (int64_t x = cell.first - 1; x <= cell.first + 1; x++) {
+         for (int64_t y = cell.second - 1; y <= cell.second + 1; y++) {
+            auto keptcell = keptcells.find(std::make_pair(x, y));
+            if (keptcell == keptcells.end()) {
+               continue;
+            }
+            for (size_t j: keptcell->second) {
+               if (j < match && approxeq(axiallines[j].start(), axiallines[k].start(), tolerance) &&
+                     approxeq(axiallines[j].end(), axiallines[k].end(), tolerance)) {
+                  match = j;
+               }
             }
-            preaxialdata.erase(preaxialdata.begin() + int(k));
-            axiallines.erase(axiallines.begin() + int(k));
-            removed++;
          }
       }
+      if (match != kept) {
+         preaxialdata[match].insert(preaxialdata[k].begin(), preaxialdata[k].end());
+         continue;
+      }
+      if (kept != k) {
+         axiallines[kept] = axiallines[k];
+         preaxialdata[kept] = std::move(preaxialdata[k]);
+      }
+      keptcells[cell].push_back(kept);
+      kept++;
    }
+   axiallines.resize(kept);
+   preaxialdata.resize(kept);
 
    region.grow(0.99); // <- this paired with crop code below to prevent error
    init(axiallines.size(), m_polygons.getRegion());  // used to be double density here
@@ -130,12 +149,12 @@ AllLineMap::AllLineMap(Communicator *comm,
 
    // n.b. make connections also initialises attributes
    // -> don't know what this was for: alllinemap.sortBins(m_poly_connections);
-   makeConnections(preaxialdata);
+   makeConnections(preaxialdata, threads);
 
    setKeyVertexCount(m_polygons.m_vertex_possibles.size());
 }
 
-std::tuple<std::unique_ptr<ShapeGraph>, std::unique_ptr<ShapeGraph>> AllLineMap::extractFewestLineMaps(Communicator *comm)
+std::tuple<std::unique_ptr<ShapeGraph>, std::unique_ptr<ShapeGraph>> AllLineMap::extractFewestLineMaps(Communicator *comm, unsigned int seed, int threads)
 {
 
    if (comm) {
@@ -143,8 +162,6 @@ std::tuple<std::unique_ptr<ShapeGraph>, std::unique_ptr<ShapeGraph>> AllLineMap:
       comm->CommPostMessage( Communicator::CURRENT_STEP, 1 );
    }
 
-   pafsrand((unsigned int)time(NULL));
-
    // make one rld for each radial line...
    std::map<RadialKey, std::set<int> > radialdivisions;
    size_t i;
@@ -161,7 +178,7 @@ std::tuple<std::unique_ptr<ShapeGraph>, std::unique_ptr<ShapeGraph>> AllLineMap:
    }
 
    // make divisions -- this is the slow part and the comm updates
-   makeDivisions(m_poly_connections, m_radial_lines, radialdivisions, ax_radial_cuts, comm);
+   makeDivisions(m_poly_connections, m_radial_lines, radialdivisions, ax_radial_cuts, comm, threads);
 
    // the slow part is over, we're into the final straight... reset the current record flag:
    if (comm) {
@@ -186,6 +203,13 @@ std::tuple<std::unique_ptr<ShapeGraph>, std::unique_ptr<ShapeGraph>> AllLineMap:
        }
    }
 
+   // radial segments in order, so that the index of a segment can be found without walking the map
+   std::vector<std::map<RadialKey,RadialSegment>::iterator> segments;
+   segments.reserve(radialsegs.size());
+   for (auto segIter = radialsegs.begin(); segIter != radialsegs.end(); ++segIter) {
+      segments.push_back(segIter);
+   }
+
    // and segment divisors from the axial lines...
    // TODO: (CS) Restructure this to get rid of all those brittle parallel data structure
    auto axIter = ax_radial_cuts.begin();
@@ -200,10 +224,13 @@ std::tuple<std::unique_ptr<ShapeGraph>, std::unique_ptr<ShapeGraph>> AllLineMap:
              RadialKey& rk_end = m_radial_lines[size_t(*axRadCutIter)];
              RadialKey& rk_start = m_radial_lines[size_t(*axRadCutIterPrev)];
              if (rk_start.vertex == rk_end.vertex) {
-                auto radialSegIter = radialsegs.find(rk_end);
-                if (radialSegIter != radialsegs.end() && rk_start == radialSegIter->second.radial_b) {
-                   radialSegIter->second.indices.insert(axIter->first);
-                   axSeg->second.insert(std::distance(radialsegs.begin(), radialSegIter));
+                auto segment = std::lower_bound(segments.begin(), segments.end(), rk_end,
+                                                [](std::map<RadialKey,RadialSegment>::iterator seg,
+                                                   const RadialKey& key) { return seg->first < key; });
+                if (segment != segments.end() && !(rk_end < (*segment)->first) &&
+                      rk_start == (*segment)->second.radial_b) {
+                   (*segment)->second.indices.insert(axIter->first);
+                   axSeg->second.insert(int(std::distance(segments.begin(), segment)));
                 }
              }
              ++axRadCutIter;
@@ -238,7 +265,7 @@ std::tuple<std::unique_ptr<ShapeGraph>, std::unique_ptr<ShapeGraph>> AllLineMap:
    // ok, after this fairly tedious set up, we are ready to go...
    // note axradialcuts aren't required anymore...
 
-   AxialMinimiser minimiser(*this, ax_seg_cuts.size(), radialsegs.size());
+   AxialMinimiser minimiser(*this, ax_seg_cuts.size(), radialsegs.size(), seed);
 
    std::vector<Line> lines_s, lines_m;
 
@@ -256,9 +283,11 @@ std::tuple<std::unique_ptr<ShapeGraph>, std::unique_ptr<ShapeGraph>> AllLineMap:
    minimiser.fewestLongest(ax_seg_cuts, radialsegs, radialdivisions, m_radial_lines, keyvertexconns, keyvertexcounts);
 
    // make new lines here (assumes line map has only lines
-   for (int k = 0; k < int(getAllShapes().size()); k++) {
+   k = -1;
+   for (const auto& shape: m_shapes) {
+      k++;
       if (!minimiser.removed(k)) {
-         lines_m.push_back( depthmapX::getMapAtIndex(getAllShapes(), k)->second.getLine() );
+         lines_m.push_back( shape.second.getLine() );
       }
    }
 
@@ -270,7 +299,7 @@ std::tuple<std::unique_ptr<ShapeGraph>, std::unique_ptr<ShapeGraph>> AllLineMap:
    for (size_t k = 0; k < lines_s.size(); k++) {
       fewestlinemap_subsets->makeLineShape(lines_s[k]);
    }
-   fewestlinemap_subsets->makeConnections();
+   fewestlinemap_subsets->makeConnections(KeyVertices(), threads);
 
 
    std::unique_ptr<ShapeGraph> fewestlinemap_minimal(new ShapeGraph("Fewest-Line Map (Minimal)", ShapeMap::AXIALMAP));
@@ -281,26 +310,46 @@ std::tuple<std::unique_ptr<ShapeGraph>, std::unique_ptr<ShapeGraph>> AllLineMap:
    for (size_t k = 0; k < lines_m.size(); k++) {
       fewestlinemap_minimal->makeLineShape(lines_m[k]);
    }
-   fewestlinemap_minimal->makeConnections();
+   fewestlinemap_minimal->makeConnections(KeyVertices(), threads);
 
    return std::make_tuple(std::move(fewestlinemap_subsets), std::move(fewestlinemap_minimal));
 }
 
 void AllLineMap::makeDivisions(const std::vector<PolyConnector>& polyconnections, const std::vector<RadialLine> &radiallines,
                                std::map<RadialKey,std::set<int> >& radialdivisions, std::map<int, std::set<int> > &axialdividers,
-                               Communicator *comm)
+                               Communicator *comm, int threads)
 {
-   time_t atime = 0;
    if (comm) {
-      qtimer( atime, 0 );
       comm->CommPostMessage( Communicator::NUM_RECORDS, polyconnections.size() );
    }
 
-   for (size_t i = 0; i < polyconnections.size(); i++) {
+   // the axial dividers are looked up by shape key, which only works if the keys are the indices
+   int k = 0;
+   for (const auto& divider: axialdividers) {
+      if (divider.first != k++) {
+         throw 1; // for the code to work later this can't be true!
+      }
+   }
+   // radial divisions in order, so that each connection can find the index of its radial line without walking the map
+   std::vector<std::map<RadialKey,std::set<int> >::iterator> divisions;
+   divisions.reserve(radialdivisions.size());
+   for (auto iter = radialdivisions.begin(); iter != radialdivisions.end(); ++iter) {
+      divisions.push_back(iter);
+   }
+
+   // each connection is tested against the axial lines on its own, and the lines that divide it
+   // are recorded afterwards, in connection order
+   std::vector<size_t> connindices(polyconnections.size());
+   std::vector<std::vector<int> > dividers(polyconnections.size());
+   depthmapX::parallelFor(comm, depthmapX::getThreadCount(threads, polyconnections.size()), polyconnections.size(),
+                          [&](size_t i, size_t) {
       PixelRefVector pixels = pixelateLine(polyconnections[i].line);
       std::vector<size_t> testedshapes;
-      auto connIter = radialdivisions.find(polyconnections[i].key);
-      size_t connindex = std::distance(radialdivisions.begin(), connIter);
+      size_t connindex = std::distance(divisions.begin(),
+                                       std::lower_bound(divisions.begin(), divisions.end(), polyconnections[i].key,
+                                                        [](std::map<RadialKey,std::set<int> >::iterator division,
+                                                           const RadialKey& key) { return division->first < key; }));
+      connindices[i] = connindex;
       double tolerance = sqrt(TOLERANCE_A);// * polyconnections[i].line.length();
       for (size_t j = 0; j < pixels.size(); j++) {
          PixelRef pix = pixels[j];
@@ -319,27 +368,12 @@ void AllLineMap::makeDivisions(const std::vector<PolyConnector>& polyconnections
                case 0:
                   break;
                case 2:
-                  {
-                     size_t index = depthmapX::findIndexFromKey(axialdividers, (int) shape.m_shape_ref);
-                     if (index != shape.m_shape_ref) {
-                        throw 1; // for the code to work later this can't be true!
-                     }
-                     axialdividers[index].insert(connindex);
-                     connIter->second.insert(shape.m_shape_ref);
-                  }
+                  dividers[i].push_back(int(shape.m_shape_ref));
                   break;
                case 1:
-                  {
-                     size_t index = depthmapX::findIndexFromKey(axialdividers, (int) shape.m_shape_ref);
-                     if (index != shape.m_shape_ref) {
-                        throw 1; // for the code to work later this can't be true!
-                     }
-                     //
-                     // this makes sure actually crosses between the line and the openspace properly
-                     if (radiallines[connindex].cuts(line)) {
-                        axialdividers[index].insert(connindex);
-                        connIter->second.insert(shape.m_shape_ref);
-                     }
+                  // this makes sure actually crosses between the line and the openspace properly
+                  if (radiallines[connindex].cuts(line)) {
+                     dividers[i].push_back(int(shape.m_shape_ref));
                   }
                   break;
                default:
@@ -348,13 +382,12 @@ void AllLineMap::makeDivisions(const std::vector<PolyConnector>& polyconnections
             }
          }
       }
-      if (comm) {
-         if (qtimer( atime, 500 )) {
-            if (comm->IsCancelled()) {
-               throw Communicator::CancelledException();
-            }
-            comm->CommPostMessage( Communicator::CURRENT_RECORD, i );
-         }
+   });
+
+   for (size_t i = 0; i < polyconnections.size(); i++) {
+      for (int shaperef: dividers[i]) {
+         axialdividers[shaperef].insert(int(connindices[i]));
+         divisions[connindices[i]]->second.insert(shaperef);
       }
    }
 }
@@ -9,7 +9,8 @@ public:
     AllLineMap(Communicator *comm,
                std::vector<SpacePixelFile> &drawingLayers,
                const Point2f& seed,
-               const std::string& name = "All-Line Map");
+               const std::string& name = "All-Line Map",
+               int threads = 1);
     AllLineMap(const std::string& name = "All-Line Map"):
         ShapeGraph(name, ShapeMap::ALLLINEMAP) {}
     AxialPolygons m_polygons;
@@ -18,9 +19,13 @@ public:
     void setKeyVertexCount(int keyvertexcount) {
         m_keyvertexcount = keyvertexcount;
     }
-    std::tuple<std::unique_ptr<ShapeGraph>, std::unique_ptr<ShapeGraph>> extractFewestLineMaps(Communicator *comm);
+    // lines that rank the same when the minimiser picks the next one to remove are taken in line order, or for
+    // a non-zero seed in an order drawn from it; either way the maps do not depend on the number of threads
+    std::tuple<std::unique_ptr<ShapeGraph>, std::unique_ptr<ShapeGraph>> extractFewestLineMaps(Communicator *comm,
+                                                                                              unsigned int seed = 0,
+                                                                                              int threads = 1);
     void makeDivisions(const std::vector<PolyConnector>& polyconnections, const std::vector<RadialLine> &radiallines,
                        std::map<RadialKey, std::set<int> > &radialdivisions, std::map<int, std::set<int> > &axialdividers,
-                       Communicator *comm);
+                       Communicator *comm, int threads = 1);
 
 };
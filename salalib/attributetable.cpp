@@ -18,9 +18,128 @@
 #include "displayparams.h"
 #include <genlib/stringutils.h>
 #include <genlib/readwritehelpers.h>
+#include <genlib/parallelutils.h>
 
 #include <sstream>
 #include <numeric>
+#include <limits>
+#include <mutex>
+
+namespace
+{
+    // With several threads columns are sorted in runs of at least this many rows, one run for each
+    // thread, which are then merged pairwise
+    const size_t SORT_RUN_SIZE = 1 << 16;
+
+    // where a row taken out by AttributeTable::removeRows goes
+    const size_t REMOVED_ROW = size_t(-1);
+
+    std::atomic<size_t> lastVersion(0);
+
+    struct ValueSummary
+    {
+        float min = std::numeric_limits<float>::infinity();
+        float max = -1.0f;
+        double total = 0.0;
+        size_t count = 0;
+    };
+
+    // negative values are the "no value" of a cell, and are left out of the stats
+    ValueSummary summariseValues(const float *begin, const float *end)
+    {
+        ValueSummary summary;
+        for (const float *value = begin; value != end; ++value)
+        {
+            bool valid = *value >= 0.0f;
+            summary.min = (valid && *value < summary.min) ? *value : summary.min;
+            summary.max = (valid && *value > summary.max) ? *value : summary.max;
+            summary.total += valid ? *value : 0.0f;
+            summary.count += valid ? 1 : 0;
+        }
+        return summary;
+    }
+
+    // rows by value, and rows with the same value by position, so that there is only one right order
+    struct ValueOrder
+    {
+        const std::vector<float> &values;
+        bool operator()(size_t a, size_t b) const
+        {
+            return values[a] < values[b] || (values[a] == values[b] && a < b);
+        }
+    };
+
+    void sortByValue(std::vector<size_t> &order, const std::vector<float> &values, int threadCount)
+    {
+        order.resize(values.size());
+        std::iota(order.begin(), order.end(), size_t(0));
+        ValueOrder before{values};
+        size_t threads = depthmapX::getThreadCount(threadCount, std::max(values.size() / SORT_RUN_SIZE, size_t(1)));
+        size_t runs = threads;
+        auto runStart = [&](size_t run) { return order.begin() + (run * order.size()) / runs; };
+        depthmapX::parallelFor(nullptr, threads, runs, [&](size_t run, size_t) {
+            std::sort(runStart(run), runStart(run + 1), before);
+        });
+        for (size_t width = 1; width < runs; width *= 2)
+        {
+            size_t pairs = (runs + 2 * width - 1) / (2 * width);
+            depthmapX::parallelFor(nullptr, depthmapX::getThreadCount(int(threads), pairs), pairs, [&](size_t pair, size_t) {
+                size_t first = pair * 2 * width;
+                size_t middle = std::min(first + width, runs);
+                size_t last = std::min(first + 2 * width, runs);
+                std::inplace_merge(runStart(first), runStart(middle), runStart(last), before);
+            });
+        }
+    }
+}
+
+size_t AttributeColumnImpl::newVersion()
+{
+    return ++lastVersion;
+}
+
+AttributeColumnImpl::AttributeColumnImpl(const AttributeColumnImpl &other)
+    : AttributeColumnStats(other), m_stats(other.m_stats), m_name(other.m_name), m_locked(other.m_locked),
+      m_hidden(other.m_hidden), m_formula(other.m_formula), m_displayParams(other.m_displayParams),
+      m_values(other.m_values), m_modified(other.m_modified.load()), m_version(other.m_version.load()),
+      m_statsVersion(other.m_statsVersion.load()), m_orderVersion(other.m_orderVersion.load()),
+      m_order(other.m_order)
+{
+}
+
+AttributeColumnImpl::AttributeColumnImpl(AttributeColumnImpl &&other)
+    : AttributeColumnStats(other), m_stats(other.m_stats), m_name(std::move(other.m_name)),
+      m_locked(other.m_locked), m_hidden(other.m_hidden), m_formula(std::move(other.m_formula)),
+      m_displayParams(other.m_displayParams), m_values(std::move(other.m_values)),
+      m_modified(other.m_modified.load()), m_version(other.m_version.load()),
+      m_statsVersion(other.m_statsVersion.load()), m_orderVersion(other.m_orderVersion.load()),
+      m_order(std::move(other.m_order))
+{
+}
+
+AttributeColumnImpl &AttributeColumnImpl::operator=(const AttributeColumnImpl &other)
+{
+    AttributeColumnImpl copy(other);
+    return *this = std::move(copy);
+}
+
+AttributeColumnImpl &AttributeColumnImpl::operator=(AttributeColumnImpl &&other)
+{
+    AttributeColumnStats::operator=(other);
+    m_stats = other.m_stats;
+    m_name = std::move(other.m_name);
+    m_locked = other.m_locked;
+    m_hidden = other.m_hidden;
+    m_formula = std::move(other.m_formula);
+    m_displayParams = other.m_displayParams;
+    m_values = std::move(other.m_values);
+    m_modified.store(other.m_modified.load());
+    m_version.store(other.m_version.load());
+    m_statsVersion.store(other.m_statsVersion.load());
+    m_orderVersion.store(other.m_orderVersion.load());
+    m_order = std::move(other.m_order);
+    return *this;
+}
 
 const std::string &AttributeColumnImpl::getName() const
 {
@@ -57,11 +176,201 @@ const std::string &AttributeColumnImpl::getFormula() const
     return m_formula;
 }
 
+size_t AttributeColumnImpl::getVersion() const
+{
+    if (!m_modified.load(std::memory_order_acquire))
+    {
+        return m_version.load(std::memory_order_acquire);
+    }
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
+    return updateVersion();
+}
+
+size_t AttributeColumnImpl::updateVersion() const
+{
+    if (m_modified.load(std::memory_order_acquire))
+    {
+        // the new version has to be in place before the column stops looking modified, or a reader
+        // could take what was worked out for the old version as up to date
+        m_version.store(newVersion(), std::memory_order_release);
+        m_modified.store(false, std::memory_order_release);
+    }
+    return m_version.load(std::memory_order_acquire);
+}
+
 const AttributeColumnStats &AttributeColumnImpl::getStats() const
 {
+    if (m_modified.load(std::memory_order_acquire) ||
+        m_statsVersion.load(std::memory_order_acquire) != m_version.load(std::memory_order_acquire))
+    {
+        refreshStats();
+    }
     return m_stats;
 }
 
+void AttributeColumnImpl::refreshStats() const
+{
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
+    size_t version = updateVersion();
+    if (m_statsVersion.load(std::memory_order_relaxed) == version)
+    {
+        // another thread got here first
+        return;
+    }
+    // one pass over the values is quick enough even for big tables that it is not worth threads
+    ValueSummary column = summariseValues(m_values.data(), m_values.data() + m_values.size());
+    if (column.count == 0)
+    {
+        m_stats.min = m_stats.max = m_stats.total = -1.0;
+    }
+    else
+    {
+        m_stats.min = column.min;
+        m_stats.max = column.max;
+        m_stats.total = column.total;
+    }
+    m_statsVersion.store(version, std::memory_order_release);
+}
+
+const std::vector<size_t> &AttributeColumnImpl::getOrder(int threadCount) const
+{
+    if (m_modified.load(std::memory_order_acquire) ||
+        m_orderVersion.load(std::memory_order_acquire) != m_version.load(std::memory_order_acquire))
+    {
+        std::lock_guard<std::mutex> lock(m_cacheMutex);
+        size_t version = updateVersion();
+        if (m_orderVersion.load(std::memory_order_relaxed) != version)
+        {
+            sortByValue(m_order, m_values, threadCount);
+            m_orderVersion.store(version, std::memory_order_release);
+        }
+    }
+    return m_order;
+}
+
+// Rows come and go on one thread, like any other change to the rows of a table, so these need no lock
+
+void AttributeColumnImpl::insertRow(size_t position)
+{
+    m_values.insert(m_values.begin() + position, -1.0f);
+    size_t version = m_version.load(std::memory_order_relaxed);
+    if (m_modified.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+    if (position + 1 == m_values.size())
+    {
+        // rows are mostly added at the end, many at a time, so rather than patching the order row by
+        // row it is sorted again the next time it is asked for; a row without a value leaves the stats
+        // as they are
+        bool statsCurrent = m_statsVersion.load(std::memory_order_relaxed) == version;
+        version = newVersion();
+        m_version.store(version);
+        if (statsCurrent)
+        {
+            m_statsVersion.store(version);
+        }
+        return;
+    }
+    if (m_orderVersion.load(std::memory_order_relaxed) != version)
+    {
+        markModified();
+        return;
+    }
+    for (auto &orderPosition : m_order)
+    {
+        if (orderPosition >= position)
+        {
+            orderPosition++;
+        }
+    }
+    m_order.insert(std::lower_bound(m_order.begin(), m_order.end(), position, ValueOrder{m_values}), position);
+    // a row without a value leaves the stats as they are
+    bool statsCurrent = m_statsVersion.load(std::memory_order_relaxed) == version;
+    version = newVersion();
+    m_version.store(version);
+    m_orderVersion.store(version);
+    if (statsCurrent)
+    {
+        m_statsVersion.store(version);
+    }
+}
+
+void AttributeColumnImpl::removeRow(size_t position)
+{
+    size_t version = m_version.load(std::memory_order_relaxed);
+    if (m_modified.load(std::memory_order_relaxed) || m_orderVersion.load(std::memory_order_relaxed) != version)
+    {
+        m_values.erase(m_values.begin() + position);
+        markModified();
+        return;
+    }
+    m_order.erase(std::lower_bound(m_order.begin(), m_order.end(), position, ValueOrder{m_values}));
+    bool statsCurrent = m_values[position] < 0.0f && m_statsVersion.load(std::memory_order_relaxed) == version;
+    m_values.erase(m_values.begin() + position);
+    if (position < m_values.size())
+    {
+        for (auto &orderPosition : m_order)
+        {
+            if (orderPosition > position)
+            {
+                orderPosition--;
+            }
+        }
+    }
+    version = newVersion();
+    m_version.store(version);
+    m_orderVersion.store(version);
+    if (statsCurrent)
+    {
+        m_statsVersion.store(version);
+    }
+}
+
+void AttributeColumnImpl::removeRows(const std::vector<size_t> &newPositions)
+{
+    size_t version = m_version.load(std::memory_order_relaxed);
+    bool orderCurrent = !m_modified.load(std::memory_order_relaxed) &&
+                        m_orderVersion.load(std::memory_order_relaxed) == version;
+    // rows without a value leave the stats as they are
+    bool statsCurrent = !m_modified.load(std::memory_order_relaxed) &&
+                        m_statsVersion.load(std::memory_order_relaxed) == version;
+    for (size_t position = 0; position < m_values.size(); position++)
+    {
+        if (newPositions[position] == REMOVED_ROW)
+        {
+            statsCurrent = statsCurrent && m_values[position] < 0.0f;
+        }
+        else
+        {
+            m_values[newPositions[position]] = m_values[position];
+        }
+    }
+    m_values.resize(m_values.size() - std::count(newPositions.begin(), newPositions.end(), REMOVED_ROW));
+    if (!orderCurrent)
+    {
+        markModified();
+        return;
+    }
+    // the rows left keep their order among themselves, so the order only needs the removed rows taken out
+    auto orderEnd = m_order.begin();
+    for (size_t orderPosition : m_order)
+    {
+        if (newPositions[orderPosition] != REMOVED_ROW)
+        {
+            *orderEnd++ = newPositions[orderPosition];
+        }
+    }
+    m_order.erase(orderEnd, m_order.end());
+    version = newVersion();
+    m_version.store(version);
+    m_orderVersion.store(version);
+    if (statsCurrent)
+    {
+        m_statsVersion.store(version);
+    }
+}
+
 void AttributeColumnImpl::updateStats(float val, float oldVal) const
 {
     if (m_stats.total < 0)
@@ -110,11 +419,12 @@ size_t AttributeColumnImpl::read(std::istream &stream)
 void AttributeColumnImpl::write(std::ostream &stream, int physicalCol)
 {
     dXstring::writeString(stream, m_name);
-    float min = (float)m_stats.min;
-    float max = (float)m_stats.max;
+    const AttributeColumnStats& stats = getStats();
+    float min = (float)stats.min;
+    float max = (float)stats.max;
     stream.write((char *)&min, sizeof(float));
     stream.write((char *)&max, sizeof(float));
-    stream.write((char *)&m_stats.total, sizeof(m_stats.total));
+    stream.write((char *)&stats.total, sizeof(stats.total));
     stream.write((char *)&physicalCol, sizeof(int));
     stream.write((char *)&m_hidden, sizeof(bool));
     stream.write((char *)&m_locked, sizeof(bool));
@@ -230,6 +540,95 @@ AttributeRow &AttributeRowImpl::incrValue(const std::string &colName, float valu
     return incrValue(m_colManager.getColumnIndex(colName), value);
 }
 
+// AttributeTableRow implementation
+float AttributeTableRow::getValue(const std::string &column) const
+{
+    return getValue(m_table->getColumnIndex(column));
+}
+
+float AttributeTableRow::getNormalisedValue(size_t index) const
+{
+    float value = getValue(index);
+    auto& colStats = m_table->getColumn(index).getStats();
+    if (colStats.max == colStats.min)
+    {
+        return 0.5f;
+    }
+    return  value < 0 ? -1.0f : float((value - colStats.min)/(colStats.max - colStats.min));
+}
+
+AttributeRow& AttributeTableRow::setValue(const std::string &column, float value)
+{
+    return setValue(m_table->getColumnIndex(column), value);
+}
+
+AttributeRow& AttributeTableRow::setValue(size_t index, float value)
+{
+    checkIndex(index);
+    AttributeColumnImpl& column = m_table->m_columns[index];
+    column.m_values[m_position] = value;
+    column.markModified();
+    return *this;
+}
+
+AttributeRow& AttributeTableRow::incrValue(const std::string &column, float value)
+{
+    return incrValue(m_table->getColumnIndex(column), value);
+}
+
+AttributeRow& AttributeTableRow::incrValue(size_t index, float value)
+{
+    float val = getValue(index);
+    if ( val < 0)
+    {
+        setValue(index, value);
+    }
+    else
+    {
+        setValue(index, val + value);
+    }
+    return *this;
+}
+
+AttributeRow& AttributeTableRow::setSelection(bool selected)
+{
+    m_selected = selected;
+    return *this;
+}
+
+bool AttributeTableRow::isSelected() const
+{
+    return m_selected;
+}
+
+AttributeTable::AttributeTable(AttributeTable &&other)
+    : m_keys(std::move(other.m_keys)), m_rows(std::move(other.m_rows)), m_rowStore(std::move(other.m_rowStore)),
+      m_freeRows(std::move(other.m_freeRows)), m_columnMapping(std::move(other.m_columnMapping)), m_columns(std::move(other.m_columns)),
+      m_keyColumn(std::move(other.m_keyColumn)), m_displayParams(std::move(other.m_displayParams))
+{
+    for (auto& row : m_rowStore)
+    {
+        row.m_table = this;
+    }
+}
+
+AttributeTable& AttributeTable::operator =(AttributeTable &&other)
+{
+    m_keys = std::move(other.m_keys);
+    m_rows = std::move(other.m_rows);
+    m_rowStore = std::move(other.m_rowStore);
+    m_freeRows = std::move(other.m_freeRows);
+    m_columnMapping = std::move(other.m_columnMapping);
+    m_columns = std::move(other.m_columns);
+    m_keyColumn = std::move(other.m_keyColumn);
+    m_displayParams = std::move(other.m_displayParams);
+    for (auto& row : m_rowStore)
+    {
+        row.m_table = this;
+    }
+    return *this;
+}
+
 AttributeRow &AttributeTable::getRow(const AttributeKey &key)
 {
     auto* row = getRowPtr(key);
@@ -252,43 +651,119 @@ const AttributeRow& AttributeTable::getRow(const AttributeKey &key) const
 
 AttributeRow *AttributeTable::getRowPtr(const AttributeKey &key)
 {
-    auto iter = m_rows.find(key);
-    if (iter == m_rows.end())
+    size_t position = findPosition(key);
+    if (!hasRowAt(position, key))
     {
         return 0;
     }
-    return iter->second.get();
+    return m_rows[position];
 }
 
 const AttributeRow *AttributeTable::getRowPtr(const AttributeKey &key) const
 {
-    auto iter = m_rows.find(key);
-    if (iter == m_rows.end())
+    size_t position = findPosition(key);
+    if (!hasRowAt(position, key))
     {
         return 0;
     }
-    return iter->second.get();
+    return m_rows[position];
+}
+
+size_t AttributeTable::findPosition(const AttributeKey &key) const
+{
+    // rows are mostly added in key order, so check the end first
+    if (m_keys.empty() || m_keys.back() < key)
+    {
+        return m_keys.size();
+    }
+    return size_t(std::distance(m_keys.begin(), std::lower_bound(m_keys.begin(), m_keys.end(), key)));
 }
 
 AttributeRow &AttributeTable::addRow(const AttributeKey &key)
 {
-    auto iter = m_rows.find(key);
-    if (iter != m_rows.end())
+    size_t position = findPosition(key);
+    if (hasRowAt(position, key))
     {
         throw new std::invalid_argument("Duplicate key");
     }
-    auto res = m_rows.insert(std::make_pair(key, std::unique_ptr<AttributeRowImpl>(new AttributeRowImpl(*this))));
-    return *res.first->second;
+    AttributeTableRow* row;
+    if (m_freeRows.empty())
+    {
+        m_rowStore.emplace_back(*this, position);
+        row = &m_rowStore.back();
+    }
+    else
+    {
+        row = m_freeRows.back();
+        m_freeRows.pop_back();
+        *row = AttributeTableRow(*this, position);
+    }
+    m_keys.insert(m_keys.begin() + position, key);
+    m_rows.insert(m_rows.begin() + position, row);
+    for (auto& column : m_columns)
+    {
+        column.insertRow(position);
+    }
+    for (size_t i = position + 1; i < m_rows.size(); i++)
+    {
+        m_rows[i]->m_position = i;
+    }
+    return *row;
 }
 
 void AttributeTable::removeRow(const AttributeKey &key)
 {
-    auto iter = m_rows.find(key);
-    if (iter == m_rows.end())
+    size_t position = findPosition(key);
+    if (!hasRowAt(position, key))
     {
         throw new std::invalid_argument("Row does not exist");
     }
-    m_rows.erase(iter);
+    m_freeRows.push_back(m_rows[position]);
+    m_keys.erase(m_keys.begin() + position);
+    m_rows.erase(m_rows.begin() + position);
+    for (auto& column : m_columns)
+    {
+        column.removeRow(position);
+    }
+    for (size_t i = position; i < m_rows.size(); i++)
+    {
+        m_rows[i]->m_position = i;
+    }
+}
+
+void AttributeTable::removeRows(const std::vector<AttributeKey> &keys)
+{
+    // the new position of each row, worked out once for the keys and the values of all the columns
+    std::vector<size_t> newPositions(m_rows.size(), 0);
+    for (auto &key : keys)
+    {
+        size_t position = findPosition(key);
+        if (!hasRowAt(position, key))
+        {
+            throw new std::invalid_argument("Row does not exist");
+        }
+        newPositions[position] = REMOVED_ROW;
+    }
+    size_t rowCount = 0;
+    for (size_t position = 0; position < m_rows.size(); position++)
+    {
+        if (newPositions[position] == REMOVED_ROW)
+        {
+            m_freeRows.push_back(m_rows[position]);
+            continue;
+        }
+        newPositions[position] = rowCount;
+        m_keys[rowCount] = m_keys[position];
+        m_rows[rowCount] = m_rows[position];
+        m_rows[rowCount]->m_position = rowCount;
+        rowCount++;
+    }
+    m_keys.erase(m_keys.begin() + rowCount, m_keys.end());
+    m_rows.erase(m_rows.begin() + rowCount, m_rows.end());
+    for (auto &column : m_columns)
+    {
+        column.removeRows(newPositions);
+    }
 }
 
 AttributeColumn &AttributeTable::getColumn(size_t index)
@@ -309,12 +784,10 @@ size_t AttributeTable::insertOrResetColumn(const std::string &columnName, const
     }
 
     // it exists - we need to reset it
-    m_columns[iter->second].m_stats = AttributeColumnStats();
-    m_columns[iter->second].setLock(false);
-    for (auto& row : m_rows)
-    {
-        row.second->setValue(iter->second, -1.0f);
-    }
+    AttributeColumnImpl& column = m_columns[iter->second];
+    column.setLock(false);
+    std::fill(column.m_values.begin(), column.m_values.end(), -1.0f);
+    column.markModified();
     return iter->second;
 }
 
@@ -356,10 +829,6 @@ void AttributeTable::removeColumn(size_t colIndex)
         }
     }
     m_columns.erase(m_columns.begin()+colIndex);
-    for (auto& row : m_rows)
-    {
-        row.second->removeColumn(colIndex);
-    }
 }
 
 void AttributeTable::renameColumn(const std::string &oldName, const std::string &newName)
@@ -379,9 +848,9 @@ void AttributeTable::renameColumn(const std::string &oldName, const std::string
 
 void AttributeTable::deselectAllRows()
 {
-    for (auto& row : m_rows)
+    for (auto* row : m_rows)
     {
-        row.second->setSelection(false);
+        row->setSelection(false);
     }
 }
 
@@ -413,11 +882,28 @@ void AttributeTable::read(std::istream &stream, LayerManager &layerManager)
 
     int rowcount, rowkey;
     stream.read((char *)&rowcount, sizeof(rowcount));
+    for (auto& column : m_columns)
+    {
+        column.m_values.reserve(size_t(rowcount));
+    }
+    std::vector<float> values;
     for (int i = 0; i < rowcount; i++) {
         stream.read((char *)&rowkey, sizeof(rowkey));
-        auto row = std::unique_ptr<AttributeRowImpl>(new AttributeRowImpl(*this));
-        row->read(stream);
-        m_rows.insert(std::make_pair(AttributeKey(rowkey),std::move(row)));
+        LayerManager::KeyType layerKey;
+        stream.read((char *)&layerKey, sizeof(layerKey));
+        dXreadwrite::readIntoVector(stream, values);
+        AttributeRow& row = addRow(AttributeKey(rowkey));
+        row.setLayerKey(layerKey);
+        size_t position = static_cast<AttributeTableRow&>(row).m_position;
+        for (size_t j = 0; j < m_columns.size() && j < values.size(); j++)
+        {
+            m_columns[j].m_values[position] = values[j];
+        }
+    }
+    // the stats stored with the columns are only as good as the version that wrote them
+    for (auto& column : m_columns)
+    {
+        column.markModified();
     }
 
     // ref column display params
@@ -447,16 +933,25 @@ void AttributeTable::write(std::ostream &stream, const LayerManager &layerManage
 
     int rowcount = (int)m_rows.size();
     stream.write((char *)&rowcount, sizeof(int));
-    for ( auto &kvp : m_rows)
+    std::vector<float> values(m_columns.size());
+    for (size_t i = 0; i < m_rows.size(); i++)
     {
-        kvp.first.write(stream);
-        kvp.second->write(stream);
+        m_keys[i].write(stream);
+        stream.write((char *)&m_rows[i]->getLayerKey(), sizeof(LayerManager::KeyType));
+        for (size_t j = 0; j < m_columns.size(); j++)
+        {
+            values[j] = m_columns[j].m_values[i];
+        }
+        dXreadwrite::writeVector(stream, values);
     }
     stream.write((const char *)&m_displayParams, sizeof(DisplayParams));
 }
 
 void AttributeTable::clear() {
+    m_keys.clear();
     m_rows.clear();
+    m_rowStore.clear();
+    m_freeRows.clear();
     m_columns.clear();
     m_columnMapping.clear();
 }
@@ -485,6 +980,56 @@ size_t AttributeTable::getColumnSortedIndex(size_t index) const
 }
 
 
+const std::vector<float> &AttributeTable::getColumnValues(size_t index) const
+{
+    checkColumnIndex(index);
+    return m_columns[index].m_values;
+}
+
+void AttributeTable::setColumnValues(size_t index, std::vector<float> values)
+{
+    checkColumnIndex(index);
+    if (values.size() != m_rows.size())
+    {
+        throw std::invalid_argument("Column values do not match the rows of the table");
+    }
+    m_columns[index].m_values = std::move(values);
+    m_columns[index].markModified();
+}
+
+const std::vector<size_t> &AttributeTable::getColumnOrder(size_t index, int threadCount) const
+{
+    checkColumnIndex(index);
+    return m_columns[index].getOrder(threadCount);
+}
+
+size_t AttributeTable::getColumnVersion(size_t index) const
+{
+    checkColumnIndex(index);
+    return m_columns[index].getVersion();
+}
+
+std::pair<size_t, size_t> AttributeTable::findValueRange(size_t index, float fromValue, float toValue) const
+{
+    const std::vector<size_t> &order = getColumnOrder(index);
+    const std::vector<float> &values = m_columns[index].m_values;
+    auto first = std::lower_bound(order.begin(), order.end(), fromValue,
+                                  [&values](size_t position, float value) { return values[position] < value; });
+    auto last = std::upper_bound(first, order.end(), toValue,
+                                 [&values](float value, size_t position) { return value < values[position]; });
+    return std::make_pair(size_t(first - order.begin()), size_t(last - order.begin()));
+}
+
+size_t AttributeTable::getRowPosition(const AttributeKey &key) const
+{
+    size_t position = findPosition(key);
+    if (!hasRowAt(position, key))
+    {
+        throw std::out_of_range("Invalid row key");
+    }
+    return position;
+}
+
 const AttributeColumn &AttributeTable::getColumn(size_t index) const
 {
     if(index == size_t(-1)) {
@@ -523,9 +1068,6 @@ size_t AttributeTable::addColumnInternal(const std::string &name, const std::str
     size_t colIndex = m_columns.size();
     m_columns.push_back(AttributeColumnImpl(name, formula));
     m_columnMapping[name] = colIndex;
-    for (auto& elem : m_rows)
-    {
-        elem.second->addColumn();
-    }
+    m_columns.back().m_values.assign(m_rows.size(), -1.0f);
     return colIndex;
 }
@@ -18,6 +18,9 @@
 #include "layermanager.h"
 #include <string>
 #include <map>
+#include <atomic>
+#include <mutex>
+#include <deque>
 #include <vector>
 #include <memory>
 #include <sstream>
@@ -130,6 +133,10 @@ public:
 
     AttributeColumnImpl() : m_locked(false), m_hidden(false)
     {}
+    AttributeColumnImpl(const AttributeColumnImpl &other);
+    AttributeColumnImpl(AttributeColumnImpl &&other);
+    AttributeColumnImpl &operator=(const AttributeColumnImpl &other);
+    AttributeColumnImpl &operator=(AttributeColumnImpl &&other);
     virtual const std::string &getName() const;
     virtual bool isLocked() const;
     virtual void setLock(bool lock);
@@ -153,12 +160,55 @@ public:
     size_t read(std::istream &stream);
     void write(std::ostream& stream, int physicalCol);
 
+    // What is worked out from the values of a column that belongs to a table - its stats and the order of its
+    // values - is not kept up to date value by value: writes only mark the column as modified. The next time
+    // anything is asked of the column a modification moves it on to a new version, and what was worked out
+    // for an older version is worked out again. Marking is safe from several threads at once, as is asking,
+    // as long as nothing writes to the column at the same time
+    void markModified()
+    {
+        if (!m_modified.load(std::memory_order_relaxed))
+        {
+            m_modified.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    // changes whenever the values do; a version is never used again for other values
+    size_t getVersion() const;
+
 private:
+    friend class AttributeTable;
+    friend class AttributeTableRow;
+
     std::string m_name;
     bool m_locked;
     bool m_hidden;
     std::string m_formula;
     DisplayParams m_displayParams;
+    // the values of the column in row order, when it belongs to an AttributeTable
+    std::vector<float> m_values;
+    mutable std::atomic<bool> m_modified{false};
+    mutable std::atomic<size_t> m_version{newVersion()};
+    mutable std::atomic<size_t> m_statsVersion{m_version.load()};
+    // the row positions sorted by value, rows with the same value in row order; 0 is never a version
+    mutable std::atomic<size_t> m_orderVersion{0};
+    mutable std::vector<size_t> m_order;
+    // held while the stats or the order are worked out, each column has its own so that neither columns nor
+    // tables wait on each other
+    mutable std::mutex m_cacheMutex;
+
+    static size_t newVersion();
+    // moves on to a new version if the column has been modified, with the cache lock held
+    size_t updateVersion() const;
+    void refreshStats() const;
+    const std::vector<size_t>& getOrder(int threadCount) const;
+    // add and remove the value of a row, patching an up to date order for a row in the middle of the table
+    // rather than sorting again later; a row added at the end is left to be sorted in when next asked for
+    void insertRow(size_t position);
+    void removeRow(size_t position);
+    // takes out the rows that newPositions marks as removed and moves the others to their new positions in
+    // one pass, keeping an up to date order
+    void removeRows(const std::vector<size_t> &newPositions);
 };
 
 // Implementation of AttributeColumn that actually links to the keys of the table
@@ -170,7 +220,7 @@ public:
 };
 
 
-// Implementation of AttributeRow
+// Implementation of AttributeRow that holds its own values, for rows outside of a table
 class AttributeRowImpl : public AttributeRow
 {
 public:
@@ -234,17 +284,66 @@ struct AttributeKey
     }
 };
 
+///
+/// \brief A column of an AttributeTable, looked up once
+/// Looking a column up by name costs a map lookup each time, so analyses look their columns up before they start
+/// and hold on to the handles. A handle is only good as long as no column before it is removed from the table.
+///
+struct ColumnHandle
+{
+    explicit ColumnHandle(size_t idx) : index(idx)
+    {}
+    size_t index;
+};
+
+class AttributeTable;
+
+///
+/// \brief A row of an AttributeTable
+/// The values of the table are held column by column, so a row is just its position in the column arrays, which
+/// the table keeps up to date as rows come and go, and the flags of the row
+///
+class AttributeTableRow : public AttributeRow
+{
+public:
+    AttributeTableRow(AttributeTable &table, size_t position) : m_table(&table), m_position(position), m_selected(false)
+    {
+        m_layerKey = 1;
+    }
+
+    // AttributeRow interface
+public:
+    virtual float getValue(const std::string &column) const;
+    virtual float getValue(size_t index) const;
+    virtual float getNormalisedValue(size_t index) const;
+    virtual AttributeRow& setValue(const std::string &column, float value);
+    virtual AttributeRow& setValue(size_t index, float value);
+    virtual AttributeRow& incrValue(const std::string &column, float value);
+    virtual AttributeRow& incrValue(size_t index, float value);
+    virtual AttributeRow& setSelection(bool selected);
+    virtual bool isSelected() const;
+
+private:
+    friend class AttributeTable;
+    AttributeTable *m_table;
+    size_t m_position;
+    bool m_selected;
+
+    void checkIndex(size_t index) const;
+};
+
 ///
 /// AttributeTable
 ///
 class AttributeTable : public AttributeColumnManager
 {
+    friend class AttributeTableRow;
     // AttributeTable "interface" - the actual table handling
 public:
     AttributeTable(){}
     virtual ~AttributeTable(){}
-    AttributeTable(AttributeTable&&) = default;
-    AttributeTable& operator =(AttributeTable&&) = default;
+    AttributeTable(AttributeTable&& other);
+    AttributeTable& operator =(AttributeTable&& other);
     AttributeTable(const AttributeTable& ) = delete;
     AttributeTable& operator =(const AttributeTable&) = delete;
 
@@ -282,9 +381,12 @@ public:
     size_t getOrInsertColumn(const std::string& columnName, const std::string &formula = std::string());
     size_t getOrInsertLockedColumn(const std::string& columnName, const std::string &formula = std::string());
     void removeRow(const AttributeKey& key);
+    // removes all the rows with these keys together, moving each row left at most once rather than once for
+    // every row removed before it
+    void removeRows(const std::vector<AttributeKey>& keys);
     void removeColumn(size_t colIndex);
     void renameColumn(const std::string& oldName, const std::string& newName);
-    size_t getNumRows() const { return m_rows.size(); }
+    size_t getNumRows() const { return m_keys.size(); }
     void deselectAllRows();
     const DisplayParams& getDisplayParams() const { return m_displayParams; }
     void setDisplayParams(const DisplayParams& params){m_displayParams = params;}
@@ -295,9 +397,9 @@ public:
     float getSelAvg(size_t columnIndex) {
         float selTotal = 0;
         int selNum = 0;
-        for(auto& pair: m_rows) {
-            if(pair.second->isSelected()) {
-                selTotal += pair.second->getValue(columnIndex);
+        for(auto* row: m_rows) {
+            if(row->isSelected()) {
+                selTotal += row->getValue(columnIndex);
                 selNum++;
             }
         }
@@ -310,6 +412,7 @@ public:
 // interface AttributeColumnManager
 public:
     virtual size_t getColumnIndex(const std::string& name) const;
+    ColumnHandle getColumnHandle(const std::string& name) const { return ColumnHandle(getColumnIndex(name)); }
     virtual const AttributeColumn& getColumn(size_t index) const;
     virtual const std::string& getColumnName(size_t index) const;
     virtual size_t getNumColumns() const;
@@ -319,9 +422,36 @@ public:
     // if the set of columns was sorted
     size_t getColumnSortedIndex(size_t index) const;
 
+    // Bulk access for analyses that write whole columns: the values of a column in row order (the order of
+    // iteration over the table), and the position of a row in that order. Setting the values of a column
+    // replaces all of them at once and leaves the stats to be worked out when they are next needed.
+    const std::vector<float>& getColumnValues(size_t index) const;
+    void setColumnValues(size_t index, std::vector<float> values);
+    size_t getRowPosition(const AttributeKey& key) const;
+    const AttributeKey& getRowKey(size_t position) const { return m_keys[position]; }
+    const AttributeRow& getRowAt(size_t position) const { return *m_rows[position]; }
+    AttributeRow& getRowAt(size_t position) { return *m_rows[position]; }
+
+    // The row positions of a table sorted by the values of a column, rows with the same value in row order.
+    // The order is kept with the column and only sorted again once the column has changed; the version of the
+    // column tells whether anything worked out from the order is still good. Sorting the order again can
+    // be shared between threadCount threads (0 for as many as the machine has)
+    const std::vector<size_t>& getColumnOrder(size_t index, int threadCount = 1) const;
+    size_t getColumnVersion(size_t index) const;
+    // the part [first, second) of getColumnOrder(index) that holds the values from fromValue to toValue
+    std::pair<size_t, size_t> findValueRange(size_t index, float fromValue, float toValue) const;
+
 private:
-    typedef std::map<AttributeKey, std::unique_ptr<AttributeRowImpl>> StorageType;
+    // The rows are kept in key order, and everything about them is indexed by their position in that order: the
+    // keys, the row objects and the array of values each column holds. Adding or removing a column only touches
+    // its own array, and reading a column down the table is a sweep through one array. Adding a row after the last
+    // one appends to the arrays; anywhere else the rows after it move along. The row objects themselves never
+    // move, so references to rows stay valid while other rows are added and removed.
+    typedef std::vector<AttributeTableRow *> StorageType;
+    std::vector<AttributeKey> m_keys;
     StorageType m_rows;
+    std::deque<AttributeTableRow> m_rowStore;
+    std::vector<AttributeTableRow *> m_freeRows;
     std::map<std::string, size_t> m_columnMapping;
     std::vector<AttributeColumnImpl> m_columns;
     KeyColumn m_keyColumn;
@@ -330,10 +460,16 @@ private:
 private:
     void checkColumnIndex(size_t index) const;
     size_t addColumnInternal(const std::string &name, const std::string &formula);
+    // position of the row with this key, or of the first row after it
+    size_t findPosition(const AttributeKey& key) const;
+    bool hasRowAt(size_t position, const AttributeKey& key) const
+    {
+        return position < m_keys.size() && !(key < m_keys[position]);
+    }
 
 // warning - here be dragons!
 // This is the implementation of stl style iterators on attribute table, allowing efficient
-// iteration of rows without resorting to log(n) access via the map
+// iteration of rows without resorting to log(n) access via the keys
 
 
 public:
@@ -355,31 +491,32 @@ private:
     class iterator_item_impl : public iterator_item
     {
     public:
-        iterator_item_impl( const iterator_type & iter) : m_iter(iter)
+        iterator_item_impl( const iterator_type & iter, const std::vector<AttributeKey> &keys) : m_iter(iter), m_keys(&keys)
         {}
-        template<typename other_type> iterator_item_impl(const iterator_item_impl<other_type>& other) : m_iter(other.m_iter)
+        template<typename other_type> iterator_item_impl(const iterator_item_impl<other_type>& other) : m_iter(other.m_iter), m_keys(other.m_keys)
         {}
 
         template<typename other_type> iterator_item_impl<iterator_type>& operator = (const iterator_item_impl<other_type>& other)
         {
             m_iter = other.m_iter;
+            m_keys = other.m_keys;
             return *this;
         }
 
 
         const AttributeKey& getKey() const
         {
-            return m_iter->first;
+            return (*m_keys)[(*m_iter)->m_position];
         }
 
         const AttributeRow& getRow() const
         {
-            return *m_iter->second;
+            return **m_iter;
         }
 
        AttributeRow& getRow()
        {
-           return *m_iter->second;
+           return **m_iter;
        }
 
         void forward() const
@@ -398,6 +535,7 @@ private:
         }
     public:
         mutable iterator_type m_iter;
+        const std::vector<AttributeKey> *m_keys;
     };
 
 
@@ -407,7 +545,7 @@ private:
     {
         template<typename other_type> friend class const_iterator_impl;
     public:
-        const_iterator_impl( const iterator_type& iter) : m_item(iter)
+        const_iterator_impl( const iterator_type& iter, const std::vector<AttributeKey> &keys) : m_item(iter, keys)
         {}
         template<typename other_type> const_iterator_impl(const const_iterator_impl<other_type>& other) : m_item(other.m_item)
         {}
@@ -438,7 +576,7 @@ public:
     class iterator : public const_iterator_impl<typename StorageType::iterator>
     {
     public:
-        iterator(const typename StorageType::iterator& iter) : const_iterator_impl<typename StorageType::iterator>(iter)
+        iterator(const typename StorageType::iterator& iter, const std::vector<AttributeKey> &keys) : const_iterator_impl<typename StorageType::iterator>(iter, keys)
         {}
         template<typename other_type> iterator(const const_iterator_impl<other_type>& other) : const_iterator_impl<StorageType::iterator>(other.item){
            // m_item = other.m_item;
@@ -455,32 +593,48 @@ public:
     // stl style iteration methods
     const_iterator begin() const
     {
-        return const_iterator(m_rows.begin());
+        return const_iterator(m_rows.begin(), m_keys);
     }
 
     iterator begin()
     {
-        return iterator(m_rows.begin());
+        return iterator(m_rows.begin(), m_keys);
     }
 
     const_iterator end() const
     {
-        return const_iterator(m_rows.end());
+        return const_iterator(m_rows.end(), m_keys);
     }
 
     iterator end()
     {
-        return iterator(m_rows.end());
+        return iterator(m_rows.end(), m_keys);
     }
 
     iterator find(AttributeKey key)
     {
-        return iterator(m_rows.find(key));
+        size_t position = findPosition(key);
+        return hasRowAt(position, key) ? iterator(m_rows.begin() + position, m_keys) : end();
     }
 
-    std::pair<const AttributeKey, std::unique_ptr<AttributeRowImpl>>& back()
+    // the row with the highest key
+    AttributeRow& back()
     {
-        return *m_rows.rbegin();
+        return *m_rows.back();
     }
 };
 
+inline float AttributeTableRow::getValue(size_t index) const
+{
+    checkIndex(index);
+    return m_table->m_columns[index].m_values[m_position];
+}
+
+inline void AttributeTableRow::checkIndex(size_t index) const
+{
+    if (index >= m_table->m_columns.size())
+    {
+        throw std::out_of_range("AttributeColumn index out of range");
+    }
+}
+
@@ -16,98 +16,60 @@
 
 #include "salalib/attributetableindex.h"
 
-std::vector<ConstAttributeIndexItem> makeAttributeIndex(const AttributeTable &table, int colIndex)
+namespace
 {
-    std::vector<ConstAttributeIndexItem> index;
-    size_t numRows = table.getNumRows();
-    if (numRows == 0)
+    // The rows in the order the table keeps for the column, so nothing needs sorting here; rows with the same
+    // value come in order of appearance in the map. Column -1 is the keys, which the rows are in already
+    template <typename Item, typename Table> std::vector<Item> makeIndex(Table &table, int colIndex)
     {
-        return index;
-    }
-    index.reserve(numRows);
-    // perturb the values to be sorted by so same values will be in order of appearence in the map
-    size_t idx = 0;
-    if ( colIndex == -1 )
-    {
-        double perturbationFactor = 1e-9 / numRows;
-        for (auto& item: table)
+        std::vector<Item> index;
+        size_t numRows = table.getNumRows();
+        if (numRows == 0)
         {
-            double value = (double)item.getKey().value;
-            value += idx * perturbationFactor;
-
-            index.push_back(ConstAttributeIndexItem(item.getKey(), value, item.getRow()));
-            ++idx;
+            return index;
         }
-    }
-    else if (colIndex >= 0 )
-    {
-        double perturbationFactor = table.getColumn(colIndex).getStats().max * 1e-9 / numRows;
-        for (auto & item : table)
+        index.reserve(numRows);
+        if ( colIndex == -1 )
         {
-            double value = item.getRow().getValue(colIndex);
-            value += idx * perturbationFactor;
-
-            index.push_back(ConstAttributeIndexItem(item.getKey(), value, item.getRow()));
-            ++idx;
+            for (auto& item: table)
+            {
+                index.push_back(Item(item.getKey(), (double)item.getKey().value, item.getRow()));
+            }
         }
-    }
-    else
-    {
-        throw std::out_of_range("Column index out of range");
-    }
-    std::sort(index.begin(), index.end());
-    return index;
-}
-
-std::vector<AttributeIndexItem> makeAttributeIndex(AttributeTable &table, int colIndex)
-{
-    std::vector<AttributeIndexItem> index;
-    size_t numRows = table.getNumRows();
-    if (numRows == 0)
-    {
-        return index;
-    }
-    index.reserve(numRows);
-    // perturb the values to be sorted by so same values will be in order of appearence in the map
-    size_t idx = 0;
-    if ( colIndex == -1 )
-    {
-        double perturbationFactor = 1e-9 / numRows;
-        for (auto& item: table)
+        else if (colIndex >= 0 )
         {
-            double value = (double)item.getKey().value;
-            value += idx * perturbationFactor;
-
-            index.push_back(AttributeIndexItem(item.getKey(), value, item.getRow()));
-            ++idx;
+            const std::vector<size_t> &order = table.getColumnOrder(size_t(colIndex));
+            const std::vector<float> &values = table.getColumnValues(size_t(colIndex));
+            for (size_t position : order)
+            {
+                index.push_back(Item(table.getRowKey(position), values[position], table.getRowAt(position)));
+            }
         }
-    }
-    else if (colIndex >= 0 )
-    {
-        double perturbationFactor = table.getColumn(colIndex).getStats().max * 1e-9 / numRows;
-        for (auto & item : table)
+        else
         {
-            double value = item.getRow().getValue(colIndex);
-            value += idx * perturbationFactor;
-
-            index.push_back(AttributeIndexItem(item.getKey(), value, item.getRow()));
-            ++idx;
+            throw std::out_of_range("Column index out of range");
         }
+        return index;
     }
-    else
-    {
-        throw std::out_of_range("Column index out of range");
-    }
-    std::sort(index.begin(), index.end());
-    return index;
+}
+
+std::vector<ConstAttributeIndexItem> makeAttributeIndex(const AttributeTable &table, int colIndex)
+{
+    return makeIndex<ConstAttributeIndexItem>(table, colIndex);
+}
+
+std::vector<AttributeIndexItem> makeAttributeIndex(AttributeTable &table, int colIndex)
+{
+    return makeIndex<AttributeIndexItem>(table, colIndex);
 }
 
 std::pair<std::vector<AttributeIndexItem>::iterator, std::vector<AttributeIndexItem>::iterator>
-getIndexItemsInValueRange(std::vector<AttributeIndexItem> &index, AttributeTable &table, float fromValue,
+getIndexItemsInValueRange(std::vector<AttributeIndexItem> &index, AttributeTable &, float fromValue,
                           float toValue) {
-    AttributeKey dummykey(-1);
-    AttributeRowImpl dummyrow(table);
-    return std::pair<std::vector<AttributeIndexItem>::iterator, std::vector<AttributeIndexItem>::iterator>(
-        std::lower_bound(index.begin(), index.end(), AttributeIndexItem(dummykey, fromValue, dummyrow)),
-        std::upper_bound(index.begin(), index.end(), AttributeIndexItem(dummykey, toValue, dummyrow)));
+    // the index is in value order, so the range is two binary searches
+    auto first = std::lower_bound(index.begin(), index.end(), fromValue,
+                                  [](const AttributeIndexItem &item, float value) { return item.value < value; });
+    auto last = std::upper_bound(index.begin(), index.end(), toValue,
+                                 [](float value, const AttributeIndexItem &item) { return value < item.value; });
+    return std::make_pair(first, last);
 }
@@ -15,7 +15,7 @@
 
 #include "attributetableview.h"
 
-AttributeTableView::AttributeTableView(const AttributeTable &table) : m_table(table), m_displayColumn(-1)
+AttributeTableView::AttributeTableView(const AttributeTable &table) : m_table(table), m_displayColumn(-1), m_indexVersion(0)
 {}
 
 void AttributeTableView::setDisplayColIndex(int columnIndex){
@@ -25,11 +25,23 @@ void AttributeTableView::setDisplayColIndex(int columnIndex){
         m_index.clear();
         return;
     }
-    // recalculate the index even if it's the same column in case stuff has changed
-    m_index = makeAttributeIndex(m_table, columnIndex);
+    // recalculate the index if the column has changed since, even if it's the same column
+    if (!isIndexCurrent(columnIndex))
+    {
+        m_index = makeAttributeIndex(m_table, columnIndex);
+        m_indexVersion = columnIndex >= 0 && size_t(columnIndex) < m_table.getNumColumns()
+                ? m_table.getColumnVersion(columnIndex) : 0;
+    }
     m_displayColumn = columnIndex;
 }
 
+bool AttributeTableView::isIndexCurrent(int columnIndex) const
+{
+    // the keys index is cheap to make, and the versions only follow the columns
+    return columnIndex >= 0 && columnIndex == m_displayColumn && size_t(columnIndex) < m_table.getNumColumns()
+            && m_indexVersion == m_table.getColumnVersion(columnIndex);
+}
+
 float AttributeTableView::getNormalisedValue(const AttributeKey &key, const AttributeRow &row) const
 {
     if ( m_displayColumn < 0)
@@ -55,9 +67,9 @@ void AttributeTableHandle::setDisplayColIndex(int columnIndex){
     {
         m_mutableIndex.clear();
     }
-    else
+    else if (!isIndexCurrent(columnIndex))
     {
-        // recalculate the index even if it's the same column in case stuff has changed
+        // recalculate the index if the column has changed since, even if it's the same column
         m_mutableIndex = makeAttributeIndex(m_mutableTable, columnIndex);
     }
     AttributeTableView::setDisplayColIndex(columnIndex);
@@ -39,9 +39,14 @@ public:
 
     const AttributeColumn& getDisplayedColumn() const;
 
+protected:
+    // whether the index was made for this column, and the column has not changed since
+    bool isIndexCurrent(int columnIndex) const;
+
 private:
     ConstIndex m_index;
     int m_displayColumn;
+    size_t m_indexVersion;
 };
 
 class AttributeTableHandle : public AttributeTableView
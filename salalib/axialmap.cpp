@@ -30,7 +30,9 @@
 #include "genlib/containerutils.h"
 #include "genlib/readwritehelpers.h"
 #include "genlib/pflipper.h"
+#include "genlib/parallelutils.h"
 
+#include <algorithm>
 #include <math.h>
 #include <float.h>
 #include <time.h>
@@ -58,9 +60,10 @@ void ShapeGraph::initialiseAttributesAxial()
 
 }
 
-void ShapeGraph::makeConnections(const KeyVertices &keyvertices)
+void ShapeGraph::makeConnections(const KeyVertices &keyvertices, int threads)
 {
    m_connectors.clear();
+   m_segment_graph_valid = false;
    m_links.clear();
    m_unlinks.clear();
    m_keyvertices.clear();
@@ -69,15 +72,20 @@ void ShapeGraph::makeConnections(const KeyVertices &keyvertices)
    int conn_col = m_attributes->getColumnIndex("Connectivity");
    int leng_col = m_attributes->getColumnIndex("Line Length");
 
+   // all the intersections are found in one go, and then handed to the connectors
+   std::vector<std::vector<int>> connections =
+         getAllLineConnections(nullptr, TOLERANCE_B*__max(m_region.height(),m_region.width()), threads);
+
+   m_connectors.reserve(m_shapes.size());
    int i = -1;
-   for (auto shape: m_shapes) {
+   for (auto& shape: m_shapes) {
       i++;
       int key = shape.first;
       AttributeRow &row =
           m_attributes->getRow(AttributeKey(key));
       // all indices should match...
       m_connectors.push_back( Connector() );
-      m_connectors[i].m_connections = getLineConnections( key, TOLERANCE_B*__max(m_region.height(),m_region.width()));
+      m_connectors[i].m_connections = std::move(connections[size_t(i)]);
       row.setValue(conn_col, float(m_connectors[i].m_connections.size()) );
       row.setValue(leng_col, float(shape.second.getLine().length()) );
       if (keyvertices.size()) {
@@ -182,6 +190,7 @@ bool ShapeGraph::read(std::istream &stream)
 {
    m_attributes->clear();
    m_connectors.clear();
+   m_segment_graph_valid = false;
    m_map_type = ShapeMap::EMPTYMAP;
 
    // note that keyvertexcount and keyvertices are different things! (length keyvertices not the same as keyvertexcount!)
@@ -201,6 +210,7 @@ bool ShapeGraph::read(std::istream &stream)
 
 bool ShapeGraph::readold( std::istream& stream)
 {
+   m_segment_graph_valid = false;
    // read in from old base class
    SpacePixel linemap;
    linemap.read(stream);
@@ -308,13 +318,13 @@ void ShapeGraph::writeLinksUnlinksAsPairsCSV(std::ostream &stream, char delimite
     stream << "refA" << delimiter << "refB" << delimiter << "link" << std::endl;
 
     for (auto &link : m_links) {
-        stream << depthmapX::getMapAtIndex(m_shapes, link.a)->first << delimiter
-               << depthmapX::getMapAtIndex(m_shapes, link.b)->first << delimiter << "1" << std::endl;
+        stream << getShapeRefFromIndex(link.a)->first << delimiter
+               << getShapeRefFromIndex(link.b)->first << delimiter << "1" << std::endl;
     }
 
     for (auto &unlink : m_unlinks) {
-        stream << depthmapX::getMapAtIndex(m_shapes, unlink.a)->first << delimiter
-               << depthmapX::getMapAtIndex(m_shapes, unlink.b)->first << delimiter << "0" << std::endl;
+        stream << getShapeRefFromIndex(unlink.a)->first << delimiter
+               << getShapeRefFromIndex(unlink.b)->first << delimiter << "0" << std::endl;
     }
 }
 
@@ -365,6 +375,7 @@ void ShapeGraph::writeSegmentConnectionsAsPairsCSV(std::ostream &stream)
 }
 
 void ShapeGraph::unlinkAtPoint(const Point2f& unlinkPoint) {
+    m_segment_graph_valid = false;
     std::vector<Point2f> closepoints;
     std::vector<std::pair<int, int>> intersections;
     PixelRef pix = pixelate(unlinkPoint);
@@ -374,11 +385,13 @@ void ShapeGraph::unlinkAtPoint(const Point2f& unlinkPoint) {
        for (auto jter = iter; jter != pix_shapes.end(); ++jter) {
           auto aIter = m_shapes.find(int(iter->m_shape_ref));
           auto bIter = m_shapes.find(int(jter->m_shape_ref));
-          int a = int(std::distance(m_shapes.begin(), aIter));
-          int b = int(std::distance(m_shapes.begin(), bIter));
+          if (aIter == m_shapes.end() || bIter == m_shapes.end()) {
+             continue;
+          }
+          int a = getShapeIndexFromKey(aIter->first);
+          int b = getShapeIndexFromKey(bIter->first);
           auto& connections = m_connectors[size_t(a)].m_connections;
-          if (aIter != m_shapes.end() && bIter != m_shapes.end()
-                  && aIter->second.isLine() && bIter->second.isLine()
+          if (aIter->second.isLine() && bIter->second.isLine()
                   && std::find(connections.begin(), connections.end(), b) != connections.end()) {
              closepoints.push_back( intersection_point(aIter->second.getLine(), bIter->second.getLine(), TOLERANCE_A) );
              intersections.push_back( std::pair<int, int>(a,b) );
@@ -410,6 +423,7 @@ void ShapeGraph::unlinkAtPoint(const Point2f& unlinkPoint) {
 
 void ShapeGraph::unlinkFromShapeMap(const ShapeMap& shapemap)
 {
+   m_segment_graph_valid = false;
    // used to make a shape map from every axial intersection,
 
    // find lines in rough vincinity of unlink point, and check for the closest
@@ -563,22 +577,33 @@ void ShapeGraph::makeNewSegMap(Communicator *comm) {
 // identify the original axial line this line segment is
 // associated with
 
-void ShapeGraph::makeSegmentMap(std::vector<Line>& lines, std::vector<Connector>& connectors, double stubremoval)
-{
-   // the first (key) pair is the line / line intersection, second is the pair of associated segments for the first line
-   std::map<OrderedIntPair, std::pair<int, int>> segmentlist;
-
-   // this code relies on the polygon order being the same as the connections
-
-   auto iter = m_shapes.begin();
-   for (size_t i = 0; i < m_connectors.size(); i++) {
-      auto shape = iter->second;
-      int axialRef = iter->first;
-      iter++;
-      if (!shape.isLine()) {
-         continue;
+namespace {
+   // One line of an axial map broken up into segments where the other lines cross it. This only
+   // depends on the line and the lines crossing it, so all the lines can be broken up at once
+   struct BrokenLine {
+      // a place where the line is crossed, by one or more lines
+      struct Junction {
+         // the segments either side, as indices into segments, or -1 where a stub was removed
+         int seg_a;
+         int seg_b;
+         // the crossing lines are in crossings, from the end of the previous junction's to this
+         size_t crossings_end;
+      };
+      std::vector<Line> segments;
+      std::vector<Junction> junctions;
+      std::vector<int> crossings;
+      // the first junction at which each crossing line crosses, sorted by line
+      std::vector<std::pair<int, int>> first_junctions;
+
+      int firstJunction(int line) const {
+         auto iter = std::lower_bound(first_junctions.begin(), first_junctions.end(), std::make_pair(line, -1));
+         return (iter == first_junctions.end() || iter->first != line) ? -1 : iter->second;
       }
-      const Line& line = shape.getLine();
+   };
+
+   void breakLine(int i, const Line& line, const std::vector<int>& connections,
+                  const std::vector<const SalaShape *>& shapes, double stubremoval, BrokenLine& broken)
+   {
       std::vector<std::pair<double,int> > breaks; // this is a vector instead of a map because the
                                                   // original code allowed for duplicate keys
       int axis = line.width() >= line.height() ? XAXIS : YAXIS;
@@ -587,52 +612,35 @@ void ShapeGraph::makeSegmentMap(std::vector<Line>& lines, std::vector<Connector>
       // if the line is ascending or decending
       int parity = (axis == XAXIS) ? 1 : line.sign();
 
-      auto& connections = m_connectors[i].m_connections;
-      for (size_t j = 0; j < connections.size(); j++) {
+      for (int connection: connections) {
          // find the intersection point and add...
          // note: more than one break at the same place allowed
-         auto shapeJ = depthmapX::getMapAtIndex(m_shapes, connections[j])->second;
-         if (static_cast<int>(i) != connections[j] && shapeJ.isLine()) {
+         const SalaShape& shapeJ = *shapes[size_t(connection)];
+         if (i != connection && shapeJ.isLine()) {
             breaks.push_back(std::make_pair(parity * line.intersection_point( shapeJ.getLine(), axis, TOLERANCE_A ),
-                                         connections[j]));
+                                         connection));
          }
       }
       std::sort(breaks.begin(), breaks.end());
       // okay, now we have a list from one end of the other of lines this line connects with
       Point2f lastpoint = line.start();
       int seg_a = -1, seg_b = -1;
-      double neardist;
-      // TOLERANCE_C is introduced as of 01.08.2008 although it is a fix to a bug first
-      // found in July 2006.  It has been set "high" deliberately (1e-6 = a millionth of the line height / width)
-      // in order to catch small errors made by operators or floating point errors in other systems
-      // when drawing, for example, three axial lines intersecting
-      if  (stubremoval == 0.0) {
-         // if 0, convert to tolerance
-         stubremoval = TOLERANCE_C;
-      }
-      neardist = (axis == XAXIS) ? (line.width() * stubremoval) : (line.height() * stubremoval);
+      double neardist = (axis == XAXIS) ? (line.width() * stubremoval) : (line.height() * stubremoval);
       double overlapdist = (axis == XAXIS) ? (line.width() * TOLERANCE_C) : (line.height() * TOLERANCE_C);
       //
       for (auto breaksIter = breaks.begin(); breaksIter != breaks.end();) {
-         std::vector<int> keylist;
          if (seg_a == -1) {
             Point2f thispoint = line.point_on_line(parity * breaksIter->first,axis);
-            if (fabs(parity * breaksIter->first - line.start()[axis]) < neardist) {
-               seg_a = -1;
-               lastpoint = thispoint;
-            }
-            else  {
-               Line segment_a(line.start(),thispoint);
-               lines.push_back(segment_a);
-               connectors.push_back(Connector(axialRef));
-               seg_a = lines.size() - 1;
+            if (!(fabs(parity * breaksIter->first - line.start()[axis]) < neardist)) {
+               broken.segments.push_back(Line(line.start(),thispoint));
+               seg_a = int(broken.segments.size()) - 1;
             }
             lastpoint = thispoint;
          }
          //
          double here = parity * breaksIter->first;
          while (breaksIter != breaks.end() && fabs(parity * breaksIter->first - here) < overlapdist) {
-            keylist.push_back(breaksIter->second);
+            broken.crossings.push_back(breaksIter->second);
             ++breaksIter;
          }
          //
@@ -647,23 +655,94 @@ void ShapeGraph::makeSegmentMap(std::vector<Line>& lines, std::vector<Connector>
             else {
                thispoint = line.end();
             }
-            Line segment_b(lastpoint,thispoint);
-            lines.push_back(segment_b);
-            connectors.push_back(Connector(axialRef));
-            seg_b = lines.size() - 1;
+            broken.segments.push_back(Line(lastpoint,thispoint));
+            seg_b = int(broken.segments.size()) - 1;
             //
             lastpoint = thispoint;
          }
-         //
-         for (size_t j = 0; j < keylist.size(); j++) {
-         //
-            if (keylist[j] < (int)i) {
-               // other line already segmented, look up in segment list,
+         broken.junctions.push_back(BrokenLine::Junction{seg_a, seg_b, broken.crossings.size()});
+         seg_a = seg_b;
+      }
+
+      size_t crossing = 0;
+      for (size_t j = 0; j < broken.junctions.size(); j++) {
+         for (; crossing < broken.junctions[j].crossings_end; crossing++) {
+            broken.first_junctions.push_back(std::make_pair(broken.crossings[crossing], int(j)));
+         }
+      }
+      // sorting puts the first junction for each line ahead of any others
+      std::sort(broken.first_junctions.begin(), broken.first_junctions.end());
+      broken.first_junctions.erase(std::unique(broken.first_junctions.begin(), broken.first_junctions.end(),
+                                               [](const std::pair<int, int>& a, const std::pair<int, int>& b) {
+                                                  return a.first == b.first;
+                                               }),
+                                   broken.first_junctions.end());
+   }
+}
+
+void ShapeGraph::makeSegmentMap(std::vector<Line>& lines, std::vector<Connector>& connectors, double stubremoval,
+                                int threads)
+{
+   // this code relies on the polygon order being the same as the connections
+
+   std::vector<const SalaShape *> shapes;
+   std::vector<int> axialRefs;
+   shapes.reserve(m_shapes.size());
+   axialRefs.reserve(m_shapes.size());
+   for (const auto& shape: m_shapes) {
+      shapes.push_back(&shape.second);
+      axialRefs.push_back(shape.first);
+   }
+
+   // TOLERANCE_C is introduced as of 01.08.2008 although it is a fix to a bug first
+   // found in July 2006.  It has been set "high" deliberately (1e-6 = a millionth of the line height / width)
+   // in order to catch small errors made by operators or floating point errors in other systems
+   // when drawing, for example, three axial lines intersecting
+   if  (stubremoval == 0.0) {
+      // if 0, convert to tolerance
+      stubremoval = TOLERANCE_C;
+   }
+
+   // first every line is broken up on its own...
+   std::vector<BrokenLine> brokenLines(m_connectors.size());
+   depthmapX::parallelFor(nullptr, depthmapX::getThreadCount(threads, brokenLines.size()), brokenLines.size(),
+                          [&](size_t i, size_t) {
+      if (shapes[i]->isLine()) {
+         breakLine(int(i), shapes[i]->getLine(), m_connectors[i].m_connections, shapes, stubremoval, brokenLines[i]);
+      }
+   });
+
+   // ...then the segments are numbered in line order...
+   std::vector<int> firstSegment(brokenLines.size());
+   for (size_t i = 0; i < brokenLines.size(); i++) {
+      firstSegment[i] = int(lines.size());
+      for (const Line& segment: brokenLines[i].segments) {
+         lines.push_back(segment);
+         connectors.push_back(Connector(axialRefs[i]));
+      }
+   }
+   auto segmentId = [&](size_t i, int localSegment) {
+      return localSegment == -1 ? -1 : firstSegment[i] + localSegment;
+   };
+
+   // ...and joined up to the segments of the lines crossing them, in the same order as they would be
+   // if the lines were broken up one after the other
+   for (size_t i = 0; i < brokenLines.size(); i++) {
+      const BrokenLine& broken = brokenLines[i];
+      size_t crossing = 0;
+      for (const BrokenLine::Junction& junction: broken.junctions) {
+         int seg_a = segmentId(i, junction.seg_a);
+         int seg_b = segmentId(i, junction.seg_b);
+         for (; crossing < junction.crossings_end; crossing++) {
+            int other = broken.crossings[crossing];
+            if (other < (int)i) {
+               // other line already segmented, look up where we cross it,
                // and join segments together nicely
-               auto segIter = segmentlist.find(OrderedIntPair(keylist[j],i));
-               if (segIter != segmentlist.end()) {   // <- if it isn't -1 something has gone badly wrong!
-                  int seg_1 = segIter->second.first;
-                  int seg_2 = segIter->second.second;
+               int otherJunction = brokenLines[size_t(other)].firstJunction(int(i));
+               if (otherJunction != -1) {   // <- if it isn't -1 something has gone badly wrong!
+                  const BrokenLine::Junction& otherSide = brokenLines[size_t(other)].junctions[size_t(otherJunction)];
+                  int seg_1 = segmentId(size_t(other), otherSide.seg_a);
+                  int seg_2 = segmentId(size_t(other), otherSide.seg_b);
                   if (seg_a != -1) {
                      if (seg_1 != -1) {
                         Point2f alpha = lines[size_t(seg_a)].start() - lines[size_t(seg_a)].end();
@@ -706,17 +785,11 @@ void ShapeGraph::makeSegmentMap(std::vector<Line>& lines, std::vector<Connector>
                   }
                }
             }
-            else {
-               // other line still to be segmented, add ourselves to segment list
-               // to be added later
-               segmentlist.insert(std::make_pair( OrderedIntPair(i,keylist[j]), std::pair<int, int>(seg_a,seg_b) ));
-            }
          }
          if (seg_a != -1 && seg_b != -1) {
             depthmapX::addIfNotExists(connectors[size_t(seg_a)].m_forward_segconns, SegmentRef(1,seg_b), 0.0f);
             depthmapX::addIfNotExists(connectors[size_t(seg_b)].m_back_segconns, SegmentRef(-1,seg_a), 0.0f);
          }
-         seg_a = seg_b;
       }
    }
 }
@@ -736,6 +809,7 @@ void ShapeGraph::initialiseAttributesSegment()
 void ShapeGraph::makeSegmentConnections(std::vector<Connector>& connectionset)
 {
    m_connectors.clear();
+   m_segment_graph_valid = false;
 
    // note, expects these in alphabetical order to preserve numbering:
    int w_conn_col = m_attributes->getOrInsertColumn("Angular Connectivity");
@@ -64,11 +64,15 @@ public:
    ShapeGraph(const std::string& name = "<axial map>", int type = ShapeMap::AXIALMAP);
    virtual ~ShapeGraph() {;}
    void initialiseAttributesAxial();
-   void makeConnections(const KeyVertices &keyvertices = KeyVertices());
+   // the lines crossing each line are found on up to threads threads (0 or less for as many
+   // as the hardware offers)
+   void makeConnections(const KeyVertices &keyvertices = KeyVertices(), int threads = 1);
    bool stepdepth(Communicator *comm = NULL);
    // lineset and connectionset are filled in by segment map
    void makeNewSegMap(Communicator *comm);
-   void makeSegmentMap(std::vector<Line> &lines, std::vector<Connector> &connectors, double stubremoval);
+   // the lines are broken into segments on up to threads threads
+   void makeSegmentMap(std::vector<Line> &lines, std::vector<Connector> &connectors, double stubremoval,
+                       int threads = 1);
    void initialiseAttributesSegment();
    void makeSegmentConnections(std::vector<Connector> &connectionset);
    void pushAxialValues(ShapeGraph& axialmap);
@@ -1,15 +1,10 @@
 #include "salalib/axialminimiser.h"
 #include "salalib/tolerances.h"
+#include "genlib/pafmath.h"
 
-static int compareValueTriplet(const void *p1, const void *p2)
-{
-   ValueTriplet *vp1 = (ValueTriplet *) p1;
-   ValueTriplet *vp2 = (ValueTriplet *) p2;
-   return (vp1->value1 > vp2->value1 ? 1 : vp1->value1 < vp2->value1 ? -1 :
-          (vp1->value2 > vp2->value2 ? 1 : vp1->value2 < vp2->value2 ? -1 : 0));
-}
+#include <algorithm>
 
-AxialMinimiser::AxialMinimiser(const AllLineMap& alllinemap, int no_of_axsegcuts, int no_of_radialsegs)
+AxialMinimiser::AxialMinimiser(const AllLineMap& alllinemap, int no_of_axsegcuts, int no_of_radialsegs, unsigned int seed)
 {
    m_alllinemap = (AllLineMap *) &alllinemap;
 
@@ -18,6 +13,14 @@ AxialMinimiser::AxialMinimiser(const AllLineMap& alllinemap, int no_of_axsegcuts
    m_affected = new bool [no_of_axsegcuts];
    m_vital = new bool [no_of_axsegcuts];
    m_radialsegcounts = new int [no_of_radialsegs];
+
+   m_tiebreak.resize(size_t(no_of_axsegcuts), 0);
+   if (seed != 0) {
+      pafsrand(seed);
+      for (auto& tiebreak: m_tiebreak) {
+         tiebreak = pafrand();
+      }
+   }
 }
 
 AxialMinimiser::~AxialMinimiser()
@@ -29,6 +32,23 @@ AxialMinimiser::~AxialMinimiser()
    delete [] m_removed;
 }
 
+// sort according to number of connections then length, and then the tie break and the line order
+void AxialMinimiser::sortValueTriplets(int count)
+{
+   std::sort(m_vps, m_vps + count, [this](const ValueTriplet& a, const ValueTriplet& b) {
+      if (a.value1 != b.value1) {
+         return a.value1 < b.value1;
+      }
+      if (a.value2 != b.value2) {
+         return a.value2 < b.value2;
+      }
+      if (m_tiebreak[size_t(a.index)] != m_tiebreak[size_t(b.index)]) {
+         return m_tiebreak[size_t(a.index)] < m_tiebreak[size_t(b.index)];
+      }
+      return a.index < b.index;
+   });
+}
+
 // Alan and Bill's algo...
 
 void AxialMinimiser::removeSubsets(std::map<int, std::set<int> >& axsegcuts, std::map<RadialKey,RadialSegment>& radialsegs,
@@ -54,12 +74,12 @@ void AxialMinimiser::removeSubsets(std::map<int, std::set<int> >& axsegcuts, std
       m_vps[y].index = y;
       double length = m_axialconns[y].m_connections.size();
       m_vps[y].value1 = (int) length;
-      length = depthmapX::getMapAtIndex(m_alllinemap->m_shapes, y)->second.getLine().length();
+      length = m_alllinemap->getShapeRefFromIndex(y)->second.getLine().length();
       m_vps[y].value2 = (float) length;
    }
 
    // sort according to number of connections then length
-   qsort(m_vps,m_axialconns.size(),sizeof(ValueTriplet),compareValueTriplet);
+   sortValueTriplets(int(m_axialconns.size()));
 
    while (removedflag) {
 
@@ -183,12 +203,12 @@ void AxialMinimiser::fewestLongest(std::map<int, std::set<int> > &axsegcuts, std
       if (!m_removed[y] && !m_vital[y]) {
          m_vps[livecount].index = (int) y;
          m_vps[livecount].value1 = (int) m_axialconns[y].m_connections.size();
-         m_vps[livecount].value2 = (float) depthmapX::getMapAtIndex(m_alllinemap->m_shapes, y)->second.getLine().length();
+         m_vps[livecount].value2 = (float) m_alllinemap->getShapeRefFromIndex(y)->second.getLine().length();
          livecount++;
       }
    }
 
-   qsort(m_vps,livecount,sizeof(ValueTriplet),compareValueTriplet);
+   sortValueTriplets(livecount);
 
    for (int i = 0; i < livecount; i++) {
 
@@ -21,8 +21,12 @@ protected:
    int *m_radialsegcounts;
    int *m_keyvertexcounts;
    std::vector<Connector> m_axialconns; // <- uses a copy of axial lines as it will remove connections
+   // breaks ties between lines with the same number of connections and length: zero for every line
+   // when there is no seed, so that the line order decides, otherwise drawn from the seed
+   std::vector<unsigned int> m_tiebreak;
+   void sortValueTriplets(int count);
 public:
-   AxialMinimiser(const AllLineMap& alllinemap, int no_of_axsegcuts, int no_of_radialsegs);
+   AxialMinimiser(const AllLineMap& alllinemap, int no_of_axsegcuts, int no_of_radialsegs, unsigned int seed = 0);
    ~AxialMinimiser();
    void removeSubsets(std::map<int, std::set<int> > &axsegcuts, std::map<RadialKey,RadialSegment>& radialsegs,
                       std::map<RadialKey, std::set<int> >& rlds, std::vector<RadialLine> &radial_lines,
@@ -18,19 +18,204 @@
 
 #include "salalib/axialmodules/axialintegration.h"
 
+#include "genlib/parallelutils.h"
 #include "genlib/pflipper.h"
 #include "genlib/stringutils.h"
 
+// what the search from one root line found within one radius
+struct AxialIntegration::RadiusResult {
+    int node_count = 0;
+    int total_depth = 0;
+    int depth = 0;
+    double total_weight = 0.0;
+    double w_total_depth = 0.0;
+    std::vector<int> depthcounts;
+};
+
+struct AxialIntegration::RootResult {
+    // control and controllability, only when the line has connections
+    bool connected = false;
+    double control = 0.0;
+    double controllability = 0.0;
+    std::vector<RadiusResult> radii;
+};
+
+// the scratch space of one worker: the search state, reset for every root, and the choice
+// accumulated over the roots of the block the worker is on
+struct AxialIntegration::Workspace {
+    std::vector<char> covered;
+    pflipper<std::vector<std::pair<int, int>>> foundlist;
+    std::vector<int> depthcounts;
+    std::vector<double> path_count, dependency, weighted_dependency;
+    std::vector<int> line_depth;
+    std::vector<int> search_order;
+    std::vector<double> choice, weighted_choice;
+    // the lines with choice in the accumulators above, so that the merge only visits those
+    std::vector<char> in_block;
+    std::vector<int> block_lines;
+};
+
+void AxialIntegration::searchFrom(ShapeGraph &map, int root, const std::vector<int> &radii,
+                                  const std::vector<double> &weights, Workspace &workspace, RootResult &result,
+                                  bool simple_version) const {
+    std::vector<char> &covered = workspace.covered;
+    std::fill(covered.begin(), covered.end(), 0);
+
+    if (m_local && !simple_version) {
+        double control = 0.0;
+        const std::vector<int> &connections = map.getConnections()[root].m_connections;
+        std::vector<int> totalneighbourhood;
+        for (int connection : connections) {
+            // n.b., as of Depthmap 10.0, connections[j] and i cannot coexist
+            depthmapX::addIfNotExists(totalneighbourhood, connection);
+            int retro_size = 0;
+            auto &retconnectors = map.getConnections()[size_t(connection)].m_connections;
+            for (auto retconnector : retconnectors) {
+                retro_size++;
+                depthmapX::addIfNotExists(totalneighbourhood, retconnector);
+            }
+            control += 1.0 / double(retro_size);
+        }
+        if (connections.size() > 0) {
+            result.connected = true;
+            result.control = control;
+            result.controllability = double(connections.size()) / double(totalneighbourhood.size() - 1);
+        }
+    }
+
+    std::vector<int> &depthcounts = workspace.depthcounts;
+    depthcounts.clear();
+    depthcounts.push_back(0);
+
+    pflipper<std::vector<std::pair<int, int>>> &foundlist = workspace.foundlist;
+    foundlist.a().clear();
+    foundlist.b().clear();
+    foundlist.a().push_back(std::pair<int, int>(root, -1));
+    covered[root] = true;
+
+    std::vector<double> &path_count = workspace.path_count;
+    std::vector<double> &dependency = workspace.dependency;
+    std::vector<double> &weighted_dependency = workspace.weighted_dependency;
+    std::vector<int> &line_depth = workspace.line_depth;
+    std::vector<int> &search_order = workspace.search_order;
+    if (m_choice) {
+        // line_depth and path_count are only read for covered lines, so need no clearing
+        search_order.clear();
+        search_order.push_back(root);
+        line_depth[root] = 0;
+        path_count[root] = 1.0;
+    }
+    int total_depth = 0, depth = 1, node_count = 1; // node_count includes this 1
+    double weight = 0.0, rootweight = 0.0, total_weight = 0.0, w_total_depth = 0.0;
+    if (m_weighted_measure_col != -1) {
+        rootweight = weights[root];
+        // include this line in total weights (as per nodecount)
+        total_weight += rootweight;
+    }
+    result.radii.resize(radii.size());
+    for (size_t r = 0; r < radii.size(); r++) {
+        int radius = radii[r];
+        while (foundlist.a().size()) {
+            int index = foundlist.a().back().first;
+            Connector &line = map.getConnections()[index];
+            for (size_t k = 0; k < line.m_connections.size(); k++) {
+                int connection = line.m_connections[k];
+                if (!covered[connection]) {
+                    covered[connection] = true;
+                    foundlist.b().push_back(std::pair<int, int>(connection, index));
+                    if (m_weighted_measure_col != -1) {
+                        // the weight is taken from the discovered node:
+                        weight = weights[connection];
+                        total_weight += weight;
+                        w_total_depth += depth * weight;
+                    }
+                    if (m_choice) {
+                        search_order.push_back(connection);
+                        line_depth[connection] = depth;
+                        path_count[connection] = path_count[index];
+                    }
+                    total_depth += depth;
+                    node_count++;
+                    depthcounts.back() += 1;
+                } else if (m_choice && line_depth[connection] == depth) {
+                    // found again at the same depth: more shortest paths to it
+                    path_count[connection] += path_count[index];
+                }
+            }
+            foundlist.a().pop_back();
+            if (!foundlist.a().size()) {
+                foundlist.flip();
+                depth++;
+                depthcounts.push_back(0);
+                if (radius != -1 && depth > radius) {
+                    break;
+                }
+            }
+        }
+        RadiusResult &found = result.radii[r];
+        found.node_count = node_count;
+        found.total_depth = total_depth;
+        found.depth = depth;
+        found.total_weight = total_weight;
+        found.w_total_depth = w_total_depth;
+        found.depthcounts = depthcounts;
+    }
+
+    if (m_choice) {
+        // both directions of every pair are counted, as each line is a root in turn
+        for (size_t ri = 0; ri < radii.size(); ri++) {
+            int radius = radii[ri];
+            // the lines are in search order, so the ones within the radius come first
+            size_t within = search_order.size();
+            while (radius != -1 && within > 0 && line_depth[search_order[within - 1]] > radius) {
+                within--;
+            }
+            for (size_t k = within; k-- > 0;) {
+                int here = search_order[k];
+                double here_dependency = 0.0, here_weighted_dependency = 0.0;
+                for (int connection : map.getConnections()[here].m_connections) {
+                    if (covered[connection] && line_depth[connection] == line_depth[here] + 1 &&
+                        (radius == -1 || line_depth[connection] <= radius)) {
+                        double share = path_count[here] / path_count[connection];
+                        here_dependency += share * (1.0 + dependency[connection]);
+                        if (m_weighted_measure_col != -1) {
+                            here_weighted_dependency +=
+                                share * (rootweight * weights[connection] + weighted_dependency[connection]);
+                        }
+                    }
+                }
+                dependency[here] = here_dependency;
+                weighted_dependency[here] = here_weighted_dependency;
+                if (here == root) {
+                    continue;
+                }
+                workspace.choice[here * radii.size() + ri] += here_dependency;
+                if (m_weighted_measure_col != -1) {
+                    workspace.weighted_choice[here * radii.size() + ri] += here_weighted_dependency;
+                    if (line_depth[here] > 1) {
+                        // in weighted choice, the root and the target of a path with lines between
+                        // them receive half its weight each
+                        double pair_weight = rootweight * weights[here] * 0.5;
+                        workspace.weighted_choice[root * radii.size() + ri] += pair_weight;
+                        workspace.weighted_choice[here * radii.size() + ri] += pair_weight;
+                    }
+                }
+            }
+        }
+        // the choice of a root only ever goes to the lines it found (the root included)
+        for (int line : search_order) {
+            if (!workspace.in_block[line]) {
+                workspace.in_block[line] = 1;
+                workspace.block_lines.push_back(line);
+            }
+        }
+    }
+}
+
 bool AxialIntegration::run(Communicator *comm, ShapeGraph &map, bool simple_version) {
     // note, from 10.0, Depthmap no longer includes *self* connections on axial lines
     // self connections are stripped out on loading graph files, as well as no longer made
 
-    time_t atime = 0;
-    if (comm) {
-        qtimer(atime, 0);
-        comm->CommPostMessage(Communicator::NUM_RECORDS, map.getShapeCount());
-    }
-
     AttributeTable &attributes = map.getAttributeTable();
 
     // note: radius must be sorted lowest to highest, but if -1 occurs ("radius n") it needs to be last...
@@ -217,137 +402,87 @@ bool AxialIntegration::run(Communicator *comm, ShapeGraph &map, bool simple_vers
         }
     }
 
-    // for choice
-    AnalysisInfo **audittrail;
+    // for choice: the shortest path betweenness of every line at every radius, accumulated over
+    // all the roots (Brandes 2001). For each root the search counts the shortest paths to each
+    // line (path_count) and then, from the deepest lines back, the share of the paths from the
+    // root that pass through each line (dependency, and weighted_dependency weighted by the root
+    // and target weights)
+    size_t line_count = map.getShapeCount();
+    std::vector<double> choice, weighted_choice;
     if (m_choice) {
-        audittrail = new AnalysisInfo *[map.getShapeCount()];
-        for (size_t i = 0; i < map.getShapeCount(); i++) {
-            audittrail[i] = new AnalysisInfo[radii.size()];
+        choice.resize(line_count * radii.size(), 0.0);
+        weighted_choice.resize(line_count * radii.size(), 0.0);
+    }
+
+    // the roots are searched from in blocks of a fixed size, handed out to the workers. Each
+    // worker adds the choice of its block up in its own accumulators, and these are added to
+    // the totals in block order, so that the sums (and so the results) are the same however
+    // many threads run
+    size_t block_size = depthmapX::getBlockSize(line_count);
+    size_t blocks = (line_count + block_size - 1) / block_size;
+    size_t thread_count = depthmapX::getThreadCount(m_threads, blocks);
+    std::vector<Workspace> workspaces(thread_count);
+    for (Workspace &workspace : workspaces) {
+        workspace.covered.resize(line_count);
+        if (m_choice) {
+            workspace.line_depth.resize(line_count);
+            workspace.path_count.resize(line_count);
+            workspace.dependency.resize(line_count);
+            workspace.weighted_dependency.resize(line_count);
+            workspace.choice.resize(line_count * radii.size(), 0.0);
+            workspace.weighted_choice.resize(line_count * radii.size(), 0.0);
+            workspace.in_block.resize(line_count, 0);
         }
     }
 
-    // n.b., for this operation we assume continuous line referencing from zero (this is silly?)
-    // has already failed due to this!  when intro hand drawn fewest line (where user may have deleted)
-    // it's going to get worse...
+    std::vector<RootResult> results(line_count);
 
-    bool *covered = new bool[map.getShapeCount()];
+    if (comm) {
+        comm->CommPostMessage(Communicator::NUM_RECORDS, int(blocks));
+    }
+    depthmapX::parallelForInBlocks(
+        comm, thread_count, line_count, block_size,
+        [&](size_t i, size_t threadIndex) {
+            searchFrom(map, int(i), radii, weights, workspaces[threadIndex], results[i], simple_version);
+        },
+        [&](size_t threadIndex) {
+            Workspace &workspace = workspaces[threadIndex];
+            for (int line : workspace.block_lines) {
+                for (size_t k = size_t(line) * radii.size(); k < size_t(line + 1) * radii.size(); k++) {
+                    choice[k] += workspace.choice[k];
+                    weighted_choice[k] += workspace.weighted_choice[k];
+                    workspace.choice[k] = 0.0;
+                    workspace.weighted_choice[k] = 0.0;
+                }
+                workspace.in_block[size_t(line)] = 0;
+            }
+            workspace.block_lines.clear();
+        });
 
+    // the attributes are written out in line order, as a single thread would
     size_t i = -1;
-    for (auto & iter : attributes) {
+    for (auto &iter : attributes) {
         i++;
         AttributeRow &row = iter.getRow();
-        for (size_t j = 0; j < map.getShapeCount(); j++) {
-            covered[j] = false;
-        }
-        if (m_choice) {
-            for (size_t k = 0; k < map.getShapeCount(); k++) {
-                audittrail[k][0].previous.ref = -1; // note, 0th member used as radius doesn't matter
-                // note, choice columns are not cleared, but cummulative over all shortest path pairs
-            }
-        }
+        const RootResult &result = results[i];
 
-        if (m_local) {
-            double control = 0.0;
-            const std::vector<int> &connections = map.getConnections()[i].m_connections;
-            std::vector<int> totalneighbourhood;
-            for (int connection : connections) {
-                // n.b., as of Depthmap 10.0, connections[j] and i cannot coexist
-                // if (connections[j] != i) {
-                depthmapX::addIfNotExists(totalneighbourhood, connection);
-                int retro_size = 0;
-                auto &retconnectors = map.getConnections()[size_t(connection)].m_connections;
-                for (auto retconnector : retconnectors) {
-                    retro_size++;
-                    depthmapX::addIfNotExists(totalneighbourhood, retconnector);
-                }
-                control += 1.0 / double(retro_size);
-                //}
-            }
-
-            if (!simple_version) {
-                if (connections.size() > 0) {
-                    row.setValue(control_col, float(control));
-                    row.setValue(controllability_col,
-                                 float(double(connections.size()) / double(totalneighbourhood.size() - 1)));
-                } else {
-                    row.setValue(control_col, -1);
-                    row.setValue(controllability_col, -1);
-                }
+        if (m_local && !simple_version) {
+            if (result.connected) {
+                row.setValue(control_col, float(result.control));
+                row.setValue(controllability_col, float(result.controllability));
+            } else {
+                row.setValue(control_col, -1);
+                row.setValue(controllability_col, -1);
             }
         }
 
-        std::vector<int> depthcounts;
-        depthcounts.push_back(0);
-
-        pflipper<std::vector<std::pair<int, int>>> foundlist;
-        foundlist.a().push_back(std::pair<int, int>(i, -1));
-        covered[i] = true;
-        int total_depth = 0, depth = 1, node_count = 1, pos = -1, previous = -1; // node_count includes this 1
-        double weight = 0.0, rootweight = 0.0, total_weight = 0.0, w_total_depth = 0.0;
-        if (m_weighted_measure_col != -1) {
-            rootweight = weights[i];
-            // include this line in total weights (as per nodecount)
-            total_weight += rootweight;
-        }
-        int index = -1;
-        int r = 0;
-        for (int radius : radii) {
-            while (foundlist.a().size()) {
-                if (!m_choice) {
-                    index = foundlist.a().back().first;
-                } else {
-                    pos = pafrand() % foundlist.a().size();
-                    index = foundlist.a().at(pos).first;
-                    previous = foundlist.a().at(pos).second;
-                    audittrail[index][0].previous.ref =
-                        previous; // note 0th member used here: can be used individually different radius previous
-                }
-                Connector &line = map.getConnections()[index];
-                for (size_t k = 0; k < line.m_connections.size(); k++) {
-                    if (!covered[line.m_connections[k]]) {
-                        covered[line.m_connections[k]] = true;
-                        foundlist.b().push_back(std::pair<int, int>(line.m_connections[k], index));
-                        if (m_weighted_measure_col != -1) {
-                            // the weight is taken from the discovered node:
-                            weight = weights[line.m_connections[k]];
-                            total_weight += weight;
-                            w_total_depth += depth * weight;
-                        }
-                        if (m_choice && previous != -1) {
-                            // both directional paths are now recorded for choice
-                            // (coincidentally fixes choice problem which was completely wrong)
-                            size_t here = index;   // note: start counting from index as actually looking ahead here
-                            while (here != i) { // not i means not the current root for the path
-                                audittrail[here][r].choice += 1;
-                                audittrail[here][r].weighted_choice += weight * rootweight;
-                                here =
-                                    audittrail[here][0].previous.ref; // <- note, just using 0th position: radius for
-                                                                      // the previous doesn't matter in this analysis
-                            }
-                            if (m_weighted_measure_col != -1) {
-                                // in weighted choice, root node and current node receive values:
-                                audittrail[i][r].weighted_choice += (weight * rootweight) * 0.5;
-                                audittrail[line.m_connections[k]][r].weighted_choice += (weight * rootweight) * 0.5;
-                            }
-                        }
-                        total_depth += depth;
-                        node_count++;
-                        depthcounts.back() += 1;
-                    }
-                }
-                if (!m_choice)
-                    foundlist.a().pop_back();
-                else
-                    foundlist.a().erase(foundlist.a().begin() + pos);
-                if (!foundlist.a().size()) {
-                    foundlist.flip();
-                    depth++;
-                    depthcounts.push_back(0);
-                    if (radius != -1 && depth > radius) {
-                        break;
-                    }
-                }
-            }
+        for (size_t r = 0; r < radii.size(); r++) {
+            const RadiusResult &found = result.radii[r];
+            int node_count = found.node_count;
+            int total_depth = found.total_depth;
+            int depth = found.depth;
+            double total_weight = found.total_weight, w_total_depth = found.w_total_depth;
+            const std::vector<int> &depthcounts = found.depthcounts;
             // set the attributes for this node:
             row.setValue(count_col[r], float(node_count));
             if (m_weighted_measure_col != -1) {
@@ -458,29 +593,16 @@ bool AxialIntegration::run(Communicator *comm, ShapeGraph &map, bool simple_vers
                     row.setValue(harmonic_col[r], -1.0f);
                 }
             }
-            ++r;
-        }
-        //
-        if (comm) {
-            if (qtimer(atime, 500)) {
-                if (comm->IsCancelled()) {
-                    delete[] covered;
-                    throw Communicator::CancelledException();
-                }
-                comm->CommPostMessage(Communicator::CURRENT_RECORD, i);
-            }
         }
     }
-    delete[] covered;
     if (m_choice) {
         i = -1;
         for (auto & iter: attributes) {
             i++;
             AttributeRow &row = iter.getRow();
-            double total_choice = 0.0, w_total_choice = 0.0;
             for (size_t r = 0; r < radii.size(); r++) {
-                total_choice += audittrail[i][r].choice;
-                w_total_choice += audittrail[i][r].weighted_choice;
+                double total_choice = choice[i * radii.size() + r];
+                double w_total_choice = weighted_choice[i * radii.size() + r];
                 // n.b., normalise choice according to (n-1)(n-2)/2 (maximum possible through routes)
                 double node_count = row.getValue(count_col[r]);
                 double total_weight = 0;
@@ -504,10 +626,6 @@ bool AxialIntegration::run(Communicator *comm, ShapeGraph &map, bool simple_vers
                 }
             }
         }
-        for (size_t i = 0; i < map.getShapeCount(); i++) {
-            delete[] audittrail[i];
-        }
-        delete[] audittrail;
     }
 
     map.setDisplayedAttribute(-1); // <- override if it's already showing
@@ -27,11 +27,21 @@ class AxialIntegration : IAxial {
     bool m_choice;
     bool m_fulloutput;
     bool m_local;
+    int m_threads;
+
+    struct RadiusResult;
+    struct RootResult;
+    struct Workspace;
+    void searchFrom(ShapeGraph &map, int root, const std::vector<int> &radii, const std::vector<double> &weights,
+                    Workspace &workspace, RootResult &result, bool simple_version) const;
 
   public:
     std::string getAnalysisName() const override { return "Angular Analysis"; }
     bool run(Communicator *, ShapeGraph &map, bool) override;
-    AxialIntegration(std::set<double> radius_set, int weighted_measure_col, bool choice, bool fulloutput, bool local)
+    // the search from every root line runs on up to threads threads (0 or less for as many as
+    // the hardware offers); the results do not depend on how many
+    AxialIntegration(std::set<double> radius_set, int weighted_measure_col, bool choice, bool fulloutput, bool local,
+                     int threads = 1)
         : m_radius_set(radius_set), m_weighted_measure_col(weighted_measure_col), m_choice(choice),
-          m_fulloutput(fulloutput), m_local(local) {}
+          m_fulloutput(fulloutput), m_local(local), m_threads(threads) {}
 };
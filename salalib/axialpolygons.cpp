@@ -3,14 +3,18 @@
 #include "salalib/tolerances.h"
 
 #include "genlib/containerutils.h"
+#include "genlib/parallelutils.h"
 
-AxialVertex AxialPolygons::makeVertex(const AxialVertexKey& vertexkey, const Point2f& openspace)
+#include <algorithm>
+#include <limits>
+
+AxialVertex AxialPolygons::makeVertex(const AxialVertexKey& vertexkey, const Point2f& openspace) const
 {
-   auto vertPossIter = depthmapX::getMapAtIndex(m_vertex_possibles, vertexkey.m_ref_key);
+   auto vertPossIter = m_vertex_possible_index[size_t(vertexkey.m_ref_key)];
    AxialVertex av(vertexkey, vertPossIter->first, openspace);
 
    // n.b., at this point, vertex key m_a and m_b are unfixed
-   std::vector<Point2f>& pointlist = vertPossIter->second;
+   const std::vector<Point2f>& pointlist = vertPossIter->second;
    if (pointlist.size() < 2) {
       return av;
    }
@@ -88,6 +92,7 @@ void AxialPolygons::clear()
 {
    // clear any existing data
    m_vertex_possibles.clear();
+   m_vertex_possible_index.clear();
    m_vertex_polys.clear();
    m_handled_list.clear();
    m_pixel_polys.reset(0,0);
@@ -138,6 +143,7 @@ void AxialPolygons::init(std::vector<Line>& lines, const QtRegion& region)
 void AxialPolygons::makeVertexPossibles(const std::vector<Line>& lines, const std::vector<Connector>& connectionset)
 {
    m_vertex_possibles.clear();
+   m_vertex_possible_index.clear();
    m_vertex_polys.clear();
 
    size_t i = 0;
@@ -192,6 +198,10 @@ void AxialPolygons::makeVertexPossibles(const std::vector<Line>& lines, const st
        sort( possible.second.begin(), possible.second.end() );
        possible.second.erase( unique( possible.second.begin(), possible.second.end() ), possible.second.end() );
    }
+   m_vertex_possible_index.reserve(m_vertex_possibles.size());
+   for (auto iter = m_vertex_possibles.cbegin(); iter != m_vertex_possibles.cend(); ++iter) {
+      m_vertex_possible_index.push_back(iter);
+   }
 
    // three pass operation: (3) create vertex poly entries
    int current_poly = -1;
@@ -202,10 +212,10 @@ void AxialPolygons::makeVertexPossibles(const std::vector<Line>& lines, const st
          addlist.push_back(int(i));
          while (addlist.size()) {
             m_vertex_polys[size_t(addlist.back())] = current_poly;
-            std::vector<Point2f>& connections = depthmapX::getMapAtIndex(m_vertex_possibles, addlist.back())->second;
+            const std::vector<Point2f>& connections = m_vertex_possible_index[size_t(addlist.back())]->second;
             addlist.pop_back();
             for (size_t j = 0; j < connections.size(); j++) {
-               int index = depthmapX::findIndexFromKey(m_vertex_possibles, connections[j]);
+               int index = findVertexPossible(connections[j]);
                if (index == -1) {
                   throw 3;
                }
@@ -218,6 +228,17 @@ void AxialPolygons::makeVertexPossibles(const std::vector<Line>& lines, const st
    }
 }
 
+int AxialPolygons::findVertexPossible(const Point2f& point) const
+{
+   auto iter = std::lower_bound(m_vertex_possible_index.begin(), m_vertex_possible_index.end(), point,
+                                [](std::map<Point2f, std::vector<Point2f>>::const_iterator possible,
+                                   const Point2f& p) { return possible->first < p; });
+   if (iter == m_vertex_possible_index.end() || (*iter)->first != point) {
+      return -1;
+   }
+   return int(std::distance(m_vertex_possible_index.begin(), iter));
+}
+
 void AxialPolygons::makePixelPolys()
 {
    // record all of this onto the pixel polygons
@@ -225,7 +246,7 @@ void AxialPolygons::makePixelPolys()
    m_pixel_polys = depthmapX::ColumnMatrix<std::vector<int>>(m_rows, m_cols);
    // now register the vertices in each pixel...
    int j = -1;
-   for (auto vertPoss: m_vertex_possibles) {
+   for (const auto& vertPoss: m_vertex_possibles) {
       j++;
       PixelRef pix = pixelate(vertPoss.first);
       m_pixel_polys(static_cast<size_t>(pix.y), static_cast<size_t>(pix.x)).push_back(j);
@@ -246,11 +267,12 @@ AxialVertexKey AxialPolygons::seedVertex(const Point2f& seed)
    int sidelength = 1;
    int runlength = 0;
    int allboundaries = 0;
+   LineTestMarks marks;
 
    while (!foundvertex) {
       for (int vertexref: m_pixel_polys(static_cast<size_t>(seedref.y), static_cast<size_t>(seedref.x))) {
-         const Point2f& trialpoint = depthmapX::getMapAtIndex(m_vertex_possibles, vertexref)->first;
-         if (!intersect_exclude(Line(seed,trialpoint))) {
+         const Point2f& trialpoint = m_vertex_possible_index[size_t(vertexref)]->first;
+         if (!intersect_exclude(Line(seed,trialpoint), marks)) {
             // yay... ...but wait... we need to see if it's a proper polygon vertex first...
             seedvertex = vertexref;
             foundvertex = true;
@@ -296,20 +318,86 @@ AxialVertexKey AxialPolygons::seedVertex(const Point2f& seed)
    return seedvertex;
 }
 
-// adds any axial lines from this point to the list of lines, adds any unhandled visible vertices it finds to the openvertices list
+// adds any axial lines from each open vertex to the list of lines, adds any unhandled visible vertices it finds to the openvertices list
 // axial lines themselves are added to the lines list - the axial line is only there to record the key vertices that comprise the line
-void AxialPolygons::makeAxialLines(std::set<AxialVertex>& openvertices, std::vector<Line>& lines,
+void AxialPolygons::makeAxialLines(Communicator *comm, std::set<AxialVertex>& openvertices, std::vector<Line>& lines,
                                    KeyVertices& keyvertices, std::vector<PolyConnector>& poly_connections,
-                                   std::vector<RadialLine>& radial_lines)
+                                   std::vector<RadialLine>& radial_lines, int threads)
 {
-   auto it = openvertices.rbegin();
-   AxialVertex vertex = *it;
-   openvertices.erase(std::next(it).base());
+   time_t atime = 0;
+   int count = 0;
+   if (comm) {
+      qtimer( atime, 0 );
+   }
+
+   // Which vertices a vertex adds depends on which are handled by the time it is handled itself, so the
+   // vertices are still handled one after the other. But every open vertex will be handled sooner or later,
+   // and what it can see does not depend on the others, so when the next one has not been looked at yet,
+   // all the open vertices that have not are looked at together
+   std::vector<LineTestMarks> marks(depthmapX::getThreadCount(threads, std::numeric_limits<size_t>::max()));
+   std::map<AxialVertex, std::vector<VisibleVertex>> looked_at;
+
+   while (!openvertices.empty()) {
+      auto it = std::prev(openvertices.end());
+      AxialVertex vertex = *it;
+      openvertices.erase(it);
+
+      auto visible = looked_at.find(vertex);
+      if (visible == looked_at.end()) {
+         std::vector<AxialVertex> batch(1, vertex);
+         for (const AxialVertex& open: openvertices) {
+            if (looked_at.find(open) == looked_at.end()) {
+               batch.push_back(open);
+            }
+         }
+         std::vector<std::vector<VisibleVertex>> found(batch.size());
+         depthmapX::parallelFor(nullptr, depthmapX::getThreadCount(threads, batch.size()), batch.size(),
+                                [&](size_t i, size_t threadIndex) {
+            findVisibleVertices(batch[i], marks[threadIndex], found[i]);
+         });
+         for (size_t i = 0; i < batch.size(); i++) {
+            looked_at.insert(std::make_pair(batch[i], std::move(found[i])));
+         }
+         visible = looked_at.find(vertex);
+      }
+
+      m_handled_list.insert(vertex);
 
-   m_handled_list.insert(vertex);
+      for (VisibleVertex& next: visible->second) {
+         // the vertex may have been handled since this one was looked at
+         if (m_handled_list.find(next.vertex) != m_handled_list.end()) {
+            continue;
+         }
+         openvertices.insert(next.vertex); // <- note, add ignores duplicate adds (each vertex tends to be added multiple times before this vertex is handled itself)
+         poly_connections.insert(poly_connections.end(), next.poly_connections.begin(), next.poly_connections.end());
+         radial_lines.insert(radial_lines.end(), next.radial_lines.begin(), next.radial_lines.end());
+         if (next.axial) {
+            lines.push_back(next.line);
+            keyvertices.push_back(std::move(next.keyvertices));
+         }
+      }
+      looked_at.erase(visible);
+
+      count++;
+      if (comm) {
+         if (qtimer( atime, 500 )) {
+            if (comm->IsCancelled()) {
+               throw Communicator::CancelledException();
+            }
+            comm->CommPostMessage( Communicator::CURRENT_RECORD, count );
+         }
+      }
+   }
+   // the first of any radial lines with the same key is kept
+   std::stable_sort( radial_lines.begin(), radial_lines.end() );
+   radial_lines.erase( std::unique( radial_lines.begin(), radial_lines.end() ), radial_lines.end() );
+}
 
+void AxialPolygons::findVisibleVertices(const AxialVertex& vertex, LineTestMarks& marks,
+                                        std::vector<VisibleVertex>& visible) const
+{
    int i = -1;
-   for (auto vertPoss: m_vertex_possibles) {
+   for (const auto& vertPoss: m_vertex_possibles) {
       i++;
       if (i == vertex.m_ref_key) {
          continue;
@@ -332,16 +420,18 @@ void AxialPolygons::makeAxialLines(std::set<AxialVertex>& openvertices, std::vec
       }
       if (possible || stubpossible) {
          Line line(vertPoss.first,vertex.m_point);
-         if (!intersect_exclude(line)) {
+         if (!intersect_exclude(line, marks)) {
             AxialVertex next_vertex = makeVertex(AxialVertexKey(i),vertex.m_point);
-            if (next_vertex.m_initialised && std::find(m_handled_list.begin(), m_handled_list.end(), next_vertex) == m_handled_list.end()) {
-               openvertices.insert(next_vertex); // <- note, add ignores duplicate adds (each vertex tends to be added multiple times before this vertex is handled itself)
+            if (next_vertex.m_initialised && m_handled_list.find(next_vertex) == m_handled_list.end()) {
+               visible.emplace_back();
+               VisibleVertex& next = visible.back();
+               next.vertex = next_vertex;
                bool shortline_segend = false;
                Line shortline = line;
                if (!vertex.m_convex && possible) {
                   Line ext(line.t_end(), line.t_end() + (line.t_end() - line.t_start()));
                   ext.ray(1, m_region);
-                  cutLine(ext, 1);
+                  cutLine(ext, 1, marks);
                   line = Line(line.t_start(), ext.t_end());
                   // for radial line segend calc:
                   if (det(-p,vertex.m_b) < 0) {
@@ -351,21 +441,21 @@ void AxialPolygons::makeAxialLines(std::set<AxialVertex>& openvertices, std::vec
                if (m_vertex_polys[vertex.m_ref_key] != m_vertex_polys[next_vertex.m_ref_key]) { // must be on separate polygons
                   // radial line(s) (for new point)
                   RadialLine radialshort(next_vertex, shortline_segend, vertex.m_point,next_vertex.m_point,next_vertex.m_point+next_vertex.m_b);
-                  poly_connections.push_back( PolyConnector(shortline, (RadialKey)radialshort) );
-                  radial_lines.push_back(radialshort);
+                  next.poly_connections.push_back( PolyConnector(shortline, (RadialKey)radialshort) );
+                  next.radial_lines.push_back(radialshort);
                   if (!vertex.m_convex && possible) {
                      Line longline = Line(vertPoss.first,line.t_end());
                      RadialLine radiallong(radialshort);
                      radiallong.segend = shortline_segend ? 0 : 1;
-                     poly_connections.push_back( PolyConnector(longline, (RadialKey)radiallong) );
-                     radial_lines.push_back(radiallong);
+                     next.poly_connections.push_back( PolyConnector(longline, (RadialKey)radiallong) );
+                     next.radial_lines.push_back(radiallong);
                   }
                }
                shortline_segend = false;
                if (!next_vertex.m_convex && next_vertex.m_axial) {
                   Line ext(line.t_start() - (line.t_end() - line.t_start()), line.t_start());
                   ext.ray(0, m_region);
-                  cutLine(ext, 0);
+                  cutLine(ext, 0, marks);
                   line = Line(ext.t_start(), line.t_end());
                   // for radial line segend calc:
                   if (det(p,next_vertex.m_b) < 0) {
@@ -375,33 +465,31 @@ void AxialPolygons::makeAxialLines(std::set<AxialVertex>& openvertices, std::vec
                if (m_vertex_polys[vertex.m_ref_key] != m_vertex_polys[next_vertex.m_ref_key]) { // must be on separate polygons
                   // radial line(s) (for original point)
                   RadialLine radialshort(vertex, shortline_segend, next_vertex.m_point,vertex.m_point,vertex.m_point+vertex.m_b);
-                  poly_connections.push_back( PolyConnector(shortline, (RadialKey)radialshort) );
-                  radial_lines.push_back(radialshort);
+                  next.poly_connections.push_back( PolyConnector(shortline, (RadialKey)radialshort) );
+                  next.radial_lines.push_back(radialshort);
                   if (!next_vertex.m_convex && next_vertex.m_axial) {
                      Line longline = Line(line.t_start(),vertex.m_point);
                      RadialLine radiallong(radialshort);
                      radiallong.segend = shortline_segend ? 0 : 1;
-                     poly_connections.push_back( PolyConnector(longline, (RadialKey)radiallong) );
-                     radial_lines.push_back(radiallong);
+                     next.poly_connections.push_back( PolyConnector(longline, (RadialKey)radiallong) );
+                     next.radial_lines.push_back(radiallong);
                   }
                }
                if (possible && next_vertex.m_axial) {
                   // axial line
-                  lines.push_back(line);
-                  keyvertices.push_back(std::set<int>());
+                  next.axial = true;
+                  next.line = line;
                   if (vertex.m_convex) {
-                     keyvertices.back().insert(vertex.m_ref_key);
+                     next.keyvertices.insert(vertex.m_ref_key);
                   }
                   if (next_vertex.m_convex) {
-                     keyvertices.back().insert(next_vertex.m_ref_key);
+                     next.keyvertices.insert(next_vertex.m_ref_key);
                   }
                }
             }
          }
       }
    }
-   std::sort( radial_lines.begin(), radial_lines.end() );
-   radial_lines.erase( std::unique( radial_lines.begin(), radial_lines.end() ), radial_lines.end() );
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////
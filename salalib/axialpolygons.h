@@ -105,6 +105,22 @@ class AxialPolygons : public SpacePixel
 protected:
    std::vector<int> m_vertex_polys;
    depthmapX::ColumnMatrix<std::vector<int> > m_pixel_polys;
+   // m_vertex_possibles in order, so that a vertex can be looked up by its index without walking the map
+   std::vector<std::map<Point2f, std::vector<Point2f>>::const_iterator> m_vertex_possible_index;
+   int findVertexPossible(const Point2f& point) const;
+
+   // a vertex visible from the one being handled, and what handling that one adds for it
+   struct VisibleVertex {
+      AxialVertex vertex;
+      std::vector<PolyConnector> poly_connections;
+      std::vector<RadialLine> radial_lines;
+      bool axial = false;
+      Line line;
+      std::set<int> keyvertices;
+   };
+   // the vertices visible from vertex that are not yet handled; this only reads the polygons, so
+   // it can be run for several vertices at once with one LineTestMarks each
+   void findVisibleVertices(const AxialVertex& vertex, LineTestMarks& marks, std::vector<VisibleVertex>& visible) const;
 public:
    AxialPolygons(): m_pixel_polys(0,0) {}
    std::set<AxialVertex> m_handled_list;
@@ -115,13 +131,15 @@ public:
    void makeVertexPossibles(const std::vector<Line> &lines, const std::vector<Connector> &connectionset);
    void makePixelPolys();
    //
-   AxialVertex makeVertex(const AxialVertexKey& vertexkey, const Point2f& openspace);
+   AxialVertex makeVertex(const AxialVertexKey& vertexkey, const Point2f& openspace) const;
    // find a polygon corner visible from seed:
    AxialVertexKey seedVertex(const Point2f& seed);
-   // make axial lines from corner vertices, visible from openspace
-   void makeAxialLines(std::set<AxialVertex> &openvertices, std::vector<Line>& lines,
+   // make axial lines from corner vertices, visible from openspace: the open vertices are handled one after
+   // the other, each adding the vertices it can see that are not yet handled, until there are none left.
+   // What each vertex can see is worked out on up to threads threads, ahead of it being handled
+   void makeAxialLines(Communicator *comm, std::set<AxialVertex> &openvertices, std::vector<Line>& lines,
                        KeyVertices &keyvertices, std::vector<PolyConnector>& poly_connections,
-                       std::vector<RadialLine> &radial_lines);
+                       std::vector<RadialLine> &radial_lines, int threads = 1);
    // extra: make all the polygons possible from the set of m_vertex_possibles
    void makePolygons(std::vector<std::vector<Point2f> > &polygons);
 };
@@ -20,6 +20,7 @@
 #include <math.h>
 #include <float.h>
 #include <time.h>
+#include <utility>
 
 ///////////////////////////////////////////////////////////////////////
 
@@ -28,7 +29,7 @@
  
 // This uses BSP trees, and appears to be superfast once the tree is built
 
-void Isovist::makeit(BSPNode *root, const Point2f& p, const QtRegion& region, double startangle, double endangle)
+void Isovist::makeit(const FlatBSPTree& tree, const Point2f& p, const QtRegion& region, double startangle, double endangle)
 {
    // region is used to give an idea of scale, so isovists can be linked when there is floating point error
    double tolerance = std::max(region.width(),region.height()) * 1e-9;
@@ -57,7 +58,7 @@ void Isovist::makeit(BSPNode *root, const Point2f& p, const QtRegion& region, do
       m_gaps.insert(IsoSeg(startangle,endangle));
    }
 
-   make(root);
+   make(tree);
 
    // now it is constructed, make the isovist polygon:
    m_poly.clear();
@@ -119,7 +120,7 @@ void Isovist::makeit(BSPNode *root, const Point2f& p, const QtRegion& region, do
    }
 }
 
-int Isovist::getClosestLine(BSPNode *root, const Point2f& p)
+int Isovist::getClosestLine(const FlatBSPTree& tree, const Point2f& p)
 {
    m_centre = p;
    m_blocks.clear();
@@ -127,7 +128,7 @@ int Isovist::getClosestLine(BSPNode *root, const Point2f& p)
 
    m_gaps.insert(IsoSeg(0.0,2.0*M_PI));
 
-   make(root);
+   make(tree);
 
    int mintag = -1;
    double mindist = 0.0;
@@ -143,23 +144,33 @@ int Isovist::getClosestLine(BSPNode *root, const Point2f& p)
    return mintag;
 }
 
-void Isovist::make(BSPNode *here)
+// Visits the tree front to back from the centre: the side of each node the centre is on,
+// then the node itself, then the far side, stopping once there are no gaps left to fill
+void Isovist::make(const FlatBSPTree& tree)
 {
-   if (m_gaps.size()) {
-      int which = here->classify(m_centre);
-      if (which == BSPNode::BSPLEFT) {
-         if (here->m_left.get())
-            make(here->m_left.get());
-         drawnode(here->getLine(),here->getTag());
-         if (here->m_right)
-            make(here->m_right.get());
+   if (tree.empty()) {
+      return;
+   }
+   m_stack.clear();
+   m_stack.push_back(tree.root());
+   while (!m_stack.empty()) {
+      int here = m_stack.back();
+      m_stack.pop_back();
+      if (here < 0) {
+         here = ~here;
+         drawnode(tree.getLine(here),tree.getTag(here));
+         continue;
       }
-      else {
-         if (here->m_right.get())
-            make(here->m_right.get());
-         drawnode(here->getLine(),here->getTag());
-         if (here->m_left)
-            make(here->m_left.get());
+      if (m_gaps.size()) {
+         int nearSide = tree.left(here), farSide = tree.right(here);
+         if (tree.classify(here, m_centre) != FlatBSPTree::BSPLEFT) {
+            std::swap(nearSide, farSide);
+         }
+         if (farSide != FlatBSPTree::NO_CHILD)
+            m_stack.push_back(farSide);
+         m_stack.push_back(~here);
+         if (nearSide != FlatBSPTree::NO_CHILD)
+            m_stack.push_back(nearSide);
       }
    }
 }
@@ -268,6 +279,11 @@ void Isovist::addBlock(const Line& li, int tag, double startangle, double endang
 }
 
 void Isovist::setData(AttributeTable& table, AttributeRow& row, bool simple_version)
+{
+   getData().write(table, row, simple_version);
+}
+
+IsovistData Isovist::getData()
 {
    // the area / centre of gravity calculation is a duplicate of the SalaPolygon version,
    // included here for general information about the isovist
@@ -305,31 +321,45 @@ void Isovist::setData(AttributeTable& table, AttributeRow& row, bool simple_vers
    driftvec.normalise();
    double driftang = driftvec.angle();
    //
+   IsovistData data;
+   data.area = float(area);
+   data.compactness = float(4.0 * M_PI * area / (m_perimeter*m_perimeter));
+   data.drift_angle = float(180.0*driftang/M_PI);
+   data.drift_magnitude = float(driftmag);
+   data.min_radial = float(m_min_radial);
+   data.max_radial = float(m_max_radial);
+   data.occlusivity = float(m_occluded_perimeter);
+   data.perimeter = float(m_perimeter);
+   return data;
+}
+
+void IsovistData::write(AttributeTable& table, AttributeRow& row, bool simple_version) const
+{
    int col = table.getOrInsertColumn("Isovist Area");
-   row.setValue(col, float(area));
+   row.setValue(col, area);
 
 
    if(!simple_version) {
        col = table.getOrInsertColumn("Isovist Compactness");
-       row.setValue(col, float(4.0 * M_PI * area / (m_perimeter*m_perimeter)));
+       row.setValue(col, compactness);
 
        col = table.getOrInsertColumn("Isovist Drift Angle");
-       row.setValue(col, float(180.0*driftang/M_PI));
+       row.setValue(col, drift_angle);
 
        col = table.getOrInsertColumn("Isovist Drift Magnitude");
-       row.setValue(col, float(driftmag));
+       row.setValue(col, drift_magnitude);
 
        col = table.getOrInsertColumn("Isovist Min Radial");
-       row.setValue(col, float(m_min_radial));
+       row.setValue(col, min_radial);
 
        col = table.getOrInsertColumn("Isovist Max Radial");
-       row.setValue(col, float(m_max_radial));
+       row.setValue(col, max_radial);
 
        col = table.getOrInsertColumn("Isovist Occlusivity");
-       row.setValue(col, float(m_occluded_perimeter));
+       row.setValue(col, occlusivity);
 
        col = table.getOrInsertColumn("Isovist Perimeter");
-       row.setValue(col, float(m_perimeter));
+       row.setValue(col, perimeter);
    }
 
 }
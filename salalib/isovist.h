@@ -53,6 +53,20 @@ inline bool operator < (const IsoSeg& b1, const IsoSeg& b2)
 
 class AttributeTable;
 
+// the measures of an isovist, as they go into the attribute table
+struct IsovistData
+{
+   float area;
+   float compactness;
+   float drift_angle;
+   float drift_magnitude;
+   float min_radial;
+   float max_radial;
+   float occlusivity;
+   float perimeter;
+   void write(AttributeTable &table, AttributeRow &row, bool simple_version) const;
+};
+
 struct PointDist {
    Point2f m_point;
    double m_dist;
@@ -72,17 +86,21 @@ protected:
    double m_occluded_perimeter;
    double m_max_radial;
    double m_min_radial;
+   // node indices still to visit in make(), with the nodes waiting to be drawn stored as ~index
+   std::vector<int> m_stack;
 public:
    Isovist() {;}
    const std::vector<Point2f>& getPolygon() const { return m_poly; }
    const std::vector<PointDist>& getOcclusionPoints() const { return m_occlusion_points; }
    const Point2f& getCentre() const { return m_centre; }
    //
-   void makeit(BSPNode *root, const Point2f& p, const QtRegion& region, double startangle = 0.0, double endangle = 0.0);
-   void make(BSPNode *here);
+   // the tree is only read, so any number of isovists can be made from it at once
+   void makeit(const FlatBSPTree& tree, const Point2f& p, const QtRegion& region, double startangle = 0.0, double endangle = 0.0);
+   void make(const FlatBSPTree& tree);
    void drawnode(const Line& li, int tag);
    void addBlock(const Line& li, int tag, double startangle, double endangle);
+   IsovistData getData();
    void setData(AttributeTable &table, AttributeRow &row, bool simple_version);
    //
-   int getClosestLine(BSPNode *root, const Point2f& p);
+   int getClosestLine(const FlatBSPTree& tree, const Point2f& p);
 };
@@ -8,7 +8,8 @@
 // convert line layers to an axial map
 
 std::unique_ptr<ShapeGraph> MapConverter::convertDrawingToAxial(Communicator *comm, const std::string& name,
-                                                                const std::vector<SpacePixelFile> &drawingFiles)
+                                                                const std::vector<SpacePixelFile> &drawingFiles,
+                                                                int threadCount)
 {
     if (comm) {
         comm->CommPostMessage( Communicator::NUM_STEPS, 2 );
@@ -81,7 +82,7 @@ std::unique_ptr<ShapeGraph> MapConverter::convertDrawingToAxial(Communicator *co
         usermap->makeLineShape(line.second.first, false, false, layerAttributes );
     }
 
-    usermap->makeConnections();
+    usermap->makeConnections(KeyVertices(), threadCount);
 
     return usermap;
 }
@@ -90,7 +91,7 @@ std::unique_ptr<ShapeGraph> MapConverter::convertDrawingToAxial(Communicator *co
 // note that actually should be able to merge this code with the line layers, now both use similar code
 
 std::unique_ptr<ShapeGraph> MapConverter::convertDataToAxial(Communicator *comm, const std::string& name,
-                                                             ShapeMap& shapemap, bool copydata)
+                                                             ShapeMap& shapemap, bool copydata, int threadCount)
 {
    if (comm) {
       comm->CommPostMessage( Communicator::NUM_STEPS, 2 );
@@ -188,7 +189,7 @@ std::unique_ptr<ShapeGraph> MapConverter::convertDataToAxial(Communicator *comm,
 
    // n.b. make connections also initialises attributes
 
-   usermap->makeConnections();
+   usermap->makeConnections(KeyVertices(), threadCount);
 
    // if we are inheriting from a mapinfo map, pass on the coordsys and bounds:
    if (shapemap.hasMapInfoData()) {
@@ -483,16 +484,16 @@ std::unique_ptr<ShapeGraph> MapConverter::convertDataToSegment(Communicator *com
 // stubremoval is fraction of overhanging line length before axial "stub" is removed
 std::unique_ptr<ShapeGraph> MapConverter::convertAxialToSegment(Communicator *, ShapeGraph& axialMap,
                                                                 const std::string& name, bool keeporiginal,
-                                                                bool copydata, double stubremoval)
+                                                                bool copydata, double stubremoval, int threadCount)
 {
     std::vector<Line> lines;
     std::vector<Connector> connectionset;
 
-    axialMap.makeSegmentMap(lines, connectionset, stubremoval);
+    axialMap.makeSegmentMap(lines, connectionset, stubremoval, threadCount);
 
     // destroy unnecessary parts of axial map as quickly as possible in order not to overload memory
     if (!keeporiginal) {
-       axialMap.getAllShapes().clear();
+       axialMap.clearShapes();
        axialMap.getConnections().clear();
     }
 
@@ -7,10 +7,13 @@
 
 namespace MapConverter {
 
+// the conversions to axial and from axial to segment maps make the connections between the lines
+// on up to threadCount threads (0 or less for as many as the hardware offers)
 std::unique_ptr<ShapeGraph> convertDrawingToAxial(Communicator *comm, const std::string& name,
-                                                  const std::vector<SpacePixelFile> &drawingFiles);
+                                                  const std::vector<SpacePixelFile> &drawingFiles,
+                                                  int threadCount = 1);
 std::unique_ptr<ShapeGraph> convertDataToAxial(Communicator *comm, const std::string& name,
-                                               ShapeMap& shapemap, bool copydata = false);
+                                               ShapeMap& shapemap, bool copydata = false, int threadCount = 1);
 std::unique_ptr<ShapeGraph> convertDrawingToConvex(Communicator *, const std::string& name,
                                                    const std::vector<SpacePixelFile> &drawingFiles);
 std::unique_ptr<ShapeGraph> convertDataToConvex(Communicator *, const std::string& name,
@@ -21,6 +24,7 @@ std::unique_ptr<ShapeGraph> convertDataToSegment(Communicator *comm, const std::
                                                  ShapeMap& shapemap, bool copydata = false);
 std::unique_ptr<ShapeGraph> convertAxialToSegment(Communicator *, ShapeGraph& axialMap,
                                                   const std::string& name, bool keeporiginal = true,
-                                                  bool pushvalues = false, double stubremoval = 0.0);
+                                                  bool pushvalues = false, double stubremoval = 0.0,
+                                                  int threadCount = 1);
 
 }
@@ -53,6 +53,7 @@
 #include "genlib/pafmath.h"
 #include "genlib/p2dpoly.h"
 #include "genlib/comm.h"
+#include "genlib/parallelutils.h"
 
 #include "math.h"
 #include "time.h"
@@ -74,16 +75,10 @@ MetaGraph::MetaGraph(std::string name)
 
    // bsp tree for making isovists:
    m_bsp_tree = false;
-   m_bsp_root = NULL;
 }
 
 MetaGraph::~MetaGraph()
 {
-   if (m_bsp_root) {
-      delete m_bsp_root;
-      m_bsp_root = NULL;
-   }
-   m_bsp_tree = false;
 }
 
 QtRegion MetaGraph::getBoundingBox() const
@@ -261,7 +256,7 @@ bool MetaGraph::clearPoints()
    return b_return;
 }
 
-bool MetaGraph::makeGraph( Communicator *communicator, int algorithm, double maxdist )
+bool MetaGraph::makeGraph( Communicator *communicator, int algorithm, double maxdist, int threadCount )
 {
    // this is essentially a version tag, and remains for historical reasons:
    m_state |= ANGULARGRAPH;
@@ -270,7 +265,7 @@ bool MetaGraph::makeGraph( Communicator *communicator, int algorithm, double max
    
    try {
       // algorithm is now used for boundary graph option (as a simple boolean)
-      graphMade = getDisplayedPointMap().sparkGraph2(communicator, (algorithm != 0), maxdist);
+      graphMade = getDisplayedPointMap().sparkGraph2(communicator, (algorithm != 0), maxdist, threadCount);
    } 
    catch (Communicator::CancelledException) {
       graphMade = false;
@@ -283,6 +278,24 @@ bool MetaGraph::makeGraph( Communicator *communicator, int algorithm, double max
    return graphMade;
 }
 
+bool MetaGraph::updateGraph( Communicator *communicator, const std::vector<Line>& changedLines, double maxdist, int threadCount )
+{
+   bool graphUpdated = false;
+
+   try {
+      graphUpdated = getDisplayedPointMap().updateGraph(communicator, changedLines, maxdist, threadCount);
+   }
+   catch (Communicator::CancelledException) {
+      graphUpdated = false;
+   }
+
+   if (graphUpdated) {
+      setViewClass(SHOWVGATOP);
+   }
+
+   return graphUpdated;
+}
+
 bool MetaGraph::unmakeGraph(bool removeLinks)
 {
    bool graphUnmade = getDisplayedPointMap().unmake(removeLinks);
@@ -326,14 +339,14 @@ bool MetaGraph::analyseGraph( Communicator *communicator, Options options , bool
       }
       else if (options.point_depth_selection == 2) {
          if (m_view_class & VIEWVGA) {
-             analysisCompleted = VGAMetricDepth().run(communicator, getDisplayedPointMap(), false);
+             analysisCompleted = VGAMetricDepth(options.traversal_queue == Options::QUEUE_SET).run(communicator, getDisplayedPointMap(), false);
          }
          else if (m_view_class & VIEWAXIAL && getDisplayedShapeGraph().isSegmentMap()) {
              analysisCompleted = SegmentMetricPD().run(communicator, getDisplayedShapeGraph(), false);
          }
       }
       else if (options.point_depth_selection == 3) {
-          analysisCompleted = VGAAngularDepth().run(communicator, getDisplayedPointMap(), false);
+          analysisCompleted = VGAAngularDepth(options.traversal_queue == Options::QUEUE_SET).run(communicator, getDisplayedPointMap(), false);
       }
       else if (options.point_depth_selection == 4) {
          if (m_view_class & VIEWVGA) {
@@ -344,7 +357,9 @@ bool MetaGraph::analyseGraph( Communicator *communicator, Options options , bool
          }
       }
       else if (options.output_type == Options::OUTPUT_ISOVIST) {
-         analysisCompleted = VGAIsovist().run(communicator, getDisplayedPointMap(), simple_version);
+         // the isovists share the tree with makeIsovist, if there is anything to make it from
+         const FlatBSPTree *tree = makeBSPtree(communicator) ? &m_bsp_nodes : NULL;
+         analysisCompleted = VGAIsovist(options.thread_count, tree).run(communicator, getDisplayedPointMap(), simple_version);
       }
       else if (options.output_type == Options::OUTPUT_VISUAL) {
           bool localResult = true;
@@ -353,15 +368,15 @@ bool MetaGraph::analyseGraph( Communicator *communicator, Options options , bool
               localResult = VGAVisualLocal(options.gates_only).run(communicator, getDisplayedPointMap(), simple_version);
           }
           if (options.global) {
-              globalResult = VGAVisualGlobal(options.radius, options.gates_only).run(communicator, getDisplayedPointMap(), simple_version);
+              globalResult = VGAVisualGlobal(options.radius, options.gates_only, options.thread_count, options.multi_source_bfs).run(communicator, getDisplayedPointMap(), simple_version);
           }
           analysisCompleted = globalResult & localResult;
       }
       else if (options.output_type == Options::OUTPUT_METRIC) {
-          analysisCompleted = VGAMetric(options.radius, options.gates_only).run(communicator, getDisplayedPointMap(), simple_version);
+          analysisCompleted = VGAMetric(options.radius, options.gates_only, options.thread_count, options.traversal_queue == Options::QUEUE_SET).run(communicator, getDisplayedPointMap(), simple_version);
       }
       else if (options.output_type == Options::OUTPUT_ANGULAR) {
-          analysisCompleted = VGAAngular(options.radius, options.gates_only).run(communicator, getDisplayedPointMap(), simple_version);
+          analysisCompleted = VGAAngular(options.radius, options.gates_only, options.thread_count, options.traversal_queue == Options::QUEUE_SET).run(communicator, getDisplayedPointMap(), simple_version);
       }
       else if (options.output_type == Options::OUTPUT_THRU_VISION) {
           analysisCompleted = VGAThroughVision().run(communicator, getDisplayedPointMap(), simple_version);
@@ -495,31 +510,63 @@ int MetaGraph::makeIsovist(Communicator *communicator, const Point2f& p, double
    Isovist iso;
 
    if (makeBSPtree(communicator)) {
-      m_view_class &= ~VIEWDATA;
-      isovistMade = 1;
-      iso.makeit(m_bsp_root, p, m_region, startangle, endangle);
-      int shapelayer = getMapRef(m_dataMaps, "Isovists");
-      if (shapelayer == -1) {
-         m_dataMaps.emplace_back("Isovists",ShapeMap::DATAMAP);
-         setDisplayedDataMapRef(m_dataMaps.size() - 1);
-         shapelayer = m_dataMaps.size() - 1;
-         m_state |= DATAMAPS;
-         isovistMade = 2;
-      }
-      ShapeMap& map = m_dataMaps[shapelayer];
-      // false: closed polygon, true: isovist
-      int polyref = map.makePolyShape(iso.getPolygon(),false);  
-      map.getAllShapes()[polyref].setCentroid(p);
-      map.overrideDisplayedAttribute(-2);
-      map.setDisplayedAttribute(-1);
-      setViewClass(SHOWSHAPETOP);
-      AttributeTable& table = map.getAttributeTable();
-      AttributeRow& row = table.getRow(AttributeKey(polyref));
-      iso.setData(table,row, simple_version);
+      iso.makeit(m_bsp_nodes, p, m_region, startangle, endangle);
+      isovistMade = addIsovist(iso, simple_version);
    }
    return isovistMade;
 }
 
+// The batch version: the isovists only read the BSP tree, so they are all made at once on
+// threadCount threads (0 = one per core), and then added to the isovist layer in order
+
+int MetaGraph::makeIsovists(Communicator *communicator, const std::vector<IsovistDefinition>& isovists, bool simple_version, int threadCount)
+{
+   int isovistsMade = 0;
+
+   if (makeBSPtree(communicator)) {
+      std::vector<Isovist> isos(isovists.size());
+      if (communicator) {
+         communicator->CommPostMessage( Communicator::NUM_RECORDS, int(isovists.size()) );
+      }
+      depthmapX::parallelFor(communicator, depthmapX::getThreadCount(threadCount, isovists.size()), isovists.size(),
+                             [&](size_t index, size_t) {
+         const IsovistDefinition& isovist = isovists[index];
+         isos[index].makeit(m_bsp_nodes, isovist.getLocation(), m_region, isovist.getLeftAngle(), isovist.getRightAngle());
+      });
+      for (Isovist& iso: isos) {
+         isovistsMade = std::max(isovistsMade, addIsovist(iso, simple_version));
+      }
+   }
+   return isovistsMade;
+}
+
+// adds a made isovist to the isovist layer:
+// returns 1: added, 2: added to a new shapemap layer
+int MetaGraph::addIsovist(Isovist& iso, bool simple_version)
+{
+   m_view_class &= ~VIEWDATA;
+   int isovistMade = 1;
+   int shapelayer = getMapRef(m_dataMaps, "Isovists");
+   if (shapelayer == -1) {
+      m_dataMaps.emplace_back("Isovists",ShapeMap::DATAMAP);
+      setDisplayedDataMapRef(m_dataMaps.size() - 1);
+      shapelayer = m_dataMaps.size() - 1;
+      m_state |= DATAMAPS;
+      isovistMade = 2;
+   }
+   ShapeMap& map = m_dataMaps[shapelayer];
+   // false: closed polygon, true: isovist
+   int polyref = map.makePolyShape(iso.getPolygon(),false);  
+   map.getAllShapes()[polyref].setCentroid(iso.getCentre());
+   map.overrideDisplayedAttribute(-2);
+   map.setDisplayedAttribute(-1);
+   setViewClass(SHOWSHAPETOP);
+   AttributeTable& table = map.getAttributeTable();
+   AttributeRow& row = table.getRow(AttributeKey(polyref));
+   iso.setData(table,row, simple_version);
+   return isovistMade;
+}
+
 static std::pair<double,double> startendangle( Point2f vec, double fov)
 {
    std::pair<double,double> angles;
@@ -590,7 +637,7 @@ int MetaGraph::makeIsovistPath(Communicator *communicator, double fov, bool simp
                if (fov < 2.0 * M_PI) {
                   angles = startendangle(vec, fov);
                }
-               iso.makeit(m_bsp_root, start, m_region, angles.first, angles.second);
+               iso.makeit(m_bsp_nodes, start, m_region, angles.first, angles.second);
                int polyref = isovists->makePolyShape(iso.getPolygon(),false);  
                isovists->getAllShapes()[polyref].setCentroid(start);
                AttributeTable& table = isovists->getAttributeTable();
@@ -605,7 +652,7 @@ int MetaGraph::makeIsovistPath(Communicator *communicator, double fov, bool simp
                   if (fov < 2.0 * M_PI) {
                      angles = startendangle(vec, fov);
                   }
-                  iso.makeit(m_bsp_root, start, m_region, angles.first, angles.second);
+                  iso.makeit(m_bsp_nodes, start, m_region, angles.first, angles.second);
                   int polyref = isovists->makePolyShape(iso.getPolygon(),false);  
                   isovists->getAllShapes().find(polyref)->second.setCentroid(start);
                   AttributeTable& table = isovists->getAttributeTable();
@@ -628,7 +675,7 @@ int MetaGraph::makeIsovistPath(Communicator *communicator, double fov, bool simp
 bool MetaGraph::makeIsovist(const Point2f& p, Isovist& iso)
 {
    if (makeBSPtree()) {
-      iso.makeit(m_bsp_root, p, m_region);
+      iso.makeit(m_bsp_nodes, p, m_region);
       return true;
    }
    return false;
@@ -667,11 +714,7 @@ bool MetaGraph::makeBSPtree(Communicator *communicator)
       //
       // Now we'll try the BSP tree:
       //
-      if (m_bsp_root) {
-         delete m_bsp_root;
-         m_bsp_root = NULL;
-      }
-      m_bsp_root = new BSPNode();
+      m_bsp_nodes = FlatBSPTree();
 
       time_t atime = 0;
       if (communicator) {
@@ -680,14 +723,12 @@ bool MetaGraph::makeBSPtree(Communicator *communicator)
       }
 
       try {
-         BSPTree::make(communicator,atime,partitionlines,m_bsp_root);
+         m_bsp_nodes = BSPTree::make(communicator,atime,partitionlines,m_bsp_options);
          m_bsp_tree = true;
       } 
       catch (Communicator::CancelledException) {
+         // the half made tree is never kept
          m_bsp_tree = false;
-         // probably best to delete the half made bastard of a tree:
-         delete m_bsp_root;
-         m_bsp_root = NULL;
       }
    }
 
@@ -759,7 +800,7 @@ void MetaGraph::removeDisplayedMap()
 //////////////////////////////////////////////////////////////////
 
 
-bool MetaGraph::convertDrawingToAxial(Communicator *comm, std::string layer_name)
+bool MetaGraph::convertDrawingToAxial(Communicator *comm, std::string layer_name, int threadCount)
 {
    int oldstate = m_state;
 
@@ -768,7 +809,7 @@ bool MetaGraph::convertDrawingToAxial(Communicator *comm, std::string layer_name
    bool converted = true;
    
    try {
-      auto shapeGraph = MapConverter::convertDrawingToAxial( comm, layer_name, m_drawingFiles );
+      auto shapeGraph = MapConverter::convertDrawingToAxial( comm, layer_name, m_drawingFiles, threadCount );
       int mapref = addShapeGraph(shapeGraph);
       setDisplayedShapeGraphRef(mapref);
    } 
@@ -786,7 +827,7 @@ bool MetaGraph::convertDrawingToAxial(Communicator *comm, std::string layer_name
    return converted;
 }
 
-bool MetaGraph::convertDataToAxial(Communicator *comm, std::string layer_name, bool keeporiginal, bool pushvalues)
+bool MetaGraph::convertDataToAxial(Communicator *comm, std::string layer_name, bool keeporiginal, bool pushvalues, int threadCount)
 {
    int oldstate = m_state;
 
@@ -795,7 +836,7 @@ bool MetaGraph::convertDataToAxial(Communicator *comm, std::string layer_name, b
    bool converted = true;
    
    try {
-       auto shapeGraph = MapConverter::convertDataToAxial( comm, layer_name, getDisplayedDataMap(), pushvalues );
+       auto shapeGraph = MapConverter::convertDataToAxial( comm, layer_name, getDisplayedDataMap(), pushvalues, threadCount );
        addShapeGraph(shapeGraph);
 
        m_shapeGraphs.back()->overrideDisplayedAttribute(-2); // <- override if it's already showing
@@ -1090,7 +1131,7 @@ bool MetaGraph::convertToDrawing(Communicator *, std::string layer_name, bool fr
    return converted;
 }
 
-bool MetaGraph::convertAxialToSegment(Communicator *comm, std::string layer_name, bool keeporiginal, bool pushvalues, double stubremoval)
+bool MetaGraph::convertAxialToSegment(Communicator *comm, std::string layer_name, bool keeporiginal, bool pushvalues, double stubremoval, int threadCount)
 {
    int oldstate = m_state;
 
@@ -1107,7 +1148,7 @@ bool MetaGraph::convertAxialToSegment(Communicator *comm, std::string layer_name
 
        auto shapeGraph = MapConverter::convertAxialToSegment(comm, getDisplayedShapeGraph(),
                                                              layer_name, keeporiginal,
-                                                             pushvalues, stubremoval);
+                                                             pushvalues, stubremoval, threadCount);
        addShapeGraph(shapeGraph);
 
        m_shapeGraphs.back()->overrideDisplayedAttribute(-2); // <- override if it's already showing
@@ -1170,7 +1211,7 @@ int MetaGraph::loadMifMap(Communicator *comm, std::istream& miffile, std::istrea
    return mapLoaded;
 }  
 
-bool MetaGraph::makeAllLineMap( Communicator *communicator, const Point2f& seed )
+bool MetaGraph::makeAllLineMap( Communicator *communicator, const Point2f& seed, int threadCount )
 {
    int oldstate = m_state;
    m_state &= ~SHAPEGRAPHS;      // Clear axial map data flag (stops accidental redraw during reload)
@@ -1186,7 +1227,8 @@ bool MetaGraph::makeAllLineMap( Communicator *communicator, const Point2f& seed
           m_all_line_map = -1;
        }
 
-      m_shapeGraphs.push_back(std::unique_ptr<AllLineMap>(new AllLineMap(communicator, m_drawingFiles, seed)));
+      m_shapeGraphs.push_back(std::unique_ptr<AllLineMap>(new AllLineMap(communicator, m_drawingFiles, seed,
+                                                                              "All-Line Map", threadCount)));
 
       m_all_line_map = int(m_shapeGraphs.size() - 1);
       setDisplayedShapeGraphRef(m_all_line_map);
@@ -1206,7 +1248,7 @@ bool MetaGraph::makeAllLineMap( Communicator *communicator, const Point2f& seed
 }
 
 
-bool MetaGraph::makeFewestLineMap( Communicator *communicator, int replace )
+bool MetaGraph::makeFewestLineMap( Communicator *communicator, int replace, unsigned int seed, int threadCount )
 {
    int oldstate= m_state;
    m_state &= ~SHAPEGRAPHS;      // Clear axial map data flag (stops accidental redraw during reload) 
@@ -1227,7 +1269,7 @@ bool MetaGraph::makeFewestLineMap( Communicator *communicator, int replace )
 
        // waiting for C++17...
        std::unique_ptr<ShapeGraph> fewestlinemap_subsets, fewestlinemap_minimal;
-       std::tie(fewestlinemap_subsets, fewestlinemap_minimal) = alllinemap->extractFewestLineMaps(communicator);
+       std::tie(fewestlinemap_subsets, fewestlinemap_minimal) = alllinemap->extractFewestLineMaps(communicator, seed, threadCount);
 
        if (replace != 0) {
            int index = -1;
@@ -1282,7 +1324,7 @@ bool MetaGraph::analyseAxial( Communicator *communicator, Options options, bool
 
    try {
        analysisCompleted = AxialIntegration(options.radius_set, options.weighted_measure_col, options.choice, options.fulloutput,
-                        options.local)
+                        options.local, options.thread_count)
            .run(communicator, getDisplayedShapeGraph(), false);
    } 
    catch (Communicator::CancelledException) {
@@ -1302,7 +1344,7 @@ bool MetaGraph::analyseSegmentsTulip( Communicator *communicator, Options option
 
    try {
        analysisCompleted = SegmentTulip(options.radius_set, options.sel_only, options.tulip_bins, options.weighted_measure_col,
-                    options.radius_type, options.choice)
+                    options.radius_type, options.choice, false, -1, -1, options.thread_count)
            .run(communicator, getDisplayedShapeGraph(), false);
    }
    catch (Communicator::CancelledException) {
@@ -1340,14 +1382,11 @@ bool MetaGraph::analyseTopoMetMultipleRadii( Communicator *communicator, Options
 
    try {
       // note: "output_type" reused for analysis type (either 0 = topological or 1 = metric)
-      for(size_t r = 0; r < options.radius_set.size(); r++) {
-          if(options.output_type == 0) {
-              if(!SegmentTopological(options.radius, options.sel_only).run(communicator, getDisplayedShapeGraph(), false))
-                  analysisCompleted = false;
-          } else {
-              if(!SegmentMetric(options.radius, options.sel_only).run(communicator, getDisplayedShapeGraph(), false))
-                  analysisCompleted = false;
-          }
+      // all the radii are done in the same pass
+      if(options.output_type == 0) {
+          analysisCompleted = SegmentTopological(options.radius_set, options.sel_only).run(communicator, getDisplayedShapeGraph(), false);
+      } else {
+          analysisCompleted = SegmentMetric(options.radius_set, options.sel_only).run(communicator, getDisplayedShapeGraph(), false);
       }
    }
    catch (Communicator::CancelledException) {
@@ -1392,10 +1431,7 @@ int MetaGraph::loadLineData( Communicator *communicator, int load_type )
    m_state &= ~LINEDATA;      // Clear line data flag (stops accidental redraw during reload) 
 
    // if bsp tree exists 
-   if (m_bsp_root) {
-      delete m_bsp_root;
-      m_bsp_root = NULL;
-   }
+   m_bsp_nodes = FlatBSPTree();
    m_bsp_tree = false;
 
    if (load_type & REPLACE) {
@@ -2494,10 +2530,7 @@ int MetaGraph::readFromStream( std::istream &stream, const std::string& filename
    m_state = 0;   // <- clear the state out
 
    // clear BSP tree if it exists:
-   if (m_bsp_root) {
-      delete m_bsp_root;
-      m_bsp_root = NULL;
-   }
+   m_bsp_nodes = FlatBSPTree();
    m_bsp_tree = false;
 
    char header[3];
@@ -33,6 +33,7 @@
 #include "salalib/shapemap.h"
 #include "salalib/pointdata.h"
 #include "salalib/axialmap.h"
+#include "salalib/isovistdef.h"
 
 
 #include "genlib/p2dpoly.h"
@@ -154,7 +155,9 @@ public:
    bool clearPoints();
    bool setGrid( double spacing, const Point2f& offset = Point2f() );                 // override of PointMap
    bool makePoints( const Point2f& p, int semifilled, Communicator *communicator = NULL);  // override of PointMap
-   bool makeGraph( Communicator *communicator, int algorithm, double maxdist );
+   bool makeGraph( Communicator *communicator, int algorithm, double maxdist, int threadCount = 1 );
+   // brings the graph up to date after changedLines and the points filled or emptied since it was made
+   bool updateGraph( Communicator *communicator, const std::vector<Line>& changedLines, double maxdist, int threadCount = 1 );
    bool unmakeGraph(bool removeLinks);
    bool analyseGraph(Communicator *communicator, Options options , bool simple_version); // <- options copied to keep thread safe
    //
@@ -176,17 +179,20 @@ public:
    void removeDisplayedMap();
    //
    // various map conversions
-   bool convertDrawingToAxial(Communicator *comm, std::string layer_name);  // n.b., name copied for thread safety
-   bool convertDataToAxial(Communicator *comm, std::string layer_name, bool keeporiginal, bool pushvalues);
+   // the conversions to axial and from axial to segment make the connections on up to threadCount threads
+   bool convertDrawingToAxial(Communicator *comm, std::string layer_name, int threadCount = 1);  // n.b., name copied for thread safety
+   bool convertDataToAxial(Communicator *comm, std::string layer_name, bool keeporiginal, bool pushvalues, int threadCount = 1);
    bool convertDrawingToSegment(Communicator *comm, std::string layer_name);
    bool convertDataToSegment(Communicator *comm, std::string layer_name, bool keeporiginal, bool pushvalues);
    bool convertToData(Communicator *, std::string layer_name, bool keeporiginal, int shapeMapType, bool copydata);
    bool convertToDrawing(Communicator *, std::string layer_name, bool fromDisplayedDataMap);
    bool convertToConvex(Communicator *comm, std::string layer_name, bool keeporiginal, int shapeMapType, bool copydata);
-   bool convertAxialToSegment(Communicator *comm, std::string layer_name, bool keeporiginal, bool pushvalues, double stubremoval);
+   bool convertAxialToSegment(Communicator *comm, std::string layer_name, bool keeporiginal, bool pushvalues, double stubremoval, int threadCount = 1);
    int loadMifMap(Communicator *comm, std::istream& miffile, std::istream& midfile);
-   bool makeAllLineMap( Communicator *communicator, const Point2f& seed );
-   bool makeFewestLineMap( Communicator *communicator, int replace );
+   // the lines seen from each corner and the connections between them are found on up to threadCount threads
+   bool makeAllLineMap( Communicator *communicator, const Point2f& seed, int threadCount = 1 );
+   // seed 0 takes lines that rank the same in line order, see AllLineMap::extractFewestLineMaps
+   bool makeFewestLineMap( Communicator *communicator, int replace, unsigned int seed = 0, int threadCount = 1 );
    bool analyseAxial(Communicator *communicator, Options options, bool); // <- options copied to keep thread safe
    bool analyseSegmentsTulip( Communicator *communicator, Options options ); // <- options copied to keep thread safe
    bool analyseSegmentsAngular( Communicator *communicator, Options options ); // <- options copied to keep thread safe
@@ -468,17 +474,24 @@ public:
    bool analyseThruVision(Communicator *comm = NULL, int gatelayer = -1);
    // BSP tree for making isovists
 protected:
-   BSPNode *m_bsp_root;
+   FlatBSPTree m_bsp_nodes;
    bool m_bsp_tree;
+   BSPTree::BuildOptions m_bsp_options;
 public:
    bool makeBSPtree(Communicator *communicator = NULL);
    void resetBSPtree() { m_bsp_tree = false; }
+   // how the tree is made the next time it is needed
+   void setBSPOptions(const BSPTree::BuildOptions& options)
+   { if (options != m_bsp_options) { m_bsp_options = options; m_bsp_tree = false; } }
    // returns 0: fail, 1: made isovist, 2: made isovist and added new shapemap layer
    int makeIsovist(Communicator *communicator, const Point2f& p, double startangle = 0, double endangle = 0, bool simple_version = true);
+   // the same for a batch of isovists, made on threadCount threads (0 = one per core)
+   int makeIsovists(Communicator *communicator, const std::vector<IsovistDefinition>& isovists, bool simple_version = true, int threadCount = 1);
    // returns 0: fail, 1: made isovist, 2: made isovist and added new shapemap layer
    int makeIsovistPath(Communicator *communicator, double fov_angle = 2.0 * M_PI, bool simple_version = true);
    bool makeIsovist(const Point2f& p, Isovist& iso);
 protected:
+   int addIsovist(Isovist& iso, bool simple_version);
    // properties
 public:
    // a few read-write returns:
@@ -34,6 +34,7 @@ void Node::make(const PixelRef pix, PixelRefVector *bins, float *bin_far_dists,
          // now, an octant filter has been used... note that the exact q-octants that
          // will have been processed rely on adjacenies in the q_octants...
          if (!(q_octants & processoctant(i))) {
+            bins[i].clear();
             continue;
          }
       }
@@ -57,35 +58,6 @@ void Node::make(const PixelRef pix, PixelRefVector *bins, float *bin_far_dists,
    }
 }
 
-void Node::extractUnseen(PixelRefVector& pixels, PointMap *pointdata)
-{
-   for (int i = 0; i < 32; i++) {
-         m_bins[i].extractUnseen(pixels, pointdata, (1 << i));
-   }
-}
-
-void Node::extractMetric(std::set<MetricTriple>& pixels, PointMap *pointdata, const MetricTriple& curs)
-{
-   //if (dist == 0.0f || concaveConnected()) { // increases effiency but is too inaccurate
-   //if (dist == 0.0f || !fullyConnected()) { // increases effiency but can miss lines
-   if (curs.dist == 0.0f || pointdata->getPoint(curs.pixel).blocked() || pointdata->blockedAdjacent(curs.pixel)) { 
-      for (int i = 0; i < 32; i++) {
-         m_bins[i].extractMetric(pixels, pointdata, curs);
-      }
-   }
-}
-
-// based on extract metric
-
-void Node::extractAngular(std::set<AngularTriple>& pixels, PointMap *pointdata, const AngularTriple& curs)
-{
-   if (curs.angle == 0.0f || pointdata->getPoint(curs.pixel).blocked() || pointdata->blockedAdjacent(curs.pixel)) {
-      for (int i = 0; i < 32; i++) {
-         m_bins[i].extractAngular(pixels, pointdata, curs);
-      }
-   }
-}
-
 bool Node::concaveConnected()
 {
    // not quite correct -- sometimes at corners you 'see through' the very first connection
@@ -235,6 +207,8 @@ void Bin::make(const PixelRefVector& pixels, char dir)
 {
    m_pixel_vecs.clear();
    m_node_count = 0;
+   // a bin remade empty has no direction, just as one that was never made
+   m_dir = PixelRef::NODIR;
 
    if (pixels.size()) {
 
@@ -305,67 +279,6 @@ void Bin::make(const PixelRefVector& pixels, char dir)
 
 ///////////////////////////////////////////////////////////////////////////////////////
 
-void Bin::extractUnseen(PixelRefVector& pixels, PointMap *pointdata, int binmark)
-{
-   for (auto pixVec: m_pixel_vecs) {
-      for (PixelRef pix = pixVec.start(); pix.col(m_dir) <= pixVec.end().col(m_dir); ) {
-         Point& pt = pointdata->getPoint(pix);
-         if (pointdata->getPoint(pix).m_misc == 0) {
-            pixels.push_back(pix);
-            pointdata->getPoint(pix).m_misc |= binmark;
-         }
-         // 10.2.02 revised --- diagonal was breaking this as it was extent in diagonal or horizontal
-         if (!(m_dir & PixelRef::DIAGONAL)) {
-            if (pt.m_extent.col(m_dir) >= pixVec.end().col(m_dir))
-               break;
-            pt.m_extent.col(m_dir) = pixVec.end().col(m_dir);
-         }
-         pix.move(m_dir);
-      }
-   }
-}
-
-///////////////////////////////////////////////////////////////////////////////////////
-
-void Bin::extractMetric(std::set<MetricTriple>& pixels, PointMap *pointdata, const MetricTriple& curs)
-{
-   for (auto pixVec: m_pixel_vecs) {
-      for (PixelRef pix = pixVec.start(); pix.col(m_dir) <= pixVec.end().col(m_dir); ) {
-         Point& pt = pointdata->getPoint(pix);
-         if (pt.m_misc == 0 && 
-            (pt.m_dist == -1.0 || (curs.dist + dist(pix,curs.pixel) < pt.m_dist))) {
-            pt.m_dist = curs.dist + (float) dist(pix,curs.pixel);
-            // n.b. dmap v4.06r now sets angle in range 0 to 4 (1 = 90 degrees)
-            pt.m_cumangle = pointdata->getPoint(curs.pixel).m_cumangle + (curs.lastpixel == NoPixel ? 0.0f : (float) (angle(pix,curs.pixel,curs.lastpixel) / (M_PI * 0.5)));
-            pixels.insert(MetricTriple(pt.m_dist, pix, curs.pixel));
-         }
-         pix.move(m_dir);
-      }
-   }
-}
-
-// based on metric
-
-void Bin::extractAngular(std::set<AngularTriple>& pixels, PointMap *pointdata, const AngularTriple& curs)
-{
-   for (auto pixVec: m_pixel_vecs) {
-      for (PixelRef pix = pixVec.start(); pix.col(m_dir) <= pixVec.end().col(m_dir); ) {
-         Point& pt = pointdata->getPoint(pix);
-         if (pt.m_misc == 0) {
-            // n.b. dmap v4.06r now sets angle in range 0 to 4 (1 = 90 degrees)
-            float ang = (curs.lastpixel == NoPixel) ? 0.0f : (float) (angle(pix,curs.pixel,curs.lastpixel) / (M_PI * 0.5));
-            if (pt.m_cumangle == -1.0 || curs.angle + ang < pt.m_cumangle) {
-               pt.m_cumangle = pointdata->getPoint(curs.pixel).m_cumangle + ang;
-               pixels.insert(AngularTriple(pt.m_cumangle, pix, curs.pixel));
-            }
-         }
-         pix.move(m_dir);
-      }
-   }
-}
-
-///////////////////////////////////////////////////////////////////////////////////////
-
 bool Bin::containsPoint(const PixelRef p) const
 {
    for (auto pixVec: m_pixel_vecs) {
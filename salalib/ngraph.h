@@ -59,9 +59,6 @@ public:
    { m_dir = PixelRef::NODIR; m_node_count = 0; m_distance = 0.0f; m_occ_distance = 0.0f; }
    //
    void make(const PixelRefVector& pixels, char m_dir);
-   void extractUnseen(PixelRefVector& pixels, PointMap *pointdata, int binmark);
-   void extractMetric(std::set<MetricTriple> &pixels, PointMap *pointdata, const MetricTriple& curs);
-   void extractAngular(std::set<AngularTriple> &pixels, PointMap *pointdata, const AngularTriple& curs);
    //
    int count() const 
    { return m_node_count; }
@@ -103,9 +100,7 @@ public:
 public:
    // Note: this function clears the bins as it goes
    void make(const PixelRef pix, PixelRefVector *bins, float *bin_far_dists, int q_octants);
-   void extractUnseen(PixelRefVector& pixels, PointMap *pointdata);
-   void extractMetric(std::set<MetricTriple> &pixels, PointMap *pointdata, const MetricTriple& curs);
-   void extractAngular(std::set<AngularTriple> &pixels, PointMap *pointdata, const AngularTriple& curs);
+   // n.b. the analyses traverse the graph through the PointMap's VisibilityGraph
    bool concaveConnected();
    bool fullyConnected();
    //
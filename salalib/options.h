@@ -53,6 +53,14 @@ struct Options
    int weighted_measure_col2;  //EFEF
     int routeweight_col;			//EFEF
    std::string output_file; // To save an output graph (for example)
+   // number of worker threads for analyses that can run in parallel (0 = one per core)
+   int thread_count;
+   // priority queue for the metric and angular traversals, the set is the original
+   // implementation and gives the same results, only more slowly
+   enum { QUEUE_BUCKET, QUEUE_SET };
+   int traversal_queue;
+   // global visibility measures from a bit-parallel traversal of 64 origins at a time
+   bool multi_source_bfs;
    // default values
    Options()
    { local = 0; global = 1; cliques = 0;
@@ -61,5 +69,8 @@ struct Options
      radius = -1; radius_type = 0;
      output_type = OUTPUT_ISOVIST; process_in_memory = false; gates_only = false; sel_only = false;
      gatelayer = -1;
-     weighted_measure_col = -1;}
+     weighted_measure_col = -1;
+     thread_count = 1;
+     traversal_queue = QUEUE_BUCKET;
+     multi_source_bfs = false;}
 };
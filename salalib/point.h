@@ -40,12 +40,9 @@ public:
    enum { CONNECT_E = 0x01, CONNECT_NE = 0x02, CONNECT_N = 0x04, CONNECT_NW = 0x08,
           CONNECT_W = 0x10, CONNECT_SW = 0x20, CONNECT_S = 0x40, CONNECT_SE = 0x80 };
 
-   // TODO: These intermediary variables are only used for storing arbitrary data during the
-   // analysis. They should be made into local variables and removed from this class
-   int m_misc;              // <- undocounter / point seen register / agent reference number, etc
-   float m_dist;            // used to speed up metric analysis
-   float m_cumangle;        // cummulative angle -- used in metric analysis and angular analysis
-   PixelRef m_extent;       // used to speed up graph analysis (not sure whether or not it breaks it!)
+   // n.b. per-analysis traversal state (seen marks, distances, cumulative angles, extents)
+   // lives in a TraversalWorkspace, not here
+   int m_misc;              // <- undocounter / graph construction tag / agent reference number, etc
 
 protected:
    int m_block;   // not used, unlikely to be used, but kept for time being
@@ -76,9 +73,6 @@ public:
        m_color = p.m_color;
        m_merge = p.m_merge;
        m_color = p.m_color;
-       m_extent = p.m_extent;
-       m_dist = p.m_dist;
-       m_cumangle = p.m_cumangle;
        m_lines = p.m_lines;
        m_processflag = p.m_processflag;
        return *this;
@@ -94,9 +88,6 @@ public:
        m_color = p.m_color;
        m_merge = p.m_merge;
        m_color = p.m_color;
-       m_extent = p.m_extent;
-       m_dist = p.m_dist;
-       m_cumangle = p.m_cumangle;
        m_lines = p.m_lines;
        m_processflag = p.m_processflag;
    }
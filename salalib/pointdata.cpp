@@ -26,14 +26,18 @@
 #include "salalib/isovist.h"
 #include "salalib/mgraph.h" // Metagraphs are used...
 #include "salalib/ngraph.h"
+#include "salalib/visibilitygraph.h"
 #include "salalib/attributetable.h"
+#include "salalib/resultwriter.h"
 #include "salalib/attributetablehelpers.h"
 
 #include "genlib/comm.h"  // for communicator
 #include "genlib/stringutils.h"
 #include "genlib/containerutils.h"
+#include "genlib/parallelutils.h"
 
 #include <math.h>
+#include <limits>
 #include <unordered_set>
 #include <numeric>
 
@@ -73,6 +77,31 @@ PointMap::PointMap(const QtRegion& parentRegion, const std::vector<SpacePixelFil
    m_displayed_attribute = -2;
 }
 
+PointMap::PointMap(PointMap&& other):
+           m_parentRegion(std::move(other.m_parentRegion)),
+           m_drawingFiles(std::move(other.m_drawingFiles)),
+           m_points(std::move(other.m_points)),
+           m_attributes(std::move(other.m_attributes)),
+           m_attribHandle(std::move(other.m_attribHandle)),
+           m_layers(std::move(other.m_layers)),
+           m_visibility_graph(std::move(other.m_visibility_graph)) {
+    copy(other);
+}
+
+PointMap& PointMap::operator =(PointMap&& other) {
+    m_parentRegion = std::move(other.m_parentRegion);
+    m_drawingFiles = std::move(other.m_drawingFiles);
+    m_points = std::move(other.m_points);
+    m_attributes = std::move(other.m_attributes);
+    m_attribHandle = std::move(other.m_attribHandle);
+    m_layers = std::move(other.m_layers);
+    m_visibility_graph = std::move(other.m_visibility_graph);
+    copy(other);
+    return *this;
+}
+
+PointMap::~PointMap() {}
+
 void PointMap::copy(const PointMap& other)
 {
    m_name = other.getName();
@@ -121,6 +150,7 @@ void PointMap::communicate( time_t& atime, Communicator *comm, int record )
 
 bool PointMap::setGrid(double spacing, const Point2f& offset)
 {
+   m_visibility_graph.reset();
    m_spacing = spacing;
    // note, the internal offset is the offset from the bottom left
    double xoffset = fmod(m_parentRegion->bottom_left.x + offset.x,m_spacing);
@@ -175,6 +205,7 @@ bool PointMap::clearPoints()
    if (!m_filled_point_count) {
       return false;
    }
+   m_visibility_graph.reset();
 
    // This function is a bit messy... 
    // each is a slight variation (saves a little time when there's a single selection as opposed to a compound selection
@@ -237,6 +268,7 @@ bool PointMap::undoPoints()
    if (!m_undocounter) {
       return false;
    }
+   m_visibility_graph.reset();
    for (auto& p: m_points) {
         if ( p.m_misc == m_undocounter) {
             if (p.m_state & Point::FILLED) {
@@ -301,6 +333,7 @@ bool PointMap::blockLines()
    if (m_blockedlines) {
       return true;
    }
+   m_visibility_graph.reset();
    // just ensure lines don't exist to start off with (e.g., if someone's been playing with the visible layers)
    unblockLines();
 
@@ -358,6 +391,7 @@ void PointMap::blockLine(const Line& li)
 
 void PointMap::unblockLines(bool clearblockedflag)
 {
+   m_visibility_graph.reset();
    // just ensure lines don't exist to start off with (e.g., if someone's been playing with the visible layers)
    for (size_t i = 0; i < m_cols; i++) {
       for (size_t j = 0; j < m_rows; j++) {
@@ -379,6 +413,7 @@ bool PointMap::fillPoint(const Point2f& p, bool add)
    if (!includes(pix)) {
       return false;
    }
+   m_visibility_graph.reset();
    Point& pt = getPoint(pix);
    if (add && !pt.filled()) {
       m_filled_point_count++;
@@ -404,6 +439,7 @@ bool PointMap::makePoints(const Point2f& seed, int fill_type, Communicator *comm
    if (!m_initialised || m_points.size() == 0) {
       return false;
    }
+   m_visibility_graph.reset();
    if (comm) {
       comm->CommPostMessage( Communicator::NUM_RECORDS, (m_rows * m_cols));
    }
@@ -1013,6 +1049,14 @@ bool PointMap::setCurSel(const std::vector<int>& selset, bool add)
 
 // This is being phased out, with the new "edge" points (which are the filled edges of the graph)
 
+const VisibilityGraph& PointMap::getVisibilityGraph()
+{
+   if (!m_visibility_graph) {
+      m_visibility_graph.reset(new VisibilityGraph(*this));
+   }
+   return *m_visibility_graph;
+}
+
 bool PointMap::blockedAdjacent( const PixelRef p ) const
 {
    bool ba = false;
@@ -1072,6 +1116,7 @@ bool PointMap::blockedAdjacent( const PixelRef p ) const
 
 bool PointMap::read(std::istream& stream )
 {
+   m_visibility_graph.reset();
    m_name = dXstring::readString(stream);
 
 
@@ -1243,9 +1288,10 @@ int PointMap::tagState(bool settag)
 // Then wouldn't have to 'test twice' for the grid point being blocked...
 // ...perhaps a tweak for a later date!
 
-bool PointMap::sparkGraph2( Communicator *comm, bool boundarygraph, double maxdist )
+bool PointMap::sparkGraph2( Communicator *comm, bool boundarygraph, double maxdist, int threadCount )
 {
    // Note, graph must be fixed (i.e., having blocking pixels filled in)
+   m_visibility_graph.reset();
 
    if (!m_blockedlines) {
       blockLines();
@@ -1272,51 +1318,33 @@ bool PointMap::sparkGraph2( Communicator *comm, bool boundarygraph, double maxdi
    // pre-label --- allows faster node access later on
    int count = tagState( true );
 
-   // start the timer when you know the true count including fixed points
-   
-   time_t atime = 0;
+   // the timer starts in parallelFor, once the true count including fixed points is known
    if (comm) {
-      qtimer( atime, 0 );
       comm->CommPostMessage( Communicator::NUM_RECORDS, count );
    }
 
-   count = 0;
-
+   std::vector<PixelRef> filled;
    for (size_t i = 0; i < m_cols; i++) {
-
       for (size_t j = 0; j < m_rows; j++) {
-
          PixelRef curs = PixelRef( i, j );
-   
          if ( getPoint( curs ).getState() & Point::FILLED ) {
-
             getPoint( curs ).m_node = std::unique_ptr<Node>(new Node());
             m_attributes->addRow( AttributeKey(curs) );
+            filled.push_back(curs);
+         }
+      }
+   }
 
-            sparkPixel2(curs,1,maxdist); // make flag of 1 suggests make this node, don't set reciprocral process flags on those you can see
-                                         // maxdist controls how far to see out to
-
-            count++;    // <- increment count
-
-            if (comm) {
-               if (qtimer( atime, 500 )) {
-                  if (comm->IsCancelled()) {
-                     tagState( false );         // <- the state field has been used for tagging visited nodes... set back to a state variable
-                     // (well, actually, no it hasn't!)
-                     // Should clear all nodes and attributes here:
-                     // Clear nodes
-                     // Clear attributes
-                     m_attributes->clear();
-                     m_displayed_attribute = -2;
-                     //
-                     throw Communicator::CancelledException();
-                  }
-                  comm->CommPostMessage( Communicator::CURRENT_RECORD, count );
-               }         
-            } // if (comm)
-         } // if ( getPoint( curs ).getState() & Point::FILLED )
-      } // rows
-   } // cols
+   try {
+      sparkPixels(comm, filled, maxdist, threadCount);
+   }
+   catch (Communicator::CancelledException&) {
+      tagState( false );         // <- the state field has been used for tagging visited nodes... set back to a state variable
+      // Should clear all nodes and attributes here:
+      m_attributes->clear();
+      m_displayed_attribute = -2;
+      throw;
+   }
 
    tagState( false );  // <- the state field has been used for tagging visited nodes... set back to a state variable
 
@@ -1340,7 +1368,209 @@ bool PointMap::sparkGraph2( Communicator *comm, bool boundarygraph, double maxdi
    return true;
 }
 
+// Makes the nodes of the given points, which must be tagged with the octants to process, and
+// writes their point statistics to the table. Each node is made from its own sieve, reading only
+// the blocking lines and states of the other points, so the points can be sparked on several
+// threads; each thread writes the statistics of its points straight into a ResultWriter, which
+// hands them to the table once all the points are done. The statistics are read back from the
+// whole node, so they are the same whether the node was made at once or only some of its
+// octants were remade
+
+void PointMap::sparkPixels(Communicator *comm, const std::vector<PixelRef>& pixels, double maxdist, int threadCount)
+{
+   ResultWriter results(*m_attributes);
+   ColumnHandle connectivity_col = results.addColumn("Connectivity");
+   ColumnHandle first_moment_col = results.addColumn("Point First Moment");
+   ColumnHandle second_moment_col = results.addColumn("Point Second Moment");
+   size_t threads = depthmapX::getThreadCount(threadCount, pixels.size());
+   std::vector<SparkWorkspace> workspaces(threads);
+   depthmapX::parallelFor(comm, threads, pixels.size(), [&](size_t index, size_t threadIndex) {
+      SparkWorkspace& workspace = workspaces[threadIndex];
+      // make flag of 1 suggests make this node, don't set reciprocral process flags on those you can see
+      // maxdist controls how far to see out to
+      sparkPixel2(pixels[index], 1, maxdist, workspace);
+      int connectivity;
+      double first_moment, second_moment;
+      getPointStatistics(pixels[index], connectivity, first_moment, second_moment);
+      size_t position = results.getRowPosition( AttributeKey(pixels[index]) );
+      results.setValue( position, connectivity_col, float(connectivity) );
+      results.setValue( position, first_moment_col, float(first_moment) );
+      results.setValue( position, second_moment_col, float(second_moment) );
+   });
+   results.commit();
+}
+
+void PointMap::getPointStatistics(PixelRef curs, int& connectivity, double& first_moment, double& second_moment) const
+{
+   const Node& node = *getPoint(curs).m_node;
+   connectivity = 0;
+   first_moment = 0.0;
+   second_moment = 0.0;
+   for (int i = 0; i < 32; i++) {
+      const Bin& bin = node.bin(i);
+      connectivity += bin.count();
+      // a diagonal bin runs from its nearest to its furthest pixel, so skip the empty cells on the way
+      for (bin.first(); !bin.is_tail(); bin.next()) {
+         if (getPoint(bin.cursor()).filled()) {
+            // note m_spacing is used to scale the moment of inertia appropriately
+            double this_dist = dist(bin.cursor(), curs) * m_spacing;
+            first_moment += this_dist;
+            second_moment += this_dist * this_dist;
+         }
+      }
+   }
+}
+
+// The octants of a sweep from curs (see sieve2) that take in a cell of the box from bottom_left to
+// top_right no more than maxdepth rows or columns away, as process flags
+
+static int octantsReaching(PixelRef curs, PixelRef bottom_left, PixelRef top_right, int maxdepth)
+{
+   int octants = 0;
+   for (int q = 0; q < 8; q++) {
+      // the box turned to the octant's own axes, in which the octant is 0 <= ind <= depth
+      int xsign = (q % 2 ? 1 : -1);
+      int ysign = (q <= 1 || q >= 6 ? 1 : -1);
+      int x0 = std::min(xsign * (bottom_left.x - curs.x), xsign * (top_right.x - curs.x));
+      int x1 = std::max(xsign * (bottom_left.x - curs.x), xsign * (top_right.x - curs.x));
+      int y0 = std::min(ysign * (bottom_left.y - curs.y), ysign * (top_right.y - curs.y));
+      int y1 = std::max(ysign * (bottom_left.y - curs.y), ysign * (top_right.y - curs.y));
+      int ind0 = (q >= 4 ? x0 : y0), ind1 = (q >= 4 ? x1 : y1);
+      int depth0 = (q >= 4 ? y0 : x0), depth1 = (q >= 4 ? y1 : x1);
+      // the nearest cell of the box inside the octant
+      int ind = std::max(ind0, 0);
+      int depth = std::max(depth0, ind);
+      if (ind <= ind1 && depth <= depth1 && depth <= maxdepth) {
+         octants |= 1 << q;
+      }
+   }
+   return octants;
+}
+
+// Brings a made graph up to date after the lines in changedLines have been added to or removed
+// from the shown drawing layers, and after points have been filled or emptied: a filled point
+// without a node joins the graph, and an emptied point that still has one leaves it.
+//
+// The sweep of an octant in sparkPixel2 reads the lines and states of the cells inside that
+// octant only, so it comes out as before unless one of them has changed: a cell a changed line
+// runs through, or a point filled or emptied. Only the octants that take in a changed cell are
+// remade, each node starting from a copy of its old self. A changed cell more than maxdist away
+// only hides cells further away still, which the node doesn't see anyway, so it is left out.
+//
+// The new nodes are swapped in as they are made and the old ones only thrown away once all of
+// them are done, so a cancelled update leaves the graph as it was.
+
+bool PointMap::updateGraph(Communicator *comm, const std::vector<Line>& changedLines, double maxdist, int threadCount)
+{
+   if (!m_processed || m_boundarygraph) {
+      return false;
+   }
+   m_visibility_graph.reset();
+
+   // the lines were freed after the graph was made: block the current set
+   m_blockedlines = false;
+   blockLines();
+
+   // the changed cells, as boxes: one around each line, and one for each point filled or emptied
+   std::vector<std::pair<PixelRef, PixelRef> > changed;
+   for (const Line& line: changedLines) {
+      std::vector<PixelRef> pixels = pixelateLineTouching(line, 1e-10);
+      if (!pixels.empty()) {
+         PixelRef bottom_left = pixels.front(), top_right = pixels.front();
+         for (PixelRef pix: pixels) {
+            bottom_left.x = std::min(bottom_left.x, pix.x);
+            bottom_left.y = std::min(bottom_left.y, pix.y);
+            top_right.x = std::max(top_right.x, pix.x);
+            top_right.y = std::max(top_right.y, pix.y);
+         }
+         changed.push_back(std::make_pair(bottom_left, top_right));
+      }
+   }
+   std::vector<PixelRef> added, removed;
+   for (size_t i = 0; i < m_cols; i++) {
+      for (size_t j = 0; j < m_rows; j++) {
+         PixelRef curs = PixelRef( i, j );
+         Point& pt = getPoint( curs );
+         if (pt.filled() && !pt.m_node) {
+            added.push_back(curs);
+            changed.push_back(std::make_pair(curs, curs));
+         }
+         else if (!pt.filled() && pt.m_node) {
+            removed.push_back(curs);
+            changed.push_back(std::make_pair(curs, curs));
+         }
+      }
+   }
+
+   // a cell is at least as far away as the rows or columns between
+   int maxdepth = (maxdist == -1.0) ? std::numeric_limits<int>::max() : int(maxdist / m_spacing) + 1;
+   std::vector<PixelRef> affected;
+   std::vector<std::unique_ptr<Node> > old_nodes;
+   for (size_t i = 0; i < m_cols; i++) {
+      for (size_t j = 0; j < m_rows; j++) {
+         PixelRef curs = PixelRef( i, j );
+         Point& pt = getPoint( curs );
+         if (!pt.filled()) {
+            continue;
+         }
+         pt.m_processflag = 0;
+         for (auto& box: changed) {
+            pt.m_processflag |= octantsReaching(curs, box.first, box.second, maxdepth);
+         }
+         if (pt.m_processflag != 0) {
+            old_nodes.push_back(std::move(pt.m_node));
+            // a changed cell of its own takes in every octant, and so does a new point
+            if (pt.m_processflag == 0x00FF) {
+               pt.m_node = std::unique_ptr<Node>(new Node());
+            }
+            else {
+               pt.m_node = std::unique_ptr<Node>(new Node(*old_nodes.back()));
+            }
+            affected.push_back(curs);
+         }
+      }
+   }
+   for (PixelRef pix: added) {
+      m_attributes->addRow( AttributeKey(pix) );
+   }
+
+   if (comm) {
+      comm->CommPostMessage( Communicator::NUM_RECORDS, int(affected.size()) );
+   }
+   try {
+      sparkPixels(comm, affected, maxdist, threadCount);
+   }
+   catch (Communicator::CancelledException&) {
+      for (size_t k = 0; k < affected.size(); k++) {
+         Point& pt = getPoint(affected[k]);
+         pt.m_node = std::move(old_nodes[k]);
+         pt.m_processflag = 0;
+      }
+      m_attributes->removeRows( std::vector<AttributeKey>(added.begin(), added.end()) );
+      unblockLines(false);
+      throw;
+   }
+
+   for (PixelRef pix: removed) {
+      Point& pt = getPoint(pix);
+      pt.m_node = nullptr;
+      pt.m_grid_connections = 0;
+   }
+   m_attributes->removeRows( std::vector<AttributeKey>(removed.begin(), removed.end()) );
+
+   unblockLines(false);
+   addGridConnections();
+
+   // override and reset, so that the display picks up the new values:
+   int displayed_attribute = m_displayed_attribute;
+   m_displayed_attribute = -2;
+   setDisplayedAttribute(displayed_attribute);
+
+   return true;
+}
+
 bool PointMap::unmake(bool removeLinks) {
+    m_visibility_graph.reset();
     for (size_t i = 0; i < m_cols; i++) {
         for (size_t j = 0; j < m_rows; j++) {
             PixelRef curs = PixelRef(static_cast<short>(i), static_cast<short>(j));
@@ -1377,16 +1607,13 @@ bool PointMap::unmake(bool removeLinks) {
 // 1 -- build this node
 // 2 -- register the reciprocal q octant in nodes you can see as requiring processing
 
-bool PointMap::sparkPixel2(PixelRef curs, int make, double maxdist)
+bool PointMap::sparkPixel2(PixelRef curs, int make, double maxdist, SparkWorkspace& workspace)
 {
-   static std::vector<PixelRef> bins_b[32];
-   static float far_bin_dists[32];
+   PixelRefVector *bins_b = workspace.bins;
+   float *far_bin_dists = workspace.far_bin_dists;
    for (int i = 0; i < 32; i++) {
       far_bin_dists[i] = 0.0f;
    }
-   int neighbourhood_size = 0;
-   double total_dist = 0.0;
-   double total_dist_sqr = 0.0;
 
    Point2f centre0 = depixelate(curs);
 
@@ -1465,15 +1692,10 @@ bool PointMap::sparkPixel2(PixelRef curs, int make, double maxdist)
             {
                int bin = whichbin(depixelate(addlist[n])-centre0);
                if (make & 1) {
-                  // the blocked cells shouldn't contribute to point stats
-                  // note m_spacing is used to scale the moment of inertia appropriately
                   double this_dist = dist(addlist[n],curs) * m_spacing;
                   if (this_dist > far_bin_dists[bin]) {
                      far_bin_dists[bin] = (float) this_dist;
                   }
-                  total_dist += this_dist;
-                  total_dist_sqr += this_dist * this_dist;
-                  neighbourhood_size++;
 
                   bins_b[bin].push_back( addlist[n] );
                }
@@ -1491,10 +1713,6 @@ bool PointMap::sparkPixel2(PixelRef curs, int make, double maxdist)
       // The bins are cleared in the make function!
       Point& pt = getPoint( curs );
       pt.m_node->make(curs, bins_b, far_bin_dists, pt.m_processflag);   // note: make clears bins!
-      AttributeRow& row = m_attributes->getRow( AttributeKey(curs) );
-      row.setValue( "Connectivity", float(neighbourhood_size) );
-      row.setValue( "Point First Moment", float(total_dist) );
-      row.setValue( "Point Second Moment", float(total_dist_sqr) );
    }
    else {
       // Clear bins by hand if not using them to make
@@ -1509,7 +1727,7 @@ bool PointMap::sparkPixel2(PixelRef curs, int make, double maxdist)
    return true;
 }
 
-bool PointMap::sieve2(sparkSieve2& sieve, std::vector<PixelRef>& addlist, int q, int depth, PixelRef curs)
+bool PointMap::sieve2(sparkSieve2& sieve, std::vector<PixelRef>& addlist, int q, int depth, PixelRef curs) const
 {
    bool hasgaps = false;
    int firstind = 0;
@@ -1641,6 +1859,7 @@ bool PointMap::unmergePoints()
 
 // Either of the pixels can be given here and the other will also be unmerged
 bool PointMap::unmergePixel(PixelRef a) {
+    m_visibility_graph.reset();
     PixelRef c = getPoint(a).m_merge;
     depthmapX::findAndErase(m_merge_lines, PixelRefPair(a,c));
     getPoint(c).m_merge = NoPixel;
@@ -1652,6 +1871,7 @@ bool PointMap::unmergePixel(PixelRef a) {
 
 bool PointMap::mergePixels(PixelRef a, PixelRef b)
 {
+   m_visibility_graph.reset();
    if (a == b && !getPoint(a).m_merge.empty()) {
        unmergePixel(a);
    }
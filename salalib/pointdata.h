@@ -55,6 +55,7 @@ struct PixelVec;
 
 
 class sparkSieve2;
+class VisibilityGraph;
 
 namespace depthmapX
 {
@@ -104,33 +105,19 @@ private:
    std::unique_ptr<AttributeTable> m_attributes;
    std::unique_ptr<AttributeTableHandle> m_attribHandle;
    LayerManagerImpl m_layers;
+   // snapshot of the graph for the analyses, built when first asked for (see getVisibilityGraph)
+   std::unique_ptr<VisibilityGraph> m_visibility_graph;
 public:
    PointMap(const QtRegion& parentRegion, const std::vector<SpacePixelFile>& drawingFiles,
             const std::string& name = std::string("VGA Map"));
-   virtual ~PointMap() {}
+   virtual ~PointMap();
    void copy(const PointMap& other);
    const std::string& getName() const
    { return m_name; }
 
-   PointMap(PointMap&& other):
-              m_parentRegion(std::move(other.m_parentRegion)),
-              m_drawingFiles(std::move(other.m_drawingFiles)),
-              m_points(std::move(other.m_points)),
-              m_attributes(std::move(other.m_attributes)),
-              m_attribHandle(std::move(other.m_attribHandle)),
-              m_layers(std::move(other.m_layers)) {
-       copy(other);
-   }
-   PointMap& operator =(PointMap&& other) {
-       m_parentRegion = std::move(other.m_parentRegion);
-       m_drawingFiles = std::move(other.m_drawingFiles);
-       m_points = std::move(other.m_points);
-       m_attributes = std::move(other.m_attributes);
-       m_attribHandle = std::move(other.m_attribHandle);
-       m_layers = std::move(other.m_layers);
-       copy(other);
-       return *this;
-   }
+   // n.b. defined with the destructor, where VisibilityGraph is complete
+   PointMap(PointMap&& other);
+   PointMap& operator =(PointMap&& other);
    PointMap(const PointMap& ) = delete;
    PointMap& operator =(const PointMap&) = delete;
 
@@ -168,10 +155,24 @@ public:
    void outputPoints(std::ostream& stream, char delim );
    void outputMergeLines(std::ostream& stream, char delim);
    int  tagState(bool settag);
-   bool sparkGraph2(Communicator *comm, bool boundarygraph, double maxdist );
+   // threadCount is the number of points built at once (0 = one per core); the graph is the same
+   bool sparkGraph2(Communicator *comm, bool boundarygraph, double maxdist, int threadCount = 1 );
+   // remakes only the part of the graph that changedLines (added to or removed from the shown
+   // drawing layers) and the points filled or emptied since the graph was made could affect
+   bool updateGraph(Communicator *comm, const std::vector<Line>& changedLines, double maxdist, int threadCount = 1);
    bool unmake(bool removeLinks);
-   bool sparkPixel2(PixelRef curs, int make, double maxdist = -1.0);
-   bool sieve2(sparkSieve2& sieve, std::vector<PixelRef>& addlist, int q, int depth, PixelRef curs);
+   // The pixels one sparkPixel2 call can see, sorted into their bins. Calls that only make their
+   // own node (make == 1) can run concurrently as long as each has its own workspace
+   struct SparkWorkspace {
+      PixelRefVector bins[32];
+      float far_bin_dists[32];
+   };
+   bool sparkPixel2(PixelRef curs, int make, double maxdist, SparkWorkspace& workspace);
+   bool sieve2(sparkSieve2& sieve, std::vector<PixelRef>& addlist, int q, int depth, PixelRef curs) const;
+   void sparkPixels(Communicator *comm, const std::vector<PixelRef>& pixels, double maxdist, int threadCount);
+   // connectivity and the first and second moments of the distances to the points the node of
+   // curs sees
+   void getPointStatistics(PixelRef curs, int& connectivity, double& first_moment, double& second_moment) const;
    // bool makeGraph( Graph& graph, int optimization_level = 0, Communicator *comm = NULL);
    //
    bool binDisplay(Communicator *);
@@ -198,6 +199,11 @@ public:
    // to be phased out
    bool blockedAdjacent( const PixelRef p ) const;
    //
+   // read-only snapshot of the visibility graph for the analyses to traverse; it is
+   // built on the first call and kept until the graph changes, so call it before
+   // handing the map to several threads
+   const VisibilityGraph& getVisibilityGraph();
+   //
    int getFilledPointCount() const
       { return m_filled_point_count; }
    //
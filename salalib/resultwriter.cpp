@@ -0,0 +1,41 @@
+// sala - a component of the depthmapX - spatial network analysis platform
+// Copyright (C) 2026, Tasos Varoudis
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "salalib/resultwriter.h"
+
+#include <algorithm>
+
+ColumnHandle ResultWriter::addColumn(ColumnHandle column) {
+    if (std::find(m_columns.begin(), m_columns.end(), column.index) != m_columns.end()) {
+        return column;
+    }
+    // throws for a column the table does not have
+    const std::vector<float> &values = m_table.getColumnValues(column.index);
+    if (m_values.size() <= column.index) {
+        m_values.resize(column.index + 1);
+    }
+    m_values[column.index] = values;
+    m_columns.push_back(column.index);
+    return column;
+}
+
+void ResultWriter::commit() {
+    for (size_t index : m_columns) {
+        m_table.setColumnValues(index, std::move(m_values[index]));
+    }
+    m_columns.clear();
+    m_values.clear();
+}
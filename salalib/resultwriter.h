@@ -0,0 +1,52 @@
+// sala - a component of the depthmapX - spatial network analysis platform
+// Copyright (C) 2026, Tasos Varoudis
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "salalib/attributetable.h"
+
+#include <string>
+#include <vector>
+
+// Collects the results of an analysis and writes them to the attribute table in one go once the
+// analysis is done. The columns to write are added to the writer once, and values are then set
+// through their handles for rows given by their position in the table (see getRowPosition), so
+// the inner loops of an analysis neither look columns up by name nor touch the table. A column
+// starts out with the values the table holds, so rows the analysis leaves alone keep theirs.
+//
+// Worker threads can set values at the same time as long as no two of them set the same cell.
+// Nothing else may write to the columns of the writer between adding them and commit().
+
+class ResultWriter {
+  public:
+    ResultWriter(AttributeTable &table) : m_table(table) {}
+
+    ColumnHandle addColumn(const std::string &name) { return addColumn(m_table.getColumnHandle(name)); }
+    ColumnHandle addColumn(ColumnHandle column);
+
+    size_t getRowPosition(const AttributeKey &key) const { return m_table.getRowPosition(key); }
+    void setValue(size_t position, ColumnHandle column, float value) { m_values[column.index][position] = value; }
+    float getValue(size_t position, ColumnHandle column) const { return m_values[column.index][position]; }
+
+    // hands the values over to the table; the writer is empty afterwards
+    void commit();
+
+  private:
+    AttributeTable &m_table;
+    std::vector<size_t> m_columns;
+    // by column index, empty for the columns not added
+    std::vector<std::vector<float>> m_values;
+};
@@ -0,0 +1,650 @@
+// sala - a component of the depthmapX - spatial network analysis platform
+// Copyright (C) 2026, Tasos Varoudis
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "salalib/salacode.h"
+
+#include <cmath>
+#include <map>
+
+// Lowers the eval stack of a command to instructions. The eval stack is first read into a tree exactly as
+// SalaCommand::evaluate(pointer, p_obj) reads it, and the tree is then emitted in the order the interpreter
+// evaluates it: the operands of an operator from the right hand side to the left, the parameter of a member
+// function before its object and the items of a list from the last to the first.
+
+struct SalaCode::Compiler {
+    struct Node {
+        int token;                 // position on the eval stack, -1 where an argument is missing
+        std::vector<int> children; // in the order they are evaluated
+        bool assigns;              // there is an assignment in the node or below it
+    };
+
+    SalaCode &code;
+    SalaCommand &command;
+    std::vector<Node> nodes;
+    std::vector<int> types;      // the static type of each register, 0 where it is not known
+    std::vector<bool> constants; // registers that are set at compile time and never written when running
+    bool ok = true;
+
+    Compiler(SalaCode &c, SalaCommand &cmd) : code(c), command(cmd) {}
+
+    static int arguments(SalaObj::Func func)
+    {
+        switch (func) {
+        case SalaObj::S_PLUS:
+        case SalaObj::S_MINUS:
+        case SalaObj::S_NOT:
+        case SalaObj::S_LEN:
+        case SalaObj::S_RANGE:
+        case SalaObj::S_SQRT:
+        case SalaObj::S_LOG:
+        case SalaObj::S_LN:
+        case SalaObj::S_RAND:
+        case SalaObj::S_SIN:
+        case SalaObj::S_COS:
+        case SalaObj::S_TAN:
+        case SalaObj::S_ASIN:
+        case SalaObj::S_ACOS:
+        case SalaObj::S_ATAN:
+            return 1;
+        case SalaObj::S_ADD:
+        case SalaObj::S_SUBTRACT:
+        case SalaObj::S_MULTIPLY:
+        case SalaObj::S_DIVIDE:
+        case SalaObj::S_MODULO:
+        case SalaObj::S_POWER:
+        case SalaObj::S_ASSIGN:
+        case SalaObj::S_LIST_ACCESS:
+        case SalaObj::S_OR:
+        case SalaObj::S_AND:
+        case SalaObj::S_EQ:
+        case SalaObj::S_IS:
+        case SalaObj::S_NEQ:
+        case SalaObj::S_GT:
+        case SalaObj::S_LT:
+        case SalaObj::S_GEQ:
+        case SalaObj::S_LEQ:
+            return 2;
+        default:
+            // member functions always take their object and a parameter, and anything else the
+            // interpreter does not know is left on the stack as it is
+            return ((func & SalaObj::S_GROUP) == SalaObj::S_MEMBER_FUNCS) ? 2 : 0;
+        }
+    }
+
+    const SalaObj &token(int n) const { return command.m_eval_stack[nodes[n].token]; }
+
+    bool isFunction(int n, SalaObj::Func func) const
+    {
+        return nodes[n].token >= 0 && token(n).type == SalaObj::S_FUNCTION && token(n).data.func == func &&
+               !nodes[n].children.empty();
+    }
+
+    bool isVariable(int n) const
+    {
+        return nodes[n].token >= 0 && (token(n).type == SalaObj::S_THIS || (token(n).type & SalaObj::S_VAR));
+    }
+
+    int build(int &pointer)
+    {
+        int n = int(nodes.size());
+        nodes.push_back(Node{pointer, std::vector<int>(), false});
+        if (pointer < 0) {
+            return n;
+        }
+        const SalaObj &data = command.m_eval_stack[pointer];
+        pointer--;
+        int count = 0;
+        if (data.type == SalaObj::S_FUNCTION) {
+            count = arguments(data.data.func);
+            nodes[n].assigns = (data.data.func == SalaObj::S_ASSIGN);
+        } else if (data.type != SalaObj::S_THIS && !(data.type & SalaObj::S_VAR) &&
+                   (data.type & SalaObj::S_CONST_LIST)) {
+            count = data.data.count;
+        }
+        for (int i = 0; i < count; i++) {
+            int child = build(pointer);
+            nodes[n].children.push_back(child);
+            nodes[n].assigns = nodes[n].assigns || nodes[child].assigns;
+        }
+        return n;
+    }
+
+    int addRegister(int type, bool constant = false)
+    {
+        code.m_registers.push_back(SalaObj());
+        types.push_back(type);
+        constants.push_back(constant);
+        return int(code.m_registers.size()) - 1;
+    }
+
+    int addConstant(const SalaObj &value)
+    {
+        int reg = addRegister(value.type, true);
+        code.m_registers[reg] = value;
+        return reg;
+    }
+
+    int addContext(SalaObj::Func func, int context)
+    {
+        std::vector<SalaObj::Func> funcs(1, func);
+        if (context != -1) {
+            funcs.insert(funcs.end(), code.m_contexts[context].begin(), code.m_contexts[context].end());
+        }
+        code.m_contexts.push_back(funcs);
+        return int(code.m_contexts.size()) - 1;
+    }
+
+    int add(Op op, int dest, int left, int right, int context, SalaObj::Func func = SalaObj::S_FNULL)
+    {
+        code.m_instructions.push_back(Instruction{op, dest, left, right, 0, 0, func, context});
+        return int(code.m_instructions.size()) - 1;
+    }
+
+    int typeOf(int op) const { return (op >= 0) ? types[op] : 0; }
+    bool isConstant(int op) const { return op == NO_OPERAND || (op >= 0 && constants[op]); }
+
+    static bool isPure(const Instruction &in)
+    {
+        switch (in.op) {
+        case ADD:
+        case SUBTRACT:
+        case MULTIPLY:
+        case DIVIDE:
+        case MODULO:
+        case MINUS:
+        case ADD_F:
+        case SUBTRACT_F:
+        case MULTIPLY_F:
+        case DIVIDE_F:
+        case MODULO_F:
+        case MINUS_F:
+        case TO_DOUBLE:
+        case POWER:
+        case TO_INT:
+        case EQ:
+        case NEQ:
+        case GT:
+        case LT:
+        case GEQ:
+        case LEQ:
+        case EQ_F:
+        case NEQ_F:
+        case GT_F:
+        case LT_F:
+        case GEQ_F:
+        case LEQ_F:
+        case IS:
+        case OR:
+        case NOT:
+            return true;
+        case GLOBAL:
+            return in.func != SalaObj::S_RAND && in.func != SalaObj::S_RANGE;
+        default:
+            return false;
+        }
+    }
+
+    // adds an instruction with a new register for its result, and folds it into a constant if it can be
+    int addResult(Op op, int type, int left, int right, int context, SalaObj::Func func = SalaObj::S_FNULL)
+    {
+        int dest = addRegister(type);
+        add(op, dest, left, right, context, func);
+        const Instruction &in = code.m_instructions.back();
+        if (!isPure(in) || !isConstant(left) || !isConstant(right)) {
+            return dest;
+        }
+        if ((op == DIVIDE || op == MODULO) && types[right] == SalaObj::S_INT &&
+            (code.m_registers[right].data.i == 0 || code.m_registers[right].data.i == -1)) {
+            // integer division by these may not get as far as an error, so leave it to happen when it is run
+            return dest;
+        }
+        SalaObj *ref = nullptr;
+        try {
+            code.execute(in, command, nullptr, ref);
+        } catch (SalaError &) {
+            // the error will be thrown when it is run, if it gets that far
+            return dest;
+        }
+        int result = code.m_registers[dest].type;
+        if (result == SalaObj::S_BOOL || result == SalaObj::S_INT || result == SalaObj::S_DOUBLE) {
+            code.m_instructions.pop_back();
+            constants[dest] = true;
+            types[dest] = result;
+        }
+        return dest;
+    }
+
+    // a variable (or 'this') is copied if anything evaluated after it and before it is used could assign to it
+    std::vector<int> emitArguments(int n, int context, bool last)
+    {
+        const std::vector<int> &children = nodes[n].children;
+        std::vector<int> ops;
+        for (size_t i = 0; i < children.size(); i++) {
+            bool lastChild = (i + 1 == children.size());
+            int op = emit(children[i], context, last && lastChild);
+            if (op < 0 && !lastChild) {
+                for (size_t j = i + 1; j < children.size(); j++) {
+                    if (nodes[children[j]].assigns) {
+                        int reg = addRegister(0);
+                        add(COPY, reg, op, NO_OPERAND, context);
+                        op = reg;
+                        break;
+                    }
+                }
+            }
+            ops.push_back(op);
+        }
+        return ops;
+    }
+
+    int emitBinary(Op op, int left, int right, int context)
+    {
+        bool comparison = (op >= EQ && op <= LEQ);
+        if (op != IS) {
+            // an integer constant against a float is the same as the float of the integer
+            if (typeOf(left) == SalaObj::S_DOUBLE && typeOf(right) == SalaObj::S_INT && constants[right]) {
+                right = addConstant(SalaObj(double(code.m_registers[right].data.i)));
+            } else if (typeOf(left) == SalaObj::S_INT && typeOf(right) == SalaObj::S_DOUBLE && constants[left]) {
+                left = addConstant(SalaObj(double(code.m_registers[left].data.i)));
+            }
+        }
+        int lt = typeOf(left), rt = typeOf(right);
+        int type = 0;
+        if (op != IS && lt == SalaObj::S_DOUBLE && rt == SalaObj::S_DOUBLE) {
+            op = comparison ? Op(op - EQ + EQ_F) : Op(op - ADD + ADD_F);
+            type = comparison ? SalaObj::S_BOOL : SalaObj::S_DOUBLE;
+        } else if (comparison || op == IS) {
+            type = SalaObj::S_BOOL;
+        } else if (lt == SalaObj::S_INT && rt == SalaObj::S_INT) {
+            type = SalaObj::S_INT;
+        } else if ((lt | rt) == SalaObj::S_NUMBER) {
+            type = SalaObj::S_DOUBLE;
+        }
+        return addResult(op, type, left, right, context);
+    }
+
+    static int globalType(SalaObj::Func func)
+    {
+        switch (func) {
+        case SalaObj::S_LEN:
+            return SalaObj::S_INT;
+        case SalaObj::S_RANGE:
+            return 0;
+        default:
+            return SalaObj::S_DOUBLE;
+        }
+    }
+
+    // emits the code for a node, returning the operand its value ends up in
+    // (last is true when nothing more is taken off the eval stack once the node has been evaluated)
+    int emit(int n, int context, bool last)
+    {
+        if (nodes[n].token < 0) {
+            int dest = addRegister(0);
+            add(MISSING, dest, NO_OPERAND, NO_OPERAND, context);
+            return dest;
+        }
+        const SalaObj &data = token(n);
+        if (data.type == SalaObj::S_FUNCTION && !nodes[n].children.empty()) {
+            return emitFunction(n, data.data.func, addContext(data.data.func, context), last);
+        } else if (data.type == SalaObj::S_THIS) {
+            return THIS_OPERAND;
+        } else if (data.type & SalaObj::S_VAR) {
+            return FIRST_VARIABLE_OPERAND - data.data.var;
+        } else if (data.type & SalaObj::S_CONST_LIST) {
+            std::vector<int> items = emitArguments(n, context, last);
+            int dest = addRegister(0);
+            add((data.type == SalaObj::S_CONST_LIST) ? LIST : TUPLE, dest, NO_OPERAND, NO_OPERAND, context);
+            code.m_instructions.back().extra = int(code.m_items.size());
+            code.m_instructions.back().count = int(items.size());
+            code.m_items.insert(code.m_items.end(), items.rbegin(), items.rend());
+            return dest;
+        }
+        return addConstant(data);
+    }
+
+    int emitFunction(int n, SalaObj::Func func, int context, bool last)
+    {
+        const std::vector<int> &children = nodes[n].children;
+        switch (func) {
+        case SalaObj::S_PLUS:
+            return emit(children[0], context, last); // just ignore it
+        case SalaObj::S_MINUS: {
+            int op = emit(children[0], context, last);
+            int type = typeOf(op);
+            if (type == SalaObj::S_DOUBLE) {
+                return addResult(MINUS_F, type, op, NO_OPERAND, context);
+            }
+            return addResult(MINUS, (type == SalaObj::S_INT) ? type : 0, op, NO_OPERAND, context);
+        }
+        case SalaObj::S_NOT: {
+            int op = emit(children[0], context, last);
+            return addResult(NOT, SalaObj::S_BOOL, op, NO_OPERAND, context);
+        }
+        case SalaObj::S_POWER: {
+            // the exponent is converted before the base is evaluated
+            int right = emit(children[0], context, false);
+            int exponent = addResult(TO_DOUBLE, SalaObj::S_DOUBLE, right, NO_OPERAND, context);
+            int left = emit(children[1], context, last);
+            return addResult(POWER, SalaObj::S_DOUBLE, left, exponent, context);
+        }
+        case SalaObj::S_LIST_ACCESS: {
+            int index = emit(children[0], context, false);
+            int x = addResult(TO_INT, SalaObj::S_INT, index, NO_OPERAND, context);
+            int list = emit(children[1], context, last);
+            int dest = addRegister(0);
+            add(ITEM, dest, list, x, context);
+            return dest;
+        }
+        case SalaObj::S_ASSIGN: {
+            int value = emit(children[0], context, false);
+            if (value < 0 && nodes[children[1]].assigns) {
+                int reg = addRegister(0);
+                add(COPY, reg, value, NO_OPERAND, context);
+                value = reg;
+            }
+            int target = emit(children[1], context, last);
+            if (isVariable(children[1])) {
+                add(ASSIGN, NO_OPERAND, target, value, context);
+            } else if (isFunction(children[1], SalaObj::S_LIST_ACCESS)) {
+                add(ASSIGN_ITEM, NO_OPERAND, NO_OPERAND, value, context);
+            } else {
+                add(NOT_ASSIGNABLE, NO_OPERAND, NO_OPERAND, NO_OPERAND, context);
+            }
+            return addConstant(SalaObj()); // assign returns nil value
+        }
+        case SalaObj::S_AND: {
+            // when the right hand side is false the interpreter leaves the left hand side on the eval stack, which
+            // only does no harm if nothing else is to be taken off it - or if this is the right hand side of
+            // another 'and', which will then be false as well
+            if (!last) {
+                ok = false;
+                return addRegister(0);
+            }
+            int right = emit(children[0], context, isFunction(children[0], SalaObj::S_AND));
+            int dest = addRegister(SalaObj::S_BOOL);
+            int jump = add(AND_RIGHT, dest, right, NO_OPERAND, context);
+            int left = emit(children[1], context, true);
+            add(TO_BOOL, dest, left, NO_OPERAND, context);
+            code.m_instructions[jump].count = int(code.m_instructions.size());
+            return dest;
+        }
+        case SalaObj::S_OR: {
+            std::vector<int> ops = emitArguments(n, context, last);
+            return addResult(OR, SalaObj::S_BOOL, ops[1], ops[0], context);
+        }
+        case SalaObj::S_ADD:
+        case SalaObj::S_SUBTRACT:
+        case SalaObj::S_MULTIPLY:
+        case SalaObj::S_DIVIDE:
+        case SalaObj::S_MODULO:
+        case SalaObj::S_EQ:
+        case SalaObj::S_NEQ:
+        case SalaObj::S_GT:
+        case SalaObj::S_LT:
+        case SalaObj::S_GEQ:
+        case SalaObj::S_LEQ:
+        case SalaObj::S_IS: {
+            static const std::map<SalaObj::Func, Op> ops = {
+                {SalaObj::S_ADD, ADD}, {SalaObj::S_SUBTRACT, SUBTRACT}, {SalaObj::S_MULTIPLY, MULTIPLY},
+                {SalaObj::S_DIVIDE, DIVIDE}, {SalaObj::S_MODULO, MODULO}, {SalaObj::S_EQ, EQ},
+                {SalaObj::S_NEQ, NEQ}, {SalaObj::S_GT, GT}, {SalaObj::S_LT, LT},
+                {SalaObj::S_GEQ, GEQ}, {SalaObj::S_LEQ, LEQ}, {SalaObj::S_IS, IS}};
+            std::vector<int> args = emitArguments(n, context, last);
+            return emitBinary(ops.at(func), args[1], args[0], context);
+        }
+        default:
+            break;
+        }
+        if ((func & SalaObj::S_GROUP) == SalaObj::S_GLOBAL_FUNCS) {
+            int arg = emit(children[0], context, last);
+            return addResult(GLOBAL, globalType(func), arg, NO_OPERAND, context, func);
+        }
+        // member functions
+        std::vector<int> args = emitArguments(n, context, last);
+        int obj = args[1], param = args[0];
+        if (func == SalaObj::S_FVALUE && isConstant(param) && code.m_registers[param].type == SalaObj::S_STRING) {
+            if (code.m_registers[param].toStringRef() == "Ref Number") {
+                return addResult(MEMBER, SalaObj::S_INT, obj, param, context, func);
+            }
+            int dest = addResult(VALUE, SalaObj::S_DOUBLE, obj, param, context, func);
+            code.m_instructions.back().extra = int(code.m_columns.size());
+            code.m_columns.push_back(ColumnLookup());
+            return dest;
+        }
+        return addResult(MEMBER, 0, obj, param, context, func);
+    }
+};
+
+bool SalaCode::compile(SalaCommand &command)
+{
+    Compiler compiler(*this, command);
+    int pointer = int(command.m_eval_stack.size()) - 1;
+    int root = compiler.build(pointer);
+    m_result = compiler.emit(root, -1, true);
+    return compiler.ok;
+}
+
+SalaObj SalaCode::run(SalaCommand &command)
+{
+    SalaProgram *program = command.m_program;
+    SalaObj *ref = nullptr;
+    size_t pc = 0;
+    try {
+        while (pc < m_instructions.size()) {
+            const Instruction &in = m_instructions[pc];
+            pc = execute(in, command, program, ref) ? size_t(in.count) : pc + 1;
+        }
+    } catch (SalaError &e) {
+        // as the interpreter would have on its way back up the eval stack
+        int context = m_instructions[pc].context;
+        if (context != -1) {
+            for (SalaObj::Func func : m_contexts[context]) {
+                SalaCommand::prefixError(func, e);
+            }
+            e.lineno = command.m_line;
+        }
+        throw;
+    }
+    return operand(m_result, program);
+}
+
+bool SalaCode::execute(const Instruction &in, SalaCommand &command, SalaProgram *program, SalaObj *&ref)
+{
+    switch (in.op) {
+    case MISSING:
+        throw SalaError("Missing argument", command.m_line);
+    case COPY:
+        m_registers[in.dest] = operand(in.left, program);
+        break;
+    case LIST:
+    case TUPLE: {
+        SalaObj list((in.op == LIST) ? SalaObj::S_LIST : SalaObj::S_TUPLE, in.count);
+        for (int i = 0; i < in.count; i++) {
+            list.data.list.list->at(i) = operand(m_items[in.extra + i], program);
+        }
+        m_registers[in.dest] = list;
+        break;
+    }
+    case ADD:
+        m_registers[in.dest] = operand(in.right, program) + operand(in.left, program);
+        break;
+    case SUBTRACT:
+        m_registers[in.dest] = operand(in.left, program) - operand(in.right, program);
+        break;
+    case MULTIPLY:
+        m_registers[in.dest] = operand(in.right, program) * operand(in.left, program);
+        break;
+    case DIVIDE:
+        m_registers[in.dest] = operand(in.left, program) / operand(in.right, program);
+        break;
+    case MODULO:
+        m_registers[in.dest] = operand(in.left, program) % operand(in.right, program);
+        break;
+    case MINUS:
+        m_registers[in.dest] = -operand(in.left, program);
+        break;
+    case ADD_F:
+        setDouble(m_registers[in.dest], m_registers[in.right].data.f + m_registers[in.left].data.f);
+        break;
+    case SUBTRACT_F:
+        setDouble(m_registers[in.dest], m_registers[in.left].data.f - m_registers[in.right].data.f);
+        break;
+    case MULTIPLY_F:
+        setDouble(m_registers[in.dest], m_registers[in.right].data.f * m_registers[in.left].data.f);
+        break;
+    case DIVIDE_F:
+        setDouble(m_registers[in.dest], m_registers[in.left].data.f / m_registers[in.right].data.f);
+        break;
+    case MODULO_F:
+        setDouble(m_registers[in.dest], fmod(m_registers[in.left].data.f, m_registers[in.right].data.f));
+        break;
+    case MINUS_F:
+        setDouble(m_registers[in.dest], -m_registers[in.left].data.f);
+        break;
+    case TO_DOUBLE:
+        setDouble(m_registers[in.dest], operand(in.left, program).toDouble());
+        break;
+    case POWER:
+        setDouble(m_registers[in.dest], pow(operand(in.left, program).toDouble(), m_registers[in.right].data.f));
+        break;
+    case ASSIGN:
+        operand(in.left, program) = operand(in.right, program);
+        break;
+    case ASSIGN_ITEM:
+        if (ref == nullptr) {
+            throw SalaError("Cannot assign to constant, function or none", command.m_line);
+        }
+        *ref = operand(in.right, program);
+        break;
+    case NOT_ASSIGNABLE:
+        throw SalaError("Cannot assign to constant, function or none", command.m_line);
+    case TO_INT:
+        setInt(m_registers[in.dest], operand(in.left, program).toInt());
+        break;
+    case ITEM: {
+        SalaObj &list = operand(in.left, program);
+        int x = m_registers[in.right].data.i;
+        if (list.type == SalaObj::S_LIST) {
+            // setting ref allows an assignment to modify it
+            ref = &(list.list_at(x));
+            m_registers[in.dest] = *ref;
+        } else if (list.type == SalaObj::S_STRING) {
+            // but n.b., strings cannot be modified
+            ref = nullptr;
+            m_registers[in.dest] = list.char_at(x);
+        } else {
+            throw SalaError("Cannot be applied to " + list.getTypeIndefArt() + list.getTypeStr(), command.m_line);
+        }
+        break;
+    }
+    case EQ:
+        setBool(m_registers[in.dest], operand(in.right, program) == operand(in.left, program));
+        break;
+    case NEQ:
+        setBool(m_registers[in.dest], operand(in.right, program) != operand(in.left, program));
+        break;
+    case GT:
+        setBool(m_registers[in.dest], operand(in.left, program) > operand(in.right, program));
+        break;
+    case LT:
+        setBool(m_registers[in.dest], operand(in.left, program) < operand(in.right, program));
+        break;
+    case GEQ:
+        setBool(m_registers[in.dest], operand(in.left, program) >= operand(in.right, program));
+        break;
+    case LEQ:
+        setBool(m_registers[in.dest], operand(in.left, program) <= operand(in.right, program));
+        break;
+    case EQ_F:
+        setBool(m_registers[in.dest], m_registers[in.right].data.f == m_registers[in.left].data.f);
+        break;
+    case NEQ_F:
+        setBool(m_registers[in.dest], m_registers[in.right].data.f != m_registers[in.left].data.f);
+        break;
+    case GT_F:
+        setBool(m_registers[in.dest], m_registers[in.left].data.f > m_registers[in.right].data.f);
+        break;
+    case LT_F:
+        setBool(m_registers[in.dest], m_registers[in.left].data.f < m_registers[in.right].data.f);
+        break;
+    case GEQ_F:
+        setBool(m_registers[in.dest], m_registers[in.left].data.f >= m_registers[in.right].data.f);
+        break;
+    case LEQ_F:
+        setBool(m_registers[in.dest], m_registers[in.left].data.f <= m_registers[in.right].data.f);
+        break;
+    case IS:
+        m_registers[in.dest] = op_is(operand(in.right, program), operand(in.left, program));
+        break;
+    case OR:
+        setBool(m_registers[in.dest], operand(in.left, program).toBool() || operand(in.right, program).toBool());
+        break;
+    case NOT:
+        setBool(m_registers[in.dest], !operand(in.left, program).toBool());
+        break;
+    case AND_RIGHT: {
+        bool right = operand(in.left, program).toBool();
+        setBool(m_registers[in.dest], right);
+        return !right;
+    }
+    case TO_BOOL:
+        setBool(m_registers[in.dest], operand(in.left, program).toBool());
+        break;
+    case GLOBAL:
+        m_registers[in.dest] = command.callGlobal(in.func, operand(in.left, program));
+        break;
+    case MEMBER:
+        m_registers[in.dest] = command.callMember(in.func, operand(in.left, program), operand(in.right, program));
+        break;
+    case VALUE: {
+        SalaObj &obj = operand(in.left, program);
+        if (obj.type == SalaObj::S_SHAPEMAPOBJ || obj.type == SalaObj::S_POINTMAPOBJ) {
+            setDouble(m_registers[in.dest], value(in, command, program, obj));
+        } else {
+            // not a graph object, which callMember will complain about
+            command.callMember(in.func, obj, m_registers[in.right]);
+        }
+        break;
+    }
+    }
+    return false;
+}
+
+double SalaCode::value(const Instruction &in, SalaCommand &command, SalaProgram *program, SalaObj &obj)
+{
+    AttributeTable *table = obj.getTable();
+    ColumnLookup &column = m_columns[in.extra];
+    if (column.run != program->m_run || column.table != table) {
+        const std::string &name = m_registers[in.right].toStringRef();
+        column.run = program->m_run;
+        column.table = table;
+        column.found = table->hasColumn(name);
+        if (column.found) {
+            column.index = table->getColumnIndex(name);
+            column.values = &table->getColumnValues(column.index);
+        }
+    }
+    if (!column.found) {
+        throw SalaError(m_registers[in.right].toStringRef() + " is an unknown column", command.m_line);
+    }
+    int node = obj.data.graph.node;
+    size_t position = program->m_row_position;
+    if (position < table->getNumRows() && table->getRowKey(position).value == node) {
+        return (*column.values)[position];
+    }
+    return table->getRow(AttributeKey(node)).getValue(column.index);
+}
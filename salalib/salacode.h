@@ -0,0 +1,156 @@
+// sala - a component of the depthmapX - spatial network analysis platform
+// Copyright (C) 2026, Tasos Varoudis
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "salalib/salaprogram.h"
+
+#include <string>
+#include <vector>
+
+// The expression of a SalaCommand compiled to bytecode. SalaCommand::evaluate(pointer, p_obj) walks the eval
+// stack of a command every time it is run, copying every value it passes up the tree; a script that updates
+// a column runs it once for every row. Here the eval stack is lowered once, after parsing, to a flat list of
+// instructions over a register file, which is then run for each row by a single loop.
+//
+// Every value gets its own register, and constants are registers filled in at compile time. Variables and
+// 'this' are read where they live, and only copied first when something evaluated after them might assign to
+// them. Registers also have a static type where it is known: operations on two floats are compiled to
+// instructions that work on the doubles directly, and operations whose operands are all constant are folded
+// into constants. value() with a constant column name finds its column once per run and reads the value of
+// the current row straight from the column values.
+//
+// The instructions are run in the same order as the interpreter evaluates the eval stack, and errors get the
+// same "In ... operator/function:" prefixes and line, so scripts behave exactly as they did when interpreted.
+// An 'and' that is not the last thing evaluated is left to the interpreter: when its right hand side is
+// false the interpreter does not step over its left hand side, and carries on from inside it.
+class SalaCode
+{
+  public:
+    // false if the command has to be interpreted
+    bool compile(SalaCommand &command);
+    SalaObj run(SalaCommand &command);
+
+  private:
+    enum Op {
+        MISSING,
+        COPY,
+        LIST,
+        TUPLE,
+        ADD,
+        SUBTRACT,
+        MULTIPLY,
+        DIVIDE,
+        MODULO,
+        MINUS,
+        ADD_F,
+        SUBTRACT_F,
+        MULTIPLY_F,
+        DIVIDE_F,
+        MODULO_F,
+        MINUS_F,
+        TO_DOUBLE,
+        POWER,
+        ASSIGN,
+        ASSIGN_ITEM,
+        NOT_ASSIGNABLE,
+        TO_INT,
+        ITEM,
+        EQ,
+        NEQ,
+        GT,
+        LT,
+        GEQ,
+        LEQ,
+        EQ_F,
+        NEQ_F,
+        GT_F,
+        LT_F,
+        GEQ_F,
+        LEQ_F,
+        IS,
+        OR,
+        NOT,
+        AND_RIGHT,
+        TO_BOOL,
+        GLOBAL,
+        MEMBER,
+        VALUE
+    };
+
+    // Operands are registers (0 and up), 'this' or a variable of the program
+    enum { NO_OPERAND = -1, THIS_OPERAND = -2, FIRST_VARIABLE_OPERAND = -3 };
+
+    struct Instruction {
+        Op op;
+        int dest;
+        int left;  // the left hand side, the object of a member function or the list of an item
+        int right; // the right hand side, the parameter of a member function or the index of an item
+        int extra; // the first item of a list in m_items, or the column of a value in m_columns
+        int count; // the number of items of a list, or where an 'and' goes when its right hand side is false
+        SalaObj::Func func;
+        int context; // the operators and functions this is evaluated in, in m_contexts, -1 for none
+    };
+
+    // what value() has looked up about its column in the current run
+    struct ColumnLookup {
+        int run = -1;
+        AttributeTable *table = nullptr;
+        bool found = false;
+        size_t index = 0;
+        const std::vector<float> *values = nullptr;
+    };
+
+    std::vector<Instruction> m_instructions;
+    std::vector<SalaObj> m_registers;
+    std::vector<int> m_items;
+    std::vector<ColumnLookup> m_columns;
+    std::vector<std::vector<SalaObj::Func>> m_contexts; // innermost first
+    int m_result = 0;
+
+    struct Compiler;
+
+    SalaObj &operand(int op, SalaProgram *program)
+    {
+        if (op >= 0) {
+            return m_registers[op];
+        }
+        if (op == THIS_OPERAND) {
+            return program->m_thisobj;
+        }
+        return program->m_var_stack[FIRST_VARIABLE_OPERAND - op];
+    }
+    // registers with a static type only ever hold values of that type, so they can be written directly
+    static void setBool(SalaObj &reg, bool value)
+    {
+        reg.type = SalaObj::S_BOOL;
+        reg.data.b = value;
+    }
+    static void setInt(SalaObj &reg, int value)
+    {
+        reg.type = SalaObj::S_INT;
+        reg.data.i = value;
+    }
+    static void setDouble(SalaObj &reg, double value)
+    {
+        reg.type = SalaObj::S_DOUBLE;
+        reg.data.f = value;
+    }
+    // runs a single instruction, returning true if it jumps
+    // (program is null when constants are being folded at compile time)
+    bool execute(const Instruction &in, SalaCommand &command, SalaProgram *program, SalaObj *&ref);
+    double value(const Instruction &in, SalaCommand &command, SalaProgram *program, SalaObj &obj);
+};
@@ -33,6 +33,7 @@
 // alongside the global variable stack
 
 #include "salalib/salaprogram.h"
+#include "salalib/salacode.h"
 #include "salalib/ngraph.h"
 #include "salalib/shapemap.h"
 #include "salalib/pointdata.h"
@@ -127,6 +128,9 @@ SalaProgram::SalaProgram(SalaObj context)
    // col is used when run in update mode, it does not form part of the program:
    m_col = -1;
    m_thisobj = context;
+
+   m_run = 0;
+   m_row_position = size_t(-1);
 }
 
 SalaProgram::~SalaProgram()
@@ -249,6 +253,16 @@ bool SalaProgram::parse(std::istream& program)
 
 SalaObj SalaProgram::evaluate()
 {
+   m_run++;
+   return evaluate(size_t(-1));
+}
+
+// runs the program on the current row of m_thisobj, at the given position in its table if it is known
+
+SalaObj SalaProgram::evaluate(size_t rowPosition)
+{
+   m_row_position = rowPosition;
+
    for (size_t i = 0; i < m_var_stack.size(); i++) {
       // uninitialise all variables:
       m_var_stack[i].uninit();
@@ -279,11 +293,17 @@ bool SalaProgram::runupdate(int col, const std::set<int> &selset)
    // note: reference, will change object directly, which is important for commands running the program
    int& row = m_thisobj.data.graph.node;
    m_col = col;
+   m_run++;
    if (selset.size()) {
+      // the selection and the rows of the table are both in key order, so the rows are found as we go
+      size_t position = 0;
       for (auto& sel: selset) {
          row = sel;
+         while (position < table->getNumRows() && table->getRowKey(position).value < sel) {
+            position++;
+         }
          try {
-            SalaObj val = evaluate();
+            SalaObj val = evaluate(position);
             float v = (float) val.toDouble();   // note, toDouble will type check and throw if there's a problem
             if (!std::isfinite(v)) {
                v = -1.0f;
@@ -298,10 +318,11 @@ bool SalaProgram::runupdate(int col, const std::set<int> &selset)
       }
    }
    else {
-      for (auto iter = table->begin(); iter != table->end(); iter++) {
+      size_t position = 0;
+      for (auto iter = table->begin(); iter != table->end(); iter++, position++) {
          row = iter->getKey().value;
          try {
-            SalaObj val = evaluate();
+            SalaObj val = evaluate(position);
             float v = (float) val.toDouble();   // note, toDouble will type check and throw if there's a problem
             if (!std::isfinite(v)) {
                v = -1.0f;
@@ -324,11 +345,19 @@ bool SalaProgram::runupdate(int col, const std::set<int> &selset)
 bool SalaProgram::runselect(std::vector<int> &selsetout, const std::set<int>& selsetin)
 {
    AttributeTable *table = m_thisobj.getTable();
-
+   //
+   // note: reference, will change object directly, which is important for commands running the program
+   int& row = m_thisobj.data.graph.node;
+   m_run++;
    if (selsetin.size()) {
+      size_t position = 0;
       for (auto& key: selsetin) {
+         row = key;
+         while (position < table->getNumRows() && table->getRowKey(position).value < key) {
+            position++;
+         }
          try {
-            SalaObj val = evaluate();
+            SalaObj val = evaluate(position);
             bool v = val.toBool();   // note, toBool will type check and throw if there's a problem
             if (v) {
                selsetout.push_back(key);
@@ -342,10 +371,12 @@ bool SalaProgram::runselect(std::vector<int> &selsetout, const std::set<int>& se
       }
    }
    else {
-      for (auto iter = table->begin(); iter != table->end(); iter++) {
-          int key = iter->getKey().value;
+      size_t position = 0;
+      for (auto iter = table->begin(); iter != table->end(); iter++, position++) {
+         int key = iter->getKey().value;
+         row = key;
          try {
-            SalaObj val = evaluate();
+            SalaObj val = evaluate(position);
             bool v = val.toBool();   // note, toBool will type check and throw if there's a problem
             if (v) {
                selsetout.push_back(key);
@@ -723,6 +754,15 @@ int SalaCommand::parse(std::istream& program, int line)
    if (m_eval_stack.size() == 0 && m_command != SC_ELSE) { // note, else is by definition empty
       throw SalaError("Partial or missing command",m_line);
    }
+
+   // the eval stack is now fixed, so it can be compiled once rather than interpreted every time it runs:
+   m_code.reset();
+   if (m_command != SC_ELSE) {
+      auto code = std::make_shared<SalaCode>();
+      if (code->compile(*this)) {
+         m_code = code;
+      }
+   }
    return line;
 }
 
@@ -995,15 +1035,13 @@ void SalaCommand::pushFunc(const SalaObj& func)
 
 void SalaCommand::evaluate(SalaObj& obj, bool& ret, bool& ifhandled)
 {
-   int begin = m_eval_stack.size()-1;
-   SalaObj *p_obj = NULL;
    switch (m_command) {
    case SC_EXPR:
-      obj = evaluate(begin,p_obj);
+      obj = evaluate();
       break;
    case SC_RETURN:
       ret = true;
-      obj = evaluate(begin,p_obj);
+      obj = evaluate();
       break;
    case SC_ROOT:
       {
@@ -1016,7 +1054,7 @@ void SalaCommand::evaluate(SalaObj& obj, bool& ret, bool& ifhandled)
       break;
    case SC_IF:
       {
-         SalaObj test = evaluate(begin,p_obj);
+         SalaObj test = evaluate();
          if (test.toBool() == true) {
             for (size_t i = 0; i < m_children.size(); i++) {
                m_children[i].evaluate(obj,ret,ifhandled);
@@ -1032,7 +1070,7 @@ void SalaCommand::evaluate(SalaObj& obj, bool& ret, bool& ifhandled)
       break;
    case SC_ELIF:
       if (!ifhandled) {
-         SalaObj test = evaluate(begin,p_obj);
+         SalaObj test = evaluate();
          if (test.toBool() == true) {
             for (size_t i = 0; i < m_children.size(); i++) {
                m_children[i].evaluate(obj,ret,ifhandled);
@@ -1055,7 +1093,7 @@ void SalaCommand::evaluate(SalaObj& obj, bool& ret, bool& ifhandled)
    case SC_FOR:
       {
          // eventually I'd like to do this with generators / iterators rather than constructing a list each time
-         SalaObj list = evaluate(begin,p_obj);
+         SalaObj list = evaluate();
          if (list.type == SalaObj::S_LIST) {
             int len = list.data.list.list->size();
             if (len != 0) {
@@ -1087,7 +1125,7 @@ void SalaCommand::evaluate(SalaObj& obj, bool& ret, bool& ifhandled)
    case SC_WHILE:
       {
          int counter = 0;
-         while (evaluate(begin,p_obj).toBool()) {
+         while (evaluate().toBool()) {
             for (size_t k = 0; k < m_children.size(); k++) {
                m_children[k].evaluate(obj,ret,ifhandled);
                if (ret)
@@ -1098,7 +1136,6 @@ void SalaCommand::evaluate(SalaObj& obj, bool& ret, bool& ifhandled)
             if (++counter == 0x04000000) { // <- an arbitrary big number
                throw SalaError("Infinite loop",m_line);
             }
-            begin = m_eval_stack.size()-1;
          }
          if (counter) {
             ifhandled = true;
@@ -1114,6 +1151,16 @@ void SalaCommand::evaluate(SalaObj& obj, bool& ret, bool& ifhandled)
    }
 }
 
+SalaObj SalaCommand::evaluate()
+{
+   if (m_code) {
+      return m_code->run(*this);
+   }
+   int pointer = m_eval_stack.size()-1;
+   SalaObj *p_obj = NULL;
+   return evaluate(pointer,p_obj);
+}
+
 SalaObj SalaCommand::evaluate(int& pointer, SalaObj* &p_obj)
 {
    if (pointer < 0) {
@@ -1203,8 +1250,11 @@ SalaObj SalaCommand::evaluate(int& pointer, SalaObj* &p_obj)
 #endif               
                break;
             case SalaObj::S_POWER:
-               data = evaluate(pointer,p_obj);   // reverse order
-               data = pow(evaluate(pointer,p_obj).toDouble(),data.toDouble());
+               {
+                  data = evaluate(pointer,p_obj);   // reverse order
+                  double exponent = data.toDouble();
+                  data = pow(evaluate(pointer,p_obj).toDouble(),exponent);
+               }
                break;
             case SalaObj::S_ASSIGN:
                data = evaluate(pointer,p_obj);  // reverse order
@@ -1241,13 +1291,7 @@ SalaObj SalaCommand::evaluate(int& pointer, SalaObj* &p_obj)
          }
          catch (SalaError e)
          {
-            // slow to go through one by one, but this is an exception...
-            for (size_t i = 0; i < g_sala_math_ops.size(); i++) {
-               if (g_sala_math_ops[i].func == func) {
-                  e.message = "In '" + g_sala_math_ops[i].name + "' operator: " + e.message;
-                  break;
-               }
-            }
+            prefixError(func, e);
             e.lineno = m_line; throw std::move(e);
          }
       }
@@ -1360,99 +1404,18 @@ SalaObj SalaCommand::evaluate(int& pointer, SalaObj* &p_obj)
          }
          catch (SalaError e)
          {
-            // slow to go through one by one, but this is an exception...
-            for (size_t i = 0; i < g_sala_logical_ops.size(); i++) {
-               if (g_sala_logical_ops[i].func == func) {
-                  e.message = "In '" + g_sala_logical_ops[i].name + "' operator: " + e.message;
-                  break;
-               }
-            }
-            for (size_t j = 0; j < g_sala_comp_ops.size(); j++) {
-               if (g_sala_comp_ops[j].func == func) {
-                  e.message = "In '" + g_sala_comp_ops[j].name + "' operator: " + e.message;
-                  break;
-               }
-            }
+            prefixError(func, e);
             e.lineno = m_line; throw std::move(e);
          }
       }
       else if (group == SalaObj::S_GLOBAL_FUNCS) {
          try {
-            switch (func) {
-            case SalaObj::S_LEN:
-               data = evaluate(pointer,p_obj);
-               data = SalaObj( data.length() );
-               break;
-            case SalaObj::S_RANGE:
-               data = evaluate(pointer,p_obj);
-               { 
-                  int len = data.length();
-                  if (len != 2 && len != 3) {
-                     throw SalaError("Range takes either 2 or 3 parameters",m_line);
-                  }
-                  int start = data.data.list.list->at(0).toInt();
-                  int end = data.data.list.list->at(1).toInt();
-                  int step = (len == 3) ? data.data.list.list->at(2).toInt() : 1;
-                  if (step == 0) {
-                     throw SalaError("Range cannot have a step of 0",m_line);
-                  }
-                  int listlen = (int) ceil(float(end - start) / float(step)); 
-                  if (listlen <= 0) {
-                     data = SalaObj( SalaObj::S_LIST );
-                  }
-                  else {
-                     data = SalaObj( SalaObj::S_LIST, listlen );
-                     for (int i = start, j = 0; i < end; i += step, j++) {
-                        data.data.list.list->at(j) = i;
-                     }
-                  }
-               }
-               break;
-            case SalaObj::S_SQRT:
-               data = sqrt(evaluate(pointer,p_obj).toDouble());
-               break;
-            case SalaObj::S_LOG:
-               data = log10(evaluate(pointer,p_obj).toDouble());
-               break;
-            case SalaObj::S_LN:
-               data = ln(evaluate(pointer,p_obj).toDouble());
-               break;
-            case SalaObj::S_RAND:
-               data = evaluate(pointer,p_obj);
-               data.ensureNone();
-               data = SalaObj(prandom());
-               break;
-            case SalaObj::S_SIN:
-               data = sin(evaluate(pointer,p_obj).toDouble());
-               break;
-            case SalaObj::S_COS:
-               data = cos(evaluate(pointer,p_obj).toDouble());
-               break;
-            case SalaObj::S_TAN:
-               data = tan(evaluate(pointer,p_obj).toDouble());
-               break;
-            case SalaObj::S_ASIN:
-               data = asin(evaluate(pointer,p_obj).toDouble());
-               break;
-            case SalaObj::S_ACOS:
-               data = acos(evaluate(pointer,p_obj).toDouble());
-               break;
-            case SalaObj::S_ATAN:
-               data = atan(evaluate(pointer,p_obj).toDouble());
-               break;
-            default:
-                break;
-            }
+            SalaObj arg = evaluate(pointer,p_obj);
+            data = callGlobal(func, arg);
          }
          catch (SalaError e)
          {
-            // slow to go through one by one, but this is an exception...
-            for (size_t i = 0; i < g_sala_global_funcs.size(); i++) {
-               if (g_sala_global_funcs[i].func == func) {
-                  e.message = "In '" + g_sala_global_funcs[i].name + "' function: " + e.message;
-                  break;
-               }
-            }
+            prefixError(func, e);
             e.lineno = m_line; throw std::move(e);
          }
       }
@@ -1460,127 +1423,11 @@ SalaObj SalaCommand::evaluate(int& pointer, SalaObj* &p_obj)
          try {
             SalaObj param = evaluate(pointer,p_obj);
             SalaObj obj = evaluate(pointer,p_obj);
-            switch (obj.type) {
-            case SalaObj::S_LIST: case SalaObj::S_TUPLE:
-               switch (func) {
-               case SalaObj::S_FAPPEND:
-                  obj.data.list.list->push_back(param);
-                  data = SalaObj(); // returns none
-                  break;
-               case SalaObj::S_FEXTEND:
-                  if (param.type & SalaObj::S_LIST) {
-                     int count = param.data.list.list->size();
-                     for (int i = 0; i < count; i++) {
-                        obj.data.list.list->push_back(param.data.list.list->at(i));
-                     }
-                  }
-                  else {
-                     throw SalaError("Parameter must be a list not "  + param.getTypeIndefArt() + param.getTypeStr(),m_line);
-                  }
-                  data = SalaObj(); // returns none
-                  break;
-               case SalaObj::S_FPOP:
-                  if (obj.data.list.list->size() == 0) {
-                     throw SalaError("List is empty", m_line);
-                  }
-                  if (param.type == SalaObj::S_NONE) {
-                     data = obj.data.list.list->back();
-                     obj.data.list.list->pop_back();
-                  }
-                  else {
-                     std::vector<SalaObj>& list = *(obj.data.list.list);
-                     int i = param.toInt();
-                     if (i < 0) 
-                        i += list.size();
-                     if (i < 0 || i >= (int)list.size()) 
-                        throw SalaError("Index out of range");
-                     data = list[i];
-                     list.erase(list.begin() + i);
-                  }
-                  break;
-               case SalaObj::S_FCLEAR:
-                  param.ensureNone();
-                  obj.data.list.list->clear();
-                  obj = SalaObj();
-                  break;
-               default:
-                  throw SalaError("Not a member function of " + obj.getTypeStr(),m_line);
-               }
-               break;
-            case SalaObj::S_SHAPEMAPOBJ: case SalaObj::S_POINTMAPOBJ:
-               switch (func) {
-               case SalaObj::S_FVALUE:
-                  {
-                     const std::string& str = param.toStringRef();
-                     AttributeTable *table = obj.getTable();
-                     if (str == "Ref Number") {
-                         data = SalaObj(obj.data.graph.node);
-                     } else {
-                         if (!table->hasColumn(str)) {
-                            throw SalaError(str + " is an unknown column",m_line);
-                         }
-                         data = SalaObj(table->getRow(AttributeKey(obj.data.graph.node)).getValue(
-                                            table->getColumnIndex(str)));
-                     }
-                  }
-                  break;
-               case SalaObj::S_FSETVALUE:
-                  {
-                     if (param.length() != 2) {
-                        throw SalaError("Function takes 2 parameters");
-                     }
-                     const std::string& str = param.list_at(0).toStringRef();
-                     float val = (float) param.list_at(1).toDouble();
-                     AttributeTable *table = obj.getTable();
-                     int col = -1;
-                     if (str != "Ref Number") {
-                        if (!table->hasColumn(str)) {
-                           throw SalaError(str + " is an unknown column",m_line);
-                        }
-                        col = table->getColumnIndex(str);
-                     } else {
-                         throw SalaError("The reference number can not be changed",m_line);
-                     }
-                     table->getRow(AttributeKey(obj.data.graph.node)).setValue(col, val);
-                     data = SalaObj(); // returns none
-                  }
-                  break;
-               case SalaObj::S_FCONNECTIONS:
-                  {
-                     data = connections(obj, param);
-                  }
-                  break;
-               case SalaObj::S_FMARK:
-                  {
-                     param.ensureNone();
-                     data = m_program->marks[obj.data.graph.node];
-                  }
-                  break;
-               case SalaObj::S_FSETMARK:
-                  {
-                     m_program->marks[obj.data.graph.node] = param;
-                     m_program->m_marked = true;   // <- this tells the program to tidy up marks between executions
-                     data = SalaObj(); // returns none
-                  }
-                  break;
-               default:
-                  throw SalaError("Not a member function of " + obj.getTypeStr(),m_line);
-               }
-               break;
-            default:
-               throw SalaError("Not a member function of " + obj.getTypeStr(), m_line);
-            }
+            data = callMember(func, obj, param);
          }
          catch (SalaError e)
          {
-            // slow to go through one by one, but this is an exception...
-            for (size_t i = 0; i < g_sala_member_funcs.size(); i++) {
-               if (g_sala_member_funcs[i].func == func) {
-                  SalaObj type = SalaObj(g_sala_member_funcs[i].type);
-                  e.message = "In " + type.getTypeStr() + " '" + g_sala_member_funcs[i].name + "' function: " + e.message;
-                  break;
-               }
-            }
+            prefixError(func, e);
             e.lineno = m_line; throw std::move(e);
          }
       }
@@ -1608,6 +1455,243 @@ SalaObj SalaCommand::evaluate(int& pointer, SalaObj* &p_obj)
 
 /////////////////////////////////////////////////////////////////////////////////
 
+// the built-in functions, applied to arguments that have already been evaluated
+
+SalaObj SalaCommand::callGlobal(SalaObj::Func func, SalaObj& arg)
+{
+   SalaObj data = SalaObj(func);
+   switch (func) {
+   case SalaObj::S_LEN:
+      data = SalaObj( arg.length() );
+      break;
+   case SalaObj::S_RANGE:
+      { 
+         int len = arg.length();
+         if (len != 2 && len != 3) {
+            throw SalaError("Range takes either 2 or 3 parameters",m_line);
+         }
+         int start = arg.data.list.list->at(0).toInt();
+         int end = arg.data.list.list->at(1).toInt();
+         int step = (len == 3) ? arg.data.list.list->at(2).toInt() : 1;
+         if (step == 0) {
+            throw SalaError("Range cannot have a step of 0",m_line);
+         }
+         int listlen = (int) ceil(float(end - start) / float(step)); 
+         if (listlen <= 0) {
+            data = SalaObj( SalaObj::S_LIST );
+         }
+         else {
+            data = SalaObj( SalaObj::S_LIST, listlen );
+            for (int i = start, j = 0; i < end; i += step, j++) {
+               data.data.list.list->at(j) = i;
+            }
+         }
+      }
+      break;
+   case SalaObj::S_SQRT:
+      data = sqrt(arg.toDouble());
+      break;
+   case SalaObj::S_LOG:
+      data = log10(arg.toDouble());
+      break;
+   case SalaObj::S_LN:
+      data = ln(arg.toDouble());
+      break;
+   case SalaObj::S_RAND:
+      arg.ensureNone();
+      data = SalaObj(prandom());
+      break;
+   case SalaObj::S_SIN:
+      data = sin(arg.toDouble());
+      break;
+   case SalaObj::S_COS:
+      data = cos(arg.toDouble());
+      break;
+   case SalaObj::S_TAN:
+      data = tan(arg.toDouble());
+      break;
+   case SalaObj::S_ASIN:
+      data = asin(arg.toDouble());
+      break;
+   case SalaObj::S_ACOS:
+      data = acos(arg.toDouble());
+      break;
+   case SalaObj::S_ATAN:
+      data = atan(arg.toDouble());
+      break;
+   default:
+       break;
+   }
+   return data;
+}
+
+SalaObj SalaCommand::callMember(SalaObj::Func func, SalaObj& obj, SalaObj& param)
+{
+   SalaObj data = SalaObj(func);
+   switch (obj.type) {
+   case SalaObj::S_LIST: case SalaObj::S_TUPLE:
+      switch (func) {
+      case SalaObj::S_FAPPEND:
+         obj.data.list.list->push_back(param);
+         data = SalaObj(); // returns none
+         break;
+      case SalaObj::S_FEXTEND:
+         if (param.type & SalaObj::S_LIST) {
+            int count = param.data.list.list->size();
+            for (int i = 0; i < count; i++) {
+               obj.data.list.list->push_back(param.data.list.list->at(i));
+            }
+         }
+         else {
+            throw SalaError("Parameter must be a list not "  + param.getTypeIndefArt() + param.getTypeStr(),m_line);
+         }
+         data = SalaObj(); // returns none
+         break;
+      case SalaObj::S_FPOP:
+         if (obj.data.list.list->size() == 0) {
+            throw SalaError("List is empty", m_line);
+         }
+         if (param.type == SalaObj::S_NONE) {
+            data = obj.data.list.list->back();
+            obj.data.list.list->pop_back();
+         }
+         else {
+            std::vector<SalaObj>& list = *(obj.data.list.list);
+            int i = param.toInt();
+            if (i < 0) 
+               i += list.size();
+            if (i < 0 || i >= (int)list.size()) 
+               throw SalaError("Index out of range");
+            data = list[i];
+            list.erase(list.begin() + i);
+         }
+         break;
+      case SalaObj::S_FCLEAR:
+         param.ensureNone();
+         obj.data.list.list->clear();
+         break;
+      default:
+         throw SalaError("Not a member function of " + obj.getTypeStr(),m_line);
+      }
+      break;
+   case SalaObj::S_SHAPEMAPOBJ: case SalaObj::S_POINTMAPOBJ:
+      switch (func) {
+      case SalaObj::S_FVALUE:
+         {
+            const std::string& str = param.toStringRef();
+            AttributeTable *table = obj.getTable();
+            if (str == "Ref Number") {
+                data = SalaObj(obj.data.graph.node);
+            } else {
+                if (!table->hasColumn(str)) {
+                   throw SalaError(str + " is an unknown column",m_line);
+                }
+                data = SalaObj(table->getRow(AttributeKey(obj.data.graph.node)).getValue(
+                                   table->getColumnIndex(str)));
+            }
+         }
+         break;
+      case SalaObj::S_FSETVALUE:
+         {
+            if (param.length() != 2) {
+               throw SalaError("Function takes 2 parameters");
+            }
+            const std::string& str = param.list_at(0).toStringRef();
+            float val = (float) param.list_at(1).toDouble();
+            AttributeTable *table = obj.getTable();
+            int col = -1;
+            if (str != "Ref Number") {
+               if (!table->hasColumn(str)) {
+                  throw SalaError(str + " is an unknown column",m_line);
+               }
+               col = table->getColumnIndex(str);
+            } else {
+                throw SalaError("The reference number can not be changed",m_line);
+            }
+            table->getRow(AttributeKey(obj.data.graph.node)).setValue(col, val);
+            data = SalaObj(); // returns none
+         }
+         break;
+      case SalaObj::S_FCONNECTIONS:
+         {
+            data = connections(obj, param);
+         }
+         break;
+      case SalaObj::S_FMARK:
+         {
+            param.ensureNone();
+            data = m_program->marks[obj.data.graph.node];
+         }
+         break;
+      case SalaObj::S_FSETMARK:
+         {
+            m_program->marks[obj.data.graph.node] = param;
+            m_program->m_marked = true;   // <- this tells the program to tidy up marks between executions
+            data = SalaObj(); // returns none
+         }
+         break;
+      default:
+         throw SalaError("Not a member function of " + obj.getTypeStr(),m_line);
+      }
+      break;
+   default:
+      throw SalaError("Not a member function of " + obj.getTypeStr(), m_line);
+   }
+   return data;
+}
+
+// errors in operators and functions are prefixed with what they happened in:
+
+void SalaCommand::prefixError(SalaObj::Func func, SalaError& e)
+{
+   // slow to go through one by one, but this is an exception...
+   switch (func & SalaObj::S_GROUP) {
+   case SalaObj::S_MATH_OPS:
+      for (size_t i = 0; i < g_sala_math_ops.size(); i++) {
+         if (g_sala_math_ops[i].func == func) {
+            e.message = "In '" + g_sala_math_ops[i].name + "' operator: " + e.message;
+            break;
+         }
+      }
+      break;
+   case SalaObj::S_LOGICAL_OPS:
+      for (size_t i = 0; i < g_sala_logical_ops.size(); i++) {
+         if (g_sala_logical_ops[i].func == func) {
+            e.message = "In '" + g_sala_logical_ops[i].name + "' operator: " + e.message;
+            break;
+         }
+      }
+      for (size_t j = 0; j < g_sala_comp_ops.size(); j++) {
+         if (g_sala_comp_ops[j].func == func) {
+            e.message = "In '" + g_sala_comp_ops[j].name + "' operator: " + e.message;
+            break;
+         }
+      }
+      break;
+   case SalaObj::S_GLOBAL_FUNCS:
+      for (size_t i = 0; i < g_sala_global_funcs.size(); i++) {
+         if (g_sala_global_funcs[i].func == func) {
+            e.message = "In '" + g_sala_global_funcs[i].name + "' function: " + e.message;
+            break;
+         }
+      }
+      break;
+   case SalaObj::S_MEMBER_FUNCS:
+      for (size_t i = 0; i < g_sala_member_funcs.size(); i++) {
+         if (g_sala_member_funcs[i].func == func) {
+            SalaObj type = SalaObj(g_sala_member_funcs[i].type);
+            e.message = "In " + type.getTypeStr() + " '" + g_sala_member_funcs[i].name + "' function: " + e.message;
+            break;
+         }
+      }
+      break;
+   default:
+      break;
+   }
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+
 SalaObj SalaCommand::connections(SalaObj graphobj, SalaObj param)
 {
    // now, depending on type of object, it may or may not be allowed parameters:
@@ -1645,8 +1729,7 @@ SalaObj SalaCommand::connections(SalaObj graphobj, SalaObj param)
       }
    }
    else {
-      int idx = std::distance(graphobj.data.graph.map.shape->getAllShapes().begin(),
-                                graphobj.data.graph.map.shape->getAllShapes().find(graphobj.data.graph.node));
+      int idx = graphobj.data.graph.map.shape->getShapeIndexFromKey(graphobj.data.graph.node);
       const Connector& connector = graphobj.data.graph.map.shape->getConnections()[idx];
       int mode = Connector::CONN_ALL;
       if (graphobj.data.graph.map.shape->isSegmentMap()) {
@@ -23,6 +23,7 @@
 #include "genlib/stringutils.h"
 
 #include <cmath>
+#include <memory>
 #include <vector>
 #include <set>
 #include <map>
@@ -121,6 +122,7 @@ class SalaObj
    friend class SalaProgram;
    friend class SalaCommand;
    friend class SalaArray;
+   friend class SalaCode;
 public:
    // Object types
    enum Type { S_BRACKET = 0x0000003f, S_OPEN_SQR_BRACKET = 0x0000000c,
@@ -255,10 +257,12 @@ public:
 
 // Quick mod - TV
 class SalaProgram;
+class SalaCode;
 
 class SalaCommand
 {
    friend class SalaProgram;
+   friend class SalaCode;
    //
    enum Command { SC_NONE, SC_ROOT, SC_EXPR, SC_RETURN, SC_FOR, SC_WHILE, SC_IF, SC_ELIF, SC_ELSE };
    enum { SP_NONE, SP_DATA, SP_NUMBER, SP_FUNCTION, SP_COMMAND }; // used while calculating what is on eval stack
@@ -280,6 +284,10 @@ protected:
    int m_line; // useful for debugging to know which line this command starts on
    std::string m_last_string; // occassionally useful in debugging if the user does something unsyntactical
    //
+   // the eval stack compiled to bytecode once it has been parsed, so that it is not walked again for every
+   // row the program is run on (null if the expression can only be interpreted from the eval stack)
+   std::shared_ptr<SalaCode> m_code;
+   //
 public:
    SalaCommand() { m_program = NULL; m_parent = NULL; m_indent = 0; m_command = SC_NONE; }
    SalaCommand(SalaProgram *program, SalaCommand *parent, int indent, Command command = SC_NONE);
@@ -290,13 +298,19 @@ protected:
    void pushFunc(const SalaObj& func);
    //
    void evaluate(SalaObj& obj, bool& ret, bool& ifhandled);
+   SalaObj evaluate();  // the value of the expression on the eval stack, run from its bytecode if it has any
    SalaObj evaluate(int& pointer, SalaObj* &p_obj);
    SalaObj connections(SalaObj graphnode, SalaObj param); 
+   // shared by the interpreter and the bytecode, once the arguments have been evaluated:
+   SalaObj callGlobal(SalaObj::Func func, SalaObj& arg);
+   SalaObj callMember(SalaObj::Func func, SalaObj& obj, SalaObj& param);
+   static void prefixError(SalaObj::Func func, SalaError& e);
 };
 
 class SalaProgram
 {
    friend class SalaCommand;
+   friend class SalaCode;
    //
    SalaCommand m_root_command;
    std::vector<SalaObj> m_var_stack;
@@ -311,6 +325,13 @@ class SalaProgram
    bool m_marked; // this is used to tell the program that a node has been "marked" -- all marks are cleared at the end of the execution
    // marks for state management in maps
    std::map<int, SalaObj> marks;
+   //
+   // each run of the program (a single evaluate, or a whole runupdate or runselect) has its own number, so that
+   // compiled commands know when what they have looked up in the attribute table has to be looked up again,
+   // and while running over a table the position of the current row lets them read values from its columns
+   int m_run;
+   size_t m_row_position;
+   SalaObj evaluate(size_t rowPosition);
 
 public:
    SalaProgram(SalaObj context);
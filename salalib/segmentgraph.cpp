@@ -0,0 +1,44 @@
+// sala - a component of the depthmapX - spatial network analysis platform
+// Copyright (C) 2026, Tasos Varoudis
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "salalib/segmentgraph.h"
+
+SegmentGraph::SegmentGraph(const std::vector<Connector> &connectors) {
+    size_t edgeCount = 0;
+    for (const Connector &connector : connectors) {
+        edgeCount += connector.m_back_segconns.size() + connector.m_forward_segconns.size();
+    }
+    m_offsets.reserve(connectors.size() + 1);
+    m_forward_offsets.reserve(connectors.size());
+    m_neighbours.reserve(edgeCount);
+    m_directions.reserve(edgeCount);
+    m_weights.reserve(edgeCount);
+
+    auto addEdges = [this](const std::map<SegmentRef, float> &segconns) {
+        for (const auto &segconn : segconns) {
+            m_neighbours.push_back(segconn.first.ref);
+            m_directions.push_back(segconn.first.dir);
+            m_weights.push_back(segconn.second);
+        }
+    };
+    m_offsets.push_back(0);
+    for (const Connector &connector : connectors) {
+        addEdges(connector.m_back_segconns);
+        m_forward_offsets.push_back(m_neighbours.size());
+        addEdges(connector.m_forward_segconns);
+        m_offsets.push_back(m_neighbours.size());
+    }
+}
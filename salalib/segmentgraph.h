@@ -0,0 +1,57 @@
+// sala - a component of the depthmapX - spatial network analysis platform
+// Copyright (C) 2026, Tasos Varoudis
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "salalib/connector.h"
+
+#include <vector>
+
+// A read-only snapshot of the segment connections of a ShapeMap in compressed sparse row
+// form, for the segment analyses. The connections of each segment are stored contiguously,
+// those off its back end first and then those off its forward end, each in the order of the
+// Connector maps they come from. Every connection keeps the direction of the segment it
+// leads to and the angle of the turn onto it in parallel arrays. The Connector maps remain
+// the editable copy (and the one that is read and written); ShapeMap::getSegmentGraph()
+// builds the snapshot the first time it is asked for and keeps it until the connections change.
+
+class SegmentGraph {
+  public:
+    SegmentGraph() {}
+    SegmentGraph(const std::vector<Connector> &connectors);
+
+    size_t segmentCount() const { return m_offsets.empty() ? 0 : m_offsets.size() - 1; }
+
+    // the connections off the back of a segment are [backBegin(segment), backEnd(segment))
+    // and those off the front [forwardBegin(segment), forwardEnd(segment))
+    size_t backBegin(int segment) const { return m_offsets[size_t(segment)]; }
+    size_t backEnd(int segment) const { return m_forward_offsets[size_t(segment)]; }
+    size_t forwardBegin(int segment) const { return m_forward_offsets[size_t(segment)]; }
+    size_t forwardEnd(int segment) const { return m_offsets[size_t(segment) + 1]; }
+
+    int neighbour(size_t edge) const { return m_neighbours[edge]; }
+    // the end the connected segment is entered from (1 or -1, as in SegmentRef::dir)
+    char direction(size_t edge) const { return m_directions[edge]; }
+    float weight(size_t edge) const { return m_weights[edge]; }
+    SegmentRef segmentRef(size_t edge) const { return SegmentRef(m_directions[edge], m_neighbours[edge]); }
+
+  private:
+    std::vector<size_t> m_offsets;
+    std::vector<size_t> m_forward_offsets;
+    std::vector<int> m_neighbours;
+    std::vector<char> m_directions;
+    std::vector<float> m_weights;
+};
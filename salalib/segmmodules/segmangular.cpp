@@ -73,6 +73,7 @@ bool SegmentAngular::run(Communicator *comm, ShapeGraph &map, bool) {
     }
 
     std::vector<bool> covered(map.getShapeCount());
+    const SegmentGraph &graph = map.getSegmentGraph();
     size_t i = 0;
     for (auto & iter : attributes){
         for (size_t j = 0; j < map.getShapeCount(); j++) {
@@ -97,11 +98,10 @@ bool SegmentAngular::run(Communicator *comm, ShapeGraph &map, bool) {
                 total_depth[lineindex.coverage] += depth_to_line;
                 node_count[lineindex.coverage] += 1;
                 anglebins.erase(iter);
-                Connector &line = map.getConnections()[lineindex.ref];
                 if (lineindex.dir != -1) {
-                    for (auto &segconn : line.m_forward_segconns) {
-                        if (!covered[segconn.first.ref]) {
-                            double angle = depth_to_line + segconn.second;
+                    for (size_t edge = graph.forwardBegin(lineindex.ref); edge < graph.forwardEnd(lineindex.ref); edge++) {
+                        if (!covered[graph.neighbour(edge)]) {
+                            double angle = depth_to_line + graph.weight(edge);
                             size_t rbin = lineindex.coverage;
                             while (rbin != radii.size() && radii[rbin] != -1 && angle > radii[rbin]) {
                                 rbin++;
@@ -109,15 +109,15 @@ bool SegmentAngular::run(Communicator *comm, ShapeGraph &map, bool) {
                             if (rbin != radii.size()) {
                                 depthmapX::insert_sorted(
                                     anglebins, std::make_pair(float(angle),
-                                                              SegmentData(segconn.first, SegmentRef(), 0, 0.0, rbin)));
+                                                              SegmentData(graph.segmentRef(edge), SegmentRef(), 0, 0.0, rbin)));
                             }
                         }
                     }
                 }
                 if (lineindex.dir != 1) {
-                    for (auto &segconn : line.m_back_segconns) {
-                        if (!covered[segconn.first.ref]) {
-                            double angle = depth_to_line + segconn.second;
+                    for (size_t edge = graph.backBegin(lineindex.ref); edge < graph.backEnd(lineindex.ref); edge++) {
+                        if (!covered[graph.neighbour(edge)]) {
+                            double angle = depth_to_line + graph.weight(edge);
                             size_t rbin = lineindex.coverage;
                             while (rbin != radii.size() && radii[rbin] != -1 && angle > radii[rbin]) {
                                 rbin++;
@@ -125,7 +125,7 @@ bool SegmentAngular::run(Communicator *comm, ShapeGraph &map, bool) {
                             if (rbin != radii.size()) {
                                 depthmapX::insert_sorted(
                                     anglebins, std::make_pair(float(angle),
-                                                              SegmentData(segconn.first, SegmentRef(), 0, 0.0, rbin)));
+                                                              SegmentData(graph.segmentRef(edge), SegmentRef(), 0, 0.0, rbin)));
                             }
                         }
                     }
@@ -33,6 +33,18 @@ struct TopoMetSegmentRef {
     }
 };
 
+// an entry in the bins of the metric and topological analyses: the segment, and the radii
+// (one bit each) that reached it with this push
+
+struct TopoMetSegmentEntry {
+    int ref;
+    unsigned int radiusmask;
+    TopoMetSegmentEntry(int r = -1, unsigned int m = 0) {
+        ref = r;
+        radiusmask = m;
+    }
+};
+
 // should be double not float!
 
 struct TopoMetSegmentChoice {
@@ -18,6 +18,8 @@
 
 #include "salalib/segmmodules/segmmetric.h"
 
+#include "salalib/resultwriter.h"
+
 #include "genlib/stringutils.h"
 
 bool SegmentMetric::run(Communicator *comm, ShapeGraph &map, bool) {
@@ -40,59 +42,121 @@ bool SegmentMetric::run(Communicator *comm, ShapeGraph &map, bool) {
     // quick through to find the longest seg length
     std::vector<float> seglengths;
     float maxseglength = 0.0f;
+    ColumnHandle axialrefcol = attributes.getColumnHandle("Axial Line Ref");
+    ColumnHandle seglengthcol = attributes.getColumnHandle("Segment Length");
     for (size_t cursor = 0; cursor < map.getShapeCount(); cursor++) {
         AttributeRow& row = map.getAttributeRowFromShapeIndex(cursor);
-        axialrefs.push_back(row.getValue(attributes.getColumnIndex("Axial Line Ref")));
-        seglengths.push_back(row.getValue(attributes.getColumnIndex("Segment Length")));
+        axialrefs.push_back(row.getValue(axialrefcol.index));
+        seglengths.push_back(row.getValue(seglengthcol.index));
         if (seglengths.back() > maxseglength) {
             maxseglength = seglengths.back();
         }
     }
 
-    std::string prefix, suffix;
+    // radii lowest to highest, with radius n (-1) last, as in the angular analysis
+    bool radius_n = false;
+    std::vector<double> radii;
+    for (double radius : m_radius_set) {
+        if (radius < 0) {
+            radius_n = true;
+        } else {
+            radii.push_back(radius);
+        }
+    }
+    if (radius_n) {
+        radii.push_back(-1.0);
+    }
+    const size_t radiussize = radii.size();
+    unsigned int radiusmask = 0;
+    for (size_t r = 0; r < radiussize; r++) {
+        radiusmask |= (1 << r);
+    }
+
+    std::string prefix;
     int maxbin = 512;
     prefix = "Metric ";
 
-    if (m_radius != -1.0) {
-        suffix = dXstring::formatString(m_radius, " R%.f metric");
+    std::vector<std::string> choicecols, wchoicecols, meandepthcols, wmeandepthcols, totaldcols, totalcols, wtotalcols;
+    for (double radius : radii) {
+        std::string suffix;
+        if (radius != -1.0) {
+            suffix = dXstring::formatString(radius, " R%.f metric");
+        }
+        choicecols.push_back(prefix + "Choice" + suffix);
+        wchoicecols.push_back(prefix + "Choice [SLW]" + suffix);
+        meandepthcols.push_back(prefix + "Mean Depth" + suffix);
+        wmeandepthcols.push_back(prefix + std::string("Mean Depth [SLW]") + suffix);
+        totaldcols.push_back(prefix + "Total Depth" + suffix);
+        totalcols.push_back(prefix + "Total Nodes" + suffix);
+        wtotalcols.push_back(prefix + "Total Length" + suffix);
     }
-    std::string choicecol = prefix + "Choice" + suffix;
-    std::string wchoicecol = prefix + "Choice [SLW]" + suffix;
-    std::string meandepthcol = prefix + "Mean Depth" + suffix;
-    std::string wmeandepthcol = prefix + std::string("Mean Depth [SLW]") + suffix;
-    std::string totaldcol = prefix + "Total Depth" + suffix;
-    std::string totalcol = prefix + "Total Nodes" + suffix;
-    std::string wtotalcol = prefix + "Total Length" + suffix;
     //
-    if (!m_sel_only) {
-        attributes.insertOrResetColumn(choicecol.c_str());
-        attributes.insertOrResetColumn(wchoicecol.c_str());
+    for (size_t r = 0; r < radiussize; r++) {
+        if (!m_sel_only) {
+            attributes.insertOrResetColumn(choicecols[r].c_str());
+            attributes.insertOrResetColumn(wchoicecols[r].c_str());
+        }
+        attributes.insertOrResetColumn(meandepthcols[r].c_str());
+        attributes.insertOrResetColumn(wmeandepthcols[r].c_str());
+        attributes.insertOrResetColumn(totaldcols[r].c_str());
+        attributes.insertOrResetColumn(totalcols[r].c_str());
+        attributes.insertOrResetColumn(wtotalcols[r].c_str());
+    }
+    // the results are collected and go into the table at the end
+    ResultWriter results(attributes);
+    std::vector<ColumnHandle> choicehandles, wchoicehandles, meandepthhandles, wmeandepthhandles, totaldhandles,
+        totalhandles, wtotalhandles;
+    for (size_t r = 0; r < radiussize; r++) {
+        if (!m_sel_only) {
+            choicehandles.push_back(results.addColumn(choicecols[r]));
+            wchoicehandles.push_back(results.addColumn(wchoicecols[r]));
+        }
+        meandepthhandles.push_back(results.addColumn(meandepthcols[r]));
+        wmeandepthhandles.push_back(results.addColumn(wmeandepthcols[r]));
+        totaldhandles.push_back(results.addColumn(totaldcols[r]));
+        totalhandles.push_back(results.addColumn(totalcols[r]));
+        wtotalhandles.push_back(results.addColumn(wtotalcols[r]));
     }
-    attributes.insertOrResetColumn(meandepthcol.c_str());
-    attributes.insertOrResetColumn(wmeandepthcol.c_str());
-    attributes.insertOrResetColumn(totaldcol.c_str());
-    attributes.insertOrResetColumn(totalcol.c_str());
-    attributes.insertOrResetColumn(wtotalcol.c_str());
     //
-    std::vector<unsigned int> seen(map.getShapeCount());
-    std::vector<TopoMetSegmentRef> audittrail(map.getShapeCount());
-    std::vector<TopoMetSegmentChoice> choicevals(map.getShapeCount());
+    // All the radii share one traversal from each segment: the bins hold each segment once per push,
+    // marked with the radii that pushed it. A smaller radius is not simply a cut of the larger ones
+    // (segments just past it are still marked seen, and choice counts them), so every radius keeps
+    // its own seen, audit trail and choice values, indexed segment * radiussize + radius.
+    // The seen values of a segment are reset the first time each traversal reaches it.
+    std::vector<unsigned int> stamp(map.getShapeCount(), 0);
+    unsigned int epoch = 0;
+    std::vector<unsigned int> seen(map.getShapeCount() * radiussize);
+    std::vector<TopoMetSegmentRef> audittrail(map.getShapeCount() * radiussize);
+    std::vector<TopoMetSegmentChoice> choicevals(map.getShapeCount() * radiussize);
+    std::vector<double> total(radiussize), wtotal(radiussize), wtotaldepth(radiussize), totalsegdepth(radiussize),
+        totalmetdepth(radiussize);
+    std::vector<size_t> hereradii;
+    const SegmentGraph &graph = map.getSegmentGraph();
     for (size_t cursor = 0; cursor < map.getShapeCount(); cursor++) {
         AttributeRow& row = map.getAttributeRowFromShapeIndex(cursor);
         if (m_sel_only && !row.isSelected()) {
             continue;
         }
-        for (size_t i = 0; i < map.getShapeCount(); i++) {
-            seen[i] = 0xffffffff;
+        size_t position = results.getRowPosition(AttributeKey(map.getShapeRefFromIndex(cursor)->first));
+        if (++epoch == 0) {
+            std::fill(stamp.begin(), stamp.end(), 0);
+            epoch = 1;
         }
-        std::vector<int> list[512]; // 512 bins!
+        std::vector<TopoMetSegmentEntry> list[512]; // 512 bins!
         int bin = 0;
-        list[bin].push_back(cursor);
+        list[bin].push_back(TopoMetSegmentEntry(cursor, radiusmask));
         double rootseglength = seglengths[cursor];
-        audittrail[cursor] = TopoMetSegmentRef(cursor, Connector::SEG_CONN_ALL, rootseglength * 0.5, -1);
+        for (size_t r = 0; r < radiussize; r++) {
+            audittrail[cursor * radiussize + r] =
+                TopoMetSegmentRef(cursor, Connector::SEG_CONN_ALL, rootseglength * 0.5, -1);
+        }
         int open = 1;
         unsigned int segdepth = 0;
-        double total = 0.0, wtotal = 0.0, wtotaldepth = 0.0, totalsegdepth = 0.0, totalmetdepth = 0.0;
+        std::fill(total.begin(), total.end(), 0.0);
+        std::fill(wtotal.begin(), wtotal.end(), 0.0);
+        std::fill(wtotaldepth.begin(), wtotaldepth.end(), 0.0);
+        std::fill(totalsegdepth.begin(), totalsegdepth.end(), 0.0);
+        std::fill(totalmetdepth.begin(), totalmetdepth.end(), 0.0);
         while (open != 0) {
             while (list[bin].size() == 0) {
                 bin++;
@@ -102,52 +166,59 @@ bool SegmentMetric::run(Communicator *comm, ShapeGraph &map, bool) {
                 }
             }
             //
-            TopoMetSegmentRef &here = audittrail[list[bin].back()];
+            TopoMetSegmentEntry entry = list[bin].back();
             list[bin].pop_back();
             open--;
             //
-            if (here.done) {
+            // the radii this segment is opened for by this push
+            hereradii.clear();
+            for (size_t r = 0; r < radiussize; r++) {
+                if ((entry.radiusmask & (1 << r)) == 0) {
+                    continue;
+                }
+                TopoMetSegmentRef &here = audittrail[entry.ref * radiussize + r];
+                if (here.done) {
+                    continue;
+                } else {
+                    here.done = true;
+                }
+                hereradii.push_back(r);
+                //
+                double len = seglengths[here.ref];
+                totalsegdepth[r] += segdepth;
+                totalmetdepth[r] += here.dist - len * 0.5; // preloaded with length ahead
+                wtotal[r] += len;
+                wtotaldepth[r] += len * (here.dist - len * 0.5);
+                total[r] += 1;
+            }
+            if (hereradii.empty()) {
                 continue;
-            } else {
-                here.done = true;
             }
             //
-            double len = seglengths[here.ref];
-            totalsegdepth += segdepth;
-            totalmetdepth += here.dist - len * 0.5; // preloaded with length ahead
-            wtotal += len;
-            wtotaldepth += len * (here.dist - len * 0.5);
-            total += 1;
-            //
-            Connector &axline = map.getConnections().at(here.ref);
-            int connected_cursor = -2;
-
-            auto iter = axline.m_back_segconns.begin();
-            bool backsegs = true;
-
-            while (connected_cursor != -1) {
-                if (backsegs && iter == axline.m_back_segconns.end()) {
-                    iter = axline.m_forward_segconns.begin();
-                    backsegs = false;
+            // back connections then forward ones
+            for (size_t edge = graph.backBegin(entry.ref); edge < graph.forwardEnd(entry.ref); edge++) {
+                int connected_cursor = graph.neighbour(edge);
+                if (static_cast<size_t>(connected_cursor) == cursor) {
+                    continue;
                 }
-                if (!backsegs && iter == axline.m_forward_segconns.end()) {
-                    break;
+                if (stamp[connected_cursor] != epoch) {
+                    stamp[connected_cursor] = epoch;
+                    std::fill_n(seen.begin() + connected_cursor * radiussize, radiussize, 0xffffffff);
                 }
 
-                connected_cursor = iter->first.ref;
-
-                if (seen[connected_cursor] > segdepth && static_cast<size_t>(connected_cursor) != cursor) {
-                    bool seenalready = (seen[connected_cursor] == 0xffffffff) ? false : true;
+                unsigned int pushmask = 0;
+                for (size_t r : hereradii) {
+                    if (seen[connected_cursor * radiussize + r] <= segdepth) {
+                        continue;
+                    }
+                    TopoMetSegmentRef &here = audittrail[entry.ref * radiussize + r];
+                    bool seenalready = (seen[connected_cursor * radiussize + r] == 0xffffffff) ? false : true;
                     float length = seglengths[connected_cursor];
-                    audittrail[connected_cursor] =
+                    audittrail[connected_cursor * radiussize + r] =
                         TopoMetSegmentRef(connected_cursor, here.dir, here.dist + length, here.ref);
-                    seen[connected_cursor] = segdepth;
-                    if (m_radius == -1 || here.dist + length < m_radius) {
-                        // puts in a suitable bin ahead of us...
-                        open++;
-                        //
-                        // better to divide by 511 but have 512 bins...
-                        list[(bin + int(floor(0.5 + 511 * length / maxseglength))) % 512].push_back(connected_cursor);
+                    seen[connected_cursor * radiussize + r] = segdepth;
+                    if (radii[r] == -1 || here.dist + length < radii[r]) {
+                        pushmask |= (1 << r);
                     }
                     // not sure why this is outside the radius restriction
                     // (sel_only: with restricted selection set, not all lines will be labelled)
@@ -159,22 +230,32 @@ bool SegmentMetric::run(Communicator *comm, ShapeGraph &map, bool) {
                         int subcur = connected_cursor;
                         while (subcur != -1) {
                             // in this method of choice, start and end lines are included
-                            choicevals[subcur].choice += 1;
-                            choicevals[subcur].wchoice += (rootseglength * length);
-                            subcur = audittrail[subcur].previous;
+                            choicevals[subcur * radiussize + r].choice += 1;
+                            choicevals[subcur * radiussize + r].wchoice += (rootseglength * length);
+                            subcur = audittrail[subcur * radiussize + r].previous;
                         }
                     }
                 }
-                iter++;
+                if (pushmask != 0) {
+                    // puts in a suitable bin ahead of us...
+                    open++;
+                    //
+                    // better to divide by 511 but have 512 bins...
+                    float length = seglengths[connected_cursor];
+                    list[(bin + int(floor(0.5 + 511 * length / maxseglength))) % 512].push_back(
+                        TopoMetSegmentEntry(connected_cursor, pushmask));
+                }
             }
         }
         // also put in mean depth:
         //
-        row.setValue(meandepthcol.c_str(), totalmetdepth / (total - 1));
-        row.setValue(totaldcol.c_str(), totalmetdepth);
-        row.setValue(wmeandepthcol.c_str(), wtotaldepth / (wtotal - rootseglength));
-        row.setValue(totalcol.c_str(), total);
-        row.setValue(wtotalcol.c_str(), wtotal);
+        for (size_t r = 0; r < radiussize; r++) {
+            results.setValue(position, meandepthhandles[r], totalmetdepth[r] / (total[r] - 1));
+            results.setValue(position, totaldhandles[r], totalmetdepth[r]);
+            results.setValue(position, wmeandepthhandles[r], wtotaldepth[r] / (wtotal[r] - rootseglength));
+            results.setValue(position, totalhandles[r], total[r]);
+            results.setValue(position, wtotalhandles[r], wtotal[r]);
+        }
         //
         if (comm) {
             if (qtimer(atime, 500)) {
@@ -189,16 +270,20 @@ bool SegmentMetric::run(Communicator *comm, ShapeGraph &map, bool) {
     if (!m_sel_only) {
         // note, I've stopped sel only from calculating choice values:
         for (size_t cursor = 0; cursor < map.getShapeCount(); cursor++) {
-            AttributeRow& row = map.getAttributeRowFromShapeIndex(cursor);
-            row.setValue(choicecol.c_str(), choicevals[cursor].choice);
-            row.setValue(wchoicecol.c_str(), choicevals[cursor].wchoice);
+            size_t position = results.getRowPosition(AttributeKey(map.getShapeRefFromIndex(cursor)->first));
+            for (size_t r = 0; r < radiussize; r++) {
+                results.setValue(position, choicehandles[r], choicevals[cursor * radiussize + r].choice);
+                results.setValue(position, wchoicehandles[r], choicevals[cursor * radiussize + r].wchoice);
+            }
         }
     }
 
+    results.commit();
+
     if (!m_sel_only) {
-        map.setDisplayedAttribute(attributes.getColumnIndex(choicecol.c_str()));
+        map.setDisplayedAttribute(int(choicehandles.back().index));
     } else {
-        map.setDisplayedAttribute(attributes.getColumnIndex(meandepthcol.c_str()));
+        map.setDisplayedAttribute(int(meandepthhandles.back().index));
     }
 
     return retvar;
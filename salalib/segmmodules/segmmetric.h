@@ -24,11 +24,13 @@
 
 class SegmentMetric : ISegment {
   private:
-    double m_radius;
+    std::set<double> m_radius_set;
     bool m_sel_only;
 
   public:
     std::string getAnalysisName() const override { return "Metric Analysis"; }
     bool run(Communicator *comm, ShapeGraph &map, bool) override;
-    SegmentMetric(double radius, bool sel_only) : m_radius(radius), m_sel_only(sel_only) {}
+    // all the radii are analysed in one traversal from each segment, out to the largest of them
+    SegmentMetric(std::set<double> radius_set, bool sel_only) : m_radius_set(radius_set), m_sel_only(sel_only) {}
+    SegmentMetric(double radius, bool sel_only) : m_radius_set({radius}), m_sel_only(sel_only) {}
 };
@@ -70,6 +70,7 @@ bool SegmentMetricPD::run(Communicator *, ShapeGraph &map, bool) {
     unsigned int segdepth = 0;
     int bin = 0;
 
+    const SegmentGraph &graph = map.getSegmentGraph();
     while (open != 0) {
         while (list[bin].size() == 0) {
             bin++;
@@ -89,22 +90,9 @@ bool SegmentMetricPD::run(Communicator *, ShapeGraph &map, bool) {
             here.done = true;
         }
 
-        Connector &axline = map.getConnections().at(here.ref);
-        int connected_cursor = -2;
-
-        auto iter = axline.m_back_segconns.begin();
-        bool backsegs = true;
-
-        while (connected_cursor != -1) {
-            if (backsegs && iter == axline.m_back_segconns.end()) {
-                iter = axline.m_forward_segconns.begin();
-                backsegs = false;
-            }
-            if (!backsegs && iter == axline.m_forward_segconns.end()) {
-                break;
-            }
-
-            connected_cursor = iter->first.ref;
+        // back connections then forward ones
+        for (size_t edge = graph.backBegin(here.ref); edge < graph.forwardEnd(here.ref); edge++) {
+            int connected_cursor = graph.neighbour(edge);
             if (seen[connected_cursor] > segdepth) {
                 float length = seglengths[connected_cursor];
                 seen[connected_cursor] = segdepth;
@@ -118,7 +106,6 @@ bool SegmentMetricPD::run(Communicator *, ShapeGraph &map, bool) {
                 AttributeRow &row = map.getAttributeRowFromShapeIndex(connected_cursor);
                 row.setValue(depthcol.c_str(), here.dist + length * 0.5);
             }
-            iter++;
         }
     }
 
@@ -66,6 +66,7 @@ bool SegmentTopologicalPD::run(Communicator *, ShapeGraph &map, bool) {
     unsigned int segdepth = 0;
     int bin = 0;
 
+    const SegmentGraph &graph = map.getSegmentGraph();
     while (open != 0) {
         while (list[bin].size() == 0) {
             bin++;
@@ -85,22 +86,9 @@ bool SegmentTopologicalPD::run(Communicator *, ShapeGraph &map, bool) {
             here.done = true;
         }
 
-        Connector &axline = map.getConnections().at(here.ref);
-        int connected_cursor = -2;
-
-        auto iter = axline.m_back_segconns.begin();
-        bool backsegs = true;
-
-        while (connected_cursor != -1) {
-            if (backsegs && iter == axline.m_back_segconns.end()) {
-                iter = axline.m_forward_segconns.begin();
-                backsegs = false;
-            }
-            if (!backsegs && iter == axline.m_forward_segconns.end()) {
-                break;
-            }
-
-            connected_cursor = iter->first.ref;
+        // back connections then forward ones
+        for (size_t edge = graph.backBegin(here.ref); edge < graph.forwardEnd(here.ref); edge++) {
+            int connected_cursor = graph.neighbour(edge);
             AttributeRow& row = map.getAttributeRowFromShapeIndex(connected_cursor);
             if (seen[connected_cursor] > segdepth) {
                 float length = seglengths[connected_cursor];
@@ -123,7 +111,6 @@ bool SegmentTopologicalPD::run(Communicator *, ShapeGraph &map, bool) {
                     row.setValue(depthcol.c_str(), segdepth + 1);
                 }
             }
-            iter++;
         }
     }
 
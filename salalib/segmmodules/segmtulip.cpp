@@ -18,8 +18,107 @@
 
 #include "salalib/segmmodules/segmtulip.h"
 
+#include "genlib/parallelutils.h"
 #include "genlib/stringutils.h"
 
+// what the traversal from one root found at each radius
+struct SegmentTulip::RootResult {
+    bool analysed = false;
+    std::vector<double> node_count, total_depth, total_weight, total_weighted_depth;
+};
+
+// The scratch space of one worker. Rather than clearing the audit trail and coverage of
+// every segment before each traversal, every segment is stamped with the traversal it was
+// last reset for, and reset the first time the current one touches it; the segments touched
+// are listed, so the totals only need to look at those. The choice in the audit trail is
+// not reset: it is built up over the roots of a block and then taken by the merge, which
+// only visits the segments touched since the last one.
+struct SegmentTulip::Workspace {
+    std::vector<std::vector<SegmentData>> bins;
+
+    Workspace(size_t segments, int radiussize, unsigned int radiusmask, int tulip_bins)
+        : bins(size_t(tulip_bins)), m_radiussize(size_t(radiussize)), m_radiusmask(radiusmask), m_epoch(1),
+          m_stamp(segments, 0), m_audittrail(segments * size_t(radiussize) * 2), m_uncovered(segments * 2),
+          m_in_block(segments, 0) {}
+
+    // start a new traversal: all segments are uncovered again
+    void reset() {
+        m_touched.clear();
+        if (++m_epoch == 0) {
+            std::fill(m_stamp.begin(), m_stamp.end(), 0);
+            m_epoch = 1;
+        }
+    }
+    AnalysisInfo &audittrail(int ref, int radius, int dir) {
+        touch(ref);
+        return m_audittrail[(size_t(ref) * m_radiussize + size_t(radius)) * 2 + size_t(dir)];
+    }
+    unsigned int &uncovered(int ref, int dir) {
+        touch(ref);
+        return m_uncovered[size_t(ref) * 2 + size_t(dir)];
+    }
+    // the segments touched by the current traversal, in segment order
+    const std::vector<int> &touchedInOrder() {
+        if (m_touched.size() * 16 > m_stamp.size()) {
+            // cheaper to pick them out again than to sort them
+            m_touched.clear();
+            for (size_t ref = 0; ref < m_stamp.size(); ref++) {
+                if (m_stamp[ref] == m_epoch) {
+                    m_touched.push_back(int(ref));
+                }
+            }
+        } else {
+            std::sort(m_touched.begin(), m_touched.end());
+        }
+        return m_touched;
+    }
+    // add the choice built up since the last call to the totals, indexed as the audit trail
+    void takeChoice(std::vector<double> &choice, std::vector<double> &weighted_choice,
+                    std::vector<double> &weighted_choice2) {
+        for (int ref : m_block_touched) {
+            size_t start = size_t(ref) * m_radiussize * 2;
+            for (size_t idx = start; idx < start + m_radiussize * 2; idx++) {
+                AnalysisInfo &info = m_audittrail[idx];
+                choice[idx] += info.choice;
+                weighted_choice[idx] += info.weighted_choice;
+                weighted_choice2[idx] += info.weighted_choice2;
+                info.choice = info.weighted_choice = info.weighted_choice2 = 0.0;
+            }
+            m_in_block[size_t(ref)] = 0;
+        }
+        m_block_touched.clear();
+    }
+
+  private:
+    void touch(int ref) {
+        size_t idx = size_t(ref);
+        if (m_stamp[idx] != m_epoch) {
+            m_stamp[idx] = m_epoch;
+            m_touched.push_back(ref);
+            if (!m_in_block[idx]) {
+                m_in_block[idx] = 1;
+                m_block_touched.push_back(ref);
+            }
+            for (size_t k = 0; k < m_radiussize * 2; k++) {
+                m_audittrail[idx * m_radiussize * 2 + k].clearLine();
+            }
+            m_uncovered[idx * 2] = m_radiusmask;
+            m_uncovered[idx * 2 + 1] = m_radiusmask;
+        }
+    }
+
+    size_t m_radiussize;
+    unsigned int m_radiusmask;
+    unsigned int m_epoch;
+    std::vector<unsigned int> m_stamp;
+    std::vector<AnalysisInfo> m_audittrail;
+    std::vector<unsigned int> m_uncovered;
+    std::vector<int> m_touched;
+    // the segments touched since the last takeChoice
+    std::vector<char> m_in_block;
+    std::vector<int> m_block_touched;
+};
+
 bool SegmentTulip::run(Communicator *comm, ShapeGraph &map, bool) {
 
     if (map.getMapType() != ShapeMap::SEGMENTMAP) {
@@ -33,16 +132,6 @@ bool SegmentTulip::run(Communicator *comm, ShapeGraph &map, bool) {
 
     AttributeTable &attributes = map.getAttributeTable();
 
-    int processed_rows = 0;
-
-    time_t atime = 0;
-
-    if (comm) {
-        qtimer(atime, 0);
-        comm->CommPostMessage(Communicator::NUM_RECORDS,
-                              (m_sel_only ? map.getSelSet().size() : map.getConnections().size()));
-    }
-
     // note: radius must be sorted lowest to highest, but if -1 occurs ("radius n") it needs to be last...
     // ...to ensure no mess ups, we'll re-sort here:
     bool radius_n = false;
@@ -303,20 +392,6 @@ bool SegmentTulip::run(Communicator *comm, ShapeGraph &map, bool) {
     tulip_bins /= 2; // <- actually use semicircle of tulip bins
     tulip_bins += 1;
 
-    std::vector<std::vector<SegmentData>> bins(tulip_bins);
-
-    // TODO: Replace these with STL
-    AnalysisInfo ***audittrail;
-    unsigned int **uncovered;
-    audittrail = new AnalysisInfo **[map.getConnections().size()];
-    uncovered = new unsigned int *[map.getConnections().size()];
-    for (size_t i = 0; i < map.getConnections().size(); i++) {
-        audittrail[i] = new AnalysisInfo *[radius_unconverted.size()];
-        for (size_t j = 0; j < radius_unconverted.size(); j++) {
-            audittrail[i][j] = new AnalysisInfo[2];
-        }
-        uncovered[i] = new unsigned int[2];
-    }
     std::vector<double> radius;
     for (r = 0; r < radius_unconverted.size(); r++) {
         if (m_radius_type == Options::RADIUS_ANGULAR && radius_unconverted[r] != -1) {
@@ -341,32 +416,50 @@ bool SegmentTulip::run(Communicator *comm, ShapeGraph &map, bool) {
         radiusmask |= (1 << i);
     }
 
-    for (size_t cursor = 0; cursor < map.getConnections().size(); cursor++) {
-        AttributeRow &row =
-            map.getAttributeRowFromShapeIndex(cursor);
+    size_t segment_count = map.getConnections().size();
+    const SegmentGraph &graph = map.getSegmentGraph();
+    std::vector<AttributeRow *> rows;
+    for (const auto &shape : map.getAllShapes()) {
+        rows.push_back(&attributes.getRow(AttributeKey(shape.first)));
+    }
+
+    // the traversals from the roots are handed out to the workers in blocks, and what each
+    // finds is written out afterwards in segment order. Each worker adds the choice of its
+    // block up in its own audit trail, and the blocks are added to the totals (both ways
+    // along each segment) in block order, so the results do not depend on the thread count
+    std::vector<double> choice, weighted_choice, weighted_choice2;
+    if (m_choice) {
+        choice.resize(segment_count * radiussize * 2, 0.0);
+        weighted_choice.resize(segment_count * radiussize * 2, 0.0);
+        weighted_choice2.resize(segment_count * radiussize * 2, 0.0);
+    }
+    std::vector<RootResult> results(segment_count);
+
+    size_t block_size = depthmapX::getBlockSize(segment_count);
+    size_t blocks = (segment_count + block_size - 1) / block_size;
+    size_t thread_count = depthmapX::getThreadCount(m_threads, blocks);
+    std::vector<Workspace> workspaces;
+    for (size_t t = 0; t < thread_count; t++) {
+        workspaces.emplace_back(segment_count, radiussize, radiusmask, tulip_bins);
+    }
 
+    auto traverse = [&](size_t cursor, Workspace &workspace) {
         if (m_sel_only) {
             // could use m_selection_set.searchindex(rowid) to find
             // if this row is selected as m_selection_set is ordered for axial and segment maps, etc
             // BUT, actually quicker to check the tag in the attributes that shows it's selected
-            if (!row.isSelected()) {
-                continue;
+            if (!rows[cursor]->isSelected()) {
+                return;
             }
         }
 
+        std::vector<std::vector<SegmentData>> &bins = workspace.bins;
         for (int k = 0; k < tulip_bins; k++) {
             bins[k].clear();
         }
-        for (size_t j = 0; j < map.getConnections().size(); j++) {
-            for (int dir = 0; dir < 2; dir++) {
-                for (int k = 0; k < radiussize; k++) {
-                    audittrail[j][k][dir].clearLine();
-                }
-                uncovered[j][dir] = radiusmask;
-            }
-        }
+        workspace.reset();
 
-        double rootseglength = row.getValue(length_col);
+        double rootseglength = lengths[cursor];
         double rootweight = (m_weighted_measure_col != -1) ? weights[cursor] : 0.0;
 
         // setup: direction 0 (both ways), segment i, previous -1, segdepth (step depth) 0, metricdepth 0.5 *
@@ -397,48 +490,48 @@ bool SegmentTulip::run(Communicator *comm, ShapeGraph &map, bool) {
 
             int ref = lineindex.ref;
             int dir = (lineindex.dir == 1) ? 0 : 1;
-            int coverage = lineindex.coverage & uncovered[ref][dir];
+            int coverage = lineindex.coverage & workspace.uncovered(ref, dir);
             if (coverage != 0) {
                 int rbin = 0;
                 int rbinbase;
                 if (lineindex.previous.ref != -1) {
-                    uncovered[ref][dir] &= ~coverage;
+                    workspace.uncovered(ref, dir) &= ~coverage;
                     while (((coverage >> rbin) & 0x1) == 0)
                         rbin++;
                     rbinbase = rbin;
                     while (rbin < radiussize) {
                         if (((coverage >> rbin) & 0x1) == 1) {
-                            audittrail[ref][rbin][dir].depth = depthlevel;
-                            audittrail[ref][rbin][dir].previous = lineindex.previous;
-                            audittrail[lineindex.previous.ref][rbin][(lineindex.previous.dir == 1) ? 0 : 1].leaf =
-                                false;
+                            workspace.audittrail(ref, rbin, dir).depth = depthlevel;
+                            workspace.audittrail(ref, rbin, dir).previous = lineindex.previous;
+                            workspace
+                                .audittrail(lineindex.previous.ref, rbin, (lineindex.previous.dir == 1) ? 0 : 1)
+                                .leaf = false;
                         }
                         rbin++;
                     }
                 } else {
                     rbinbase = 0;
-                    uncovered[ref][0] &= ~coverage;
-                    uncovered[ref][1] &= ~coverage;
+                    workspace.uncovered(ref, 0) &= ~coverage;
+                    workspace.uncovered(ref, 1) &= ~coverage;
                 }
-                Connector &line = map.getConnections()[ref];
                 float seglength;
                 int extradepth;
                 if (lineindex.dir != -1) {
-                    for (auto &segconn : line.m_forward_segconns) {
+                    for (size_t edge = graph.forwardBegin(ref); edge < graph.forwardEnd(ref); edge++) {
                         rbin = rbinbase;
-                        SegmentRef conn = segconn.first;
-                        if ((uncovered[conn.ref][(conn.dir == 1 ? 0 : 1)] & coverage) != 0) {
+                        SegmentRef conn = graph.segmentRef(edge);
+                        if ((workspace.uncovered(conn.ref, (conn.dir == 1 ? 0 : 1)) & coverage) != 0) {
                             // EF routeweight*
                             if (routeweight_col != -1) { // EF here we do the weighting of the angular cost by the
                                                          // weight of the next segment
                                 // note that the content of the routeweights array is scaled between 0 and 1 and is
                                 // reversed
                                 // such that: = 1.0-(attributes.getValue(i, routeweight_col)/max_value)
-                                extradepth = (int)floor(segconn.second * tulip_bins * 0.5 * routeweights[conn.ref]);
+                                extradepth = (int)floor(graph.weight(edge) * tulip_bins * 0.5 * routeweights[conn.ref]);
                             }
                             //*EF routeweight
                             else {
-                                extradepth = (int)floor(segconn.second * tulip_bins * 0.5);
+                                extradepth = (int)floor(graph.weight(edge) * tulip_bins * 0.5);
                             }
                             seglength = lengths[conn.ref];
                             switch (m_radius_type) {
@@ -472,21 +565,21 @@ bool SegmentTulip::run(Communicator *comm, ShapeGraph &map, bool) {
                     }
                 }
                 if (lineindex.dir != 1) {
-                    for (auto &segconn : line.m_back_segconns) {
+                    for (size_t edge = graph.backBegin(ref); edge < graph.backEnd(ref); edge++) {
                         rbin = rbinbase;
-                        SegmentRef conn = segconn.first;
-                        if ((uncovered[conn.ref][(conn.dir == 1 ? 0 : 1)] & coverage) != 0) {
+                        SegmentRef conn = graph.segmentRef(edge);
+                        if ((workspace.uncovered(conn.ref, (conn.dir == 1 ? 0 : 1)) & coverage) != 0) {
                             // EF routeweight*
                             if (routeweight_col != -1) { // EF here we do the weighting of the angular cost by the
                                                          // weight of the next segment
                                 // note that the content of the routeweights array is scaled between 0 and 1 and is
                                 // reversed
                                 // such that: = 1.0-(attributes.getValue(i, routeweight_col)/max_value)
-                                extradepth = (int)floor(segconn.second * tulip_bins * 0.5 * routeweights[conn.ref]);
+                                extradepth = (int)floor(graph.weight(edge) * tulip_bins * 0.5 * routeweights[conn.ref]);
                             }
                             //*EF routeweight
                             else {
-                                extradepth = (int)floor(segconn.second * tulip_bins * 0.5);
+                                extradepth = (int)floor(graph.weight(edge) * tulip_bins * 0.5);
                             }
                             seglength = lengths[conn.ref];
                             switch (m_radius_type) {
@@ -521,21 +614,27 @@ bool SegmentTulip::run(Communicator *comm, ShapeGraph &map, bool) {
                 }
             }
         }
-        // set the attributes for this node:
+        // the totals for this node, over the segments the traversal reached, in segment order:
+        RootResult &result = results[cursor];
+        result.analysed = true;
+        result.node_count.assign(radiussize, 0.0);
+        result.total_depth.assign(radiussize, 0.0);
+        result.total_weight.assign(radiussize, 0.0);
+        result.total_weighted_depth.assign(radiussize, 0.0);
+        const std::vector<int> &reached = workspace.touchedInOrder();
         for (int k = 0; k < radiussize; k++) {
             // note, curs_total_depth must use double as mantissa can get too long for int in large systems
             double curs_node_count = 0.0, curs_total_depth = 0.0;
             double curs_total_weight = 0.0, curs_total_weighted_depth = 0.0;
-            size_t j;
-            for (j = 0; j < map.getConnections().size(); j++) {
+            for (int j : reached) {
                 // find dir according
-                bool m0 = ((uncovered[j][0] >> k) & 0x1) == 0;
-                bool m1 = ((uncovered[j][1] >> k) & 0x1) == 0;
+                bool m0 = ((workspace.uncovered(j, 0) >> k) & 0x1) == 0;
+                bool m1 = ((workspace.uncovered(j, 1) >> k) & 0x1) == 0;
                 if ((m0 | m1) != 0) {
                     int dir;
                     if (m0 & m1) {
                         // dir is the one with the lowest depth:
-                        if (audittrail[j][k][0].depth < audittrail[j][k][1].depth)
+                        if (workspace.audittrail(j, k, 0).depth < workspace.audittrail(j, k, 1).depth)
                             dir = 0;
                         else
                             dir = 1;
@@ -544,11 +643,11 @@ bool SegmentTulip::run(Communicator *comm, ShapeGraph &map, bool) {
                         dir = m0 ? 0 : 1;
                     }
                     curs_node_count++;
-                    curs_total_depth += audittrail[j][k][dir].depth;
+                    curs_total_depth += workspace.audittrail(j, k, dir).depth;
                     curs_total_weight += weights[j];
-                    curs_total_weighted_depth += audittrail[j][k][dir].depth * weights[j];
+                    curs_total_weighted_depth += workspace.audittrail(j, k, dir).depth * weights[j];
                     //
-                    if (m_choice && audittrail[j][k][dir].leaf) {
+                    if (m_choice && workspace.audittrail(j, k, dir).leaf) {
                         // note, graph may be directed (e.g., for one way streets), so both ways must be included from
                         // now on:
                         SegmentRef here = SegmentRef(dir == 0 ? 1 : -1, j);
@@ -560,17 +659,18 @@ bool SegmentTulip::run(Communicator *comm, ShapeGraph &map, bool) {
                             //*EFEF
                             while (here.ref != static_cast<int>(cursor)) { // not rowid means not the current root for the path
                                 int heredir = (here.dir == 1) ? 0 : 1;
+                                AnalysisInfo &hereinfo = workspace.audittrail(here.ref, k, heredir);
                                 // each node has the existing choicecount and choiceweight from previously encountered
                                 // nodes added to it
-                                audittrail[here.ref][k][heredir].choice += choicecount;
+                                hereinfo.choice += choicecount;
                                 // nb, weighted values calculated anyway to save time on 'if'
-                                audittrail[here.ref][k][heredir].weighted_choice += choiceweight;
+                                hereinfo.weighted_choice += choiceweight;
                                 // EFEF*
-                                audittrail[here.ref][k][heredir].weighted_choice2 += choiceweight2;
+                                hereinfo.weighted_choice2 += choiceweight2;
                                 //*EFEF
                                 // if the node hasn't been encountered before, the choicecount and choiceweight is
                                 // incremented for all remaining nodes to be encountered on the backwards route from it
-                                if (!audittrail[here.ref][k][heredir].choicecovered) {
+                                if (!hereinfo.choicecovered) {
                                     // this node has not been encountered before: this adds the choicecount and weight
                                     // for this node, and flags it as visited
                                     choicecount++;
@@ -579,29 +679,27 @@ bool SegmentTulip::run(Communicator *comm, ShapeGraph &map, bool) {
                                     choiceweight2 += weights2[here.ref] * rootweight; // rootweight!
                                     //*EFEF
 
-                                    audittrail[here.ref][k][heredir].choicecovered = true;
+                                    hereinfo.choicecovered = true;
                                     // note, for weighted choice, the start and end points have choice added to them:
                                     if (m_weighted_measure_col != -1) {
-                                        audittrail[here.ref][k][heredir].weighted_choice +=
-                                            (weights[here.ref] * rootweight) / 2.0;
+                                        hereinfo.weighted_choice += (weights[here.ref] * rootweight) / 2.0;
                                         // EFEF*
                                         if (weighting_col2 != -1) {
-                                            audittrail[here.ref][k][heredir].weighted_choice2 +=
-                                                (weights2[here.ref] * rootweight) / 2.0; // rootweight!
+                                            hereinfo.weighted_choice2 += (weights2[here.ref] * rootweight) / 2.0; // rootweight!
                                         }
                                         //*EFEF
                                     }
                                 }
-                                here = audittrail[here.ref][k][heredir].previous;
+                                here = hereinfo.previous;
                             }
                             // note, for weighted choice, the start and end points have choice added to them:
                             // (this is the summed weight for all starting nodes encountered in this path)
                             if (m_weighted_measure_col != -1) {
-                                audittrail[here.ref][k][(here.dir == 1) ? 0 : 1].weighted_choice += choiceweight / 2.0;
+                                AnalysisInfo &rootinfo = workspace.audittrail(here.ref, k, (here.dir == 1) ? 0 : 1);
+                                rootinfo.weighted_choice += choiceweight / 2.0;
                                 // EFEF*
                                 if (weighting_col2 != -1) {
-                                    audittrail[here.ref][k][(here.dir == 1) ? 0 : 1].weighted_choice2 +=
-                                        choiceweight2 / 2.0;
+                                    rootinfo.weighted_choice2 += choiceweight2 / 2.0;
                                 }
                                 //*EFEF
                             }
@@ -609,6 +707,46 @@ bool SegmentTulip::run(Communicator *comm, ShapeGraph &map, bool) {
                     }
                 }
             }
+            result.node_count[k] = curs_node_count;
+            result.total_depth[k] = curs_total_depth;
+            result.total_weight[k] = curs_total_weight;
+            result.total_weighted_depth[k] = curs_total_weighted_depth;
+        }
+    };
+
+    if (comm) {
+        comm->CommPostMessage(Communicator::NUM_RECORDS, int(blocks));
+    }
+    try {
+        depthmapX::parallelForInBlocks(
+            comm, thread_count, segment_count, block_size,
+            [&](size_t cursor, size_t threadIndex) { traverse(cursor, workspaces[threadIndex]); },
+            [&](size_t threadIndex) {
+                if (m_choice) {
+                    workspaces[threadIndex].takeChoice(choice, weighted_choice, weighted_choice2);
+                }
+            });
+    } catch (Communicator::CancelledException &) {
+        // interactive is usual Depthmap: throw an exception if cancelled
+        if (interactive) {
+            throw;
+        }
+        // in non-interactive mode, retain what's been processed already
+    }
+
+    int processed_rows = 0;
+    for (size_t cursor = 0; cursor < segment_count; cursor++) {
+        const RootResult &result = results[cursor];
+        if (!result.analysed) {
+            continue;
+        }
+        processed_rows++;
+        AttributeRow &row = *rows[cursor];
+        // set the attributes for this node:
+        for (int k = 0; k < radiussize; k++) {
+            double curs_node_count = result.node_count[k], curs_total_depth = result.total_depth[k];
+            double curs_total_weight = result.total_weight[k];
+            double curs_total_weighted_depth = result.total_weighted_depth[k];
             double total_depth_conv = curs_total_depth / ((tulip_bins - 1.0f) * 0.5f);
             double total_weighted_depth_conv = curs_total_weighted_depth / ((tulip_bins - 1.0f) * 0.5f);
             //
@@ -641,46 +779,18 @@ bool SegmentTulip::run(Communicator *comm, ShapeGraph &map, bool) {
                 }
             }
         }
-        //
-        processed_rows++;
-        //
-        if (comm) {
-            if (qtimer(atime, 500)) {
-                if (comm->IsCancelled()) {
-                    // interactive is usual Depthmap: throw an exception if cancelled
-                    if (interactive) {
-                        for (size_t i = 0; i < map.getConnections().size(); i++) {
-                            for (size_t j = 0; j < size_t(radiussize); j++) {
-                                delete[] audittrail[i][j];
-                            }
-                            delete[] audittrail[i];
-                            delete[] uncovered[i];
-                        }
-                        delete[] audittrail;
-                        delete[] uncovered;
-                        throw Communicator::CancelledException();
-                    } else {
-                        // in non-interactive mode, retain what's been processed already
-                        break;
-                    }
-                }
-                comm->CommPostMessage(Communicator::CURRENT_RECORD, cursor);
-            }
-        }
     }
     if (m_choice) {
-        for (size_t cursor = 0; cursor < map.getConnections().size(); cursor++) {
-            AttributeRow &row =
-                attributes.getRow(AttributeKey(depthmapX::getMapAtIndex(map.getAllShapes(), cursor)->first));
+        for (size_t cursor = 0; cursor < segment_count; cursor++) {
+            AttributeRow &row = *rows[cursor];
             for (size_t r = 0; r < radius.size(); r++) {
                 // according to Eva's correction, total choice and total weighted choice
                 // should already have been accumulated by radius at this stage
-                double total_choice = audittrail[cursor][r][0].choice + audittrail[cursor][r][1].choice;
-                double total_weighted_choice =
-                    audittrail[cursor][r][0].weighted_choice + audittrail[cursor][r][1].weighted_choice;
+                size_t idx = (cursor * radiussize + r) * 2;
+                double total_choice = choice[idx] + choice[idx + 1];
+                double total_weighted_choice = weighted_choice[idx] + weighted_choice[idx + 1];
                 // EFEF*
-                double total_weighted_choice2 =
-                    audittrail[cursor][r][0].weighted_choice2 + audittrail[cursor][r][1].weighted_choice2;
+                double total_weighted_choice2 = weighted_choice2[idx] + weighted_choice2[idx + 1];
                 //*EFEF
 
                 // normalised choice now excluded for two reasons:
@@ -704,16 +814,6 @@ bool SegmentTulip::run(Communicator *comm, ShapeGraph &map, bool) {
             }
         }
     }
-    for (size_t i = 0; i < map.getConnections().size(); i++) {
-        for (int j = 0; j < radiussize; j++) {
-            delete[] audittrail[i][j];
-        }
-        delete[] audittrail[i];
-        delete[] uncovered[i];
-    }
-    delete[] audittrail;
-    delete[] uncovered;
-
     map.setDisplayedAttribute(-2); // <- override if it's already showing
     if (m_choice) {
         map.setDisplayedAttribute(choice_col.back());
@@ -38,10 +38,11 @@ bool SegmentTulipDepth::run(Communicator *, ShapeGraph &map, bool) {
        covered[i] = false;
     }
     std::vector<std::vector<SegmentData> > bins(tulip_bins);
+    const SegmentGraph &graph = map.getSegmentGraph();
 
     int opencount = 0;
     for (auto& sel: map.getSelSet()) {
-       int row = depthmapX::getMapAtIndex(map.getAllShapes(), sel)->first;
+       int row = map.getShapeRefFromIndex(sel)->first;
        if (row != -1) {
           bins[0].push_back(SegmentData(0,row,SegmentRef(),0,0.0,0));
           opencount++;
@@ -76,28 +77,27 @@ bool SegmentTulipDepth::run(Communicator *, ShapeGraph &map, bool) {
        opencount--;
        if (!covered[lineindex.ref]) {
           covered[lineindex.ref] = true;
-          Connector& line = map.getConnections()[lineindex.ref];
           // convert depth from tulip_bins normalised to standard angle
           // (note the -1)
           double depth_to_line = depthlevel / ((tulip_bins - 1) * 0.5);
           map.getAttributeRowFromShapeIndex(lineindex.ref).setValue(stepdepth_col,depth_to_line);
           int extradepth;
           if (lineindex.dir != -1) {
-             for (auto& segconn: line.m_forward_segconns) {
-                if (!covered[segconn.first.ref]) {
-                   extradepth = (int) floor(segconn.second * tulip_bins * 0.5);
+             for (size_t edge = graph.forwardBegin(lineindex.ref); edge < graph.forwardEnd(lineindex.ref); edge++) {
+                if (!covered[graph.neighbour(edge)]) {
+                   extradepth = (int) floor(graph.weight(edge) * tulip_bins * 0.5);
                    bins[(currentbin + tulip_bins + extradepth) % tulip_bins].push_back(
-                       SegmentData(segconn.first,lineindex.ref,lineindex.segdepth+1,0.0,0));
+                       SegmentData(graph.segmentRef(edge),lineindex.ref,lineindex.segdepth+1,0.0,0));
                    opencount++;
                 }
              }
           }
           if (lineindex.dir != 1) {
-             for (auto& segconn: line.m_back_segconns) {
-                if (!covered[segconn.first.ref]) {
-                   extradepth = (int) floor(segconn.second * tulip_bins * 0.5);
+             for (size_t edge = graph.backBegin(lineindex.ref); edge < graph.backEnd(lineindex.ref); edge++) {
+                if (!covered[graph.neighbour(edge)]) {
+                   extradepth = (int) floor(graph.weight(edge) * tulip_bins * 0.5);
                    bins[(currentbin + tulip_bins + extradepth) % tulip_bins].push_back(
-                       SegmentData(segconn.first,lineindex.ref,lineindex.segdepth+1,0.0,0));
+                       SegmentData(graph.segmentRef(edge),lineindex.ref,lineindex.segdepth+1,0.0,0));
                    opencount++;
                  }
              }
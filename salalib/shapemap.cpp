@@ -25,6 +25,7 @@
 #include "genlib/comm.h" // for communicator
 #include "genlib/containerutils.h"
 #include "genlib/exceptions.h"
+#include "genlib/parallelutils.h"
 #include "genlib/stringutils.h"
 
 #include <float.h>
@@ -33,7 +34,6 @@
 #include <stdexcept>
 #include <time.h>
 #include <unordered_map>
-#include <unordered_set>
 
 #ifndef _WIN32
 #define _finite finite
@@ -153,17 +153,11 @@ ShapeMap::ShapeMap(const std::string &name, int type)
     m_editable = false;
 
     m_bsp_tree = false;
-    m_bsp_root = NULL;
     //
     m_hasMapInfoData = false;
 }
 
-ShapeMap::~ShapeMap() {
-    if (m_bsp_root) {
-        delete m_bsp_root;
-        m_bsp_root = NULL;
-    }
-}
+ShapeMap::~ShapeMap() {}
 
 //////////////////////////////////////////////////////////////////////////////////////////
 
@@ -187,8 +181,10 @@ void ShapeMap::init(int size, const QtRegion &r) {
 // this makes an exact copy, keep the reference numbers and so on:
 
 void ShapeMap::copy(const ShapeMap &sourcemap, int copyflags) {
+    m_segment_graph_valid = false;
     if ((copyflags & ShapeMap::COPY_GEOMETRY) == ShapeMap::COPY_GEOMETRY) {
         m_shapes.clear();
+        m_shape_edits++;
         init(sourcemap.m_shapes.size(), sourcemap.m_region);
         for (auto shape : sourcemap.m_shapes) {
             // using makeShape is actually easier than thinking about a total copy:
@@ -244,13 +240,13 @@ void ShapeMap::copy(const ShapeMap &sourcemap, int copyflags) {
 
 // Zaps all memory structures, apart from mapinfodata
 void ShapeMap::clearAll() {
-    if (m_bsp_root) {
-        delete m_bsp_root;
-        m_bsp_root = NULL;
-    }
+    m_bsp_nodes = FlatBSPTree();
+    m_bsp_tree = false;
+    m_segment_graph_valid = false;
     m_display_shapes.clear();
 
     m_shapes.clear();
+    m_shape_edits++;
     m_undobuffer.clear();
     m_connectors.clear();
     m_attributes->clear();
@@ -274,6 +270,7 @@ int ShapeMap::makePointShapeWithRef(const Point2f &point, int shape_ref, bool te
     }
 
     m_shapes.insert(std::make_pair(shape_ref, SalaShape(point)));
+    shapeAdded(shape_ref);
 
     if (bounds_good) {
         // note: also sets polygon bounding box:
@@ -316,6 +313,7 @@ int ShapeMap::makeLineShapeWithRef(const Line &line, int shape_ref, bool through
 
     // note, shape constructor sets centroid, length etc
     m_shapes.insert(std::make_pair(shape_ref, SalaShape(line)));
+    shapeAdded(shape_ref);
 
     if (bounds_good) {
         // note: also sets polygon bounding box:
@@ -338,7 +336,7 @@ int ShapeMap::makeLineShapeWithRef(const Line &line, int shape_ref, bool through
     if (through_ui) {
         // manually add connections:
         if (m_hasgraph) {
-            int rowid = depthmapX::findIndexFromKey(m_shapes, shape_ref);
+            int rowid = getShapeIndexFromKey(shape_ref);
             if (isAxialMap()) {
                 connectIntersected(rowid, true); // "true" means line-line intersections only will be applied
             } else {
@@ -407,6 +405,7 @@ int ShapeMap::makePolyShapeWithRef(const std::vector<Point2f> &points, bool open
     } else {
         m_shapes.insert(std::make_pair(shape_ref, SalaShape(SalaShape::SHAPE_POLY | SalaShape::SHAPE_CLOSED)));
     }
+    shapeAdded(shape_ref);
     for (i = 0; i < len; i++) {
         m_shapes.rbegin()->second.m_points.push_back(points[i]);
     }
@@ -461,6 +460,7 @@ int ShapeMap::makeShape(const SalaShape &poly, int override_shape_ref, const std
     }
 
     m_shapes.insert(std::make_pair(shape_ref, poly));
+    shapeAdded(shape_ref);
 
     if (bounds_good) {
         // note: also sets polygon bounding box:
@@ -542,6 +542,7 @@ int ShapeMap::makeShapeFromPointSet(const PointMap &pointmap) {
 
     int new_shape_ref = getNextShapeKey();
     m_shapes.insert(std::make_pair(new_shape_ref, poly));
+    shapeAdded(new_shape_ref);
 
     if (bounds_good) {
         // note: also sets polygon bounding box:
@@ -633,6 +634,7 @@ bool ShapeMap::convertPointsToPolys(double poly_radius, bool selected_only) {
 ///////////////////////////////////////////////////////////////////////////////////////////////////////
 
 bool ShapeMap::moveShape(int shaperef, const Line &line, bool undoing) {
+    m_segment_graph_valid = false;
     bool bounds_good = true;
 
     auto shapeIter = m_shapes.find(shaperef);
@@ -668,7 +670,7 @@ bool ShapeMap::moveShape(int shaperef, const Line &line, bool undoing) {
         }
     }
 
-    int rowid = std::distance(m_shapes.begin(), shapeIter);
+    int rowid = getShapeIndexFromKey(shapeIter->first);
     AttributeRow &row = m_attributes->getRow(AttributeKey(shapeIter->first));
     // change connections:
     if (m_hasgraph) {
@@ -691,7 +693,7 @@ bool ShapeMap::moveShape(int shaperef, const Line &line, bool undoing) {
         row.setValue(conn_col, float(newconnections.size()));
         if (isAxialMap()) {
             leng_col = m_attributes->getOrInsertLockedColumn("Line Length");
-            row.setValue(leng_col, (float)depthmapX::getMapAtIndex(m_shapes, rowid)->second.getLength());
+            row.setValue(leng_col, (float)getShapeRefFromIndex(rowid)->second.getLength());
         }
         //
         // now go through our old connections, and remove ourself:
@@ -766,6 +768,7 @@ bool ShapeMap::moveShape(int shaperef, const Line &line, bool undoing) {
 // some functions to make a polygon from the UI
 
 int ShapeMap::polyBegin(const Line &line) {
+    m_segment_graph_valid = false;
     // add geometry
     bool bounds_good = true;
     if (!(m_region.contains_touch(line.start()) && m_region.contains_touch(line.end()))) {
@@ -775,6 +778,7 @@ int ShapeMap::polyBegin(const Line &line) {
 
     int new_shape_ref = getNextShapeKey();
     m_shapes.insert(std::make_pair(new_shape_ref, SalaShape(line)));
+    shapeAdded(new_shape_ref);
     m_shapes.rbegin()->second.m_centroid = line.getCentre();
 
     if (bounds_good) {
@@ -902,9 +906,13 @@ bool ShapeMap::removeSelected() {
 
     // pray that the selection set is in order!
     // (it should be: code currently uses add() throughout)
+    std::vector<AttributeKey> shapeRefKeys;
     for (auto &shapeRef : m_selection_set) {
-        removeShape(shapeRef);
+        removeShapeKeepingRow(shapeRef, false);
+        // n.b., shaperef should have been used to create the row in the first place:
+        shapeRefKeys.push_back(AttributeKey(shapeRef));
     }
+    m_attributes->removeRows(shapeRefKeys);
     m_selection_set.clear();
 
     invalidateDisplayedAttribute();
@@ -913,11 +921,19 @@ bool ShapeMap::removeSelected() {
 }
 
 void ShapeMap::removeShape(int shaperef, bool undoing) {
+    removeShapeKeepingRow(shaperef, undoing);
+    // n.b., shaperef should have been used to create the row in the first place:
+    const AttributeKey shapeRefKey(shaperef);
+    m_attributes->removeRow(shapeRefKey);
+}
+
+void ShapeMap::removeShapeKeepingRow(int shaperef, bool undoing) {
+    m_segment_graph_valid = false;
     // remove shape from four keys: the pixel grid, the poly list, the attributes and the connections
     removePolyPixels(shaperef); // done first, as all interface references use this list
 
     auto shapeIter = m_shapes.find(shaperef);
-    size_t rowid = std::distance(m_shapes.begin(), shapeIter);
+    size_t rowid = (shapeIter == m_shapes.end()) ? m_shapes.size() : size_t(getShapeIndexFromKey(shaperef));
 
     if (!undoing) { // <- if not currently undoing another event, then add to the undo buffer:
         m_undobuffer.push_back(SalaEvent(SalaEvent::SALA_DELETED, shaperef));
@@ -978,16 +994,15 @@ void ShapeMap::removeShape(int shaperef, bool undoing) {
 
     if (shapeIter != m_shapes.end()) {
         shapeIter = m_shapes.erase(shapeIter);
+        m_shape_edits++;
     }
-    // n.b., shaperef should have been used to create the row in the first place:
-    const AttributeKey shapeRefKey(shaperef);
-    m_attributes->removeRow(shapeRefKey);
 
     m_newshape = true;
     m_invalidate = true;
 }
 
 void ShapeMap::undo() {
+    m_segment_graph_valid = false;
     if (m_undobuffer.size() == 0) {
         return;
     }
@@ -1003,7 +1018,7 @@ void ShapeMap::undo() {
     } else if (event.m_action == SalaEvent::SALA_DELETED) {
 
         makeShape(event.m_geometry, event.m_shape_ref);
-        int rowid = std::distance(m_shapes.begin(), m_shapes.find(event.m_shape_ref));
+        int rowid = getShapeIndexFromKey(event.m_shape_ref);
         auto &row = m_attributes->getRow(AttributeKey(event.m_shape_ref));
 
         if (rowid != -1 && m_hasgraph) {
@@ -1048,7 +1063,7 @@ void ShapeMap::undo() {
             //
             if (event.m_geometry.isLine()) {
                 int leng_col = m_attributes->getOrInsertLockedColumn("Line Length");
-                row.setValue(leng_col, (float)depthmapX::getMapAtIndex(m_shapes, rowid)->second.getLength());
+                row.setValue(leng_col, (float)getShapeRefFromIndex(rowid)->second.getLength());
             }
             //
             // now go through our connections, and add ourself:
@@ -1500,7 +1515,7 @@ std::vector<int> ShapeMap::lineInPolyList(const Line &li_orig, size_t lineref, d
                         if (intersect_region(li, poly.m_region)) {
                             // note: in this case m_region is stored as a line:
                             if (intersect_line(li, poly.m_region, tolerance)) {
-                                shapeindexlist.push_back(int(std::distance(m_shapes.begin(), shapeIter)));
+                                shapeindexlist.push_back(getShapeIndexFromKey(shapeIter->first));
                             }
                         }
                         break;
@@ -1510,7 +1525,7 @@ std::vector<int> ShapeMap::lineInPolyList(const Line &li_orig, size_t lineref, d
                                               poly.m_points[((shape.m_polyrefs[k] + 1) % poly.m_points.size())]);
                             if (intersect_region(li, lineb)) {
                                 if (intersect_line(li, lineb, tolerance)) {
-                                    shapeindexlist.push_back(int(std::distance(m_shapes.begin(), shapeIter)));
+                                    shapeindexlist.push_back(getShapeIndexFromKey(shapeIter->first));
                                 }
                             }
                         }
@@ -1554,7 +1569,7 @@ std::vector<int> ShapeMap::polyInPolyList(int polyref, double tolerance) const {
                             if (iter == testedlist.end()) {
                                 testedlist.insert(iter, shapeRef.m_shape_ref);
                                 shapeindexlist.push_back(
-                                    int(depthmapX::findIndexFromKey(m_shapes, int(shapeRef.m_shape_ref))));
+                                    int(getShapeIndexFromKey(int(shapeRef.m_shape_ref))));
                             }
                         }
                     }
@@ -1575,7 +1590,7 @@ std::vector<int> ShapeMap::polyInPolyList(int polyref, double tolerance) const {
                             auto iter = depthmapX::findBinary(testedlist, shaperefb.m_shape_ref);
                             if (shaperef != shaperefb && iter == testedlist.end()) {
                                 auto shapeIter = m_shapes.find(shaperefb.m_shape_ref);
-                                size_t indexb = std::distance(m_shapes.begin(), shapeIter);
+                                size_t indexb = size_t(getShapeIndexFromKey(shapeIter->first));
                                 const SalaShape &polyb = shapeIter->second;
                                 if (polyb.isPoint()) {
                                     if (testPointInPoly(polyb.getPoint(), shaperef) != -1) {
@@ -1700,6 +1715,7 @@ std::vector<int> ShapeMap::shapeInPolyList(const SalaShape &shape) // note: no c
         // clean up:
         removePolyPixels(ref);
         m_shapes.erase(m_shapes.find(ref));
+        m_shape_edits++;
     }
     return shapeindexlist;
 }
@@ -1852,7 +1868,7 @@ int ShapeMap::testPointInPoly(const Point2f &p, const ShapeRef &shape) const {
             }
         }
     }
-    return (shapeIter == m_shapes.end()) ? -1 : std::distance(m_shapes.begin(), shapeIter); // note convert to -1
+    return (shapeIter == m_shapes.end()) ? -1 : getShapeIndexFromKey(shapeIter->first); // note convert to -1
 }
 
 // also note that you may want to find a close poly line or point
@@ -1901,7 +1917,7 @@ int ShapeMap::getClosestOpenGeom(const Point2f &p) const {
         }
     }
 
-    return (shapeIter == m_shapes.end()) ? -1 : std::distance(m_shapes.begin(), shapeIter); // note conversion to -1
+    return (shapeIter == m_shapes.end()) ? -1 : getShapeIndexFromKey(shapeIter->first); // note conversion to -1
 }
 
 Point2f ShapeMap::getClosestVertex(const Point2f &p) const {
@@ -1978,7 +1994,7 @@ int ShapeMap::getClosestLine(const Point2f &p) const {
 
     if (m_bsp_tree) { // <- check there is actually something in the tree!
         Isovist iso;
-        index = iso.getClosestLine(m_bsp_root, p);
+        index = iso.getClosestLine(m_bsp_nodes, p);
     }
 
     return index;
@@ -1986,7 +2002,8 @@ int ShapeMap::getClosestLine(const Point2f &p) const {
 
 // code to add intersections when shapes are added to the graph one by one:
 int ShapeMap::connectIntersected(int rowid, bool linegraph) {
-    auto shaperefIter = depthmapX::getMapAtIndex(m_shapes, rowid);
+    m_segment_graph_valid = false;
+    auto shaperefIter = getShapeRefFromIndex(rowid);
     int conn_col = m_attributes->getOrInsertLockedColumn("Connectivity");
     int leng_col = -1;
     if (linegraph) {
@@ -2023,43 +2040,70 @@ int ShapeMap::connectIntersected(int rowid, bool linegraph) {
 // note, connections are listed by rowid in list, *not* reference number
 // (so they may vary: must be checked carefully when shapes are removed / added)
 std::vector<int> ShapeMap::getLineConnections(int lineref, double tolerance) {
-    std::vector<int> connections;
-
-    SalaShape &poly = m_shapes.find(lineref)->second;
+    const SalaShape &poly = m_shapes.find(lineref)->second;
     if (!poly.isLine()) {
         return std::vector<int>();
     }
-    const Line &l = poly.getLine();
+    std::vector<int> candidates;
+    return getCrossingLines(lineref, poly.getLine(), tolerance, candidates);
+}
 
-    std::unordered_set<ShapeRef, ShapeRefHash> shapesToTest;
+// the whole map version of getLineConnections, for building a graph from scratch: every line
+// finds the lines crossing it independently, so the lines are shared out over the threads
+std::vector<std::vector<int>> ShapeMap::getAllLineConnections(Communicator *comm, double tolerance,
+                                                              int threads) const {
+    std::vector<std::vector<int>> connections(m_shapes.size());
+    if (m_shapes.empty()) {
+        return connections;
+    }
+    // the shape index is built here, as the workers only read it
+    updateShapeIndex();
+    size_t thread_count = depthmapX::getThreadCount(threads, m_shapes.size());
+    std::vector<std::vector<int>> candidates(thread_count);
+    if (comm) {
+        comm->CommPostMessage(Communicator::NUM_RECORDS, int(m_shapes.size()));
+    }
+    depthmapX::parallelFor(comm, thread_count, m_shapes.size(), [&](size_t i, size_t threadIndex) {
+        auto shape = m_shape_index[i];
+        if (shape->second.isLine()) {
+            connections[i] =
+                getCrossingLines(shape->first, shape->second.getLine(), tolerance, candidates[threadIndex]);
+        }
+    });
+    return connections;
+}
 
+std::vector<int> ShapeMap::getCrossingLines(int lineref, const Line &l, double tolerance,
+                                            std::vector<int> &candidates) const {
     // As of version 10, self-connections are *not* added
     // In the past:
     // <exclude> it's useful to have yourself in your connections list
     // (apparently! -- this needs checking, as most of the time it is then checked to exclude self again!) </exclude>
     // <exclude> connections.add(m_shapes.searchindex(lineref)); </exclude>
 
-    shapesToTest.insert(lineref);
-
-    PixelRefVector list = pixelateLine(l);
-
-    for (size_t i = 0; i < list.size(); i++) {
-        const std::vector<ShapeRef> &shapeRefs =
-            m_pixel_shapes(static_cast<size_t>(list[i].y), static_cast<size_t>(list[i].x));
+    // every open shape sharing a pixel with the line, each once: keys are in the same order as
+    // rows, so sorting them also puts the connections in order
+    candidates.clear();
+    for (const PixelRef &pix : pixelateLine(l)) {
+        const std::vector<ShapeRef> &shapeRefs = m_pixel_shapes(static_cast<size_t>(pix.y), static_cast<size_t>(pix.x));
         for (const ShapeRef &shape : shapeRefs) {
-            shapesToTest.insert(shape);
-        }
-    }
-    for (ShapeRef shape : shapesToTest) {
-        if ((shape.m_tags & ShapeRef::SHAPE_OPEN) == ShapeRef::SHAPE_OPEN) {
-            const Line &line = m_shapes.find(int(shape.m_shape_ref))->second.getLine();
-            if (intersect_region(line, l, line.length() * tolerance)) {
-                // n.b. originally this followed the logic that we must normalise intersect_line properly: tolerance *
-                // line length one * line length two in fact, works better if it's just line.length() * tolerance...
-                if (intersect_line(line, l, line.length() * tolerance)) {
-                    depthmapX::insert_sorted(connections,
-                                             depthmapX::findIndexFromKey(m_shapes, int(shape.m_shape_ref)));
-                }
+            if ((shape.m_tags & ShapeRef::SHAPE_OPEN) == ShapeRef::SHAPE_OPEN && int(shape.m_shape_ref) != lineref) {
+                candidates.push_back(int(shape.m_shape_ref));
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    std::vector<int> connections;
+    for (int key : candidates) {
+        int rowid = getShapeIndexFromKey(key);
+        const Line &line = m_shape_index[size_t(rowid)]->second.getLine();
+        if (intersect_region(line, l, line.length() * tolerance)) {
+            // n.b. originally this followed the logic that we must normalise intersect_line properly: tolerance *
+            // line length one * line length two in fact, works better if it's just line.length() * tolerance...
+            if (intersect_line(line, l, line.length() * tolerance)) {
+                connections.push_back(rowid);
             }
         }
     }
@@ -2100,6 +2144,7 @@ std::vector<int> ShapeMap::getShapeConnections(int shaperef, double tolerance) {
 
 // for any geometry, not just line to lines
 void ShapeMap::makeShapeConnections() {
+    m_segment_graph_valid = false;
     if (m_hasgraph) {
         m_connectors.clear();
         m_attributes->clear();
@@ -2270,7 +2315,39 @@ bool ShapeMap::selectionToLayer(const std::string &name) {
 
 /////////////////////////////////////////////////////////////////////////////////////////////////
 
+void ShapeMap::updateShapeIndex() const {
+    if (m_shape_index_edits != m_shape_edits) {
+        m_shape_index.clear();
+        m_shape_key_index.clear();
+        m_shape_index.reserve(m_shapes.size());
+        m_shape_index_edits = m_shape_edits;
+    } else if (m_shape_index.size() == m_shapes.size()) {
+        // nothing has been added since
+        return;
+    }
+    // n.b. the index hands out iterators that the non-const accessors may write through
+    auto &shapes = const_cast<std::map<int, SalaShape> &>(m_shapes);
+    // only shapes with a new largest key have been added since the index was made, so they follow
+    // the last shape in it
+    auto iter = m_shape_index.empty() ? shapes.begin() : std::next(m_shape_index.back());
+    for (; iter != shapes.end(); ++iter) {
+        m_shape_key_index[iter->first] = int(m_shape_index.size());
+        m_shape_index.push_back(iter);
+    }
+}
+
+const SegmentGraph &ShapeMap::getSegmentGraph() const {
+    // n.b. the connections can also be changed through getConnections(), so a snapshot
+    // that no longer matches them in size is rebuilt too
+    if (!m_segment_graph_valid || m_segment_graph.segmentCount() != m_connectors.size()) {
+        m_segment_graph = SegmentGraph(m_connectors);
+        m_segment_graph_valid = true;
+    }
+    return m_segment_graph;
+}
+
 bool ShapeMap::read(std::istream &stream) {
+    m_segment_graph_valid = false;
     // turn off selection / editable etc
     m_editable = false;
     m_show = true; // <- by default show
@@ -2278,11 +2355,12 @@ bool ShapeMap::read(std::istream &stream) {
 
     // clear old BSP tree (if exists)
     m_bsp_tree = false;
-    m_bsp_root = NULL;
+    m_bsp_nodes = FlatBSPTree();
 
     // clear old:
     m_display_shapes.clear();
     m_shapes.clear();
+    m_shape_edits++;
     m_attributes->clear();
     m_connectors.clear();
     m_links.clear();
@@ -2322,6 +2400,7 @@ bool ShapeMap::read(std::istream &stream) {
         stream.read((char *)&key, sizeof(key));
         auto iter = m_shapes.insert(std::make_pair(key, SalaShape())).first;
         iter->second.read(stream);
+        shapeAdded(key);
     }
 
     // read object data (currently unused)
@@ -2693,7 +2772,7 @@ void ShapeMap::makeViewportShapes(const QtRegion &viewport) const {
             const std::vector<ShapeRef> &shapeRefs = m_pixel_shapes(static_cast<size_t>(j), static_cast<size_t>(i));
             for (const ShapeRef &shape : shapeRefs) {
                 // copy the index to the correct draworder position (draworder is formatted on display attribute)
-                int x = std::distance(m_shapes.begin(), m_shapes.find(shape.m_shape_ref));
+                int x = getShapeIndexFromKey(shape.m_shape_ref);
                 AttributeKey shapeRefKey(shape.m_shape_ref);
                 if (isObjectVisible(m_layers, m_attributes->getRow(shapeRefKey))) {
                     m_display_shapes[m_attribHandle->findInIndex(shapeRefKey)] = x;
@@ -2727,7 +2806,7 @@ bool ShapeMap::findNextShape(bool &nextlayer) const {
 const SalaShape &ShapeMap::getNextShape() const {
     int x = m_display_shapes[m_current]; // x has display order in it
     m_display_shapes[m_current] = -1;    // you've drawn it
-    return depthmapX::getMapAtIndex(m_shapes, x)->second;
+    return getShapeRefFromIndex(x)->second;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////
@@ -2832,7 +2911,7 @@ bool ShapeMap::linkShapes(const Point2f &p) {
     if (m_selection_set.size() != 1) {
         return false;
     }
-    int index1 = std::distance(m_shapes.begin(), m_shapes.find(*m_selection_set.begin()));
+    int index1 = getShapeIndexFromKey(*m_selection_set.begin());
     // note: uses rowid not key
     int index2 = pointInPoly(p);
     if (index2 == -1) {
@@ -2850,12 +2929,13 @@ bool ShapeMap::linkShapes(const Point2f &p) {
 }
 
 bool ShapeMap::linkShapesFromRefs(int ref1, int ref2, bool refresh) {
-    int index1 = depthmapX::findIndexFromKey(m_shapes, ref1);
-    int index2 = depthmapX::findIndexFromKey(m_shapes, ref2);
+    int index1 = getShapeIndexFromKey(ref1);
+    int index2 = getShapeIndexFromKey(ref2);
     return linkShapes(index1, index2, refresh);
 }
 
 bool ShapeMap::linkShapes(int index1, int index2, bool refresh) {
+    m_segment_graph_valid = false;
     int conn_col = m_attributes->getOrInsertLockedColumn("Connectivity");
     bool update = false;
 
@@ -2900,6 +2980,7 @@ bool ShapeMap::linkShapes(int index1, int index2, bool refresh) {
 // this version is used to link segments in segment analysis
 // note it only links one way!
 bool ShapeMap::linkShapes(int id1, int dir1, int id2, int dir2, float weight) {
+    m_segment_graph_valid = false;
     bool success = false;
     Connector &connector = m_connectors[size_t(id1)];
     if (dir1 == 1) {
@@ -2924,7 +3005,7 @@ bool ShapeMap::unlinkShapes(const Point2f &p) {
     if (m_selection_set.size() != 1) {
         return false;
     }
-    int index1 = std::distance(m_shapes.begin(), m_shapes.find(*m_selection_set.begin()));
+    int index1 = getShapeIndexFromKey(*m_selection_set.begin());
     int index2 = pointInPoly(p);
     if (index2 == -1) {
         // try looking for a polyline instead
@@ -2941,13 +3022,14 @@ bool ShapeMap::unlinkShapes(const Point2f &p) {
 }
 
 bool ShapeMap::unlinkShapesFromRefs(int ref1, int ref2, bool refresh) {
-    int index1 = depthmapX::findIndexFromKey(m_shapes, ref1);
-    int index2 = depthmapX::findIndexFromKey(m_shapes, ref2);
+    int index1 = getShapeIndexFromKey(ref1);
+    int index2 = getShapeIndexFromKey(ref2);
     return unlinkShapes(index1, index2, refresh);
 }
 
 // note: uses rowids rather than shape key
 bool ShapeMap::unlinkShapes(int index1, int index2, bool refresh) {
+    m_segment_graph_valid = false;
     int conn_col = m_attributes->getColumnIndex("Connectivity");
     bool update = false;
 
@@ -2989,11 +3071,12 @@ bool ShapeMap::unlinkShapes(int index1, int index2, bool refresh) {
 }
 
 bool ShapeMap::unlinkShapesByKey(int key1, int key2, bool refresh) {
+    m_segment_graph_valid = false;
     int conn_col = m_attributes->getColumnIndex("Connectivity");
     bool update = false;
 
-    int index1 = std::distance(m_shapes.begin(), m_shapes.find(key1));
-    int index2 = std::distance(m_shapes.begin(), m_shapes.find(key2));
+    int index1 = getShapeIndexFromKey(key1);
+    int index2 = getShapeIndexFromKey(key2);
 
     if (key1 != key2) {
         // unlink these shapes...
@@ -3033,6 +3116,7 @@ bool ShapeMap::unlinkShapesByKey(int key1, int key2, bool refresh) {
 }
 
 bool ShapeMap::clearLinks() {
+    m_segment_graph_valid = false;
     for (size_t i = 0; i < m_unlinks.size(); i++) {
         OrderedIntPair link = m_unlinks[i];
         depthmapX::insert_sorted(m_connectors[size_t(link.a)].m_connections, link.b);
@@ -3113,8 +3197,8 @@ bool ShapeMap::findNextLinkLine() const {
 Line ShapeMap::getNextLinkLine() const {
     // note, links are stored directly by rowid, not by key:
     if (m_curlinkline < (int)m_links.size()) {
-        return Line(depthmapX::getMapAtIndex(m_shapes, m_links[m_curlinkline].a)->second.getCentroid(),
-                    depthmapX::getMapAtIndex(m_shapes, m_links[m_curlinkline].b)->second.getCentroid());
+        return Line(getShapeRefFromIndex(m_links[m_curlinkline].a)->second.getCentroid(),
+                    getShapeRefFromIndex(m_links[m_curlinkline].b)->second.getCentroid());
     }
     return Line();
 }
@@ -3122,8 +3206,8 @@ Line ShapeMap::getNextLinkLine() const {
 std::vector<SimpleLine> ShapeMap::getAllLinkLines() {
     std::vector<SimpleLine> linkLines;
     for (size_t i = 0; i < m_links.size(); i++) {
-        linkLines.push_back(SimpleLine(depthmapX::getMapAtIndex(m_shapes, m_links[i].a)->second.getCentroid(),
-                                       depthmapX::getMapAtIndex(m_shapes, m_links[i].b)->second.getCentroid()));
+        linkLines.push_back(SimpleLine(getShapeRefFromIndex(m_links[i].a)->second.getCentroid(),
+                                       getShapeRefFromIndex(m_links[i].b)->second.getCentroid()));
     }
     return linkLines;
 }
@@ -3140,8 +3224,8 @@ bool ShapeMap::findNextUnlinkPoint() const {
 Point2f ShapeMap::getNextUnlinkPoint() const {
     // note, links are stored directly by rowid, not by key:
     if (m_curunlinkpoint < (int)m_unlinks.size()) {
-        return intersection_point(depthmapX::getMapAtIndex(m_shapes, m_unlinks[m_curunlinkpoint].a)->second.getLine(),
-                                  depthmapX::getMapAtIndex(m_shapes, m_unlinks[m_curunlinkpoint].b)->second.getLine(),
+        return intersection_point(getShapeRefFromIndex(m_unlinks[m_curunlinkpoint].a)->second.getLine(),
+                                  getShapeRefFromIndex(m_unlinks[m_curunlinkpoint].b)->second.getLine(),
                                   TOLERANCE_A);
     }
     return Point2f();
@@ -3149,8 +3233,8 @@ Point2f ShapeMap::getNextUnlinkPoint() const {
 std::vector<Point2f> ShapeMap::getAllUnlinkPoints() {
     std::vector<Point2f> unlinkPoints;
     for (size_t i = 0; i < m_unlinks.size(); i++) {
-        unlinkPoints.push_back(intersection_point(depthmapX::getMapAtIndex(m_shapes, m_unlinks[i].a)->second.getLine(),
-                                                  depthmapX::getMapAtIndex(m_shapes, m_unlinks[i].b)->second.getLine(),
+        unlinkPoints.push_back(intersection_point(getShapeRefFromIndex(m_unlinks[i].a)->second.getLine(),
+                                                  getShapeRefFromIndex(m_unlinks[i].b)->second.getLine(),
                                                   TOLERANCE_A));
     }
     return unlinkPoints;
@@ -3163,8 +3247,8 @@ void ShapeMap::outputUnlinkPoints(std::ofstream &stream, char delim) {
     for (size_t i = 0; i < m_unlinks.size(); i++) {
         // note, links are stored directly by rowid, not by key:
         Point2f p =
-            intersection_point(depthmapX::getMapAtIndex(m_shapes, m_unlinks[i].a)->second.getLine(),
-                               depthmapX::getMapAtIndex(m_shapes, m_unlinks[i].b)->second.getLine(), TOLERANCE_A);
+            intersection_point(getShapeRefFromIndex(m_unlinks[i].a)->second.getLine(),
+                               getShapeRefFromIndex(m_unlinks[i].b)->second.getLine(), TOLERANCE_A);
         stream << p.x << delim << p.y << std::endl;
     }
 }
@@ -3187,13 +3271,7 @@ bool ShapeMap::makeBSPtree() const {
         //
         // Now we'll try the BSP tree:
         //
-        if (m_bsp_root) {
-            delete m_bsp_root;
-            m_bsp_root = NULL;
-        }
-        m_bsp_root = new BSPNode();
-
-        BSPTree::make(NULL, 0, partitionlines, m_bsp_root);
+        m_bsp_nodes = BSPTree::make(NULL, 0, partitionlines);
         m_bsp_tree = true;
     }
 
@@ -3293,11 +3371,11 @@ std::vector<SimpleLine> ShapeMap::getAllShapesAsLines() const {
 
 std::vector<std::pair<SimpleLine, PafColor>> ShapeMap::getAllLinesWithColour() {
     std::vector<std::pair<SimpleLine, PafColor>> colouredLines;
-    std::map<int, SalaShape> &allShapes = getAllShapes();
+    const std::map<int, SalaShape> &allShapes = m_shapes;
     int k = -1;
-    for (auto &refShape : allShapes) {
+    for (const auto &refShape : allShapes) {
         k++;
-        SalaShape &shape = refShape.second;
+        const SalaShape &shape = refShape.second;
         PafColor colour(dXreimpl::getDisplayColor(AttributeKey(refShape.first),
                                                   m_attributes->getRow(AttributeKey(refShape.first)),
                                                   *m_attribHandle.get(), true));
@@ -3315,9 +3393,9 @@ std::vector<std::pair<SimpleLine, PafColor>> ShapeMap::getAllLinesWithColour() {
 
 std::vector<std::pair<std::vector<Point2f>, PafColor>> ShapeMap::getAllPolygonsWithColour() {
     std::vector<std::pair<std::vector<Point2f>, PafColor>> colouredPolygons;
-    std::map<int, SalaShape> &allShapes = getAllShapes();
-    for (auto &refShape : allShapes) {
-        SalaShape &shape = refShape.second;
+    const std::map<int, SalaShape> &allShapes = m_shapes;
+    for (const auto &refShape : allShapes) {
+        const SalaShape &shape = refShape.second;
         if (shape.isPolygon()) {
             std::vector<Point2f> vertices;
             for (size_t n = 0; n < shape.m_points.size(); n++) {
@@ -3335,9 +3413,9 @@ std::vector<std::pair<std::vector<Point2f>, PafColor>> ShapeMap::getAllPolygonsW
 
 std::vector<std::pair<Point2f, PafColor>> ShapeMap::getAllPointsWithColour() {
     std::vector<std::pair<Point2f, PafColor>> colouredPoints;
-    std::map<int, SalaShape> &allShapes = getAllShapes();
-    for (auto &refShape : allShapes) {
-        SalaShape &shape = refShape.second;
+    const std::map<int, SalaShape> &allShapes = m_shapes;
+    for (const auto &refShape : allShapes) {
+        const SalaShape &shape = refShape.second;
         if (shape.isPoint()) {
             PafColor colour(dXreimpl::getDisplayColor(AttributeKey(refShape.first),
                                                       m_attributes->getRow(AttributeKey(refShape.first)),
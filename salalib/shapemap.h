@@ -25,9 +25,11 @@
 #include "salalib/importtypedefs.h"
 #include "salalib/layermanagerimpl.h"
 #include "salalib/parsers/mapinfodata.h"
+#include "salalib/segmentgraph.h"
 #include "salalib/spacepix.h"
 
 #include "genlib/bsptree.h"
+#include "genlib/comm.h"
 #include "genlib/containerutils.h"
 #include "genlib/p2dpoly.h"
 #include "genlib/readwritehelpers.h"
@@ -36,6 +38,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 // each pixel has various lists of information:
@@ -241,10 +244,29 @@ class ShapeMap : public PixelBase {
     depthmapX::ColumnMatrix<std::vector<ShapeRef>> m_pixel_shapes; // i rows of j columns
     //
     // allow quick closest line test (note only works for a given layer, with many layers will be tricky)
-    mutable BSPNode *m_bsp_root = nullptr;
+    mutable FlatBSPTree m_bsp_nodes;
     mutable bool m_bsp_tree = false;
     //
     std::map<int, SalaShape> m_shapes;
+    // the shapes in index (key) order and the index of each key, so that neither lookup walks
+    // the map. m_shape_edits counts the changes to the map other than adding a shape with a new
+    // largest key: the index is rebuilt if it was made before the last of those, and otherwise
+    // only extended with the shapes added since (see updateShapeIndex)
+    mutable std::vector<std::map<int, SalaShape>::iterator> m_shape_index;
+    mutable std::unordered_map<int, int> m_shape_key_index;
+    size_t m_shape_edits = 0;
+    mutable size_t m_shape_index_edits = size_t(-1);
+    void updateShapeIndex() const;
+    // to be called after a shape has been inserted into m_shapes
+    void shapeAdded(int key) {
+        if (key != m_shapes.rbegin()->first) {
+            m_shape_edits++;
+        }
+    }
+    // the rows of the lines crossing line l, which is the shape with key lineref, in row order;
+    // candidates is scratch space
+    std::vector<int> getCrossingLines(int lineref, const Line &l, double tolerance,
+                                      std::vector<int> &candidates) const;
     //
     std::vector<SalaEvent> m_undobuffer;
     //
@@ -256,6 +278,9 @@ class ShapeMap : public PixelBase {
     // Note: this list is stored PACKED for optimal performance on graph analysis
     // ALWAYS check it is in the same order as the shape list and attribute table
     std::vector<Connector> m_connectors;
+    // snapshot of the segment connections for the analyses (see getSegmentGraph)
+    mutable SegmentGraph m_segment_graph;
+    mutable bool m_segment_graph_valid = false;
     //
     // for geometric operations
     double m_tolerance;
@@ -268,8 +293,10 @@ private:
     void moveData(ShapeMap& other) {
         m_show = other.isShown();
         m_shapes = std::move(other.m_shapes);
+        m_shape_edits++;
         m_hasgraph = other.m_hasgraph;
         m_connectors = std::move(other.m_connectors);
+        m_segment_graph_valid = false;
         m_links = std::move(other.m_links);
         m_unlinks = std::move(other.m_unlinks);
         m_mapinfodata = std::move(other.m_mapinfodata);
@@ -312,7 +339,18 @@ private:
     // that still use them are the connections of the axial/segment maps and the point
     // in polygon functions.
     const std::map<int, SalaShape>::const_iterator getShapeRefFromIndex(size_t index) const {
-        return depthmapX::getMapAtIndex(m_shapes, index);
+        updateShapeIndex();
+        return m_shape_index[index];
+    }
+    std::map<int, SalaShape>::iterator getShapeRefFromIndex(size_t index) {
+        updateShapeIndex();
+        return m_shape_index[index];
+    }
+    // the index of the shape with this key, or -1 if there is none
+    int getShapeIndexFromKey(int key) const {
+        updateShapeIndex();
+        auto iter = m_shape_key_index.find(key);
+        return iter == m_shape_key_index.end() ? -1 : iter->second;
     }
     AttributeRow &getAttributeRowFromShapeIndex(size_t index) {
         return m_attributes->getRow(AttributeKey(getShapeRefFromIndex(index)->first));
@@ -327,10 +365,10 @@ private:
     // num shapes for this object (note, request by object rowid
     // -- on interrogation, this is what you will usually receive)
     size_t getShapeCount(int rowid) const {
-        return depthmapX::getMapAtIndex(m_shapes, rowid)->second.m_points.size();
+        return getShapeRefFromIndex(size_t(rowid))->second.m_points.size();
     }
     //
-    int getIndex(int rowid) const { return depthmapX::getMapAtIndex(m_shapes, rowid)->first; }
+    int getIndex(int rowid) const { return getShapeRefFromIndex(size_t(rowid))->first; }
     //
     // add shape tools
     void makePolyPixels(int shaperef);
@@ -414,6 +452,10 @@ private:
     int connectIntersected(int rowid, bool linegraph);
     // Get the connections for a particular line
     std::vector<int> getLineConnections(int lineref, double tolerance);
+    // The connections of every shape in the map at once, as getLineConnections gives them
+    // (empty for shapes that are not lines), worked out on up to threads threads (0 or less
+    // for as many as the hardware offers)
+    std::vector<std::vector<int>> getAllLineConnections(Communicator *comm, double tolerance, int threads = 1) const;
     // Get arbitrary shape connections for a particular shape
     std::vector<int> getShapeConnections(int polyref, double tolerance);
     // Make all connections
@@ -423,6 +465,9 @@ private:
     //
     const std::vector<Connector> &getConnections() const { return m_connectors; }
     std::vector<Connector> &getConnections() { return m_connectors; }
+    // the segment connections in compressed form, built the first time they are asked for
+    // and kept until the connections change
+    const SegmentGraph &getSegmentGraph() const;
     //
     bool isAllLineMap() const { return m_map_type == ALLLINEMAP; }
     bool isSegmentMap() const { return m_map_type == SEGMENTMAP; }
@@ -554,7 +599,7 @@ private:
         ;
     }
     bool getShapeSelected() const {
-        return depthmapX::getMapAtIndex(m_shapes, m_display_shapes[m_current])->second.m_selected;
+        return getShapeRefFromIndex(size_t(m_display_shapes[m_current]))->second.m_selected;
     }
     //
     double getLocationValue(const Point2f &point) const;
@@ -571,7 +616,14 @@ private:
     //
     // dangerous: accessor for the shapes themselves:
     const std::map<int, SalaShape> &getAllShapes() const { return m_shapes; }
+    // n.b. the shapes may be changed through this, but not added or removed, as the shape index
+    // would not know about it: use the make/remove functions or clearShapes for that
     std::map<int, SalaShape> &getAllShapes() { return m_shapes; }
+    // drops the shapes, but not their attributes or connections
+    void clearShapes() {
+        m_shapes.clear();
+        m_shape_edits++;
+    }
     // required for PixelBase, have to implement your own version of pixelate
     PixelRef pixelate(const Point2f &p, bool constrain = true, int = 1) const;
     //
@@ -627,4 +679,6 @@ private:
 
   private:
     bool importData(const depthmapX::Table &data, std::vector<int> shape_refs);
+    // removes everything of a shape but its attribute row, so that the rows of many shapes can be removed together
+    void removeShapeKeepingRow(int shaperef, bool undoing);
 };
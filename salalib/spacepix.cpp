@@ -559,16 +559,16 @@ bool SpacePixel::intersect(const Line &l, double tolerance) {
     return false;
 }
 
-bool SpacePixel::intersect_exclude(const Line &l, double tolerance) {
-    m_test++; // note loops! (but vary rarely: inevitabley, lines will have been marked before it loops)
+bool SpacePixel::intersect_exclude(const Line &l, LineTestMarks &marks, double tolerance) const {
+    marks.reset(m_ref);
 
     PixelRefVector list = pixelateLine(l);
 
     for (size_t i = 0; i < list.size(); i++) {
         auto &pixel_lines = m_pixel_lines(static_cast<size_t>(list[i].y), static_cast<size_t>(list[i].x));
         for (int lineref : pixel_lines) {
-            LineTest &linetest = m_lines.find(lineref)->second;
-            if (linetest.test != m_test) {
+            if (marks.mark(lineref)) {
+                const LineTest &linetest = m_lines.find(lineref)->second;
                 if (intersect_region(linetest.line, l)) {
                     if (intersect_line(linetest.line, l, tolerance)) {
                         if (linetest.line.start() != l.start() && linetest.line.start() != l.end() &&
@@ -577,7 +577,6 @@ bool SpacePixel::intersect_exclude(const Line &l, double tolerance) {
                         }
                     }
                 }
-                linetest.test = m_test;
             }
         }
     }
@@ -585,8 +584,8 @@ bool SpacePixel::intersect_exclude(const Line &l, double tolerance) {
     return false;
 }
 
-void SpacePixel::cutLine(Line &l, short dir) {
-    m_test++;
+void SpacePixel::cutLine(Line &l, short dir, LineTestMarks &marks) const {
+    marks.reset(m_ref);
 
     double tolerance = l.length() * 1e-9;
 
@@ -611,8 +610,8 @@ void SpacePixel::cutLine(Line &l, short dir) {
         auto &pixel_lines = m_pixel_lines(static_cast<size_t>(pix.y), static_cast<size_t>(pix.x));
         for (int lineref : pixel_lines) {
             // try {
-            LineTest &linetest = m_lines.find(lineref)->second;
-            if (linetest.test != m_test) {
+            if (marks.mark(lineref)) {
+                const LineTest &linetest = m_lines.find(lineref)->second;
                 if (intersect_region(linetest.line, l, tolerance * linetest.line.length())) {
                     switch (intersect_line_distinguish(linetest.line, l, tolerance * linetest.line.length())) {
                     case 0:
@@ -668,7 +667,6 @@ void SpacePixel::cutLine(Line &l, short dir) {
                         break;
                     }
                 }
-                linetest.test = m_test;
             }
             //}
             // catch (pexception) {
@@ -27,6 +27,7 @@
 #include "genlib/simplematrix.h"
 #include "genlib/stringutils.h"
 
+#include <algorithm>
 #include <deque>
 #include <map>
 
@@ -66,6 +67,36 @@ struct LineTest {
     // operator Line() {return line;}
 };
 
+// Which lines a test against a SpacePixel has already looked at, in place of the test counter
+// on the lines themselves, so that several threads can test against the same lines at once
+// with one LineTestMarks each
+class LineTestMarks {
+  public:
+    // start a new test, against lines with refs up to maxRef
+    void reset(int maxRef) {
+        if (m_marks.size() <= size_t(maxRef + 1)) {
+            m_marks.resize(size_t(maxRef + 1), 0);
+        }
+        if (++m_test == 0) {
+            std::fill(m_marks.begin(), m_marks.end(), 0);
+            m_test = 1;
+        }
+    }
+    // true the first time it is called for a line in a test
+    bool mark(int lineref) {
+        unsigned int &marked = m_marks[size_t(lineref)];
+        if (marked == m_test) {
+            return false;
+        }
+        marked = m_test;
+        return true;
+    }
+
+  private:
+    std::vector<unsigned int> m_marks;
+    unsigned int m_test = 0;
+};
+
 struct LineKey {
     unsigned int file : 4;
     unsigned int layer : 6;
@@ -136,9 +167,10 @@ class SpacePixel : public PixelBase {
     virtual const Line &getNextLine() const;
     //
     bool intersect(const Line &l, double tolerance = 0.0);
-    bool intersect_exclude(const Line &l, double tolerance = 0.0);
+    // marks is scratch space, so that these can be run from several threads at once
+    bool intersect_exclude(const Line &l, LineTestMarks &marks, double tolerance = 0.0) const;
 
-    void cutLine(Line &l, short dir);
+    void cutLine(Line &l, short dir, LineTestMarks &marks) const;
 
     QtRegion &getRegion() const { return (QtRegion &)m_region; }
 
@@ -0,0 +1,140 @@
+// sala - a component of the depthmapX - spatial network analysis platform
+// Copyright (C) 2026, Tasos Varoudis
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "salalib/pointdata.h"
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+// Priority queues for the metric and angular traversals of the visibility graph
+// (VisibilityGraph::extractMetric / extractAngular). Both pop the same entries in the same
+// order: smallest first by the entry's operator<, and an entry that compares equal to
+// one already queued is dropped, as std::set::insert would do.
+
+inline float traversalKey(const MetricTriple &triple) { return triple.dist; }
+inline float traversalKey(const AngularTriple &triple) { return triple.angle; }
+
+// bucket widths for BucketTraversalQueue: metric distances are in grid units and every
+// step is at least one unit long, while angles are in quarter turns (1 = 90 degrees) and
+// steps straight ahead add nothing at all
+const float METRIC_BUCKET_WIDTH = 1.0f;
+const float ANGULAR_BUCKET_WIDTH = 0.125f;
+
+// The original implementation, kept for checking the bucket queue against
+template <typename T> class SetTraversalQueue {
+  public:
+    void push(const T &item) { m_items.insert(item); }
+    T pop() {
+        auto it = m_items.begin();
+        T item = *it;
+        m_items.erase(it);
+        return item;
+    }
+    bool empty() const { return m_items.empty(); }
+    void clear() { m_items.clear(); }
+
+  private:
+    std::set<T> m_items;
+};
+
+// Monotone bucket (Dial) queue: entries are binned by traversalKey() into buckets of a
+// fixed width, and only the bucket currently being popped is kept ordered (as a heap).
+// Keys are expected never to drop below the last key popped; an entry that does is put
+// in the current bucket, where it still comes out next. The buckets keep their memory
+// over clear(), so a queue reused for many traversals stops allocating after the first.
+template <typename T> class BucketTraversalQueue {
+  public:
+    BucketTraversalQueue(float bucketWidth) : m_width(bucketWidth) {}
+
+    void push(const T &item) {
+        float key = traversalKey(item) / m_width;
+        size_t bucket = key > 0.0f ? static_cast<size_t>(key) : 0;
+        if (bucket < m_current) {
+            bucket = m_current;
+        }
+        if (bucket >= m_buckets.size()) {
+            m_buckets.resize(bucket + 1);
+        }
+        m_buckets[bucket].push_back(Entry{item, m_sequence++});
+        if (bucket == m_current) {
+            std::push_heap(m_buckets[bucket].begin(), m_buckets[bucket].end(), popsAfter);
+        }
+        m_last = std::max(m_last, bucket);
+        m_size++;
+    }
+
+    T pop() {
+        while (m_buckets[m_current].empty()) {
+            m_current++;
+            std::make_heap(m_buckets[m_current].begin(), m_buckets[m_current].end(), popsAfter);
+        }
+        std::vector<Entry> &entries = m_buckets[m_current];
+        T item = popFront(entries);
+        // equal entries are adjacent in the heap order, and only the first one pushed
+        // would have made it into a set
+        while (!entries.empty() && !(item < entries.front().item)) {
+            popFront(entries);
+        }
+        return item;
+    }
+
+    bool empty() const { return m_size == 0; }
+
+    void clear() {
+        for (size_t i = 0; i < m_buckets.size() && i <= m_last; i++) {
+            m_buckets[i].clear();
+        }
+        m_current = 0;
+        m_last = 0;
+        m_size = 0;
+        m_sequence = 0;
+    }
+
+  private:
+    struct Entry {
+        T item;
+        unsigned int sequence;
+    };
+
+    // heap comparator: ordered by item, then by the order of pushing
+    static bool popsAfter(const Entry &a, const Entry &b) {
+        if (b.item < a.item) {
+            return true;
+        }
+        if (a.item < b.item) {
+            return false;
+        }
+        return a.sequence > b.sequence;
+    }
+
+    T popFront(std::vector<Entry> &entries) {
+        std::pop_heap(entries.begin(), entries.end(), popsAfter);
+        T item = entries.back().item;
+        entries.pop_back();
+        m_size--;
+        return item;
+    }
+
+    float m_width;
+    std::vector<std::vector<Entry>> m_buckets;
+    size_t m_current = 0;
+    size_t m_last = 0;
+    size_t m_size = 0;
+    unsigned int m_sequence = 0;
+};
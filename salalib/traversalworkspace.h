@@ -0,0 +1,81 @@
+// sala - a component of the depthmapX - spatial network analysis platform
+// Copyright (C) 2026, Tasos Varoudis
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <vector>
+
+// Per-traversal scratch state for the visibility graph analyses (what used to be
+// m_misc, m_dist and m_cumangle on Point), indexed by the node ids of a VisibilityGraph.
+// Each workspace belongs to one traversal at a time, so several traversals can run
+// concurrently with one each. Every value is stamped with the epoch it was last written
+// in, and values from an older epoch read as the defaults, so starting a new traversal
+// does not touch the arrays.
+
+class TraversalWorkspace {
+  public:
+    TraversalWorkspace(size_t size, float defaultDist = -1.0f, float defaultCumAngle = 0.0f)
+        : m_epoch(1), m_default_dist(defaultDist), m_default_cumangle(defaultCumAngle), m_misc(size),
+          m_dist(size), m_cumangle(size) {}
+
+    // start a new traversal: all nodes revert to the defaults
+    void reset() {
+        if (++m_epoch == 0) {
+            m_misc.clearStamps();
+            m_dist.clearStamps();
+            m_cumangle.clearStamps();
+            m_epoch = 1;
+        }
+    }
+
+    int &misc(int node) { return m_misc.get(static_cast<size_t>(node), m_epoch, 0); }
+    float &dist(int node) { return m_dist.get(static_cast<size_t>(node), m_epoch, m_default_dist); }
+    float &cumangle(int node) { return m_cumangle.get(static_cast<size_t>(node), m_epoch, m_default_cumangle); }
+
+  private:
+    // one array per value, so that a traversal only pulls in and writes the values it
+    // actually uses, with each stamp stored next to its value so that a lookup is one access
+    template <typename T> class StampedArray {
+        struct Cell {
+            unsigned int stamp = 0;
+            T value;
+        };
+        std::vector<Cell> m_cells;
+
+      public:
+        StampedArray(size_t size) : m_cells(size) {}
+        T &get(size_t idx, unsigned int epoch, const T &defaultValue) {
+            Cell &cell = m_cells[idx];
+            if (cell.stamp != epoch) {
+                cell.stamp = epoch;
+                cell.value = defaultValue;
+            }
+            return cell.value;
+        }
+        void clearStamps() {
+            for (auto &cell : m_cells) {
+                cell.stamp = 0;
+            }
+        }
+    };
+
+    unsigned int m_epoch;
+    float m_default_dist;
+    float m_default_cumangle;
+    StampedArray<int> m_misc;
+    StampedArray<float> m_dist;
+    StampedArray<float> m_cumangle;
+};
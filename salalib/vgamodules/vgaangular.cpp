@@ -17,13 +17,13 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "salalib/vgamodules/vgaangular.h"
+#include "salalib/traversalqueue.h"
 
+#include "genlib/parallelutils.h"
 #include "genlib/stringutils.h"
 
 bool VGAAngular::run(Communicator *comm, PointMap &map, bool) {
-    time_t atime = 0;
     if (comm) {
-        qtimer(atime, 0);
         comm->CommPostMessage(Communicator::NUM_RECORDS, map.getFilledPointCount());
     }
 
@@ -51,83 +51,86 @@ bool VGAAngular::run(Communicator *comm, PointMap &map, bool) {
     // TODO: Binary compatibility. Remove in re-examination
     total_depth_col = attributes.getOrInsertColumn(total_detph_col_text.c_str());
 
-    int count = 0;
+    // every node is an origin, and the nodes are numbered in grid order
+    const VisibilityGraph &graph = map.getVisibilityGraph();
+    size_t nodeCount = graph.nodeCount();
 
-    for (size_t i = 0; i < map.getCols(); i++) {
-        for (size_t j = 0; j < map.getRows(); j++) {
-            PixelRef curs = PixelRef(static_cast<short>(i), static_cast<short>(j));
+    size_t threadCount = depthmapX::getThreadCount(m_threads, nodeCount);
+    std::vector<TraversalWorkspace> workspaces(threadCount, TraversalWorkspace(nodeCount, 0.0f, -1.0f));
+    std::vector<OriginResult> results(nodeCount);
 
-            if (map.getPoint(curs).filled()) {
+    auto traverseAll = [&](auto queues) {
+        depthmapX::parallelFor(comm, threadCount, nodeCount, [&](size_t idx, size_t threadIndex) {
+            if (m_gates_only) {
+                return;
+            }
+            results[idx] = traverse(graph, int(idx), workspaces[threadIndex], queues[threadIndex]);
+        });
+    };
+    if (m_set_queue) {
+        traverseAll(std::vector<SetTraversalQueue<AngularTriple>>(threadCount));
+    } else {
+        traverseAll(std::vector<BucketTraversalQueue<AngularTriple>>(
+            threadCount, BucketTraversalQueue<AngularTriple>(ANGULAR_BUCKET_WIDTH)));
+    }
 
-                if (m_gates_only) {
-                    count++;
-                    continue;
-                }
+    // results are written in grid order, whatever order they were calculated in
+    for (size_t idx = 0; idx < nodeCount; idx++) {
+        const OriginResult &result = results[idx];
+        if (!result.analysed) {
+            continue;
+        }
+        AttributeRow &row = attributes.getRow(AttributeKey(graph.pixel(int(idx))));
+        if (result.total_nodes > 0) {
+            row.setValue(mean_depth_col, float(double(result.total_angle) / double(result.total_nodes)));
+        }
+        row.setValue(total_depth_col, result.total_angle);
+        row.setValue(count_col, float(result.total_nodes));
+    }
 
-                // TODO: Break out miscs/dist/cumangle into local variables and remove from Point class
-                for (auto &point : map.getPoints()) {
-                    point.m_misc = 0;
-                    point.m_dist = 0.0f;
-                    point.m_cumangle = -1.0f;
-                }
+    map.setDisplayedAttribute(-2);
+    map.setDisplayedAttribute(mean_depth_col);
 
-                float total_angle = 0.0f;
-                int total_nodes = 0;
-
-                // note that m_misc is used in a different manner to analyseGraph / PointDepth
-                // here it marks the node as used in calculation only
-
-                std::set<AngularTriple> search_list;
-                search_list.insert(AngularTriple(0.0f, curs, NoPixel));
-                map.getPoint(curs).m_cumangle = 0.0f;
-                while (search_list.size()) {
-                    std::set<AngularTriple>::iterator it = search_list.begin();
-                    AngularTriple here = *it;
-                    search_list.erase(it);
-                    if (m_radius != -1.0 && here.angle > m_radius) {
-                        break;
-                    }
-                    Point &p = map.getPoint(here.pixel);
-                    // nb, the filled check is necessary as diagonals seem to be stored with 'gaps' left in
-                    if (p.filled() && p.m_misc != ~0) {
-                        p.getNode().extractAngular(search_list, &map, here);
-                        p.m_misc = ~0;
-                        if (!p.getMergePixel().empty()) {
-                            Point &p2 = map.getPoint(p.getMergePixel());
-                            if (p2.m_misc != ~0) {
-                                p2.m_cumangle = p.m_cumangle;
-                                p2.getNode().extractAngular(search_list, &map,
-                                                            AngularTriple(here.angle, p.getMergePixel(), NoPixel));
-                                p2.m_misc = ~0;
-                            }
-                        }
-                        total_angle += p.m_cumangle;
-                        total_nodes += 1;
-                    }
-                }
+    return true;
+}
 
-                AttributeRow &row = map.getAttributeTable().getRow(AttributeKey(curs));
-                if (total_nodes > 0) {
-                    row.setValue(mean_depth_col, float(double(total_angle) / double(total_nodes)));
-                }
-                row.setValue(total_depth_col, total_angle);
-                row.setValue(count_col, float(total_nodes));
+template <typename Queue>
+VGAAngular::OriginResult VGAAngular::traverse(const VisibilityGraph &graph, int origin, TraversalWorkspace &workspace,
+                                              Queue &search_list) const {
+    workspace.reset();
+    search_list.clear();
 
-                count++; // <- increment count
-            }
-            if (comm) {
-                if (qtimer(atime, 500)) {
-                    if (comm->IsCancelled()) {
-                        throw Communicator::CancelledException();
-                    }
-                    comm->CommPostMessage(Communicator::CURRENT_RECORD, count);
+    OriginResult result;
+    result.analysed = true;
+
+    // note that misc is used in a different manner to analyseGraph / PointDepth
+    // here it marks the node as used in calculation only
+
+    search_list.push(AngularTriple(0.0f, graph.pixel(origin), NoPixel));
+    workspace.cumangle(origin) = 0.0f;
+    while (!search_list.empty()) {
+        AngularTriple here = search_list.pop();
+        if (m_radius != -1.0 && here.angle > m_radius) {
+            break;
+        }
+        int node = graph.nodeAt(here.pixel);
+        int &pmisc = workspace.misc(node);
+        if (pmisc != ~0) {
+            graph.extractAngular(search_list, workspace, node, here);
+            pmisc = ~0;
+            int partner = graph.mergePartner(node);
+            if (partner != VisibilityGraph::NO_NODE) {
+                int &p2misc = workspace.misc(partner);
+                if (p2misc != ~0) {
+                    workspace.cumangle(partner) = workspace.cumangle(node);
+                    graph.extractAngular(search_list, workspace, partner,
+                                         AngularTriple(here.angle, graph.pixel(partner), NoPixel));
+                    p2misc = ~0;
                 }
             }
+            result.total_angle += workspace.cumangle(node);
+            result.total_nodes += 1;
         }
     }
-
-    map.setDisplayedAttribute(-2);
-    map.setDisplayedAttribute(mean_depth_col);
-
-    return true;
+    return result;
 }
@@ -21,14 +21,30 @@
 #include "salalib/ivga.h"
 #include "salalib/pixelref.h"
 #include "salalib/pointdata.h"
+#include "salalib/traversalworkspace.h"
+#include "salalib/visibilitygraph.h"
 
 class VGAAngular : IVGA {
   private:
     double m_radius;
     bool m_gates_only;
+    int m_threads;
+    bool m_set_queue;
+
+    struct OriginResult {
+        bool analysed = false;
+        float total_angle = 0.0f;
+        int total_nodes = 0;
+    };
+    template <typename Queue>
+    OriginResult traverse(const VisibilityGraph &graph, int origin, TraversalWorkspace &workspace,
+                          Queue &search_list) const;
 
   public:
     std::string getAnalysisName() const override { return "Angular Analysis"; }
     bool run(Communicator *, PointMap &map, bool) override;
-    VGAAngular(double radius, bool gates_only) : m_radius(radius), m_gates_only(gates_only) {}
+    // threads: number of worker threads, 0 for one per available core
+    // set_queue: use the original std::set search queue instead of the bucket queue
+    VGAAngular(double radius, bool gates_only, int threads = 1, bool set_queue = false)
+        : m_radius(radius), m_gates_only(gates_only), m_threads(threads), m_set_queue(set_queue) {}
 };
@@ -17,6 +17,9 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "salalib/vgamodules/vgaangulardepth.h"
+#include "salalib/traversalqueue.h"
+#include "salalib/traversalworkspace.h"
+#include "salalib/visibilitygraph.h"
 
 #include "genlib/stringutils.h"
 
@@ -27,45 +30,53 @@ bool VGAAngularDepth::run(Communicator *, PointMap &map, bool) {
     // n.b., insert columns sets values to -1 if the column already exists
     int path_angle_col = attributes.insertOrResetColumn("Angular Step Depth");
 
-    for (auto iter = attributes.begin(); iter != attributes.end(); iter++) {
-        PixelRef pix = iter->getKey().value;
-        map.getPoint(pix).m_misc = 0;
-        map.getPoint(pix).m_dist = 0.0f;
-        map.getPoint(pix).m_cumangle = -1.0f;
-    }
-
-    std::set<AngularTriple> search_list; // contains root point
+    const VisibilityGraph &graph = map.getVisibilityGraph();
+    TraversalWorkspace workspace(graph.nodeCount(), 0.0f, -1.0f);
 
-    for (auto &sel : map.getSelSet()) {
-        search_list.insert(AngularTriple(0.0f, sel, NoPixel));
-        map.getPoint(sel).m_cumangle = 0.0f;
-    }
+    auto traverse = [&](auto &search_list) {
+        for (auto &sel : map.getSelSet()) {
+            int node = graph.nodeAt(sel);
+            if (node == VisibilityGraph::NO_NODE) {
+                continue;
+            }
+            search_list.push(AngularTriple(0.0f, sel, NoPixel));
+            workspace.cumangle(node) = 0.0f;
+        }
 
-    // note that m_misc is used in a different manner to analyseGraph / PointDepth
-    // here it marks the node as used in calculation only
-    while (search_list.size()) {
-        std::set<AngularTriple>::iterator it = search_list.begin();
-        AngularTriple here = *it;
-        search_list.erase(it);
-        Point &p = map.getPoint(here.pixel);
-        // nb, the filled check is necessary as diagonals seem to be stored with 'gaps' left in
-        if (p.filled() && p.m_misc != ~0) {
-            p.getNode().extractAngular(search_list, &map, here);
-            p.m_misc = ~0;
-            AttributeRow &row = map.getAttributeTable().getRow(AttributeKey(here.pixel));
-            row.setValue(path_angle_col, float(p.m_cumangle));
-            if (!p.getMergePixel().empty()) {
-                Point &p2 = map.getPoint(p.getMergePixel());
-                if (p2.m_misc != ~0) {
-                    p2.m_cumangle = p.m_cumangle;
-                    AttributeRow &mergePixelRow = map.getAttributeTable().getRow(AttributeKey(p.getMergePixel()));
-                    mergePixelRow.setValue(path_angle_col, float(p2.m_cumangle));
-                    p2.getNode().extractAngular(search_list, &map,
-                                                AngularTriple(here.angle, p.getMergePixel(), NoPixel));
-                    p2.m_misc = ~0;
+        // note that misc is used in a different manner to analyseGraph / PointDepth
+        // here it marks the node as used in calculation only
+        while (!search_list.empty()) {
+            AngularTriple here = search_list.pop();
+            int node = graph.nodeAt(here.pixel);
+            int &pmisc = workspace.misc(node);
+            if (pmisc != ~0) {
+                graph.extractAngular(search_list, workspace, node, here);
+                pmisc = ~0;
+                AttributeRow &row = map.getAttributeTable().getRow(AttributeKey(here.pixel));
+                row.setValue(path_angle_col, float(workspace.cumangle(node)));
+                int partner = graph.mergePartner(node);
+                if (partner != VisibilityGraph::NO_NODE) {
+                    int &p2misc = workspace.misc(partner);
+                    if (p2misc != ~0) {
+                        PixelRef mergePixel = graph.pixel(partner);
+                        float &p2cumangle = workspace.cumangle(partner);
+                        p2cumangle = workspace.cumangle(node);
+                        AttributeRow &mergePixelRow = map.getAttributeTable().getRow(AttributeKey(mergePixel));
+                        mergePixelRow.setValue(path_angle_col, float(p2cumangle));
+                        graph.extractAngular(search_list, workspace, partner,
+                                             AngularTriple(here.angle, mergePixel, NoPixel));
+                        p2misc = ~0;
+                    }
                 }
             }
         }
+    };
+    if (m_set_queue) {
+        SetTraversalQueue<AngularTriple> search_list;
+        traverse(search_list);
+    } else {
+        BucketTraversalQueue<AngularTriple> search_list(ANGULAR_BUCKET_WIDTH);
+        traverse(search_list);
     }
 
     map.setDisplayedAttribute(-2);
@@ -23,7 +23,12 @@
 #include "salalib/pointdata.h"
 
 class VGAAngularDepth : IVGA {
+  private:
+    bool m_set_queue;
+
   public:
+    // set_queue: use the original std::set search queue instead of the bucket queue
+    VGAAngularDepth(bool set_queue = false) : m_set_queue(set_queue) {}
     std::string getAnalysisName() const override { return "Angular Depth"; }
     bool run(Communicator *comm, PointMap &map, bool) override;
 };
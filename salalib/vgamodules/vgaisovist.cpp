@@ -19,6 +19,7 @@
 #include "salalib/vgamodules/vgaisovist.h"
 #include "salalib/isovist.h"
 
+#include "genlib/parallelutils.h"
 #include "genlib/stringutils.h"
 
 bool VGAIsovist::run(Communicator *comm, PointMap &map, bool simple_version) {
@@ -29,67 +30,72 @@ bool VGAIsovist::run(Communicator *comm, PointMap &map, bool simple_version) {
         comm->CommPostMessage(Communicator::NUM_STEPS, 2);
         comm->CommPostMessage(Communicator::CURRENT_STEP, 1);
     }
-    BSPNode bspRoot = makeBSPtree(comm, map.getDrawingFiles());
+    FlatBSPTree ownTree;
+    if (!m_tree) {
+        ownTree = makeBSPtree(comm, map.getDrawingFiles());
+    }
+    const FlatBSPTree &bspTree = m_tree ? *m_tree : ownTree;
 
     AttributeTable &attributes = map.getAttributeTable();
 
     if(comm) comm->CommPostMessage(Communicator::CURRENT_STEP, 2);
 
-    time_t atime = 0;
     if (comm) {
-        qtimer(atime, 0);
         comm->CommPostMessage(Communicator::NUM_RECORDS, map.getFilledPointCount());
     }
-    int count = 0;
 
+    std::vector<PixelRef> origins;
     for (size_t i = 0; i < map.getCols(); i++) {
         for (size_t j = 0; j < map.getRows(); j++) {
             PixelRef curs = PixelRef(static_cast<short>(i), static_cast<short>(j));
-            if (map.getPoint(curs).filled()) {
-                count++;
-                if (map.getPoint(curs).contextfilled() && !curs.iseven()) {
-                    continue;
-                }
-                Isovist isovist;
-                isovist.makeit(&bspRoot, map.depixelate(curs), map.getRegion(), 0, 0);
-
-                AttributeRow &row = attributes.getRow(AttributeKey(curs));
-                isovist.setData(attributes, row, simple_version);
-                Node &node = map.getPoint(curs).getNode();
-                std::vector<PixelRef> *occ = node.m_occlusion_bins;
-                for (size_t k = 0; k < 32; k++) {
-                    occ[k].clear();
-                    node.bin(static_cast<int>(k)).setOccDistance(0.0f);
-                }
-                for (size_t k = 0; k < isovist.getOcclusionPoints().size(); k++) {
-                    const PointDist &pointdist = isovist.getOcclusionPoints().at(k);
-                    int bin = whichbin(pointdist.m_point - map.depixelate(curs));
-                    // only occlusion bins with a certain distance recorded (arbitrary scale note!)
-                    if (pointdist.m_dist > 1.5) {
-                        PixelRef pix = map.pixelate(pointdist.m_point);
-                        if (pix != curs) {
-                            occ[bin].push_back(pix);
-                        }
-                    }
-                    node.bin(bin).setOccDistance(static_cast<float>(pointdist.m_dist));
-                }
+            if (map.getPoint(curs).filled() && !(map.getPoint(curs).contextfilled() && !curs.iseven())) {
+                origins.push_back(curs);
             }
-            if (comm) {
-                if (qtimer(atime, 500)) {
-                    if (comm->IsCancelled()) {
-                        throw Communicator::CancelledException();
-                    }
-                    comm->CommPostMessage(Communicator::CURRENT_RECORD, count);
+        }
+    }
+
+    // The isovists only read the tree, and each one writes the occlusion bins of its own node,
+    // so they are made on all the workers at once, each reusing its own Isovist. The measures
+    // are written to the table afterwards, in the original order
+    size_t threads = depthmapX::getThreadCount(m_threads, origins.size());
+    std::vector<Isovist> isovists(threads);
+    std::vector<IsovistData> results(origins.size());
+    depthmapX::parallelFor(comm, threads, origins.size(), [&](size_t index, size_t threadIndex) {
+        PixelRef curs = origins[index];
+        Isovist &isovist = isovists[threadIndex];
+        isovist.makeit(bspTree, map.depixelate(curs), map.getRegion(), 0, 0);
+        results[index] = isovist.getData();
+
+        Node &node = map.getPoint(curs).getNode();
+        std::vector<PixelRef> *occ = node.m_occlusion_bins;
+        for (size_t k = 0; k < 32; k++) {
+            occ[k].clear();
+            node.bin(static_cast<int>(k)).setOccDistance(0.0f);
+        }
+        for (size_t k = 0; k < isovist.getOcclusionPoints().size(); k++) {
+            const PointDist &pointdist = isovist.getOcclusionPoints().at(k);
+            int bin = whichbin(pointdist.m_point - map.depixelate(curs));
+            // only occlusion bins with a certain distance recorded (arbitrary scale note!)
+            if (pointdist.m_dist > 1.5) {
+                PixelRef pix = map.pixelate(pointdist.m_point);
+                if (pix != curs) {
+                    occ[bin].push_back(pix);
                 }
             }
+            node.bin(bin).setOccDistance(static_cast<float>(pointdist.m_dist));
         }
+    });
+
+    for (size_t i = 0; i < origins.size(); i++) {
+        AttributeRow &row = attributes.getRow(AttributeKey(origins[i]));
+        results[i].write(attributes, row, simple_version);
     }
     map.m_hasIsovistAnalysis = true;
 
     return true;
 }
 
-BSPNode VGAIsovist::makeBSPtree(Communicator *communicator, const std::vector<SpacePixelFile>& drawingFiles) {
+FlatBSPTree VGAIsovist::makeBSPtree(Communicator *communicator, const std::vector<SpacePixelFile>& drawingFiles) {
     std::vector<TaggedLine> partitionlines;
     for (const auto &pixelGroup : drawingFiles) {
         for (const auto &pixel : pixelGroup.m_spacePixels) {
@@ -113,7 +119,7 @@ BSPNode VGAIsovist::makeBSPtree(Communicator *communicator, const std::vector<Sp
         }
     }
 
-    BSPNode bspRoot;
+    FlatBSPTree bspTree;
     if (partitionlines.size()) {
 
         time_t atime = 0;
@@ -122,8 +128,8 @@ BSPNode VGAIsovist::makeBSPtree(Communicator *communicator, const std::vector<Sp
             qtimer(atime, 0);
         }
 
-        BSPTree::make(communicator, atime, partitionlines, &bspRoot);
+        bspTree = BSPTree::make(communicator, atime, partitionlines);
     }
 
-    return bspRoot;
+    return bspTree;
 }
@@ -18,13 +18,21 @@
 
 #pragma once
 
+#include "genlib/bsptree.h"
 #include "salalib/ivga.h"
 #include "salalib/pixelref.h"
 #include "salalib/pointdata.h"
 
 class VGAIsovist : IVGA {
+  private:
+    int m_threads;
+    const FlatBSPTree *m_tree;
+
   public:
     std::string getAnalysisName() const override { return "Isovist Analysis"; }
     bool run(Communicator *comm, PointMap &map, bool simple_version) override;
-    BSPNode makeBSPtree(Communicator *communicator, const std::vector<SpacePixelFile> &drawingFiles);
+    FlatBSPTree makeBSPtree(Communicator *communicator, const std::vector<SpacePixelFile> &drawingFiles);
+    // threads: number of worker threads, 0 for one per available core
+    // tree: the BSP tree of the drawing, if it has already been made
+    VGAIsovist(int threads = 1, const FlatBSPTree *tree = nullptr) : m_threads(threads), m_tree(tree) {}
 };
@@ -17,16 +17,16 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "salalib/vgamodules/vgametric.h"
+#include "salalib/traversalqueue.h"
 
+#include "genlib/parallelutils.h"
 #include "genlib/stringutils.h"
 
 // This is a slow algorithm, but should give the correct answer
 // for demonstrative purposes
 
 bool VGAMetric::run(Communicator *comm, PointMap &map, bool) {
-    time_t atime = 0;
     if (comm) {
-        qtimer(atime, 0);
         comm->CommPostMessage(Communicator::NUM_RECORDS, map.getFilledPointCount());
     }
 
@@ -52,85 +52,87 @@ bool VGAMetric::run(Communicator *comm, PointMap &map, bool) {
     std::string count_col_text = std::string("Metric Node Count") + radius_text;
     int count_col = attributes.insertOrResetColumn(count_col_text.c_str());
 
-    int count = 0;
+    // every node is an origin, and the nodes are numbered in grid order
+    const VisibilityGraph &graph = map.getVisibilityGraph();
+    size_t nodeCount = graph.nodeCount();
 
-    for (size_t i = 0; i < map.getCols(); i++) {
-        for (size_t j = 0; j < map.getRows(); j++) {
-            PixelRef curs = PixelRef(static_cast<short>(i), static_cast<short>(j));
+    size_t threadCount = depthmapX::getThreadCount(m_threads, nodeCount);
+    std::vector<TraversalWorkspace> workspaces(threadCount, TraversalWorkspace(nodeCount));
+    std::vector<OriginResult> results(nodeCount);
 
-            if (map.getPoint(curs).filled()) {
+    auto traverseAll = [&](auto queues) {
+        depthmapX::parallelFor(comm, threadCount, nodeCount, [&](size_t idx, size_t threadIndex) {
+            if (m_gates_only) {
+                return;
+            }
+            results[idx] = traverse(map, graph, int(idx), workspaces[threadIndex], queues[threadIndex]);
+        });
+    };
+    if (m_set_queue) {
+        traverseAll(std::vector<SetTraversalQueue<MetricTriple>>(threadCount));
+    } else {
+        traverseAll(std::vector<BucketTraversalQueue<MetricTriple>>(
+            threadCount, BucketTraversalQueue<MetricTriple>(METRIC_BUCKET_WIDTH)));
+    }
 
-                if (m_gates_only) {
-                    count++;
-                    continue;
-                }
+    // results are written in grid order, whatever order they were calculated in
+    for (size_t idx = 0; idx < nodeCount; idx++) {
+        const OriginResult &result = results[idx];
+        if (!result.analysed) {
+            continue;
+        }
+        AttributeRow &row = attributes.getRow(AttributeKey(graph.pixel(int(idx))));
+        row.setValue(mspa_col, float(double(result.total_angle) / double(result.total_nodes)));
+        row.setValue(mspl_col, float(double(result.total_depth) / double(result.total_nodes)));
+        row.setValue(dist_col, float(double(result.euclid_depth) / double(result.total_nodes)));
+        row.setValue(count_col, float(result.total_nodes));
+    }
 
-                // TODO: Break out miscs/dist/cumangle into local variables and remove from Point class
-                for (auto &point : map.getPoints()) {
-                    point.m_misc = 0;
-                    point.m_dist = -1.0f;
-                    point.m_cumangle = 0.0f;
-                }
+    map.overrideDisplayedAttribute(-2);
+    map.setDisplayedAttribute(mspl_col);
 
-                float euclid_depth = 0.0f;
-                float total_depth = 0.0f;
-                float total_angle = 0.0f;
-                int total_nodes = 0;
-
-                // note that m_misc is used in a different manner to analyseGraph / PointDepth
-                // here it marks the node as used in calculation only
-
-                std::set<MetricTriple> search_list;
-                search_list.insert(MetricTriple(0.0f, curs, NoPixel));
-                while (search_list.size()) {
-                    std::set<MetricTriple>::iterator it = search_list.begin();
-                    MetricTriple here = *it;
-                    search_list.erase(it);
-                    if (m_radius != -1.0 && (here.dist * map.getSpacing()) > m_radius) {
-                        break;
-                    }
-                    Point &p = map.getPoint(here.pixel);
-                    // nb, the filled check is necessary as diagonals seem to be stored with 'gaps' left in
-                    if (p.filled() && p.m_misc != ~0) {
-                        p.getNode().extractMetric(search_list, &map, here);
-                        p.m_misc = ~0;
-                        if (!p.getMergePixel().empty()) {
-                            Point &p2 = map.getPoint(p.getMergePixel());
-                            if (p2.m_misc != ~0) {
-                                p2.m_cumangle = p.m_cumangle;
-                                p2.getNode().extractMetric(search_list, &map,
-                                                           MetricTriple(here.dist, p.getMergePixel(), NoPixel));
-                                p2.m_misc = ~0;
-                            }
-                        }
-                        total_depth += float(here.dist * map.getSpacing());
-                        total_angle += p.m_cumangle;
-                        euclid_depth += float(map.getSpacing() * dist(here.pixel, curs));
-                        total_nodes += 1;
-                    }
-                }
+    return true;
+}
 
-                AttributeRow &row = attributes.getRow(AttributeKey(curs));
-                row.setValue(mspa_col, float(double(total_angle) / double(total_nodes)));
-                row.setValue(mspl_col, float(double(total_depth) / double(total_nodes)));
-                row.setValue(dist_col, float(double(euclid_depth) / double(total_nodes)));
-                row.setValue(count_col, float(total_nodes));
+template <typename Queue>
+VGAMetric::OriginResult VGAMetric::traverse(PointMap &map, const VisibilityGraph &graph, int origin,
+                                            TraversalWorkspace &workspace, Queue &search_list) const {
+    workspace.reset();
+    search_list.clear();
 
-                count++; // <- increment count
-            }
-            if (comm) {
-                if (qtimer(atime, 500)) {
-                    if (comm->IsCancelled()) {
-                        throw Communicator::CancelledException();
-                    }
-                    comm->CommPostMessage(Communicator::CURRENT_RECORD, count);
+    OriginResult result;
+    result.analysed = true;
+
+    // note that misc is used in a different manner to analyseGraph / PointDepth
+    // here it marks the node as used in calculation only
+
+    PixelRef curs = graph.pixel(origin);
+    search_list.push(MetricTriple(0.0f, curs, NoPixel));
+    while (!search_list.empty()) {
+        MetricTriple here = search_list.pop();
+        if (m_radius != -1.0 && (here.dist * map.getSpacing()) > m_radius) {
+            break;
+        }
+        int node = graph.nodeAt(here.pixel);
+        int &pmisc = workspace.misc(node);
+        if (pmisc != ~0) {
+            graph.extractMetric(search_list, workspace, node, here);
+            pmisc = ~0;
+            int partner = graph.mergePartner(node);
+            if (partner != VisibilityGraph::NO_NODE) {
+                int &p2misc = workspace.misc(partner);
+                if (p2misc != ~0) {
+                    workspace.cumangle(partner) = workspace.cumangle(node);
+                    graph.extractMetric(search_list, workspace, partner,
+                                        MetricTriple(here.dist, graph.pixel(partner), NoPixel));
+                    p2misc = ~0;
                 }
             }
+            result.total_depth += float(here.dist * map.getSpacing());
+            result.total_angle += workspace.cumangle(node);
+            result.euclid_depth += float(map.getSpacing() * dist(here.pixel, curs));
+            result.total_nodes += 1;
         }
     }
-
-    map.overrideDisplayedAttribute(-2);
-    map.setDisplayedAttribute(mspl_col);
-
-    return true;
+    return result;
 }
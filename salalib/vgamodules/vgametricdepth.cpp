@@ -17,6 +17,9 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "salalib/vgamodules/vgametricdepth.h"
+#include "salalib/traversalqueue.h"
+#include "salalib/traversalworkspace.h"
+#include "salalib/visibilitygraph.h"
 
 #include "genlib/stringutils.h"
 
@@ -33,56 +36,62 @@ bool VGAMetricDepth::run(Communicator *, PointMap &map, bool) {
         dist_col = attributes.insertOrResetColumn("Metric Straight-Line Distance");
     }
 
-    for (auto iter = attributes.begin(); iter != attributes.end(); iter++) {
-        PixelRef pix = iter->getKey().value;
-        map.getPoint(pix).m_misc = 0;
-        map.getPoint(pix).m_dist = -1.0f;
-        map.getPoint(pix).m_cumangle = 0.0f;
-    }
+    const VisibilityGraph &graph = map.getVisibilityGraph();
+    TraversalWorkspace workspace(graph.nodeCount(), -1.0f, 0.0f);
 
     // in order to calculate Penn angle, the MetricPair becomes a metric triple...
-    std::set<MetricTriple> search_list; // contains root point
-
-    for (auto &sel : map.getSelSet()) {
-        search_list.insert(MetricTriple(0.0f, sel, NoPixel));
-    }
-
-    // note that m_misc is used in a different manner to analyseGraph / PointDepth
-    // here it marks the node as used in calculation only
-    while (search_list.size()) {
-        std::set<MetricTriple>::iterator it = search_list.begin();
-        MetricTriple here = *it;
-        search_list.erase(it);
-        Point &p = map.getPoint(here.pixel);
-        // nb, the filled check is necessary as diagonals seem to be stored with 'gaps' left in
-        if (p.filled() && p.m_misc != ~0) {
-            p.getNode().extractMetric(search_list, &map, here);
-            p.m_misc = ~0;
-            AttributeRow &row = map.getAttributeTable().getRow(AttributeKey(here.pixel));
-            row.setValue(path_length_col, float(map.getSpacing() * here.dist));
-            row.setValue(path_angle_col, float(p.m_cumangle));
-            if (map.getSelSet().size() == 1) {
-                // Note: Euclidean distance is currently only calculated from a single point
-                row.setValue(dist_col, float(map.getSpacing() * dist(here.pixel, *map.getSelSet().begin())));
+    auto traverse = [&](auto &search_list) {
+        for (auto &sel : map.getSelSet()) {
+            if (graph.nodeAt(sel) != VisibilityGraph::NO_NODE) {
+                search_list.push(MetricTriple(0.0f, sel, NoPixel));
             }
-            if (!p.getMergePixel().empty()) {
-                Point &p2 = map.getPoint(p.getMergePixel());
-                if (p2.m_misc != ~0) {
-                    p2.m_cumangle = p.m_cumangle;
-                    AttributeRow &mergePixelRow =
-                        map.getAttributeTable().getRow(AttributeKey(p.getMergePixel()));
-                    mergePixelRow.setValue(path_length_col, float(map.getSpacing() * here.dist));
-                    mergePixelRow.setValue(path_angle_col, float(p2.m_cumangle));
-                    if (map.getSelSet().size() == 1) {
-                        // Note: Euclidean distance is currently only calculated from a single point
-                        mergePixelRow.setValue(
-                            dist_col, float(map.getSpacing() * dist(p.getMergePixel(), *map.getSelSet().begin())));
+        }
+
+        // note that misc is used in a different manner to analyseGraph / PointDepth
+        // here it marks the node as used in calculation only
+        while (!search_list.empty()) {
+            MetricTriple here = search_list.pop();
+            int node = graph.nodeAt(here.pixel);
+            int &pmisc = workspace.misc(node);
+            if (pmisc != ~0) {
+                graph.extractMetric(search_list, workspace, node, here);
+                pmisc = ~0;
+                AttributeRow &row = map.getAttributeTable().getRow(AttributeKey(here.pixel));
+                row.setValue(path_length_col, float(map.getSpacing() * here.dist));
+                row.setValue(path_angle_col, float(workspace.cumangle(node)));
+                if (map.getSelSet().size() == 1) {
+                    // Note: Euclidean distance is currently only calculated from a single point
+                    row.setValue(dist_col, float(map.getSpacing() * dist(here.pixel, *map.getSelSet().begin())));
+                }
+                int partner = graph.mergePartner(node);
+                if (partner != VisibilityGraph::NO_NODE) {
+                    int &p2misc = workspace.misc(partner);
+                    if (p2misc != ~0) {
+                        PixelRef mergePixel = graph.pixel(partner);
+                        float &p2cumangle = workspace.cumangle(partner);
+                        p2cumangle = workspace.cumangle(node);
+                        AttributeRow &mergePixelRow = map.getAttributeTable().getRow(AttributeKey(mergePixel));
+                        mergePixelRow.setValue(path_length_col, float(map.getSpacing() * here.dist));
+                        mergePixelRow.setValue(path_angle_col, float(p2cumangle));
+                        if (map.getSelSet().size() == 1) {
+                            // Note: Euclidean distance is currently only calculated from a single point
+                            mergePixelRow.setValue(
+                                dist_col, float(map.getSpacing() * dist(mergePixel, *map.getSelSet().begin())));
+                        }
+                        graph.extractMetric(search_list, workspace, partner,
+                                            MetricTriple(here.dist, mergePixel, NoPixel));
+                        p2misc = ~0;
                     }
-                    p2.getNode().extractMetric(search_list, &map, MetricTriple(here.dist, p.getMergePixel(), NoPixel));
-                    p2.m_misc = ~0;
                 }
             }
         }
+    };
+    if (m_set_queue) {
+        SetTraversalQueue<MetricTriple> search_list;
+        traverse(search_list);
+    } else {
+        BucketTraversalQueue<MetricTriple> search_list(METRIC_BUCKET_WIDTH);
+        traverse(search_list);
     }
 
     map.setDisplayedAttribute(-2);
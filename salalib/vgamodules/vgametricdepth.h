@@ -23,7 +23,12 @@
 #include "salalib/pointdata.h"
 
 class VGAMetricDepth : IVGA {
+  private:
+    bool m_set_queue;
+
   public:
+    // set_queue: use the original std::set search queue instead of the bucket queue
+    VGAMetricDepth(bool set_queue = false) : m_set_queue(set_queue) {}
     std::string getAnalysisName() const override { return "Metric Depth"; }
     bool run(Communicator *, PointMap &map, bool) override;
 };
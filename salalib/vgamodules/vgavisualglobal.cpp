@@ -17,13 +17,33 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "salalib/vgamodules/vgavisualglobal.h"
+#include "salalib/resultwriter.h"
+#include "salalib/visibilitygraph.h"
 
+#include "genlib/parallelutils.h"
 #include "genlib/stringutils.h"
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+namespace {
+    inline int lowestBit(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(bits);
+#else
+        int bit = 0;
+        while (!(bits & 1)) {
+            bits >>= 1;
+            bit++;
+        }
+        return bit;
+#endif
+    }
+} // namespace
+
 bool VGAVisualGlobal::run(Communicator *comm, PointMap &map, bool simple_version) {
-    time_t atime = 0;
     if (comm) {
-        qtimer(atime, 0);
         comm->CommPostMessage(Communicator::NUM_RECORDS, map.getFilledPointCount());
     }
     AttributeTable &attributes = map.getAttributeTable();
@@ -62,179 +82,299 @@ bool VGAVisualGlobal::run(Communicator *comm, PointMap &map, bool simple_version
     }
 #endif
 
-    int count = 0;
+    // every node is an origin: they are handed out to the workers, and the results are then
+    // written out in node order, which is the order a single-threaded run would use
+    const VisibilityGraph &graph = map.getVisibilityGraph();
+    size_t nodeCount = graph.nodeCount();
+    std::vector<OriginResult> results(nodeCount);
 
-    depthmapX::RowMatrix<int> miscs(map.getRows(), map.getCols());
-    depthmapX::RowMatrix<PixelRef> extents(map.getRows(), map.getCols());
-
-    for (size_t i = 0; i < map.getCols(); i++) {
-        for (size_t j = 0; j < map.getRows(); j++) {
-            PixelRef curs = PixelRef(i, j);
-            if (map.getPoint(curs).filled()) {
-
-                if ((map.getPoint(curs).contextfilled() && !curs.iseven()) || (m_gates_only)) {
-                    count++;
-                    continue;
-                }
+    // the multi-source traversal turns down the few maps it cannot reproduce exactly
+    if (!m_multi_source || !traverseMultiSource(comm, graph, results)) {
+        // every worker owns a workspace so that origins can be traversed concurrently
+        size_t threadCount = depthmapX::getThreadCount(m_threads, nodeCount);
+        std::vector<TraversalWorkspace> workspaces(threadCount, TraversalWorkspace(nodeCount));
+        depthmapX::parallelFor(comm, threadCount, nodeCount, [&](size_t idx, size_t threadIndex) {
+            if (graph.contextOdd(int(idx)) || (m_gates_only)) {
+                return;
+            }
+            results[idx] = traverse(graph, int(idx), workspaces[threadIndex]);
+        });
+    }
 
-                for (size_t ii = 0; ii < map.getCols(); ii++) {
-                    for (size_t jj = 0; jj < map.getRows(); jj++) {
-                        miscs(jj, ii) = 0;
-                        extents(jj, ii) = PixelRef(ii, jj);
-                    }
-                }
+    // the results go into the columns in bulk, so that the column stats are worked out once at the end
+    ResultWriter writer(attributes);
+    for (int col : {entropy_col, rel_entropy_col, integ_dv_col, integ_pv_col, integ_tk_col, depth_col, count_col}) {
+        if (col != -1) {
+            writer.addColumn(ColumnHandle(size_t(col)));
+        }
+    }
 
-                int total_depth = 0;
-                int total_nodes = 0;
-
-                std::vector<int> distribution;
-                std::vector<PixelRefVector> search_tree;
-                search_tree.push_back(PixelRefVector());
-                search_tree.back().push_back(curs);
-
-                int level = 0;
-                while (search_tree[level].size()) {
-                    search_tree.push_back(PixelRefVector());
-                    const PixelRefVector &searchTreeAtLevel = search_tree[level];
-                    distribution.push_back(0);
-                    for (auto currLvlIter = searchTreeAtLevel.rbegin(); currLvlIter != searchTreeAtLevel.rend();
-                         currLvlIter++) {
-                        int &pmisc = miscs(currLvlIter->y, currLvlIter->x);
-                        Point &p = map.getPoint(*currLvlIter);
-                        if (p.filled() && pmisc != ~0) {
-                            total_depth += level;
-                            total_nodes += 1;
-                            distribution.back() += 1;
-                            if ((int)m_radius == -1 ||
-                                (level < (int)m_radius &&
-                                    (!p.contextfilled() || currLvlIter->iseven()))) {
-                                extractUnseen(p.getNode(), search_tree[level + 1], miscs, extents);
-                                pmisc = ~0;
-                                if (!p.getMergePixel().empty()) {
-                                    PixelRef mergePixel = p.getMergePixel();
-                                    int &p2misc = miscs(mergePixel.y, mergePixel.x);
-                                    Point &p2 = map.getPoint(mergePixel);
-                                    if (p2misc != ~0) {
-                                        extractUnseen(p2.getNode(), search_tree[level + 1], miscs,
-                                                      extents); // did say p.misc
-                                        p2misc = ~0;
-                                    }
-                                }
-                            } else {
-                                pmisc = ~0;
-                            }
-                        }
-                        search_tree[level].pop_back();
-                    }
-                    level++;
-                }
-                AttributeRow &row = attributes.getRow(AttributeKey(curs));
-                // only set to single float precision after divide
-                // note -- total_nodes includes this one -- mean depth as per p.108 Social Logic of Space
+    for (size_t idx = 0; idx < nodeCount; idx++) {
+        const OriginResult &result = results[idx];
+        if (!result.analysed) {
+            continue;
+        }
+        int total_depth = result.total_depth;
+        int total_nodes = result.total_nodes;
+        size_t position = writer.getRowPosition(AttributeKey(graph.pixel(int(idx))));
+        auto setValue = [&writer, position](int col, float value) {
+            writer.setValue(position, ColumnHandle(size_t(col)), value);
+        };
+        // only set to single float precision after divide
+        // note -- total_nodes includes this one -- mean depth as per p.108 Social Logic of Space
+        if (!simple_version) {
+            setValue(count_col, float(total_nodes)); // note: total nodes includes this one
+        }
+        // ERROR !!!!!!
+        if (total_nodes > 1) {
+            double mean_depth = double(total_depth) / double(total_nodes - 1);
+            if (!simple_version) {
+                setValue(depth_col, float(mean_depth));
+            }
+            // total nodes > 2 to avoid divide by 0 (was > 3)
+            if (total_nodes > 2 && mean_depth > 1.0) {
+                double ra = 2.0 * (mean_depth - 1.0) / double(total_nodes - 2);
+                // d-value / p-values from Depthmap 4 manual, note: node_count includes this one
+                double rra_d = ra / dvalue(total_nodes);
+                double rra_p = ra / pvalue(total_nodes);
+                double integ_tk = teklinteg(total_nodes, total_depth);
+                setValue(integ_dv_col, float(1.0 / rra_d));
                 if (!simple_version) {
-                    row.setValue(count_col, float(total_nodes)); // note: total nodes includes this one
+                    setValue(integ_pv_col, float(1.0 / rra_p));
                 }
-                // ERROR !!!!!!
-                if (total_nodes > 1) {
-                    double mean_depth = double(total_depth) / double(total_nodes - 1);
-                    if (!simple_version) {
-                        row.setValue(depth_col, float(mean_depth));
-                    }
-                    // total nodes > 2 to avoid divide by 0 (was > 3)
-                    if (total_nodes > 2 && mean_depth > 1.0) {
-                        double ra = 2.0 * (mean_depth - 1.0) / double(total_nodes - 2);
-                        // d-value / p-values from Depthmap 4 manual, note: node_count includes this one
-                        double rra_d = ra / dvalue(total_nodes);
-                        double rra_p = ra / pvalue(total_nodes);
-                        double integ_tk = teklinteg(total_nodes, total_depth);
-                        row.setValue(integ_dv_col, float(1.0 / rra_d));
-                        if (!simple_version) {
-                            row.setValue(integ_pv_col, float(1.0 / rra_p));
-                        }
-                        if (total_depth - total_nodes + 1 > 1) {
-                            if (!simple_version) {
-                                row.setValue(integ_tk_col, float(integ_tk));
-                            }
-                        } else {
-                            if (!simple_version) {
-                                row.setValue(integ_tk_col, -1.0f);
-                            }
-                        }
-                    } else {
-                        row.setValue(integ_dv_col, (float)-1);
-                        if (!simple_version) {
-                            row.setValue(integ_pv_col, (float)-1);
-                            row.setValue(integ_tk_col, (float)-1);
-                        }
-                    }
-                    double entropy = 0.0, rel_entropy = 0.0, factorial = 1.0;
-                    // n.b., this distribution contains the root node itself in distribution[0]
-                    // -> chopped from entropy to avoid divide by zero if only one node
-                    for (size_t k = 1; k < distribution.size(); k++) {
-                        if (distribution[k] > 0) {
-                            double prob = double(distribution[k]) / double(total_nodes - 1);
-                            entropy -= prob * pafLog2(prob);
-                            // Formula from Turner 2001, "Depthmap"
-                            factorial *= double(k + 1);
-                            double q = (pow(mean_depth, double(k)) / double(factorial)) * exp(-mean_depth);
-                            rel_entropy += (float)prob * pafLog2(prob / q);
-                        }
-                    }
+                if (total_depth - total_nodes + 1 > 1) {
                     if (!simple_version) {
-                        row.setValue(entropy_col, float(entropy));
-                        row.setValue(rel_entropy_col, float(rel_entropy));
+                        setValue(integ_tk_col, float(integ_tk));
                     }
                 } else {
                     if (!simple_version) {
-                        row.setValue(depth_col, (float)-1);
-                        row.setValue(entropy_col, (float)-1);
-                        row.setValue(rel_entropy_col, (float)-1);
+                        setValue(integ_tk_col, -1.0f);
                     }
                 }
-                count++; // <- increment count
-                if (comm) {
-                    if (qtimer(atime, 500)) {
-                        if (comm->IsCancelled()) {
-                            throw Communicator::CancelledException();
+            } else {
+                setValue(integ_dv_col, (float)-1);
+                if (!simple_version) {
+                    setValue(integ_pv_col, (float)-1);
+                    setValue(integ_tk_col, (float)-1);
+                }
+            }
+            if (!simple_version) {
+                setValue(entropy_col, float(result.entropy));
+                setValue(rel_entropy_col, float(result.rel_entropy));
+            }
+        } else {
+            if (!simple_version) {
+                setValue(depth_col, (float)-1);
+                setValue(entropy_col, (float)-1);
+                setValue(rel_entropy_col, (float)-1);
+            }
+        }
+    }
+    writer.commit();
+    map.setDisplayedAttribute(integ_dv_col);
+
+    return true;
+}
+
+VGAVisualGlobal::OriginResult VGAVisualGlobal::traverse(const VisibilityGraph &graph, int origin,
+                                                        TraversalWorkspace &workspace) const {
+    workspace.reset();
+
+    int total_depth = 0;
+    int total_nodes = 0;
+
+    std::vector<int> distribution;
+    std::vector<std::vector<int>> search_tree;
+    search_tree.push_back(std::vector<int>());
+    search_tree.back().push_back(origin);
+
+    int level = 0;
+    while (search_tree[level].size()) {
+        search_tree.push_back(std::vector<int>());
+        const std::vector<int> &searchTreeAtLevel = search_tree[level];
+        distribution.push_back(0);
+        for (auto currLvlIter = searchTreeAtLevel.rbegin(); currLvlIter != searchTreeAtLevel.rend();
+             currLvlIter++) {
+            int node = *currLvlIter;
+            int &pmisc = workspace.misc(node);
+            if (pmisc != ~0) {
+                total_depth += level;
+                total_nodes += 1;
+                distribution.back() += 1;
+                if ((int)m_radius == -1 || (level < (int)m_radius && !graph.contextOdd(node))) {
+                    graph.extractUnseen(search_tree[level + 1], workspace, node);
+                    pmisc = ~0;
+                    int partner = graph.mergePartner(node);
+                    if (partner != VisibilityGraph::NO_NODE) {
+                        int &p2misc = workspace.misc(partner);
+                        if (p2misc != ~0) {
+                            graph.extractUnseen(search_tree[level + 1], workspace, partner); // did say p.misc
+                            p2misc = ~0;
                         }
-                        comm->CommPostMessage(Communicator::CURRENT_RECORD, count);
                     }
+                } else {
+                    pmisc = ~0;
                 }
             }
+            search_tree[level].pop_back();
         }
+        level++;
     }
-    for (size_t i = 0; i < map.getCols(); i++) {
-        for (size_t j = 0; j < map.getRows(); j++) {
-            PixelRef curs = PixelRef(static_cast<short>(i), static_cast<short>(j));
-            map.getPoint(curs).m_misc = miscs(j, i);
-            map.getPoint(curs).m_extent = extents(j, i);
+
+    return summarise(total_depth, total_nodes, distribution);
+}
+
+VGAVisualGlobal::OriginResult VGAVisualGlobal::summarise(int total_depth, int total_nodes,
+                                                         const std::vector<int> &distribution) {
+    OriginResult result;
+    result.analysed = true;
+    result.total_depth = total_depth;
+    result.total_nodes = total_nodes;
+    if (total_nodes > 1) {
+        double mean_depth = double(total_depth) / double(total_nodes - 1);
+        double entropy = 0.0, rel_entropy = 0.0, factorial = 1.0;
+        // n.b., this distribution contains the root node itself in distribution[0]
+        // -> chopped from entropy to avoid divide by zero if only one node
+        for (size_t k = 1; k < distribution.size(); k++) {
+            if (distribution[k] > 0) {
+                double prob = double(distribution[k]) / double(total_nodes - 1);
+                entropy -= prob * pafLog2(prob);
+                // Formula from Turner 2001, "Depthmap"
+                factorial *= double(k + 1);
+                double q = (pow(mean_depth, double(k)) / double(factorial)) * exp(-mean_depth);
+                rel_entropy += (float)prob * pafLog2(prob / q);
+            }
         }
+        result.entropy = entropy;
+        result.rel_entropy = rel_entropy;
     }
-    map.setDisplayedAttribute(integ_dv_col);
-
-    return true;
+    return result;
 }
 
-void VGAVisualGlobal::extractUnseen(Node &node, PixelRefVector &pixels, depthmapX::RowMatrix<int> &miscs,
-                                    depthmapX::RowMatrix<PixelRef> &extents) {
-    for (int i = 0; i < 32; i++) {
-        Bin &bin = node.bin(i);
-        for (auto pixVec : bin.m_pixel_vecs) {
-            for (PixelRef pix = pixVec.start(); pix.col(bin.m_dir) <= pixVec.end().col(bin.m_dir);) {
-                int &misc = miscs(pix.y, pix.x);
-                PixelRef &extent = extents(pix.y, pix.x);
-                if (misc == 0) {
-                    pixels.push_back(pix);
-                    misc |= (1 << i);
+bool VGAVisualGlobal::traverseMultiSource(Communicator *comm, const VisibilityGraph &graph,
+                                          std::vector<OriginResult> &results) const {
+    // each node carries a mask of batchWords 64-bit words, one bit per origin of the batch;
+    // the wider the batch, the more origins share each scan of a node's neighbours
+    const size_t batchWords = 4;
+    const size_t batchSize = batchWords * 64;
+    const int noPartner = VisibilityGraph::NO_NODE;
+    int radius = int(m_radius);
+    int nodeCount = int(graph.nodeCount());
+
+    std::vector<int> sources;
+    for (int n = 0; n < nodeCount; n++) {
+        bool contextOdd = graph.contextOdd(n);
+        if (!contextOdd && !m_gates_only) {
+            sources.push_back(n);
+        }
+        int partner = graph.mergePartner(n);
+        // the order in which traverse() meets the two halves of a merged pair only stops
+        // mattering when both halves always expand alike
+        if (partner != noPartner && radius != -1 && (contextOdd || graph.contextOdd(partner))) {
+            return false;
+        }
+    }
+
+    struct BatchMasks {
+        std::vector<uint64_t> seen;
+        std::vector<uint64_t> frontier;
+        std::vector<uint64_t> next;
+    };
+    size_t batches = (sources.size() + batchSize - 1) / batchSize;
+    size_t threadCount = depthmapX::getThreadCount(m_threads, batches);
+    std::vector<BatchMasks> masks(threadCount);
+
+    if (comm) {
+        comm->CommPostMessage(Communicator::NUM_RECORDS, int(batches));
+    }
+    depthmapX::parallelFor(comm, threadCount, batches, [&](size_t batch, size_t threadIndex) {
+        BatchMasks &batchMasks = masks[threadIndex];
+        std::vector<uint64_t> &seen = batchMasks.seen;
+        std::vector<uint64_t> &frontier = batchMasks.frontier;
+        std::vector<uint64_t> &next = batchMasks.next;
+        seen.assign(size_t(nodeCount) * batchWords, 0);
+        frontier.assign(seen.size(), 0);
+        next.assign(seen.size(), 0);
+
+        size_t first = batch * batchSize;
+        size_t count = std::min(batchSize, sources.size() - first);
+        for (size_t b = 0; b < count; b++) {
+            size_t word = size_t(sources[first + b]) * batchWords + b / 64;
+            frontier[word] |= uint64_t(1) << (b % 64);
+            seen[word] |= uint64_t(1) << (b % 64);
+        }
+
+        auto expand = [&](int n, const uint64_t *bits) {
+            for (size_t edge = graph.edgesBegin(n); edge < graph.edgesEnd(n); edge++) {
+                uint64_t *target = &next[size_t(graph.neighbour(edge)) * batchWords];
+                for (size_t w = 0; w < batchWords; w++) {
+                    target[w] |= bits[w];
+                }
+            }
+        };
+
+        std::vector<int> total_depth(batchSize, 0);
+        std::vector<int> total_nodes(batchSize, 0);
+        std::vector<std::vector<int>> distributions;
+        for (int level = 0;; level++) {
+            distributions.emplace_back(batchSize, 0);
+            std::vector<int> &distribution = distributions.back();
+            for (int n = 0; n < nodeCount; n++) {
+                uint64_t bits[batchWords];
+                bool any = false;
+                bool expandable = radius == -1 || (level < radius && !graph.contextOdd(n));
+                int partner = graph.mergePartner(n);
+                for (size_t w = 0; w < batchWords; w++) {
+                    bits[w] = frontier[size_t(n) * batchWords + w];
+                    // both halves of a merged pair reached at once only count once, and the
+                    // first half takes care of the other
+                    if (expandable && partner != noPartner && partner < n) {
+                        bits[w] &= ~frontier[size_t(partner) * batchWords + w];
+                    }
+                    any |= (bits[w] != 0);
+                }
+                if (!any) {
+                    continue;
+                }
+                for (size_t w = 0; w < batchWords; w++) {
+                    for (uint64_t rest = bits[w]; rest; rest &= rest - 1) {
+                        size_t b = w * 64 + size_t(lowestBit(rest));
+                        total_depth[b] += level;
+                        total_nodes[b] += 1;
+                        distribution[b] += 1;
+                    }
                 }
-                // 10.2.02 revised --- diagonal was breaking this as it was extent in diagonal or horizontal
-                if (!(bin.m_dir & PixelRef::DIAGONAL)) {
-                    if (extent.col(bin.m_dir) >= pixVec.end().col(bin.m_dir))
-                        break;
-                    extent.col(bin.m_dir) = pixVec.end().col(bin.m_dir);
+                if (expandable) {
+                    expand(n, bits);
+                    // a merged pixel's partner is traversed as if it were the same pixel
+                    if (partner != noPartner) {
+                        expand(partner, bits);
+                        for (size_t w = 0; w < batchWords; w++) {
+                            seen[size_t(partner) * batchWords + w] |= bits[w];
+                        }
+                    }
                 }
-                pix.move(bin.m_dir);
+            }
+            bool reached = false;
+            for (size_t word = 0; word < next.size(); word++) {
+                uint64_t fresh = next[word] & ~seen[word];
+                seen[word] |= fresh;
+                frontier[word] = fresh;
+                next[word] = 0;
+                reached |= (fresh != 0);
+            }
+            if (!reached) {
+                break;
             }
         }
-    }
+
+        std::vector<int> distribution(distributions.size());
+        for (size_t b = 0; b < count; b++) {
+            for (size_t level = 0; level < distributions.size(); level++) {
+                distribution[level] = distributions[level][b];
+            }
+            results[size_t(sources[first + b])] = summarise(total_depth[b], total_nodes[b], distribution);
+        }
+    });
+    return true;
 }
@@ -21,18 +21,37 @@
 #include "salalib/ivga.h"
 #include "salalib/pixelref.h"
 #include "salalib/pointdata.h"
-
-#include "genlib/simplematrix.h"
+#include "salalib/traversalworkspace.h"
+#include "salalib/visibilitygraph.h"
 
 class VGAVisualGlobal : IVGA {
   private:
     double m_radius;
     bool m_gates_only;
+    int m_threads;
+    bool m_multi_source;
+
+    // per-origin totals, gathered by the workers and written to the attribute table afterwards
+    struct OriginResult {
+        bool analysed = false;
+        int total_depth = 0;
+        int total_nodes = 0;
+        double entropy = 0.0;
+        double rel_entropy = 0.0;
+    };
+    OriginResult traverse(const VisibilityGraph &graph, int origin, TraversalWorkspace &workspace) const;
+    // the same results as traverse() for all the nodes, traversing from up to 256 of them
+    // together (bit-parallel multi-source BFS); returns false, having done nothing, for the
+    // maps with merged pixels where it could not give identical results
+    bool traverseMultiSource(Communicator *comm, const VisibilityGraph &graph,
+                             std::vector<OriginResult> &results) const;
+    static OriginResult summarise(int total_depth, int total_nodes, const std::vector<int> &distribution);
 
   public:
     std::string getAnalysisName() const override { return "Global Visibility Analysis"; }
     bool run(Communicator *comm, PointMap &map, bool simple_version) override;
-    void extractUnseen(Node &node, PixelRefVector &pixels, depthmapX::RowMatrix<int> &miscs,
-                       depthmapX::RowMatrix<PixelRef> &extents);
-    VGAVisualGlobal(double radius, bool gates_only) : m_radius(radius), m_gates_only(gates_only) {}
+    // threads: number of worker threads, 0 for one per available core
+    // multi_source: use the bit-parallel traversal where the map allows it
+    VGAVisualGlobal(double radius, bool gates_only, int threads = 1, bool multi_source = false)
+        : m_radius(radius), m_gates_only(gates_only), m_threads(threads), m_multi_source(multi_source) {}
 };
@@ -17,6 +17,8 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "salalib/vgamodules/vgavisualglobaldepth.h"
+#include "salalib/traversalworkspace.h"
+#include "salalib/visibilitygraph.h"
 
 #include "genlib/stringutils.h"
 
@@ -27,42 +29,44 @@ bool VGAVisualGlobalDepth::run(Communicator *, PointMap &map, bool) {
     // n.b., insert columns sets values to -1 if the column already exists
     int col = attributes.insertOrResetColumn("Visual Step Depth");
 
-    for (auto iter = attributes.begin(); iter != attributes.end(); iter++) {
-        PixelRef pix = iter->getKey().value;
-        map.getPoint(pix).m_misc = 0;
-        map.getPoint(pix).m_extent = pix;
-    }
+    const VisibilityGraph &graph = map.getVisibilityGraph();
+    TraversalWorkspace workspace(graph.nodeCount());
 
-    std::vector<PixelRefVector> search_tree;
-    search_tree.push_back(PixelRefVector());
+    std::vector<std::vector<int>> search_tree;
+    search_tree.push_back(std::vector<int>());
     for (auto &sel : map.getSelSet()) {
-        // need to convert from ints (m_selection_set) to pixelrefs for this op:
-        search_tree.back().push_back(sel);
+        // need to convert from pixelrefs (m_selection_set) to nodes for this op:
+        int node = graph.nodeAt(sel);
+        if (node != VisibilityGraph::NO_NODE) {
+            search_tree.back().push_back(node);
+        }
     }
 
     size_t level = 0;
     while (search_tree[level].size()) {
-        search_tree.push_back(PixelRefVector());
-        const PixelRefVector& searchTreeAtLevel = search_tree[level];
+        search_tree.push_back(std::vector<int>());
+        const std::vector<int> &searchTreeAtLevel = search_tree[level];
         for (auto currLvlIter = searchTreeAtLevel.rbegin(); currLvlIter != searchTreeAtLevel.rend(); currLvlIter++) {
-            Point &p = map.getPoint(*currLvlIter);
-            if (p.filled() && p.m_misc != ~0) {
-                AttributeRow &row = attributes.getRow(AttributeKey(*currLvlIter));
+            int node = *currLvlIter;
+            int &pmisc = workspace.misc(node);
+            if (pmisc != ~0) {
+                AttributeRow &row = attributes.getRow(AttributeKey(graph.pixel(node)));
                 row.setValue(col, float(level));
-                if (!p.contextfilled() || currLvlIter->iseven() || level == 0) {
-                    p.getNode().extractUnseen(search_tree[level + 1], &map);
-                    p.m_misc = ~0;
-                    if (!p.getMergePixel().empty()) {
-                        Point &p2 = map.getPoint(p.getMergePixel());
-                        if (p2.m_misc != ~0) {
-                            AttributeRow &mergePixelRow = attributes.getRow(AttributeKey(p.getMergePixel()));
+                if (!graph.contextOdd(node) || level == 0) {
+                    graph.extractUnseen(search_tree[level + 1], workspace, node);
+                    pmisc = ~0;
+                    int partner = graph.mergePartner(node);
+                    if (partner != VisibilityGraph::NO_NODE) {
+                        int &p2misc = workspace.misc(partner);
+                        if (p2misc != ~0) {
+                            AttributeRow &mergePixelRow = attributes.getRow(AttributeKey(graph.pixel(partner)));
                             mergePixelRow.setValue(col, float(level));
-                            p2.getNode().extractUnseen(search_tree[level + 1], &map); // did say p.misc
-                            p2.m_misc = ~0;
+                            graph.extractUnseen(search_tree[level + 1], workspace, partner); // did say p.misc
+                            p2misc = ~0;
                         }
                     }
                 } else {
-                    p.m_misc = ~0;
+                    pmisc = ~0;
                 }
             }
         }
@@ -75,27 +79,3 @@ bool VGAVisualGlobalDepth::run(Communicator *, PointMap &map, bool) {
 
     return true;
 }
-
-void VGAVisualGlobalDepth::extractUnseen(Node &node, PixelRefVector &pixels, depthmapX::RowMatrix<int> &miscs,
-                   depthmapX::RowMatrix<PixelRef> &extents) {
-    for (int i = 0; i < 32; i++) {
-        Bin &bin = node.bin(i);
-        for (auto pixVec : bin.m_pixel_vecs) {
-            for (PixelRef pix = pixVec.start(); pix.col(bin.m_dir) <= pixVec.end().col(bin.m_dir);) {
-                int &misc = miscs(pix.y, pix.x);
-                PixelRef &extent = extents(pix.y, pix.x);
-                if (misc == 0) {
-                    pixels.push_back(pix);
-                    misc |= (1 << i);
-                }
-                // 10.2.02 revised --- diagonal was breaking this as it was extent in diagonal or horizontal
-                if (!(bin.m_dir & PixelRef::DIAGONAL)) {
-                    if (extent.col(bin.m_dir) >= pixVec.end().col(bin.m_dir))
-                        break;
-                    extent.col(bin.m_dir) = pixVec.end().col(bin.m_dir);
-                }
-                pix.move(bin.m_dir);
-            }
-        }
-    }
-}
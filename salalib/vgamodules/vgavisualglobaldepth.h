@@ -22,12 +22,8 @@
 #include "salalib/pixelref.h"
 #include "salalib/pointdata.h"
 
-#include "genlib/simplematrix.h"
-
 class VGAVisualGlobalDepth : IVGA {
   public:
     std::string getAnalysisName() const override { return "Global Visibility Depth"; }
     bool run(Communicator *comm, PointMap &map, bool simple_version) override;
-    void extractUnseen(Node &node, PixelRefVector &pixels, depthmapX::RowMatrix<int> &miscs,
-                       depthmapX::RowMatrix<PixelRef> &extents);
 };
@@ -0,0 +1,64 @@
+// sala - a component of the depthmapX - spatial network analysis platform
+// Copyright (C) 2026, Tasos Varoudis
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "salalib/visibilitygraph.h"
+
+VisibilityGraph::VisibilityGraph(PointMap &map)
+    : m_rows(map.getRows()), m_cols(map.getCols()), m_node_at(m_rows * m_cols, NO_NODE) {
+    for (size_t i = 0; i < m_cols; i++) {
+        for (size_t j = 0; j < m_rows; j++) {
+            PixelRef curs = PixelRef(static_cast<short>(i), static_cast<short>(j));
+            Point &p = map.getPoint(curs);
+            if (p.filled() && p.hasNode()) {
+                m_node_at[j * m_cols + i] = int(m_pixels.size());
+                m_pixels.push_back(curs);
+            }
+        }
+    }
+
+    m_merge_partners.reserve(m_pixels.size());
+    m_flags.reserve(m_pixels.size());
+    m_offsets.reserve(m_pixels.size() + 1);
+    m_offsets.push_back(0);
+    for (PixelRef curs : m_pixels) {
+        Point &p = map.getPoint(curs);
+        m_merge_partners.push_back(p.getMergePixel().empty() ? NO_NODE : nodeAt(p.getMergePixel()));
+        unsigned char flags = 0;
+        if (p.blocked() || map.blockedAdjacent(curs)) {
+            flags |= BOUNDARY;
+        }
+        if (p.contextfilled() && !curs.iseven()) {
+            flags |= CONTEXT_ODD;
+        }
+        m_flags.push_back(flags);
+
+        Node &node = p.getNode();
+        for (int b = 0; b < 32; b++) {
+            const Bin &bin = node.bin(b);
+            for (const PixelVec &pixVec : bin.m_pixel_vecs) {
+                for (PixelRef pix = pixVec.start(); pix.col(bin.m_dir) <= pixVec.end().col(bin.m_dir);
+                     pix.move(bin.m_dir)) {
+                    int neighbour = nodeAt(pix);
+                    if (neighbour != NO_NODE) {
+                        m_neighbours.push_back(neighbour);
+                        m_bins.push_back(static_cast<unsigned char>(b));
+                    }
+                }
+            }
+        }
+        m_offsets.push_back(m_neighbours.size());
+    }
+}
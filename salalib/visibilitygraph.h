@@ -0,0 +1,143 @@
+// sala - a component of the depthmapX - spatial network analysis platform
+// Copyright (C) 2026, Tasos Varoudis
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "salalib/pixelref.h"
+#include "salalib/pointdata.h"
+#include "salalib/traversalworkspace.h"
+
+#include <math.h>
+#include <vector>
+
+// A read-only snapshot of the visibility graph of a PointMap in compressed sparse row form,
+// for the analyses that walk the graph. Every filled point with a node gets a dense id, in
+// the order the analyses visit the grid (column by column), and the nodes each one can see
+// are stored contiguously: bin by bin, and within a bin in the order its runs hold them,
+// together with the bin they are in. Cells that are not nodes (diagonal runs can have
+// unfilled 'gaps' in them) are left out. PointMap::getVisibilityGraph() builds the snapshot
+// the first time it is asked for and keeps it until the graph changes.
+
+class VisibilityGraph {
+  public:
+    static constexpr int NO_NODE = -1;
+
+    VisibilityGraph(PointMap &map);
+
+    size_t nodeCount() const { return m_pixels.size(); }
+    PixelRef pixel(int node) const { return m_pixels[size_t(node)]; }
+    // NO_NODE for cells outside the grid and cells that are not nodes
+    int nodeAt(PixelRef p) const {
+        if (p.x < 0 || p.y < 0 || size_t(p.x) >= m_cols || size_t(p.y) >= m_rows) {
+            return NO_NODE;
+        }
+        return m_node_at[size_t(p.y) * m_cols + size_t(p.x)];
+    }
+
+    // the edges of a node are [edgesBegin(node), edgesEnd(node))
+    size_t edgesBegin(int node) const { return m_offsets[size_t(node)]; }
+    size_t edgesEnd(int node) const { return m_offsets[size_t(node) + 1]; }
+    int neighbour(size_t edge) const { return m_neighbours[edge]; }
+    int bin(size_t edge) const { return m_bins[edge]; }
+
+    // the node this one is merged with, or NO_NODE
+    int mergePartner(int node) const { return m_merge_partners[size_t(node)]; }
+    // blocked, or next to a blocked cell: the metric and angular traversals only carry on
+    // through such nodes, as elsewhere the straight line past them is always shorter
+    bool onBoundary(int node) const { return (m_flags[size_t(node)] & BOUNDARY) != 0; }
+    // the in-between nodes of a context filled area, which radius limited traversals do not
+    // carry on through
+    bool contextOdd(int node) const { return (m_flags[size_t(node)] & CONTEXT_ODD) != 0; }
+
+    // The expansion steps of the visual, metric and angular traversals: the nodes seen from
+    // node are added to the search list unless the workspace already marks them as used
+    void extractUnseen(std::vector<int> &nodes, TraversalWorkspace &workspace, int node) const;
+    // Queue is one of the traversal queues in traversalqueue.h
+    template <typename Queue>
+    void extractMetric(Queue &pixels, TraversalWorkspace &workspace, int node, const MetricTriple &curs) const;
+    template <typename Queue>
+    void extractAngular(Queue &pixels, TraversalWorkspace &workspace, int node, const AngularTriple &curs) const;
+
+  private:
+    enum { BOUNDARY = 0x01, CONTEXT_ODD = 0x02 };
+
+    size_t m_rows;
+    size_t m_cols;
+    std::vector<int> m_node_at;
+    std::vector<PixelRef> m_pixels;
+    std::vector<int> m_merge_partners;
+    std::vector<unsigned char> m_flags;
+    std::vector<size_t> m_offsets;
+    std::vector<int> m_neighbours;
+    std::vector<unsigned char> m_bins;
+};
+
+inline void VisibilityGraph::extractUnseen(std::vector<int> &nodes, TraversalWorkspace &workspace,
+                                           int node) const {
+    for (size_t edge = edgesBegin(node); edge < edgesEnd(node); edge++) {
+        int next = m_neighbours[edge];
+        int &misc = workspace.misc(next);
+        if (misc == 0) {
+            nodes.push_back(next);
+            misc |= (1 << m_bins[edge]);
+        }
+    }
+}
+
+template <typename Queue>
+void VisibilityGraph::extractMetric(Queue &pixels, TraversalWorkspace &workspace, int node,
+                                    const MetricTriple &curs) const {
+    if (curs.dist != 0.0f && !onBoundary(node)) {
+        return;
+    }
+    for (size_t edge = edgesBegin(node); edge < edgesEnd(node); edge++) {
+        int next = m_neighbours[edge];
+        PixelRef pix = m_pixels[size_t(next)];
+        float &ptdist = workspace.dist(next);
+        if (workspace.misc(next) == 0 && (ptdist == -1.0 || (curs.dist + dist(pix, curs.pixel) < ptdist))) {
+            ptdist = curs.dist + (float)dist(pix, curs.pixel);
+            // n.b. dmap v4.06r now sets angle in range 0 to 4 (1 = 90 degrees)
+            workspace.cumangle(next) =
+                workspace.cumangle(node) +
+                (curs.lastpixel == NoPixel ? 0.0f : (float)(angle(pix, curs.pixel, curs.lastpixel) / (M_PI * 0.5)));
+            pixels.push(MetricTriple(ptdist, pix, curs.pixel));
+        }
+    }
+}
+
+// based on metric
+
+template <typename Queue>
+void VisibilityGraph::extractAngular(Queue &pixels, TraversalWorkspace &workspace, int node,
+                                     const AngularTriple &curs) const {
+    if (curs.angle != 0.0f && !onBoundary(node)) {
+        return;
+    }
+    for (size_t edge = edgesBegin(node); edge < edgesEnd(node); edge++) {
+        int next = m_neighbours[edge];
+        if (workspace.misc(next) == 0) {
+            PixelRef pix = m_pixels[size_t(next)];
+            // n.b. dmap v4.06r now sets angle in range 0 to 4 (1 = 90 degrees)
+            float ang =
+                (curs.lastpixel == NoPixel) ? 0.0f : (float)(angle(pix, curs.pixel, curs.lastpixel) / (M_PI * 0.5));
+            float &cumangle = workspace.cumangle(next);
+            if (cumangle == -1.0 || curs.angle + ang < cumangle) {
+                cumangle = workspace.cumangle(node) + ang;
+                pixels.push(AngularTriple(cumangle, pix, curs.pixel));
+            }
+        }
+    }
+}